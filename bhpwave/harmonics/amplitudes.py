@@ -60,6 +60,19 @@ class HarmonicAmplitudes:
         
         return self.amplitude_generator.amplitude(l, m, a, r)*np.exp(1.j*self.amplitude_generator.phase(l, m, a, r))
     
+    def preload(self, select_modes = None):
+        """
+        Loads harmonic modes ahead of their first use. Modes are otherwise read and interpolated
+        the first time that they are evaluated, so that only the modes that are used are loaded
+
+        :param select_modes: The :math:`(l,m)` modes to load. The default setting loads all modes
+        :type select_modes: list or array[tuple(double, double)], optional
+        """
+        if select_modes is None:
+            self.amplitude_generator.preload()
+        else:
+            self.amplitude_generator.preload([mode[0] for mode in select_modes], [mode[1] for mode in select_modes])
+
     @property
     def base_class(self):
         """
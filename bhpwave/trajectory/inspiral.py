@@ -3,6 +3,7 @@ from bhpwaveformcy import (TrajectoryDataPy,
                            InspiralGeneratorPy)
 from bhpwave.constants import *
 from bhpwave.trajectory.geodesic import kerr_circ_geo_orbital_frequency
+import numpy as np
 import os
 
 path_to_file = os.path.dirname(os.path.abspath(__file__))
@@ -61,6 +62,28 @@ class InspiralGenerator:
 
         return inspiral
 
+    def initial_radius(self, M, mu, a, T, num_threads=0):
+        """
+        The initial Boyer-Lindquist radius from which the small body reaches the ISCO
+        after a time T, the inverse of TrajectoryData.time_to_merger. Durations longer
+        than the interpolation range allows give the largest radius of the range.
+
+        :param M: the mass of the rotating massive black hole (in solar masses)
+        :type M: double or numpy array
+        :param mu: the mass of the smaller compact object (in solar masses)
+        :type mu: double or numpy array
+        :param a: Kerr spin parameter
+        :type a: double or numpy array
+        :param T: time to merger in years
+        :type T: double or numpy array
+
+        :return: the initial radius, with the broadcast shape of the parameters
+        :rtype: double or numpy array
+        """
+        massratio = np.divide(mu, M)
+        TM = np.multiply(T, yr_MKS)/np.multiply(M, Modot_GC1_to_S)
+        return self.inspiral_generator.initial_radius(massratio, a, TM, num_threads)
+
 class TrajectoryData:
     """
     A class that holds all of the pre-computed trajectory data
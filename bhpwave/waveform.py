@@ -60,12 +60,16 @@ class KerrCircularWaveform:
     :type trajectory_data: TrajectoryData or None, optional
     :param harmonic_data: a HarmonicAmplitudes class which holds interpolants of the harmonic mode amplitudes
     :type harmonic_data: HarmonicAmplitudes or None, optional
-    :param num_threads: the number of threads used to evaluate the waveform
+    :param num_threads: the number of threads used to evaluate the waveform. The default (None or 0) draws threads from a pool shared with the other waveform calls of the process, which split it evenly when they run at the same time
     :type num_threads: int or None, optional
+    :param phase_tolerance: if positive, the inspiral is interpolated from sparse nodes to within this error (in radians) in the orbital phase
+    :type phase_tolerance: double, optional
+    :param segment_steps: if positive, the inspiral is generated and summed into the waveform in segments of this many time steps, which bounds the memory used for long waveforms
+    :type segment_steps: int, optional
     """
-    def __init__(self, trajectory_data=None, harmonic_data=None, num_threads=None):
+    def __init__(self, trajectory_data=None, harmonic_data=None, num_threads=None, phase_tolerance=0., segment_steps=0):
         if num_threads is None:
-            num_threads = CPU_MAX
+            num_threads = 0
         if trajectory_data is None:
             self.trajectory_data = TrajectoryDataPy(filename=traj_path, dealloc_flag=False)
         else:
@@ -76,7 +80,9 @@ class KerrCircularWaveform:
             self.harmonic_data = harmonic_data.base_class
 
         waveform_kwargs = {
-            "num_threads": num_threads
+            "num_threads": num_threads,
+            "phase_tolerance": phase_tolerance,
+            "segment_steps": segment_steps
         }
 
         self.waveform_generator = WaveformGeneratorPy(self.trajectory_data, self.harmonic_data, waveform_kwargs=waveform_kwargs)
@@ -148,6 +154,10 @@ class KerrCircularWaveform:
         :type return_list: bool, optional
         :param include_negative_m: True returns the sum of the positive and negative m-modes for each mode in select_modes
         :type include_negative_m: bool, optional
+        :param phase_tolerance: overrides the phase tolerance of the sparse inspiral for this waveform
+        :type phase_tolerance: double, optional
+        :param segment_steps: overrides the number of time steps per inspiral segment for this waveform
+        :type segment_steps: int, optional
         
         :rtype: 1d-array[complex] or list[two 1d-arrays[double]]
 
@@ -183,6 +193,50 @@ class KerrCircularWaveform:
             h = self.waveform_generator.waveform(M, mu, a, r0, dist, qS, phiS, qK, phiK, Phi_phi0, dt, T, **kwargs)
         return h
     
+    def multirate(self, M, mu, a, r0, dist, qS, phiS, qK, phiK, Phi_phi0, dt=10., dt_max=100., T=1., samples_per_cycle=8., **kwargs):
+        """
+        Calculate the complex gravitational wave strain on a piecewise-uniform time grid, which samples
+        the waveform more sparsely early in the inspiral, when its frequency is low
+
+        :param M: mass (in solar masses) of the massive black hole
+        :type M: double
+        :param mu: mass (in solar masses) of the (smaller) stellar-mass compact object
+        :type mu: double
+        :param a: dimensionless black hole spin
+        :type a: double
+        :param r0: initial orbital separation of the two objects
+        :type r0: double
+        :param dist: luminosity distance to the source in Gpc
+        :type dist: double
+        :param qS: polar angle of the source's sky location
+        :type qS: double
+        :param phiS: azimuthal angle of the source's sky location
+        :type phiS: double
+        :param qK: polar angle of the Kerr spin vector
+        :type qK: double
+        :param phiK: azimuthal angle of the Kerr spin vector
+        :type phiK: double
+        :param Phi_phi0: Initial azimuthal position of the small compact object
+        :type Phi_phi0: double
+        :param dt: Smallest spacing of time samples in seconds, which is also the spacing of the uniform grid
+        :type dt: double, optional
+        :param dt_max: Largest spacing of time samples in seconds
+        :type dt_max: double, optional
+        :param T: Duration of the waveform in years
+        :type T: double, optional
+        :param samples_per_cycle: Smallest number of samples per cycle of the highest-frequency harmonic
+        :type samples_per_cycle: double, optional
+
+        :param return_list: True returns the plus and cross polarizations of the waveform as separate ndarrays
+        :type return_list: bool, optional
+
+        :return: the waveform at the samples, and the sampling, whose time attribute holds the times of the samples and whose resample method interpolates the waveform to the uniform grid
+        :rtype: tuple(1d-array[complex] or list[two 1d-arrays[double]], MultirateSamplingPy)
+
+        """
+
+        return self.waveform_generator.waveform_multirate(M, mu, a, r0, dist, qS, phiS, qK, phiK, Phi_phi0, dt, dt_max, T, samples_per_cycle, **kwargs)
+
     def harmonics(self, M, mu, a, r0, dist, qS, phiS, qK, phiK, Phi_phi0, dt=10., T=1., **kwargs):
         """
         Calculate the spin-weighted spherical harmonic modes of the gravitational wave strain
@@ -397,7 +451,7 @@ class KerrWaveform(KerrCircularWaveform):
     :type trajectory_data: TrajectoryData or None, optional
     :param harmonic_data: a HarmonicAmplitudes class which holds interpolants of the harmonic mode amplitudes
     :type harmonic_data: HarmonicAmplitudes or None, optional
-    :param num_threads: the number of threads used to evaluate the waveform
+    :param num_threads: the number of threads used to evaluate the waveform. The default (None or 0) draws threads from a pool shared with the other waveform calls of the process, which split it evenly when they run at the same time
     :type num_threads: int or None, optional  
     """
     def __call__(self, M, mu, a, p0, e0, x0, dist, qS, phiS, qK, phiK, Phi_phi0, Phi_r0, Phi_theta0, dt=10., T=1., **kwargs):
@@ -570,12 +624,12 @@ class KerrCircularFrequencyWaveform:
     :type trajectory_data: TrajectoryData or None, optional
     :param harmonic_data: a HarmonicAmplitudes class which holds interpolants of the harmonic mode amplitudes
     :type harmonic_data: HarmonicAmplitudes or None, optional
-    :param num_threads: the number of threads used to evaluate the waveform
+    :param num_threads: the number of threads used to evaluate the waveform. The default (None or 0) draws threads from a pool shared with the other waveform calls of the process, which split it evenly when they run at the same time
     :type num_threads: int or None, optional
     """
     def __init__(self, trajectory_data=None, harmonic_data=None, num_threads=None):
         if num_threads is None:
-            num_threads = CPU_MAX
+            num_threads = 0
         if trajectory_data is None:
             self.trajectory_data = TrajectoryDataPy(filename=traj_path, dealloc_flag=False)
         else:
@@ -986,7 +1040,7 @@ class KerrFrequencyWaveform(KerrCircularFrequencyWaveform):
     :type trajectory_data: TrajectoryData or None, optional
     :param harmonic_data: a HarmonicAmplitudes class which holds interpolants of the harmonic mode amplitudes
     :type harmonic_data: HarmonicAmplitudes or None, optional
-    :param num_threads: the number of threads used to evaluate the waveform
+    :param num_threads: the number of threads used to evaluate the waveform. The default (None or 0) draws threads from a pool shared with the other waveform calls of the process, which split it evenly when they run at the same time
     :type num_threads: int or None, optional  
     """
     def __call__(self, M, mu, a, p0, e0, x0, dist, qS, phiS, qK, phiK, Phi_phi0, Phi_r0, Phi_theta0, dt=10., T = 1., df = None, fmax = None, frequencies = None, **kwargs):
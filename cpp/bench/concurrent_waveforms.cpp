@@ -0,0 +1,106 @@
+// Times N independent time-domain waveforms generated at once from N user
+// threads with one shared WaveformGenerator, for N = 1 up to the number of
+// cores, with every call asking for all of the cores (so that N calls start N
+// full teams of threads) and with every call drawing its threads from the
+// shared pool of execution_context.hpp, and reports the throughput of both
+// relative to a single waveform, with the largest number of pool threads in
+// use at once, which stays at the pool size for N calls on N cores. Build from the repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -fno-math-errno -Icpp/include cpp/bench/concurrent_waveforms.cpp
+//       cpp/src/waveform.cpp cpp/src/harmonics.cpp cpp/src/trajectory.cpp cpp/src/swsh.cpp cpp/src/spline.cpp -lgsl -lgslcblas -o concurrent_waveforms
+//
+// and run as ./concurrent_waveforms [trajectory file] [harmonic file base] [waveforms per thread]
+
+#include "waveform.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <atomic>
+
+#define BENCH_MASS 1.e6
+#define BENCH_SPIN 0.9
+#define BENCH_RADIUS 10.
+#define BENCH_DT 10.
+#define BENCH_DURATION 0.5
+
+// seconds to generate waveformsPerThread waveforms on each of threadNum user
+// threads, all with num_threads threads per call. Every waveform has its own
+// small mass, so no two of them share an inspiral. peakThreads is the largest
+// number of pool threads in use during the calls
+static double time_concurrent(WaveformGenerator &gen, int threadNum, int waveformsPerThread, int num_threads, int &peakThreads){
+	WaveformHarmonicOptions wOpts = gen.getWaveformHarmonicOptions();
+	wOpts.num_threads = num_threads;
+	HarmonicOptions hOpts = gen.getHarmonicOptions();
+	std::vector<std::thread> threads;
+	std::atomic<bool> running(true);
+	peakThreads = 0;
+	std::thread monitor([&running, &peakThreads](){
+		while(running.load()){
+			peakThreads = std::max(peakThreads, ExecutionContext::getThreadsInUse());
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	});
+	StopWatch watch;
+	watch.start();
+	for(int n = 0; n < threadNum; n++){
+		threads.push_back(std::thread([&gen, &wOpts, &hOpts, n, waveformsPerThread](){
+			for(int k = 0; k < waveformsPerThread; k++){
+				double mu = 10. + 0.01*(n*waveformsPerThread + k);
+				int steps = gen.computeTimeStepNumber(BENCH_MASS, mu, BENCH_SPIN, BENCH_RADIUS, BENCH_DT, BENCH_DURATION);
+				WaveformContainer h(steps);
+				gen.computeWaveform(h, BENCH_MASS, mu, BENCH_SPIN, BENCH_RADIUS, 1., 0.5, 0.4, 0.3, 0.2, 0.1, BENCH_DT, BENCH_DURATION, hOpts, wOpts);
+			}
+		}));
+	}
+	for(int n = 0; n < threadNum; n++){
+		threads[n].join();
+	}
+	watch.stop();
+	running.store(false);
+	monitor.join();
+	return watch.time();
+}
+
+int main(int argc, char *argv[]){
+	std::string trajectory_file = "bhpwave/data/trajectory.txt";
+	std::string harmonic_file_base = "bhpwave/data/circ_data";
+	int waveformsPerThread = 4;
+	if(argc > 1){
+		trajectory_file = argv[1];
+	}
+	if(argc > 2){
+		harmonic_file_base = argv[2];
+	}
+	if(argc > 3){
+		waveformsPerThread = atoi(argv[3]);
+	}
+
+	std::vector<int> lmodes;
+	std::vector<int> mmodes;
+	for(int l = 2; l <= 15; l++){
+		for(int m = 1; m <= l; m++){
+			lmodes.push_back(l);
+			mmodes.push_back(m);
+		}
+	}
+	TrajectorySpline2D traj(trajectory_file);
+	HarmonicAmplitudes harm(lmodes, mmodes, harmonic_file_base);
+	WaveformGenerator gen(traj, harm);
+	gen.getInspiralGenerator().setInspiralCacheBytes(0);
+
+	int cores = ExecutionContext::getPoolSize();
+	int peak;
+	// the first waveform builds the slices, which are not part of the timing
+	time_concurrent(gen, 1, 1, cores, peak);
+	double single = time_concurrent(gen, 1, waveformsPerThread, cores, peak);
+
+	printf("%d waveforms per user thread, %d cores (time in s, throughput relative to one user thread)\n", waveformsPerThread, cores);
+	printf("  user threads   all cores per call   throughput   shared pool   throughput   peak pool threads\n");
+	for(int n = 1; n <= cores; n++){
+		double oversubscribed = time_concurrent(gen, n, waveformsPerThread, cores, peak);
+		double shared = time_concurrent(gen, n, waveformsPerThread, 0, peak);
+		printf("  %12d   %18.3f   %10.2f   %11.3f   %10.2f   %17d\n", n, oversubscribed, n*single/oversubscribed, shared, n*single/shared, peak);
+	}
+
+	return 0;
+}
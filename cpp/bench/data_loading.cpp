@@ -0,0 +1,160 @@
+// Times the loading of the harmonic amplitude files and the trajectory file,
+// with the buffered parser used by the readers and with the line-by-line
+// stream parser they used before, and reports the peak resident memory.
+// Build from the repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -Icpp/include cpp/bench/data_loading.cpp
+//       cpp/src/harmonics.cpp cpp/src/trajectory.cpp cpp/src/swsh.cpp cpp/src/spline.cpp -lgsl -lgslcblas -o data_loading
+//
+// and run as ./data_loading [trajectory file] [harmonic file base] [lmax]
+
+#include "harmonics.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+
+static double peak_rss_mb(){
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss/1024.;
+}
+
+// the stream-based reader that read_harmonic_mode_data replaced
+static HarmonicModeData read_harmonic_mode_data_stream(int L, int m, std::string filepath_base){
+	std::string filepath = filepath_base + "_" + std::to_string(L) + "_" + std::to_string(m) + ".txt";
+	std::ifstream inFile(filepath);
+	std::istringstream lin;
+	std::string line;
+	std::getline(inFile, line);
+	while(line.empty() || line[0] == '#' || isalpha(line[0])){
+		std::getline(inFile, line);
+	}
+	lin.str(line);
+	int chiSample, alphaSample;
+	lin >> chiSample >> alphaSample;
+	HarmonicModeData mode;
+	mode.chi.resize(chiSample);
+	mode.alpha.resize(alphaSample);
+	int i = 0;
+	double chi, alpha, Alm, Philm;
+	while(std::getline(inFile, line)){
+		lin.clear();
+		lin.str(line);
+		if(lin >> chi >> alpha >> Alm >> Philm){
+			if(i % alphaSample == 0){
+				mode.chi[i/alphaSample] = chi;
+			}
+			if(i < alphaSample){
+				mode.alpha[i] = alpha;
+			}
+			mode.A.push_back(log(Alm));
+			mode.Phi.push_back(Philm);
+			i++;
+		}
+	}
+	return mode;
+}
+
+static double compare_modes(const HarmonicModeData &a, const HarmonicModeData &b){
+	double difference = (a.A.size() == b.A.size()) ? 0. : 1.;
+	for(size_t i = 0; i < a.A.size() && i < b.A.size(); i++){
+		difference = std::max(difference, fabs(a.A[i] - b.A[i]) + fabs(a.Phi[i] - b.Phi[i]));
+	}
+	return difference;
+}
+
+int main(int argc, char *argv[]){
+	std::string trajectory_file = "bhpwave/data/trajectory.txt";
+	std::string harmonic_file_base = "bhpwave/data/circ_data";
+	int lmax = 15;
+	if(argc > 1){
+		trajectory_file = argv[1];
+	}
+	if(argc > 2){
+		harmonic_file_base = argv[2];
+	}
+	if(argc > 3){
+		lmax = atoi(argv[3]);
+	}
+
+	std::vector<int> lmodes;
+	std::vector<int> mmodes;
+	for(int l = 2; l <= lmax; l++){
+		for(int m = 1; m <= l; m++){
+			lmodes.push_back(l);
+			mmodes.push_back(m);
+		}
+	}
+	int modeNum = lmodes.size();
+	std::vector<HarmonicModeData> modes(modeNum);
+
+	StopWatch streamWatch;
+	streamWatch.start();
+	for(int k = 0; k < modeNum; k++){
+		modes[k] = read_harmonic_mode_data_stream(lmodes[k], mmodes[k], harmonic_file_base);
+	}
+	streamWatch.stop();
+
+	StopWatch serialWatch;
+	double difference = 0.;
+	serialWatch.start();
+	for(int k = 0; k < modeNum; k++){
+		HarmonicModeData mode = read_harmonic_mode_data(lmodes[k], mmodes[k], harmonic_file_base);
+		difference = std::max(difference, compare_modes(mode, modes[k]));
+	}
+	serialWatch.stop();
+
+	StopWatch parallelWatch;
+	parallelWatch.start();
+	#pragma omp parallel for schedule(dynamic)
+	for(int k = 0; k < modeNum; k++){
+		modes[k] = read_harmonic_mode_data(lmodes[k], mmodes[k], harmonic_file_base);
+	}
+	parallelWatch.stop();
+	modes.clear();
+	double rssParse = peak_rss_mb();
+
+	// modes load on their first request, so the construction only indexes them
+	StopWatch lazyWatch;
+	lazyWatch.start();
+	HarmonicAmplitudes *harm = new HarmonicAmplitudes(lmodes, mmodes, harmonic_file_base);
+	lazyWatch.stop();
+	StopWatch firstModeWatch;
+	firstModeWatch.start();
+	harm->amplitude(2, 2, 0.5, 0.5);
+	firstModeWatch.stop();
+	StopWatch harmonicWatch;
+	harmonicWatch.start();
+	harm->preload();
+	harmonicWatch.stop();
+	double rssHarmonic = peak_rss_mb();
+	delete harm;
+
+	StopWatch trajectoryDataWatch;
+	trajectoryDataWatch.start();
+	TrajectoryData trajData = read_trajectory_data(trajectory_file);
+	trajectoryDataWatch.stop();
+
+	StopWatch trajectoryWatch;
+	trajectoryWatch.start();
+	TrajectorySpline2D traj(trajectory_file);
+	trajectoryWatch.stop();
+	double rssTrajectory = peak_rss_mb();
+
+	printf("Loading %d harmonic files (%s) and %s\n", modeNum, harmonic_file_base.c_str(), trajectory_file.c_str());
+	printf("                                                 time (ms)   peak RSS (MB)\n");
+	printf("  harmonic files, stream parser, serial       %10.2f\n", 1.e3*streamWatch.time());
+	printf("  harmonic files, buffered parser, serial     %10.2f\n", 1.e3*serialWatch.time());
+	printf("  harmonic files, buffered parser, parallel   %10.2f   %13.1f\n", 1.e3*parallelWatch.time(), rssParse);
+	printf("  HarmonicAmplitudes, construction            %10.2f\n", 1.e3*lazyWatch.time());
+	printf("  HarmonicAmplitudes, first (2, 2) request    %10.2f\n", 1.e3*firstModeWatch.time());
+	printf("  HarmonicAmplitudes, preload of all modes    %10.2f   %13.1f\n", 1.e3*harmonicWatch.time(), rssHarmonic);
+	printf("  read_trajectory_data                        %10.2f\n", 1.e3*trajectoryDataWatch.time());
+	printf("  TrajectorySpline2D                          %10.2f   %13.1f\n", 1.e3*trajectoryWatch.time(), rssTrajectory);
+	printf("  largest difference between the parsers      %10.3e\n", difference);
+	if(trajData.t.size() == 0){
+		printf("  (no trajectory data)\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,138 @@
+// Times the scalar and the array versions of the circular-orbit functions in
+// trajectory.hpp, in ns per point, on random points of the trajectory domain,
+// together with the array queries of TrajectorySpline2D and the array time,
+// phase and dt/domega of a TrajectorySlice against loops over their scalar
+// methods.
+// Build from the repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -fno-math-errno -Icpp/include cpp/bench/kerr_math.cpp
+//       cpp/src/trajectory.cpp cpp/src/spline.cpp -lgsl -lgslcblas -o kerr_math
+//
+// and run as ./kerr_math [trajectory file] [repeats]
+
+#include "trajectory.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+#define BENCH_POINTS 4096
+#define BENCH_A_MAX 0.9999
+#define BENCH_OMEGA_MIN 2.e-3
+
+// ns per point of repeats calls of f, which evaluates all BENCH_POINTS points
+static double time_points(std::function<void()> f, int repeats){
+	f();
+	StopWatch watch;
+	watch.start();
+	for(int r = 0; r < repeats; r++){
+		f();
+	}
+	watch.stop();
+	return 1.e9*watch.time()/repeats/BENCH_POINTS;
+}
+
+static void print_times(const char *name, double scalar, double array){
+	printf("  %-46s %10.2f %10.2f %8.1fx\n", name, scalar, array, scalar/array);
+}
+
+int main(int argc, char *argv[]){
+	std::string trajectory_file = "bhpwave/data/trajectory.txt";
+	int repeats = 2000;
+	if(argc > 1){
+		trajectory_file = argv[1];
+	}
+	if(argc > 2){
+		repeats = atoi(argv[2]);
+	}
+
+	int n = BENCH_POINTS;
+	Vector a(n), omega(n), oISCO(n), radius(n), alpha(n), chi(n), out(n);
+	unsigned long long state = 1;
+	for(int i = 0; i < n; i++){
+		double u[3];
+		for(int k = 0; k < 3; k++){
+			state = state*6364136223846793005ULL + 1442695040888963407ULL;
+			u[k] = (state >> 11)*(1./9007199254740992.);
+		}
+		a[i] = BENCH_A_MAX*(2.*u[0] - 1.);
+		oISCO[i] = kerr_isco_frequency(a[i]);
+		omega[i] = BENCH_OMEGA_MIN + u[1]*(oISCO[i] - BENCH_OMEGA_MIN);
+		radius[i] = kerr_isco_radius(a[i]) + 50.*u[2];
+		alpha[i] = u[2];
+		chi[i] = u[1];
+	}
+	double aFixed = 0.9;
+	double oISCOFixed = kerr_isco_frequency(aFixed);
+
+	printf("ns per point (%d points, %d repeats)               scalar      array  speedup\n", n, repeats);
+	print_times("kerr_geo_azimuthal_frequency_circ_time",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = kerr_geo_azimuthal_frequency_circ_time(a[i], radius[i]); } }, repeats),
+		time_points([&](){ kerr_geo_azimuthal_frequency_circ_time(out.data(), a.data(), radius.data(), n); }, repeats));
+	print_times("kerr_isco_frequency",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = kerr_isco_frequency(a[i]); } }, repeats),
+		time_points([&](){ kerr_isco_frequency(out.data(), a.data(), n); }, repeats));
+	print_times("alpha_of_a_omega",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = alpha_of_a_omega(a[i], omega[i], oISCO[i]); } }, repeats),
+		time_points([&](){ alpha_of_a_omega(out.data(), omega.data(), oISCO.data(), n); }, repeats));
+	print_times("omega_of_a_alpha",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = omega_of_a_alpha(a[i], alpha[i], oISCO[i]); } }, repeats),
+		time_points([&](){ omega_of_a_alpha(out.data(), alpha.data(), oISCO.data(), n); }, repeats));
+	print_times("spin_of_chi",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = spin_of_chi(chi[i]); } }, repeats),
+		time_points([&](){ spin_of_chi(out.data(), chi.data(), n); }, repeats));
+	print_times("chi_of_spin",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = chi_of_spin(a[i]); } }, repeats),
+		time_points([&](){ chi_of_spin(out.data(), a.data(), n); }, repeats));
+	print_times("kerr_geo_denergy_domega_circ",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = kerr_geo_denergy_domega_circ(a[i], omega[i]); } }, repeats),
+		time_points([&](){ kerr_geo_denergy_domega_circ(out.data(), a.data(), omega.data(), n); }, repeats));
+	print_times("normalize_energy_flux",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = normalize_energy_flux(omega[i]); } }, repeats),
+		time_points([&](){ normalize_energy_flux(out.data(), omega.data(), n); }, repeats));
+	print_times("normalize_time",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = normalize_time(omega[i], oISCOFixed); } }, repeats),
+		time_points([&](){ normalize_time(out.data(), omega.data(), oISCOFixed, n); }, repeats));
+	print_times("normalize_phase",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = normalize_phase(omega[i], oISCOFixed); } }, repeats),
+		time_points([&](){ normalize_phase(out.data(), omega.data(), oISCOFixed, n); }, repeats));
+	print_times("normalize_time_domega",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = normalize_time_domega(omega[i]); } }, repeats),
+		time_points([&](){ normalize_time_domega(out.data(), omega.data(), n); }, repeats));
+	print_times("normalize_phase_domega",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = normalize_phase_domega(omega[i]); } }, repeats),
+		time_points([&](){ normalize_phase_domega(out.data(), omega.data(), n); }, repeats));
+
+	TrajectorySpline2D traj(trajectory_file);
+	int trajRepeats = std::max(1, repeats/10);
+	print_times("TrajectorySpline2D::flux_of_a_omega",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = traj.flux_of_a_omega(a[i], omega[i]); } }, trajRepeats),
+		time_points([&](){ traj.flux_of_a_omega(out.data(), a.data(), omega.data(), n, 1); }, trajRepeats));
+	print_times("TrajectorySpline2D::time_of_a_omega",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = traj.time_of_a_omega(a[i], omega[i]); } }, trajRepeats),
+		time_points([&](){ traj.time_of_a_omega(out.data(), a.data(), omega.data(), n, 1); }, trajRepeats));
+	print_times("TrajectorySpline2D::phase_of_a_omega",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = traj.phase_of_a_omega(a[i], omega[i]); } }, trajRepeats),
+		time_points([&](){ traj.phase_of_a_omega(out.data(), a.data(), omega.data(), n, 1); }, trajRepeats));
+	print_times("TrajectorySpline2D::time_of_a_omega_derivative",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = traj.time_of_a_omega_derivative(a[i], omega[i]); } }, trajRepeats),
+		time_points([&](){ traj.time_of_a_omega_derivative(out.data(), a.data(), omega.data(), n, 1); }, trajRepeats));
+	Vector t(n);
+	traj.time_of_a_omega(t.data(), a.data(), omega.data(), n, 1);
+	print_times("TrajectorySpline2D::orbital_frequency",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = traj.orbital_frequency(a[i], t[i]); } }, trajRepeats),
+		time_points([&](){ traj.orbital_frequency(out.data(), a.data(), t.data(), n, 1); }, trajRepeats));
+	print_times("TrajectorySpline2D::phase_of_a_time",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = traj.phase_of_a_time(a[i], t[i]); } }, trajRepeats),
+		time_points([&](){ traj.phase_of_a_time(out.data(), a.data(), t.data(), n, 1); }, trajRepeats));
+	std::shared_ptr<TrajectorySlice> slice = traj.slice(chi_of_spin(aFixed));
+	print_times("TrajectorySlice::time",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = slice->time(alpha[i]); } }, trajRepeats),
+		time_points([&](){ slice->time(out.data(), alpha.data(), n); }, trajRepeats));
+	print_times("TrajectorySlice::phase",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = slice->phase(alpha[i]); } }, trajRepeats),
+		time_points([&](){ slice->phase(out.data(), alpha.data(), n); }, trajRepeats));
+	print_times("TrajectorySlice::time_of_alpha_omega_derivative",
+		time_points([&](){ for(int i = 0; i < n; i++){ out[i] = slice->time_of_alpha_omega_derivative(alpha[i]); } }, trajRepeats),
+		time_points([&](){ slice->time_of_alpha_omega_derivative(out.data(), alpha.data(), n); }, trajRepeats));
+
+	return 0;
+}
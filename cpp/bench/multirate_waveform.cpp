@@ -0,0 +1,91 @@
+// Times a time-domain waveform sampled uniformly against the same waveform
+// sampled piecewise uniformly by WaveformGenerator::computeMultirateSampling,
+// for a source that plunges at the end of the waveform, and reports the
+// samples and time of both and the largest difference between the uniform
+// waveform and the multirate waveform resampled to the uniform grid, relative
+// to the largest amplitude. Build from the repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -fno-math-errno -Icpp/include cpp/bench/multirate_waveform.cpp
+//       cpp/src/waveform.cpp cpp/src/harmonics.cpp cpp/src/trajectory.cpp cpp/src/swsh.cpp cpp/src/spline.cpp -lgsl -lgslcblas -o multirate_waveform
+//
+// and run as ./multirate_waveform [trajectory file] [harmonic file base] [duration in years]
+
+#include "waveform.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+#define BENCH_MASS 1.e6
+#define BENCH_SMALL_MASS 10.
+#define BENCH_SPIN 0.9
+#define BENCH_DT 2.
+#define BENCH_DT_MAX 64.
+
+int main(int argc, char *argv[]){
+	std::string trajectory_file = "bhpwave/data/trajectory.txt";
+	std::string harmonic_file_base = "bhpwave/data/circ_data";
+	double duration = 0.5;
+	if(argc > 1){
+		trajectory_file = argv[1];
+	}
+	if(argc > 2){
+		harmonic_file_base = argv[2];
+	}
+	if(argc > 3){
+		duration = atof(argv[3]);
+	}
+
+	std::vector<int> lmodes;
+	std::vector<int> mmodes;
+	for(int l = 2; l <= 15; l++){
+		for(int m = 1; m <= l; m++){
+			lmodes.push_back(l);
+			mmodes.push_back(m);
+		}
+	}
+	TrajectorySpline2D traj(trajectory_file);
+	HarmonicAmplitudes harm(lmodes, mmodes, harmonic_file_base);
+	WaveformGenerator gen(traj, harm);
+	gen.getInspiralGenerator().setInspiralCacheBytes(0);
+	HarmonicOptions hOpts = gen.getHarmonicOptions();
+	WaveformHarmonicOptions wOpts = gen.getWaveformHarmonicOptions();
+
+	// the source plunges just after the end of the waveform
+	double massratio = BENCH_SMALL_MASS/BENCH_MASS;
+	double r0 = gen.getInspiralGenerator().computeInitialRadius(BENCH_SPIN, massratio, 1.001*gen.convertTime(years_to_seconds(duration), BENCH_MASS));
+
+	StopWatch watch;
+	int steps = gen.computeTimeStepNumber(BENCH_MASS, BENCH_SMALL_MASS, BENCH_SPIN, r0, BENCH_DT, duration);
+	WaveformContainer h(steps);
+	// the first waveform builds the slices, which are not part of the timing
+	gen.computeWaveform(h, BENCH_MASS, BENCH_SMALL_MASS, BENCH_SPIN, r0, 1., 0.5, 0.4, 0.3, 0.2, 0.1, BENCH_DT, duration, hOpts, wOpts);
+	watch.start();
+	gen.computeWaveform(h, BENCH_MASS, BENCH_SMALL_MASS, BENCH_SPIN, r0, 1., 0.5, 0.4, 0.3, 0.2, 0.1, BENCH_DT, duration, hOpts, wOpts);
+	watch.stop();
+	double uniformTime = watch.time();
+	watch.reset();
+
+	printf("r0 = %.4f, dt = %g s, dt_max = %g s, %g years, %d uniform samples (%.3f s)\n", r0, BENCH_DT, BENCH_DT_MAX, duration, steps, uniformTime);
+	printf("  samples per cycle   samples   segments   time (s)   speedup   resampling error\n");
+	double samplesPerCycle[] = {4., 8., 16., 32.};
+	for(double n: samplesPerCycle){
+		watch.start();
+		MultirateSampling sampling = gen.computeMultirateSampling(BENCH_MASS, BENCH_SMALL_MASS, BENCH_SPIN, r0, 0.5, 0.4, 0.3, 0.2, BENCH_DT, BENCH_DT_MAX, duration, hOpts, n);
+		MultirateWaveformContainer hMultirate(sampling);
+		gen.computeWaveform(hMultirate, BENCH_MASS, BENCH_SMALL_MASS, BENCH_SPIN, r0, 1., 0.5, 0.4, 0.3, 0.2, 0.1, hOpts, wOpts);
+		watch.stop();
+		double multirateTime = watch.time();
+		watch.reset();
+
+		WaveformContainer hResampled(sampling.getUniformSize());
+		hMultirate.resample(hResampled);
+		double error = 0.;
+		double amplitude = 0.;
+		for(int i = 0; i < std::min(steps, hResampled.getSize()); i++){
+			error = std::max(error, std::abs(Complex(h.getPlus(i) - hResampled.getPlus(i), h.getCross(i) - hResampled.getCross(i))));
+			amplitude = std::max(amplitude, std::abs(Complex(h.getPlus(i), h.getCross(i))));
+		}
+		printf("  %17g   %7d   %8d   %8.3f   %7.2f   %16.2e\n", n, sampling.getSize(), sampling.getSegmentNumber(), multirateTime, uniformTime/multirateTime, error/amplitude);
+	}
+
+	return 0;
+}
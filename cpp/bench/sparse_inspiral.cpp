@@ -0,0 +1,67 @@
+// Times InspiralGenerator::computeInspiral with the trajectory evaluated at
+// every time step and on sparse nodes for a range of phase tolerances, and
+// reports the largest errors of the sparse inspirals in alpha and in the
+// orbital phase (in radians). Build from the repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -Icpp/include cpp/bench/sparse_inspiral.cpp
+//       cpp/src/trajectory.cpp cpp/src/spline.cpp -lgsl -lgslcblas -o sparse_inspiral
+//
+// and run as ./sparse_inspiral [trajectory file] [mass ratio] [time step] [duration]
+
+#include "trajectory.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+#define BENCH_SPIN 0.9
+#define BENCH_RADIUS 10.
+
+int main(int argc, char *argv[]){
+	std::string trajectory_file = "bhpwave/data/trajectory.txt";
+	double massratio = 1.e-5;
+	double dt = 5.;
+	double T = 1.e7;
+	if(argc > 1){
+		trajectory_file = argv[1];
+	}
+	if(argc > 2){
+		massratio = atof(argv[2]);
+	}
+	if(argc > 3){
+		dt = atof(argv[3]);
+	}
+	if(argc > 4){
+		T = atof(argv[4]);
+	}
+
+	TrajectorySpline2D traj(trajectory_file);
+	InspiralGenerator inspiralGen(traj);
+	int threads = omp_get_max_threads();
+	// the first call builds the slice, which is not part of the timing
+	inspiralGen.computeInspiral(BENCH_SPIN, massratio, BENCH_RADIUS, dt, T, threads);
+
+	StopWatch denseWatch;
+	denseWatch.start();
+	InspiralContainer dense = inspiralGen.computeInspiral(BENCH_SPIN, massratio, BENCH_RADIUS, dt, T, threads);
+	denseWatch.stop();
+
+	printf("Inspiral of %d steps (a = %.2f, r0 = %.1f, q = %.1e, %d threads)\n", dense.getSize(), BENCH_SPIN, BENCH_RADIUS, massratio, threads);
+	printf("  phase tolerance   time (ms)   speedup   max error in alpha   max error in phase (rad)\n");
+	printf("  dense            %10.2f\n", 1.e3*denseWatch.time());
+	double tolerances[5] = {1.e-2, 1.e-4, 1.e-6, 1.e-8, 1.e-10};
+	for(int k = 0; k < 5; k++){
+		StopWatch sparseWatch;
+		sparseWatch.start();
+		InspiralContainer sparse = inspiralGen.computeInspiral(BENCH_SPIN, massratio, BENCH_RADIUS, dt, T, threads, tolerances[k]);
+		sparseWatch.stop();
+
+		double alphaError = 0., phaseError = 0.;
+		for(int j = 0; j < dense.getSize(); j++){
+			alphaError = std::max(alphaError, fabs(sparse.getAlpha(j) - dense.getAlpha(j)));
+			phaseError = std::max(phaseError, fabs(sparse.getPhase(j) - dense.getPhase(j)));
+		}
+		printf("  %.0e          %10.2f   %7.1f   %.3e            %.3e\n", tolerances[k], 1.e3*sparseWatch.time(),
+			denseWatch.time()/sparseWatch.time(), alphaError, phaseError);
+	}
+
+	return 0;
+}
@@ -0,0 +1,47 @@
+// Times the construction of BicubicSpline coefficients on grids of the size
+// used by the harmonic amplitude and trajectory data, for each of the
+// first-derivative boundary conditions. Build from the repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -Icpp/include cpp/bench/spline_construction.cpp
+//       cpp/src/spline.cpp -o spline_construction
+//
+// and run as ./spline_construction [repeats]
+
+#include "spline.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char *argv[]){
+	int repeats = 20;
+	if(argc > 1){
+		repeats = atoi(argv[1]);
+	}
+
+	int sizes[3][2] = {{65, 65}, {129, 257}, {513, 513}};
+	for(int s = 0; s < 3; s++){
+		int nx = sizes[s][0];
+		int ny = sizes[s][1];
+		double dx = 1./(nx - 1);
+		double dy = 1./(ny - 1);
+		Vector z(nx*ny);
+		for(int i = 0; i < nx; i++){
+			for(int j = 0; j < ny; j++){
+				z[i*ny + j] = sin(3.*i*dx)*cos(5.*j*dy) + i*dx*j*dy*j*dy;
+			}
+		}
+
+		for(int method = 1; method <= 4; method++){
+			StopWatch watch;
+			double check = 0.;
+			watch.start();
+			for(int r = 0; r < repeats; r++){
+				BicubicSpline spline(0., dx, nx - 1, 0., dy, ny - 1, z, method);
+				check += spline.evaluate(0.3, 0.7);
+			}
+			watch.stop();
+			printf("%4d x %4d  method %d  %10.3f ms per spline  (check %.15e)\n", nx, ny, method, 1.e3*watch.time()/repeats, check/repeats);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,129 @@
+// Times bicubic cell evaluation against the placement of the coefficient table.
+// The first part evaluates the same table at byte offsets of 0, 16, 32 and 48
+// from a cache-line boundary: an offset of 0 is the SPLINE_ALIGNMENT storage,
+// while the others are the placements that an unaligned std::vector can get,
+// for which a cell straddles three cache lines instead of two. The second part
+// times BicubicSpline itself, with random queries and with a cursor sweep in y.
+// Build from the repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -Icpp/include cpp/bench/spline_layout.cpp
+//       cpp/src/spline.cpp -o spline_layout
+//
+// and again with -DSPLINE_PREFETCH to compare the cursor sweep with software
+// prefetching, and run as ./spline_layout [repeats]
+
+#include "spline.hpp"
+#include <cstdio>
+
+#define LAYOUT_NX 256
+#define LAYOUT_NY 512
+#define LAYOUT_SAMPLES 4000000
+
+// deterministic uniform samples in [0, 1)
+static double uniform(unsigned long long &state){
+	state = state*6364136223846793005ULL + 1442695040888963407ULL;
+	return (state >> 11)*(1./9007199254740992.);
+}
+
+static double time_cells(const double *c, const int cell[], const double xbar[], const double ybar[], double z[], int n, int repeats){
+	StopWatch watch;
+	watch.start();
+	for(int r = 0; r < repeats; r++){
+		#pragma omp simd
+		for(int k = 0; k < n; k++){
+			z[k] = bicubic_cell<0, 0>(c, cell[k], xbar[k], ybar[k]);
+		}
+	}
+	watch.stop();
+	return 1.e9*watch.time()/(double(repeats)*n);
+}
+
+static void report_offsets(int repeats){
+	const int cells = LAYOUT_NX*LAYOUT_NY;
+	const int n = LAYOUT_SAMPLES;
+	AlignedVector buffer(16*cells + 8);
+	std::vector<int> randomCell(n), sequentialCell(n);
+	Vector xbar(n), ybar(n), z(n);
+	unsigned long long state = 1;
+	for(int k = 0; k < n; k++){
+		randomCell[k] = 16*static_cast<int>(uniform(state)*cells);
+		sequentialCell[k] = 16*static_cast<int>(double(k)*cells/n);
+		xbar[k] = uniform(state);
+		ybar[k] = uniform(state);
+	}
+
+	printf("table of %d cells (%.1f MB)\n", cells, 128.*cells/1048576.);
+	printf("  offset (bytes)   random (ns/eval)   sequential (ns/eval)\n");
+	for(int offset = 0; offset < 64; offset += 16){
+		double *c = reinterpret_cast<double*>(reinterpret_cast<char*>(buffer.data()) + offset);
+		for(int k = 0; k < 16*cells; k++){
+			c[k] = 1./(1. + (k % 97));
+		}
+		double randomTime = time_cells(c, randomCell.data(), xbar.data(), ybar.data(), z.data(), n, repeats);
+		double sequentialTime = time_cells(c, sequentialCell.data(), xbar.data(), ybar.data(), z.data(), n, repeats);
+		printf("  %14d   %16.3f   %20.3f\n", offset, randomTime, sequentialTime);
+	}
+}
+
+static void report_spline(int repeats){
+	const int n = LAYOUT_SAMPLES;
+	double dx = 1./LAYOUT_NX;
+	double dy = 1./LAYOUT_NY;
+	Vector zGrid((LAYOUT_NX + 1)*(LAYOUT_NY + 1));
+	for(int i = 0; i <= LAYOUT_NX; i++){
+		for(int j = 0; j <= LAYOUT_NY; j++){
+			zGrid[i*(LAYOUT_NY + 1) + j] = sin(3.*i*dx)*cos(5.*j*dy);
+		}
+	}
+	BicubicSpline spline(0., dx, LAYOUT_NX, 0., dy, LAYOUT_NY, zGrid);
+
+	Vector x(n), y(n), ySorted(n), z(n);
+	unsigned long long state = 2;
+	for(int k = 0; k < n; k++){
+		x[k] = uniform(state);
+		y[k] = uniform(state);
+		ySorted[k] = double(k)/n;
+	}
+
+	StopWatch randomWatch;
+	randomWatch.start();
+	for(int r = 0; r < repeats; r++){
+		spline.evaluate(z.data(), x.data(), y.data(), n);
+	}
+	randomWatch.stop();
+
+	// one sweep in y per row of cells, so that every cell of the table is visited
+	StopWatch sweepWatch;
+	double check = 0.;
+	sweepWatch.start();
+	for(int r = 0; r < repeats; r++){
+		for(int i = 0; i < LAYOUT_NX; i++){
+			BicubicSplineCursor cursor(spline, (i + 0.5)*dx);
+			for(int k = 0; k < n/LAYOUT_NX; k++){
+				check += cursor.evaluate(ySorted[k*LAYOUT_NX]);
+			}
+		}
+	}
+	sweepWatch.stop();
+
+#if defined(SPLINE_PREFETCH)
+	const char *prefetch = "on";
+#else
+	const char *prefetch = "off";
+#endif
+	printf("BicubicSpline %d x %d (alignment %d bytes, prefetch %s)\n", LAYOUT_NX, LAYOUT_NY, SPLINE_ALIGNMENT, prefetch);
+	printf("  batched random queries   %8.3f ns/eval\n", 1.e9*randomWatch.time()/(double(repeats)*n));
+	printf("  cursor sweeps in y       %8.3f ns/eval  (check %.6e)\n", 1.e9*sweepWatch.time()/(double(repeats)*(n/LAYOUT_NX)*LAYOUT_NX), check);
+}
+
+int main(int argc, char *argv[]){
+	int repeats = 5;
+	if(argc > 1){
+		repeats = atoi(argv[1]);
+	}
+
+	report_offsets(repeats);
+	report_spline(repeats);
+
+	return 0;
+}
@@ -0,0 +1,134 @@
+// Breaks down the time of WaveformHarmonicGenerator::computeWaveformHarmonics
+// into the stages of its inner loop, each timed on its own over every block of
+// time samples and mode: the batched amplitude and phase splines, the reduction
+// of the mode phase with fmod and with fmod_2pi, and the cosine and sine of each
+// mode summed into the waveform. The stage times are compared against the total
+// time of computeWaveformHarmonics on the same inspiral. Build from the
+// repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -fno-math-errno -Icpp/include cpp/bench/waveform_harmonics_profile.cpp
+//       cpp/src/waveform.cpp cpp/src/harmonics.cpp cpp/src/trajectory.cpp cpp/src/swsh.cpp cpp/src/spline.cpp -lgsl -lgslcblas -o waveform_harmonics_profile
+//
+// and run as OMP_NUM_THREADS=1 ./waveform_harmonics_profile [trajectory file] [harmonic file base] [duration in years]
+
+#include "waveform.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+#define BENCH_MASS 1.e6
+#define BENCH_SMALL_MASS 10.
+#define BENCH_SPIN 0.9
+#define BENCH_DT 2.
+#define BENCH_THETA 0.5
+#define BENCH_PHI 0.4
+
+static void report(const char *stage, double time, double total){
+	printf("  %-28s %8.3f s   %5.1f %%\n", stage, time, 100.*time/total);
+}
+
+int main(int argc, char *argv[]){
+	std::string trajectory_file = "bhpwave/data/trajectory.txt";
+	std::string harmonic_file_base = "bhpwave/data/circ_data";
+	double duration = 0.4;
+	if(argc > 1){
+		trajectory_file = argv[1];
+	}
+	if(argc > 2){
+		harmonic_file_base = argv[2];
+	}
+	if(argc > 3){
+		duration = atof(argv[3]);
+	}
+
+	int l[] = {2, 2, 3, 3, 3, 4, 4, 4, 5};
+	int m[] = {2, 1, 3, 2, 1, 4, 3, 2, 5};
+	int modeNum = 9;
+	std::vector<int> lmodes(l, l + modeNum);
+	std::vector<int> mmodes(m, m + modeNum);
+	TrajectorySpline2D traj(trajectory_file);
+	HarmonicAmplitudes harm(lmodes, mmodes, harmonic_file_base);
+	WaveformGenerator gen(traj, harm);
+	WaveformHarmonicOptions wOpts = gen.getWaveformHarmonicOptions();
+	wOpts.num_threads = 1;
+
+	double massratio = BENCH_SMALL_MASS/BENCH_MASS;
+	double T = gen.convertTime(years_to_seconds(duration), BENCH_MASS);
+	double dt = gen.convertTime(BENCH_DT, BENCH_MASS);
+	double r0 = gen.getInspiralGenerator().computeInitialRadius(BENCH_SPIN, massratio, 1.001*T);
+	InspiralContainer inspiral = gen.getInspiralGenerator().computeInspiral(BENCH_SPIN, massratio, r0, dt, T, ExecutionContext(1));
+	int imax = inspiral.getSize();
+
+	double plusY[9], crossY[9];
+	for(int j = 0; j < modeNum; j++){
+		plusY[j] = 1.;
+		crossY[j] = 1.;
+	}
+
+	StopWatch watch;
+	WaveformContainer h(imax);
+	// the first call builds the slices, which are not part of the timing
+	gen.computeWaveformHarmonics(h, l, m, plusY, crossY, modeNum, inspiral, BENCH_THETA, BENCH_PHI, wOpts);
+	watch.start();
+	gen.computeWaveformHarmonics(h, l, m, plusY, crossY, modeNum, inspiral, BENCH_THETA, BENCH_PHI, wOpts);
+	watch.stop();
+	double total = watch.time();
+	watch.reset();
+
+	std::shared_ptr<HarmonicSlice> slice = harm.slice(chi_of_spin(BENCH_SPIN));
+	HarmonicSpline* Alms[9];
+	for(int j = 0; j < modeNum; j++){
+		Alms[j] = slice->getPointer(l[j], m[j]);
+	}
+	const double* alpha = inspiral.getAlpha().data();
+	const double* phase = inspiral.getPhase().data();
+	int blockNum = (imax + WAVEFORM_BLOCK_SIZE - 1)/WAVEFORM_BLOCK_SIZE;
+	double* plus = h.getPlusPointer();
+	double* cross = h.getCrossPointer();
+	double amp[WAVEFORM_BLOCK_SIZE], Phi[WAVEFORM_BLOCK_SIZE];
+	double hplus[WAVEFORM_BLOCK_SIZE], hcross[WAVEFORM_BLOCK_SIZE];
+	double checksum = 0.;
+
+	printf("%d modes, %d samples, one thread\n", modeNum, imax);
+	printf("  %-28s %8.3f s\n", "computeWaveformHarmonics", total);
+
+	const char *stages[] = {"amplitude splines", "phase splines", "phase reduction (fmod)", "phase reduction (fmod_2pi)", "cos, sin and sum into h"};
+	for(int stage = 0; stage < 5; stage++){
+		watch.start();
+		for(int b = 0; b < blockNum; b++){
+			int i0 = b*WAVEFORM_BLOCK_SIZE;
+			int blockSize = std::min(WAVEFORM_BLOCK_SIZE, imax - i0);
+			for(int j = 0; j < modeNum; j++){
+				if(stage == 0){
+					Alms[j]->amplitude(amp, &alpha[i0], blockSize);
+				}else if(stage == 1){
+					Alms[j]->phase(Phi, &alpha[i0], blockSize);
+				}else if(stage == 2){
+					for(int k = 0; k < blockSize; k++){
+						Phi[k] = fmod(m[j]*phase[i0 + k], 2.*M_PI);
+					}
+				}else if(stage == 3){
+					for(int k = 0; k < blockSize; k++){
+						Phi[k] = fmod_2pi(m[j]*phase[i0 + k]);
+					}
+				}else{
+					for(int k = 0; k < blockSize; k++){
+						double x = 2.*M_PI*alpha[i0 + k];
+						hplus[k] = plusY[j]*std::cos(x);
+						hcross[k] = -crossY[j]*std::sin(x);
+					}
+					for(int k = 0; k < blockSize; k++){
+						plus[i0 + k] += hplus[k];
+						cross[i0 + k] += hcross[k];
+					}
+				}
+			}
+			checksum += amp[0] + Phi[0];
+		}
+		watch.stop();
+		report(stages[stage], watch.time(), total);
+		watch.reset();
+	}
+
+	printf("(checksum %g)\n", checksum + h.getPlus(imax/2));
+	return 0;
+}
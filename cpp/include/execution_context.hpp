@@ -0,0 +1,129 @@
+#ifndef EXECUTION_CONTEXT_HPP
+#define EXECUTION_CONTEXT_HPP
+
+#include <atomic>
+#include <algorithm>
+#include "omp.h"
+
+class ThreadLease;
+
+// number of threads shared by the calls that do not ask for a fixed number,
+// omp_get_max_threads() when first used unless set with setPoolSize
+inline std::atomic<int>& execution_pool_size(){
+	static std::atomic<int> size(std::max(omp_get_max_threads(), 1));
+	return size;
+}
+
+// number of calls currently drawing threads from the pool
+inline std::atomic<int>& execution_active_leases(){
+	static std::atomic<int> active(0);
+	return active;
+}
+
+// the innermost lease held by the calling thread
+inline ThreadLease*& current_thread_lease(){
+	static thread_local ThreadLease *lease = nullptr;
+	return lease;
+}
+
+// How a call runs its parallel regions. The context is passed to every call
+// that has them, in place of setting the OpenMP thread count of the whole
+// process. It either asks for a fixed number of threads or, with 0 threads
+// (the default), draws threads from a pool shared by the process. Calls made
+// at the same time from several user threads then split the pool evenly
+// between them instead of each starting a full team: every parallel region
+// runs with the pool size divided by the number of active calls, with at least
+// one thread per call, so N calls on a pool of N threads run N threads
+class ExecutionContext{
+public:
+	ExecutionContext(int num_threads = 0): _num_threads(std::max(num_threads, 0)) {}
+
+	int getNumThreads() const{
+		return _num_threads;
+	}
+
+	bool isShared() const{
+		return _num_threads == 0;
+	}
+
+	static int getPoolSize(){
+		return execution_pool_size().load();
+	}
+
+	static void setPoolSize(int size){
+		execution_pool_size().store(std::max(size, 1));
+	}
+
+	// calls currently drawing threads from the pool
+	static int getActiveCalls(){
+		return execution_active_leases().load();
+	}
+
+	// threads that the active calls run their parallel regions with
+	static int getThreadsInUse(){
+		int active = getActiveCalls();
+		return active*getFairShare(active);
+	}
+
+	// threads per call when active calls share the pool
+	static int getFairShare(int active){
+		return std::max(1, getPoolSize()/std::max(active, 1));
+	}
+
+private:
+	int _num_threads;
+};
+
+// The threads that a call runs its parallel regions with, held for the length
+// of the call. A call with a shared context counts as active for as long as it
+// holds its lease, and threads() gives its current share of the pool, so a
+// call started while others run takes only its share and the calls already
+// running shrink to theirs at their next parallel region. A lease taken while
+// the calling thread already holds one (one generator calling another) follows
+// the outer lease, and a lease taken inside a parallel region gets a single
+// thread, so nested calls never start nested teams or count twice
+class ThreadLease{
+public:
+	ThreadLease(const ExecutionContext &context): _outer(current_thread_lease()), _shared(false), _active(false), _threads(1) {
+		if(omp_in_parallel()){
+			_threads = 1;
+		}else if(!context.isShared()){
+			_threads = context.getNumThreads();
+		}else if(_outer != nullptr){
+			_shared = _outer->_shared;
+			_threads = _outer->_threads;
+		}else{
+			_shared = true;
+			_active = true;
+			execution_active_leases().fetch_add(1);
+		}
+		current_thread_lease() = this;
+	}
+
+	~ThreadLease(){
+		if(_active){
+			execution_active_leases().fetch_sub(1);
+		}
+		current_thread_lease() = _outer;
+	}
+
+	// read at the start of each parallel region, since the share of a shared
+	// lease changes as other calls start and finish
+	int threads() const{
+		if(_shared){
+			return ExecutionContext::getFairShare(ExecutionContext::getActiveCalls());
+		}
+		return _threads;
+	}
+
+private:
+	ThreadLease(const ThreadLease&);
+	ThreadLease& operator=(const ThreadLease&);
+
+	ThreadLease *_outer;
+	bool _shared;
+	bool _active;
+	int _threads;
+};
+
+#endif
@@ -7,20 +7,20 @@ class WaveformFourierHarmonicGenerator{
 public:
   WaveformFourierHarmonicGenerator(HarmonicAmplitudes &Alm, HarmonicOptions hOpts = HarmonicOptions(), WaveformHarmonicOptions wOpts = WaveformHarmonicOptions());
 
-  void computeWaveformFourierHarmonics(WaveformContainer &h, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, HarmonicOptions hOpts, int num_threads, double freq[], int fsamples);
-  void computeWaveformFourierHarmonics(WaveformContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, int num_threads, double freq[], int fsamples, int include_negative_m = 1);
-  void computeWaveformFourierHarmonics(WaveformContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, int num_threads, double freq[], int fsamples);
+  void computeWaveformFourierHarmonics(WaveformContainer &h, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, HarmonicOptions hOpts, ExecutionContext context, double freq[], int fsamples);
+  void computeWaveformFourierHarmonics(WaveformContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, ExecutionContext context, double freq[], int fsamples, int include_negative_m = 1);
+  void computeWaveformFourierHarmonics(WaveformContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, ExecutionContext context, double freq[], int fsamples);
 
-  void computeWaveformFourierHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, int num_threads, double freq[], int fsamples, int include_negative_m = 1);
-  void computeWaveformFourierHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, int num_threads, double freq[], int fsamples);
+  void computeWaveformFourierHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, ExecutionContext context, double freq[], int fsamples, int include_negative_m = 1);
+  void computeWaveformFourierHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, ExecutionContext context, double freq[], int fsamples);
 
-  void computeWaveformFourierHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, int num_threads, double freq[], int fsamples);
-  void computeWaveformFourierHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, int num_threads, double freq[], int fsamples);
+  void computeWaveformFourierHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, ExecutionContext context, double freq[], int fsamples);
+  void computeWaveformFourierHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, ExecutionContext context, double freq[], int fsamples);
 
 
   HarmonicSelector& getModeSelector();
-  HarmonicModeContainer selectModes(InspiralContainer &inspiral, double theta);
-  HarmonicModeContainer selectModes(InspiralContainer &inspiral, double theta, HarmonicOptions opts);
+  HarmonicModeContainer selectModes(const InspiralContainer &inspiral, double theta);
+  HarmonicModeContainer selectModes(const InspiralContainer &inspiral, double theta, HarmonicOptions opts);
 
   WaveformHarmonicOptions getWaveformHarmonicOptions();
   HarmonicOptions getHarmonicOptions();  
@@ -56,6 +56,9 @@ public:
   HarmonicModeContainer selectModes(double M, double mu, double a, double r0, double qS, double phiS, double qK, double phiK, double Phi_phi0, double T);
   HarmonicModeContainer selectModes(double M, double mu, double a, double r0, double qS, double phiS, double qK, double phiK, double Phi_phi0, double T, HarmonicOptions opts);
 
+  // the generator of the inspirals, which holds the inspiral cache
+  InspiralGenerator& getInspiralGenerator();
+
 private:
   InspiralGenerator _inspiralGen;
 };
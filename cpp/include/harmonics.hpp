@@ -4,10 +4,66 @@
 #include <string>
 #include <utility>
 #include <map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <type_traits>
 #include "trajectory.hpp"
+#include "lru_cache.hpp"
+#include "mapped_file.hpp"
+#include "text_reader.hpp"
 #include "swsh.hpp"
 #include "omp.h"
 
+// fields of the harmonic splines that can be stored in single precision,
+// combined as a bitmask when constructing HarmonicAmplitudes
+#define HARMONIC_AMPLITUDE_SINGLE_PRECISION 1
+#define HARMONIC_PHASE_SINGLE_PRECISION 2
+
+// number of spins whose reduced harmonic splines are kept by HarmonicAmplitudes
+#define HARMONIC_SLICE_CACHE_SIZE 8
+
+// default resolution, in intervals, of the (chi, alpha) lookup tables of the
+// approximate evaluation mode of HarmonicAmplitudes
+#define HARMONIC_LOOKUP_CHI_SAMPLES 128
+#define HARMONIC_LOOKUP_ALPHA_SAMPLES 512
+
+// Binary harmonic files hold the finished amplitude and phase spline
+// coefficients of a set of modes, so that loading them maps a single file
+// instead of parsing and fitting one text file per mode. A file consists of a
+// HarmonicBinaryHeader, one HarmonicBinaryMode record per mode, which indexes
+// the modes by (l, m) and holds their grids, and the coefficients of the
+// amplitude and phase of each mode starting at their offsets, which are
+// multiples of SPLINE_ALIGNMENT. The amplitude spline interpolates the log of
+// the amplitude, as when fitting the text files. Numbers are stored in the byte
+// order of the machine that wrote the file, which is checked on loading
+#define HARMONIC_BINARY_MAGIC "BHPWHARM"
+#define HARMONIC_BINARY_VERSION 1
+#define HARMONIC_BINARY_BYTE_ORDER 0x01020304
+
+typedef struct HarmonicBinaryHeaderStruct{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t modes;
+	uint32_t reserved;
+} HarmonicBinaryHeader;
+
+typedef struct HarmonicBinaryModeStruct{
+	int32_t l;
+	int32_t m;
+	int32_t nx;
+	int32_t ny;
+	double x0;
+	double dx;
+	double y0;
+	double dy;
+	uint64_t amplitude_offset; // in bytes from the start of the file
+	uint64_t phase_offset;
+	uint64_t size; // number of coefficients of each of the two splines
+} HarmonicBinaryMode;
+
 typedef struct HarmonicModeStruct{
 	Vector chi;
 	Vector alpha;
@@ -17,14 +73,38 @@ typedef struct HarmonicModeStruct{
 
 HarmonicModeData read_harmonic_mode_data(int L, int m, std::string filepath_base = "data/circ_data");
 
+// spline tables of a binary harmonic file, which point into its mapping
+class HarmonicBinaryData{
+public:
+  std::shared_ptr<const MappedFile> file;
+  std::vector<int> lmodes;
+  std::vector<int> mmodes;
+  std::vector<BicubicSplineData> amplitude;
+  std::vector<BicubicSplineData> phase;
+};
+
+// maps a binary harmonic file and validates its header and mode records. Throws
+// std::runtime_error if the file cannot be mapped or is not a valid harmonic file
+HarmonicBinaryData read_harmonic_binary(std::string filename);
+// whether the file starts like a binary harmonic file
+bool is_harmonic_binary(std::string filename);
+// fits the splines of the text files of the modes and writes them to a single
+// binary file. Returns 0 on success
+int convert_harmonic_files(int lmodes[], int mmodes[], int modeNum, std::string filepath_base, std::string binary_filename);
+int convert_harmonic_files(std::vector<int> &lmodes, std::vector<int> &mmodes, std::string filepath_base, std::string binary_filename);
+
 class HarmonicSpline{
 public:
   HarmonicSpline(double chi, const Vector &alpha, const Vector &A, const Vector &Phi);
   HarmonicSpline(double spin, CubicSpline amplitude_spline, CubicSpline phase_spline);
+  // a mode evaluated by linear interpolation of its amplitude and phase
+  HarmonicSpline(double spin, LinearTable amplitude_table, LinearTable phase_table);
   ~HarmonicSpline();
 
   double amplitude(double alpha);
   double phase(double alpha);
+  void amplitude(double amp[], const double alpha[], int n);
+  void phase(double phase[], const double alpha[], int n);
 
 	double amplitude_of_omega(double omega);
   double phase_of_omega(double omega);
@@ -34,6 +114,9 @@ private:
   double _spin;
   CubicSpline _amplitude_spline;
   CubicSpline _phase_spline;
+  bool _lookup;
+  LinearTable _amplitude_table;
+  LinearTable _phase_table;
 };
 
 class HarmonicSpline2D{
@@ -41,26 +124,106 @@ public:
   HarmonicSpline2D(int L, int m, std::string filepath_base = "data/circ_data");
   HarmonicSpline2D(HarmonicModeData mode);
   HarmonicSpline2D(const Vector &chi, const Vector &alpha, const Vector &Amp, const Vector &Phi);
+  // evaluates in place on the coefficients of a binary harmonic file, which
+  // storage keeps mapped
+  HarmonicSpline2D(const BicubicSplineData &amplitude, const BicubicSplineData &phase, std::shared_ptr<const void> storage);
   ~HarmonicSpline2D();
 
   double amplitude(double chi, double alpha);
   double phase(double chi, double alpha);
+  void amplitude(double amp[], double chi, const double alpha[], int n);
+  void phase(double phase[], double chi, const double alpha[], int n);
 
 	double amplitude_of_a_omega(double a, double omega);
   double phase_of_a_omega(double a, double omega);
 	double phase_of_a_omega_derivative(double a, double omega);
 
+  void convertToSinglePrecision(bool amplitude = true, bool phase = true);
+  // coefficients of the log-amplitude and phase splines, which are only
+  // available while they are stored in double precision
+  BicubicSplineData amplitudeData() const;
+  BicubicSplineData phaseData() const;
+
+  // resamples the amplitude and phase onto uniform tables of chi_samples x
+  // alpha_samples intervals, which then replace the splines in every evaluation.
+  // The largest errors of the tables, relative for the amplitude and absolute
+  // for the phase, are measured against the splines at the centers of the cells
+  void convertToLookupTables(int chi_samples, int alpha_samples);
+  bool lookupTables() const;
+  double lookupAmplitudeError() const;
+  double lookupPhaseError() const;
+
+  // the mode at fixed chi as 1D splines in alpha, or as 1D tables with lookup tables enabled
+  HarmonicSpline reduce(double chi);
+
 private:
+  friend class HarmonicSplineCursor;
   BicubicSpline _amplitude_spline;
   BicubicSpline _phase_spline;
+  bool _lookup;
+  BilinearTable _amplitude_table;
+  BilinearTable _phase_table;
+  double _amplitude_error;
+  double _phase_error;
+};
+
+// cursor over a single mode at fixed chi for monotone sweeps in alpha
+class HarmonicSplineCursor{
+public:
+  HarmonicSplineCursor(const HarmonicSpline2D &harm, double chi);
+
+  double amplitude(double alpha);
+  double phase(double alpha);
+
+private:
+  BicubicSplineCursor _amplitude_cursor;
+  BicubicSplineCursor _phase_cursor;
+};
+
+class HarmonicAmplitudes;
+
+// The modes of a HarmonicAmplitudes reduced to 1D splines in alpha at a single
+// chi, which is fixed along an inspiral. Built by HarmonicAmplitudes::slice.
+// Each mode is reduced on its first request, from any thread, and the
+// HarmonicAmplitudes must outlive the slice
+class HarmonicSlice{
+public:
+  HarmonicSlice(double chi, HarmonicAmplitudes &harm);
+  ~HarmonicSlice();
+
+  double getChi();
+  double amplitude(int l, int m, double alpha);
+  double phase(int l, int m, double alpha);
+
+  HarmonicSpline* getPointer(int l, int m);
+
+private:
+  typedef std::aligned_storage<sizeof(HarmonicSpline), alignof(HarmonicSpline)>::type HarmonicSplineStorage;
+
+  double _chi;
+  HarmonicAmplitudes &_harm;
+  // the reduced mode objects are built in place in one contiguous block, while
+  // their coefficients keep their own storage
+  std::unique_ptr<HarmonicSplineStorage[]> _arena;
+  std::unique_ptr<std::atomic<HarmonicSpline*>[]> _harmonics;
+  std::unique_ptr<std::once_flag[]> _reduce_flags;
 };
 
 class HarmonicAmplitudes{
 public:
-  HarmonicAmplitudes(std::vector<int> &lmodes, std::vector<int> &mmodes, std::string filepath_base = "data/circ_data");
-  HarmonicAmplitudes(int lmodes[], int mmodes[], int modeNum, std::string filepath_base = "data/circ_data");
+  HarmonicAmplitudes(std::vector<int> &lmodes, std::vector<int> &mmodes, std::string filepath_base = "data/circ_data", int single_precision = 0);
+  HarmonicAmplitudes(int lmodes[], int mmodes[], int modeNum, std::string filepath_base = "data/circ_data", int single_precision = 0);
+  // the modes of a binary harmonic file, all of them or those listed, which
+  // evaluate in place on its mapping. Throws std::runtime_error if a listed
+  // mode is not in the file
+  HarmonicAmplitudes(const HarmonicBinaryData &harm, int single_precision = 0);
+  HarmonicAmplitudes(int lmodes[], int mmodes[], int modeNum, const HarmonicBinaryData &harm, int single_precision = 0);
   ~HarmonicAmplitudes();
 
+  // writes the modes in the binary harmonic format, loading those that are
+  // not yet loaded. Returns 0 on success
+  int writeBinary(std::string filename);
+
   double amplitude(int l, int m, double chi, double alpha);
   double phase(int l, int m, double chi, double alpha);
   int key_check(std::pair<int, int> key);
@@ -69,12 +232,73 @@ public:
   double phase_of_a_omega(int l, int m, double a, double omega);
 	double phase_of_a_omega_derivative(int l, int m, double a, double omega);
   
+  // A mode that is not held is reported and falls back to the first mode, as
+  // do the evaluations above and HarmonicSlice. Use findPointer where a
+  // missing mode has to be detected
   HarmonicSpline2D* getPointer(int l, int m);
 
+  // Lock-free lookups for per-sample code running on many threads. Modes are
+  // indexed by a dense table over (l, m), so finding a mode costs two array
+  // reads, and once a mode is loaded its pointer costs one atomic read. The
+  // index is -1, and the pointer nullptr, for a mode that is not held
+  int getModeIndex(int l, int m) const;
+  HarmonicSpline2D* getModePointer(int i) const;
+  HarmonicSpline2D* findPointer(int l, int m) const;
+
+  // Modes are read from their files and fit on their first request through
+  // getPointer, an evaluation or a slice, from any thread, so that only the
+  // modes that are used are loaded. preload loads modes in parallel ahead of
+  // time, all of them or those listed, skipping modes that are not held
+  void preload();
+  void preload(int lmodes[], int mmodes[], int modeNum);
+  void preload(std::vector<int> &lmodes, std::vector<int> &mmodes);
+  int getModeNumber();
+  int loadedModeNumber();
+
+  // Approximate evaluation mode for quick-look calculations. Every mode is
+  // resampled once onto uniform (chi, alpha) tables, after which all evaluations,
+  // including the slices used by the waveform generators, interpolate linearly
+  // instead of evaluating splines. Use lookupAmplitudeError and lookupPhaseError
+  // to choose a resolution. Modes loaded later are converted as they load
+  void useLookupTables(int chi_samples = HARMONIC_LOOKUP_CHI_SAMPLES, int alpha_samples = HARMONIC_LOOKUP_ALPHA_SAMPLES);
+  int lookupTables();
+  double lookupAmplitudeError(int l, int m);
+  double lookupPhaseError(int l, int m);
+
+  // all modes reduced at fixed chi. Slices are built on the first request for
+  // a chi and cached for the HARMONIC_SLICE_CACHE_SIZE most recent spins
+  std::shared_ptr<HarmonicSlice> slice(double chi);
+
 private:
+  friend class HarmonicSlice;
+  typedef std::aligned_storage<sizeof(HarmonicSpline2D), alignof(HarmonicSpline2D)>::type HarmonicSpline2DStorage;
+
+  // position of mode (l, m), where a mode that is not held is reported and falls back to the first one
+  int position(int l, int m) const;
+  // mode i, read and fit on its first request
+  HarmonicSpline2D* loadMode(int i) const;
+
   int _modeNum;
-  std::vector<HarmonicSpline2D*> _harmonics;
-  std::map<std::pair<int,int>,int> _position_map;
+  std::vector<int> _lmodes;
+  std::vector<int> _mmodes;
+  std::string _filepath_base;
+  int _single_precision;
+  int _lookup_chi_samples;
+  int _lookup_alpha_samples;
+  // the mode objects are built in place in one contiguous block, and published
+  // through _harmonics once they are loaded. Their coefficients keep their own
+  // aligned storage, or stay in the mapped file
+  std::unique_ptr<HarmonicSpline2DStorage[]> _arena;
+  std::unique_ptr<std::atomic<HarmonicSpline2D*>[]> _harmonics;
+  std::unique_ptr<std::once_flag[]> _load_flags;
+  // position of mode (l, m) at l*(l + 1) + m for |m| <= l <= _lmax, or -1
+  int _lmax;
+  std::vector<int> _mode_index;
+  // splines of each mode in a mapped binary harmonic file, if the modes come from one
+  std::shared_ptr<const MappedFile> _file;
+  std::vector<BicubicSplineData> _amplitude_data;
+  std::vector<BicubicSplineData> _phase_data;
+  LRUCache<double, HarmonicSlice> _slice_cache;
 };
 
 class HarmonicModeContainer{
@@ -98,15 +322,15 @@ class HarmonicSelector{
 public:
   HarmonicSelector(HarmonicAmplitudes &harm, HarmonicOptions opts = HarmonicOptions());
 
-  double modePower(int l, int m, InspiralContainer &inspiral);
-  int gradeMode(int l, int m, InspiralContainer &inspiral, double power22);
-  int gradeMode(int l, int m, InspiralContainer &inspiral, double power22, double &plusYlm, double &crossYlm, double theta);
-  HarmonicModeContainer selectModes(InspiralContainer &inspiral, double theta);
+  double modePower(int l, int m, const InspiralContainer &inspiral);
+  int gradeMode(int l, int m, const InspiralContainer &inspiral, double power22);
+  int gradeMode(int l, int m, const InspiralContainer &inspiral, double power22, double &plusYlm, double &crossYlm, double theta);
+  HarmonicModeContainer selectModes(const InspiralContainer &inspiral, double theta);
 
-  double modePower(int l, int m, InspiralContainer &inspiral, HarmonicOptions opts);
-  int gradeMode(int l, int m, InspiralContainer &inspiral, double power22, HarmonicOptions opts);
-  int gradeMode(int l, int m, InspiralContainer &inspiral, double power22, double &plusYlm, double &crossYlm, double theta, HarmonicOptions opts);
-  HarmonicModeContainer selectModes(InspiralContainer &inspiral, double theta, HarmonicOptions opts);
+  double modePower(int l, int m, const InspiralContainer &inspiral, HarmonicOptions opts);
+  int gradeMode(int l, int m, const InspiralContainer &inspiral, double power22, HarmonicOptions opts);
+  int gradeMode(int l, int m, const InspiralContainer &inspiral, double power22, double &plusYlm, double &crossYlm, double theta, HarmonicOptions opts);
+  HarmonicModeContainer selectModes(const InspiralContainer &inspiral, double theta, HarmonicOptions opts);
 
   HarmonicOptions getHarmonicOptions();
 
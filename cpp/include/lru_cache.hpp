@@ -0,0 +1,133 @@
+#ifndef LRU_CACHE_HPP
+#define LRU_CACHE_HPP
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+// Bounded least-recently-used cache of shared values. Lookups and insertions
+// are serialized by a mutex, so a single cache can be shared by threads, and
+// values are handed out as shared_ptr, so an evicted entry stays alive for as
+// long as a caller holds it. Entries are kept in a recency list and found
+// through a hash index into it, so lookups, insertions and evictions take
+// constant time at any capacity. Keys need == and a hash, std::hash<Key> by
+// default. A capacity of 0 disables caching.
+// Every entry costs 1 against the capacity unless inserted with its own cost
+// (e.g. its size in bytes), in which case the capacity bounds the total cost
+template <typename Key, typename Value, typename Hash = std::hash<Key> >
+class LRUCache{
+public:
+	LRUCache(size_t capacity): _capacity(capacity), _cost(0), _hits(0), _misses(0) {}
+
+	// returns the cached value and marks it as most recently used, or a null
+	// pointer if the key is not cached
+	std::shared_ptr<Value> find(const Key &key){
+		std::lock_guard<std::mutex> lock(_mutex);
+		typename EntryIndex::iterator found = _index.find(key);
+		if(found == _index.end()){
+			_misses++;
+			return std::shared_ptr<Value>();
+		}
+		_entries.splice(_entries.begin(), _entries, found->second);
+		_hits++;
+		return _entries.front().value;
+	}
+
+	// inserts a value as most recently used, evicting the least recently used
+	// entries until the cost fits the capacity. A value already cached under the
+	// key is replaced, and a value that costs more than the capacity is not cached
+	void insert(const Key &key, std::shared_ptr<Value> value, size_t cost = 1){
+		std::lock_guard<std::mutex> lock(_mutex);
+		typename EntryIndex::iterator found = _index.find(key);
+		if(found != _index.end()){
+			_cost -= found->second->cost;
+			_entries.erase(found->second);
+			_index.erase(found);
+		}
+		if(cost > _capacity){
+			return;
+		}
+		Entry entry = {key, value, cost};
+		_entries.push_front(entry);
+		_index[key] = _entries.begin();
+		_cost += cost;
+		evict();
+	}
+
+	void clear(){
+		std::lock_guard<std::mutex> lock(_mutex);
+		_entries.clear();
+		_index.clear();
+		_cost = 0;
+	}
+
+	size_t size(){
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _entries.size();
+	}
+
+	size_t capacity(){
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _capacity;
+	}
+
+	// evicts the least recently used entries that no longer fit
+	void setCapacity(size_t capacity){
+		std::lock_guard<std::mutex> lock(_mutex);
+		_capacity = capacity;
+		evict();
+	}
+
+	// total cost of the cached entries
+	size_t cost(){
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _cost;
+	}
+
+	// number of calls to find that did and did not return a value
+	size_t hits(){
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _hits;
+	}
+
+	size_t misses(){
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _misses;
+	}
+
+	void resetCounters(){
+		std::lock_guard<std::mutex> lock(_mutex);
+		_hits = 0;
+		_misses = 0;
+	}
+
+private:
+	struct Entry{
+		Key key;
+		std::shared_ptr<Value> value;
+		size_t cost;
+	};
+	typedef std::list<Entry> EntryList;
+	typedef std::unordered_map<Key, typename EntryList::iterator, Hash> EntryIndex;
+
+	void evict(){
+		while(_cost > _capacity){
+			_cost -= _entries.back().cost;
+			_index.erase(_entries.back().key);
+			_entries.pop_back();
+		}
+	}
+
+	std::mutex _mutex;
+	EntryList _entries;
+	EntryIndex _index;
+	size_t _capacity;
+	size_t _cost;
+	size_t _hits;
+	size_t _misses;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Read-only memory mapping of a whole file. The pages are shared with every
+// other process that maps the same file and are only read from disk when they
+// are first touched, so opening a large file costs little more than the
+// system calls. The mapping lives as long as the object, which is typically
+// held by a shared_ptr in every structure that points into it
+class MappedFile{
+public:
+	MappedFile(const std::string &filename): _data(nullptr), _size(0) {
+		int fd = open(filename.c_str(), O_RDONLY);
+		if(fd < 0){
+			return;
+		}
+		struct stat fileStat;
+		if(fstat(fd, &fileStat) == 0 && fileStat.st_size > 0){
+			void *data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			if(data != MAP_FAILED){
+				_data = static_cast<const char*>(data);
+				_size = fileStat.st_size;
+			}
+		}
+		// the mapping stays valid after the descriptor is closed
+		close(fd);
+	}
+
+	~MappedFile(){
+		if(_data != nullptr){
+			munmap(const_cast<char*>(_data), _size);
+		}
+	}
+
+	bool isOpen() const{
+		return _data != nullptr;
+	}
+
+	const char* data() const{
+		return _data;
+	}
+
+	size_t size() const{
+		return _size;
+	}
+
+	// whether count elements of element_size bytes, starting offset bytes into
+	// the file, lie within it. Compared by division, so that the byte counts of
+	// corrupt records cannot overflow
+	bool contains(uint64_t offset, uint64_t count, size_t element_size) const{
+		return offset <= _size && count <= (_size - offset)/element_size;
+	}
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const char *_data;
+	size_t _size;
+};
+
+#endif
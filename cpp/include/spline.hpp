@@ -3,8 +3,83 @@
 
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <memory>
 #include "omp.h"
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <stdint.h>
+#if defined(SPLINE_HUGE_PAGES) && defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+// the cell kernels are small but are called from many sites, which exhausts the
+// inlining budget of -O2, so they are forced inline where the compiler allows it
+#if defined(__GNUC__)
+#define SPLINE_INLINE inline __attribute__((always_inline))
+#else
+#define SPLINE_INLINE inline
+#endif
+
+// alignment in bytes of the Matrix and spline coefficient storage. With 64 the
+// 16 double-precision coefficients of a bicubic cell occupy exactly two cache
+// lines, and the 16 single-precision ones a single line
+#ifndef SPLINE_ALIGNMENT
+#define SPLINE_ALIGNMENT 64
+#endif
+
+// with SPLINE_HUGE_PAGES defined, allocations of at least this many bytes are
+// aligned to it and advised to be backed by transparent huge pages (Linux only)
+#define SPLINE_HUGE_PAGE_SIZE 2097152
+
+// with SPLINE_PREFETCH defined, the cursors prefetch the next cell along the
+// direction of their sweep whenever they enter a new cell
+
+template <typename T>
+class AlignedAllocator{
+public:
+	typedef T value_type;
+
+	AlignedAllocator() {}
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U> &) {}
+
+	T* allocate(size_t n){
+		size_t bytes = n*sizeof(T);
+		size_t alignment = SPLINE_ALIGNMENT;
+#if defined(SPLINE_HUGE_PAGES) && defined(__linux__)
+		if(bytes >= SPLINE_HUGE_PAGE_SIZE){
+			alignment = SPLINE_HUGE_PAGE_SIZE;
+		}
+#endif
+		void *p = nullptr;
+		if(posix_memalign(&p, alignment, bytes) != 0){
+			throw std::bad_alloc();
+		}
+#if defined(SPLINE_HUGE_PAGES) && defined(__linux__)
+		if(bytes >= SPLINE_HUGE_PAGE_SIZE){
+			madvise(p, bytes, MADV_HUGEPAGE);
+		}
+#endif
+		return static_cast<T*>(p);
+	}
+
+	void deallocate(T *p, size_t){
+		free(p);
+	}
+};
+
+template <typename T, typename U>
+bool operator==(const AlignedAllocator<T> &, const AlignedAllocator<U> &){
+	return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const AlignedAllocator<T> &, const AlignedAllocator<U> &){
+	return false;
+}
 
 class StopWatch{
 public:
@@ -24,6 +99,12 @@ private:
 };
 
 typedef std::vector<double> Vector;
+typedef std::vector<double, AlignedAllocator<double> > AlignedVector;
+typedef std::vector<float, AlignedAllocator<float> > AlignedFloatVector;
+
+// dense row-major matrix. The storage is aligned to SPLINE_ALIGNMENT, so the
+// (nx, 16*ny) coefficient tables of the bicubic splines, which are already
+// laid out cell by cell, start every cell on a cache-line boundary
 class Matrix{
 public:
 	Matrix();
@@ -52,18 +133,95 @@ public:
 	double& operator()(int i, int j);
 	const double& operator()(int i, int j) const;
 
+	double* data();
+	const double* data() const;
+
 private:
 	int _n;
 	int _m;
-	Vector _A;
+	AlignedVector _A;
 };
 
+// element access is defined here so that it inlines into the spline kernels
+inline double& Matrix::operator()(int i, int j){
+	return _A[i*_m + j];
+}
+inline const double& Matrix::operator()(int i, int j) const{
+	return _A[i*_m + j];
+}
+
+inline double* Matrix::data(){
+	return _A.data();
+}
+inline const double* Matrix::data() const{
+	return _A.data();
+}
+
+/////////////////////////////////////////////////////////
+////                  Cell Kernels                   ////
+/////////////////////////////////////////////////////////
+
+// n-th derivative of a0 + a1*t + a2*t^2 + a3*t^3. Each order is its own
+// specialization, so the kernels below reduce to straight-line code
+template <int n>
+SPLINE_INLINE double cubic_polynomial_derivative(const double /* a0 */, const double /* a1 */, const double /* a2 */, const double /* a3 */, const double /* t */){
+	return 0.;
+}
+
+template <>
+SPLINE_INLINE double cubic_polynomial_derivative<0>(const double a0, const double a1, const double a2, const double a3, const double t){
+	return a0 + t*(a1 + t*(a2 + a3*t));
+}
+
+template <>
+SPLINE_INLINE double cubic_polynomial_derivative<1>(const double /* a0 */, const double a1, const double a2, const double a3, const double t){
+	return a1 + t*(2.*a2 + 3.*a3*t);
+}
+
+template <>
+SPLINE_INLINE double cubic_polynomial_derivative<2>(const double /* a0 */, const double /* a1 */, const double a2, const double a3, const double t){
+	return 2.*(a2 + 3.*a3*t);
+}
+
+template <>
+SPLINE_INLINE double cubic_polynomial_derivative<3>(const double /* a0 */, const double /* a1 */, const double /* a2 */, const double a3, const double /* t */){
+	return 6.*a3;
+}
+
+// (dx_order, dy_order) derivative in the normalized coordinates of a bicubic cell
+template <int dx_order, int dy_order, typename T>
+SPLINE_INLINE double bicubic_cell(const T *c, const int cell, const double xbar, const double ybar){
+	double z0 = cubic_polynomial_derivative<dy_order>(c[cell + 0], c[cell + 1], c[cell + 2], c[cell + 3], ybar);
+	double z1 = cubic_polynomial_derivative<dy_order>(c[cell + 4], c[cell + 5], c[cell + 6], c[cell + 7], ybar);
+	double z2 = cubic_polynomial_derivative<dy_order>(c[cell + 8], c[cell + 9], c[cell + 10], c[cell + 11], ybar);
+	double z3 = cubic_polynomial_derivative<dy_order>(c[cell + 12], c[cell + 13], c[cell + 14], c[cell + 15], ybar);
+	return cubic_polynomial_derivative<dx_order>(z0, z1, z2, z3, xbar);
+}
+
+// value and normalized gradient of a bicubic cell from a single pass over its coefficients
+template <typename T>
+SPLINE_INLINE void bicubic_cell_gradient(double &z, double &dzdx, double &dzdy, const T *c, const int cell, const double xbar, const double ybar){
+	double z0 = cubic_polynomial_derivative<0>(c[cell + 0], c[cell + 1], c[cell + 2], c[cell + 3], ybar);
+	double z1 = cubic_polynomial_derivative<0>(c[cell + 4], c[cell + 5], c[cell + 6], c[cell + 7], ybar);
+	double z2 = cubic_polynomial_derivative<0>(c[cell + 8], c[cell + 9], c[cell + 10], c[cell + 11], ybar);
+	double z3 = cubic_polynomial_derivative<0>(c[cell + 12], c[cell + 13], c[cell + 14], c[cell + 15], ybar);
+	double w0 = cubic_polynomial_derivative<1>(c[cell + 0], c[cell + 1], c[cell + 2], c[cell + 3], ybar);
+	double w1 = cubic_polynomial_derivative<1>(c[cell + 4], c[cell + 5], c[cell + 6], c[cell + 7], ybar);
+	double w2 = cubic_polynomial_derivative<1>(c[cell + 8], c[cell + 9], c[cell + 10], c[cell + 11], ybar);
+	double w3 = cubic_polynomial_derivative<1>(c[cell + 12], c[cell + 13], c[cell + 14], c[cell + 15], ybar);
+	z = cubic_polynomial_derivative<0>(z0, z1, z2, z3, xbar);
+	dzdx = cubic_polynomial_derivative<1>(z0, z1, z2, z3, xbar);
+	dzdy = cubic_polynomial_derivative<0>(w0, w1, w2, w3, xbar);
+}
+
 /////////////////////////////////////////////////////////
 ////               Basic Interpolators               ////
 /////////////////////////////////////////////////////////
 
 class CubicSpline{
 public:
+	// empty spline, only meant as a placeholder until one is assigned
+	CubicSpline();
 	CubicSpline(double x0, double dx, const Vector &y, int method = 1);
 	CubicSpline(const Vector &x, const Vector &y, int method = 1);
 
@@ -73,9 +231,23 @@ public:
     double derivative(const double x);
     double derivative2(const double x);
 
+	// batched evaluation over n points, vectorized across points
+	void evaluate(double y[], const double x[], int n);
+
+	// the nintervals + 1 nodes of the spline
+	Vector nodes() const;
+
 	double getSplineCoefficient(int i, int j);
 
+	// stores the coefficients in single precision, which halves the memory
+	// traffic of evaluation. Evaluation still accumulates in double
+	void convertToSinglePrecision();
+	bool singlePrecision() const;
+
 private:
+	friend class CubicSplineCursor;
+	double coefficient(int i, int k) const;
+	template <typename T> void evaluateBatch(const T *c, double y[], const double x[], int n);
 	double evaluateInterval(int i, const double x);
     double evaluateDerivativeInterval(int i, const double x);
     double evaluateSecondDerivativeInterval(int i, const double x);
@@ -90,30 +262,105 @@ private:
 	int nintervals;
 	double x0;
 	Matrix cij;
+	AlignedFloatVector cij_single;
+	bool single_precision;
 };
 
+// grid of a bicubic spline, or of a bundle of nfields splines, and its
+// 16*nfields*nx*ny coefficients laid out cell by cell as in the coefficient tables
+typedef struct BicubicSplineDataStruct{
+	double x0;
+	double dx;
+	int nx;
+	double y0;
+	double dy;
+	int ny;
+	int nfields;
+	const double *coefficients;
+} BicubicSplineData;
+
+// whether the grid of data is usable, with finite origins, finite and positive
+// spacings and positive dimensions, and matches a table of count coefficients.
+// Meant for grids read from files, where a zero or NaN spacing would make every
+// cell lookup undefined
+inline bool valid_spline_data(const BicubicSplineData &data, uint64_t count){
+	if(!(std::isfinite(data.x0) && std::isfinite(data.y0) && std::isfinite(data.dx) && std::isfinite(data.dy))){
+		return false;
+	}
+	if(!(data.dx > 0. && data.dy > 0.) || data.nx <= 0 || data.ny <= 0 || data.nfields <= 0){
+		return false;
+	}
+	// count = 16*nfields*nx*ny, divided out so that large dimensions cannot overflow
+	uint64_t cells = count/16;
+	return (count % 16 == 0) && (cells % data.nfields == 0) && (cells/data.nfields % data.nx == 0) && (cells/data.nfields/data.nx == uint64_t(data.ny));
+}
+
 class BicubicSpline{
 public:
 	BicubicSpline(const Vector &x, const Vector &y, Matrix &z, int method = 3);
 	BicubicSpline(double x0, double dx, int nx, double y0, double dy, int ny, Matrix &z, int method = 3);
 	BicubicSpline(const Vector &x, const Vector &y, const Vector &z, int method = 3);
 	BicubicSpline(double x0, double dx, int nx, double y0, double dy, int ny, const Vector &z_vec, int method = 3);
+	// wraps precomputed coefficients, e.g. in a memory-mapped file, without
+	// copying them. storage keeps the memory of the coefficients alive
+	BicubicSpline(const BicubicSplineData &data, std::shared_ptr<const void> storage);
+
+	// grid and coefficients of the spline, which keeps ownership of them.
+	// Only available while the coefficients are stored in double precision
+	BicubicSplineData data() const;
 	double evaluate(const double x, const double y);
     double derivative_x(const double x, const double y);
     double derivative_y(const double x, const double y);
     double derivative_xy(const double x, const double y);
     double derivative_xx(const double x, const double y);
     double derivative_yy(const double x, const double y);
+
+	// (dx_order, dy_order) derivative at (x, y). The scalar methods above are
+	// specializations of this kernel and are all inlined at the call site
+	template <int dx_order, int dy_order>
+	double evaluate(const double x, const double y);
+	// value and gradient at (x, y) from a single cell lookup
+	void evaluateAll(double &z, double &dzdx, double &dzdy, const double x, const double y);
+
+	// batched evaluation over n points, vectorized across points with
+	// gathered coefficient loads (AVX2/AVX-512 when compiled with -march=native)
+	void evaluate(double z[], const double x[], const double y[], int n);
+	void evaluate(double z[], const double x, const double y[], int n);
+	void derivative_x(double dzdx[], const double x[], const double y[], int n);
+	void derivative_y(double dzdy[], const double x[], const double y[], int n);
+	void derivative_y(double dzdy[], const double x, const double y[], int n);
+	void evaluate_gradient(double z[], double dzdx[], double dzdy[], const double x[], const double y[], int n);
+
+	// 1D splines along y at fixed x (reduce_x) or along x at fixed y (reduce_y).
+	// They reproduce the bicubic spline on that line, so repeated queries at a
+	// fixed coordinate only cost a cubic polynomial
     CubicSpline reduce_x(const double x);
     CubicSpline reduce_y(const double y);
 
+	// stores the coefficients in single precision, which halves the memory
+	// traffic of evaluation. Evaluation still accumulates in double
+	void convertToSinglePrecision();
+	bool singlePrecision() const;
+
+	// boundaries of the grid
+	double xmin() const;
+	double xmax() const;
+	double ymin() const;
+	double ymax() const;
+
 private:
-	double evaluateInterval(int i, int j, const double x, const double y);
-    double evaluateDerivativeXInterval(int i, int j, const double x, const double y);
-    double evaluateDerivativeYInterval(int i, int j, const double x, const double y);
-    double evaluateDerivativeXYInterval(int i, int j, const double x, const double y);
-    double evaluateDerivativeXXInterval(int i, int j, const double x, const double y);
-    double evaluateDerivativeYYInterval(int i, int j, const double x, const double y);
+	friend class BicubicSplineBundle;
+	friend class BicubicSplineCursor;
+	double coefficient(int i, int k) const;
+	template <typename T> void evaluateBatch(const T *c, double z[], const double x[], const double y[], int n);
+	template <typename T> void evaluateBatch(const T *c, double z[], const double x, const double y[], int n);
+	template <typename T> void derivativeXBatch(const T *c, double dzdx[], const double x[], const double y[], int n);
+	template <typename T> void derivativeYBatch(const T *c, double dzdy[], const double x[], const double y[], int n);
+	template <typename T> void derivativeYBatch(const T *c, double dzdy[], const double x, const double y[], int n);
+	template <typename T> void gradientBatch(const T *c, double z[], double dzdx[], double dzdy[], const double x[], const double y[], int n);
+	const double* coefficients() const;
+	int cellIndex(int i, int j) const;
+	void prefetchCell(int i, int j) const;
 	Matrix computeSplineCoefficientsDX(Matrix &m_z, int method = 3);
 	Matrix computeSplineCoefficientsDY(Matrix &m_z, int method = 3);
 	void computeSplineCoefficients(Matrix &z, int method = 3);
@@ -127,6 +374,361 @@ private:
 	double x0;
 	double y0;
 	Matrix cij;
+	AlignedFloatVector cij_single;
+	bool single_precision;
+	// coefficients that are not owned, which take the place of cij when set
+	const double *mapped_cij;
+	std::shared_ptr<const void> mapped_storage;
 };
 
-#endif
\ No newline at end of file
+SPLINE_INLINE int CubicSpline::findInterval(const double x){
+	// clamp without early returns so that the batched loop can if-convert it
+	int i = static_cast<int>((x-x0)/dx);
+    if(i >= nintervals){
+        i = nintervals - 1;
+    }
+	if(i < 0){
+		i = 0;
+	}
+	return i;
+}
+
+SPLINE_INLINE int BicubicSpline::findXInterval(const double x){
+	// clamp without early returns so that the batched loops can if-convert it
+	int i = static_cast<int>((x-x0)/dx);
+    if(i >= nx){
+        i = nx - 1;
+    }
+	if(i < 0){
+		i = 0;
+	}
+	return i;
+}
+
+SPLINE_INLINE int BicubicSpline::findYInterval(const double y){
+	int i = static_cast<int>((y-y0)/dy);
+    if(i >= ny){
+        i = ny - 1;
+    }
+	if(i < 0){
+		i = 0;
+	}
+	return i;
+}
+
+SPLINE_INLINE const double* BicubicSpline::coefficients() const{
+	return mapped_cij ? mapped_cij : cij.data();
+}
+
+// offset of the first coefficient of cell (i, j)
+SPLINE_INLINE int BicubicSpline::cellIndex(int i, int j) const{
+	return 16*(ny*i + j);
+}
+
+// hint that cell (i, j) will be read soon, if it lies on the grid. A no-op
+// unless SPLINE_PREFETCH is defined
+SPLINE_INLINE void BicubicSpline::prefetchCell(int i, int j) const{
+#if defined(SPLINE_PREFETCH) && defined(__GNUC__)
+	if(i < 0 || i >= nx || j < 0 || j >= ny){
+		return;
+	}
+	const char *p;
+	if(single_precision){
+		p = reinterpret_cast<const char*>(cij_single.data() + cellIndex(i, j));
+	}else{
+		p = reinterpret_cast<const char*>(coefficients() + cellIndex(i, j));
+	}
+	__builtin_prefetch(p);
+	__builtin_prefetch(p + 64);
+#else
+	(void)i;
+	(void)j;
+#endif
+}
+
+SPLINE_INLINE double BicubicSpline::coefficient(int i, int k) const{
+	if(single_precision){
+		return cij_single[16*ny*i + k];
+	}
+	return coefficients()[16*ny*i + k];
+}
+
+template <int dx_order, int dy_order>
+SPLINE_INLINE double BicubicSpline::evaluate(const double x, const double y){
+	int i = findXInterval(x);
+	int j = findYInterval(y);
+	double xbar = (x - x0 - i*dx)/dx;
+	double ybar = (y - y0 - j*dy)/dy;
+	double result;
+	if(single_precision){
+		result = bicubic_cell<dx_order, dy_order>(cij_single.data(), cellIndex(i, j), xbar, ybar);
+	}else{
+		result = bicubic_cell<dx_order, dy_order>(coefficients(), cellIndex(i, j), xbar, ybar);
+	}
+	for(int n = 0; n < dx_order; n++){
+		result /= dx;
+	}
+	for(int n = 0; n < dy_order; n++){
+		result /= dy;
+	}
+	return result;
+}
+
+SPLINE_INLINE void BicubicSpline::evaluateAll(double &z, double &dzdx, double &dzdy, const double x, const double y){
+	int i = findXInterval(x);
+	int j = findYInterval(y);
+	double xbar = (x - x0 - i*dx)/dx;
+	double ybar = (y - y0 - j*dy)/dy;
+	if(single_precision){
+		bicubic_cell_gradient(z, dzdx, dzdy, cij_single.data(), cellIndex(i, j), xbar, ybar);
+	}else{
+		bicubic_cell_gradient(z, dzdx, dzdy, coefficients(), cellIndex(i, j), xbar, ybar);
+	}
+	dzdx /= dx;
+	dzdy /= dy;
+}
+
+inline double BicubicSpline::evaluate(const double x, const double y){
+	return evaluate<0, 0>(x, y);
+}
+
+inline double BicubicSpline::derivative_x(const double x, const double y){
+	return evaluate<1, 0>(x, y);
+}
+
+inline double BicubicSpline::derivative_y(const double x, const double y){
+	return evaluate<0, 1>(x, y);
+}
+
+inline double BicubicSpline::derivative_xy(const double x, const double y){
+	return evaluate<1, 1>(x, y);
+}
+
+inline double BicubicSpline::derivative_xx(const double x, const double y){
+	return evaluate<2, 0>(x, y);
+}
+
+inline double BicubicSpline::derivative_yy(const double x, const double y){
+	return evaluate<0, 2>(x, y);
+}
+
+/////////////////////////////////////////////////////////
+////                 Spline Cursors                  ////
+/////////////////////////////////////////////////////////
+
+// Cursors are meant for sweeps where successive queries stay in the same cell
+// or move to a neighbouring one (e.g., alpha along an inspiral). The current
+// cell and its coefficients are cached, and the cell is only searched for again
+// once a query leaves it. The cell bounds are tested so that a NaN query also
+// searches for its cell, as the first query must. A cursor is cheap to
+// construct, so each thread should hold its own
+
+class CubicSplineCursor{
+public:
+	CubicSplineCursor(const CubicSpline &spline);
+
+	double evaluate(const double x);
+	double derivative(const double x);
+	double derivative2(const double x);
+
+private:
+	void locate(const double x);
+
+	const CubicSpline &_spline;
+	int _i;
+	double _xlow;
+	double _xhigh;
+	double _c[4];
+};
+
+// With a fixed x, the cursor pre-reduces the x-direction of each cell it
+// enters, so that queries in y only cost a cubic polynomial
+class BicubicSplineCursor{
+public:
+	BicubicSplineCursor(const BicubicSpline &spline);
+	BicubicSplineCursor(const BicubicSpline &spline, const double x);
+
+	// free (x, y) queries
+	double evaluate(const double x, const double y);
+	double derivative_x(const double x, const double y);
+	double derivative_y(const double x, const double y);
+
+	// queries along the fixed x of the cursor
+	double evaluate(const double y);
+	double derivative_y(const double y);
+
+private:
+	void locate(const double x, const double y);
+	void locate(const double y);
+
+	const BicubicSpline &_spline;
+	int _i;
+	int _j;
+	double _xlow;
+	double _xhigh;
+	double _ylow;
+	double _yhigh;
+	double _c[16];
+
+	int _ifixed;
+	int _jfixed;
+	double _xbar;
+	double _yfixedlow;
+	double _yfixedhigh;
+	double _r[4];
+};
+
+// K bicubic splines that share the same grid. The coefficients of all fields
+// are interleaved cell by cell, so a single interval search and a contiguous
+// block of 16*K coefficients serves every field at a given (x, y)
+class BicubicSplineBundle{
+public:
+	BicubicSplineBundle(const Vector &x, const Vector &y, const std::vector<Vector> &z, int method = 3);
+	BicubicSplineBundle(double x0, double dx, int nx, double y0, double dy, int ny, const std::vector<Vector> &z, int method = 3);
+	// wraps precomputed coefficients without copying them, as for BicubicSpline
+	BicubicSplineBundle(const BicubicSplineData &data, std::shared_ptr<const void> storage);
+
+	BicubicSplineData data() const;
+
+	int fields() const;
+
+	void evaluate(double z[], const double x, const double y);
+	double evaluate(int k, const double x, const double y);
+	double derivative_x(int k, const double x, const double y);
+	double derivative_y(int k, const double x, const double y);
+	void evaluateAll(int k, double &z, double &dzdx, double &dzdy, const double x, const double y);
+
+	// field k along y at fixed x, as in BicubicSpline::reduce_x
+	CubicSpline reduce_x(int k, const double x);
+
+	void convertToSinglePrecision();
+	bool singlePrecision() const;
+
+private:
+	int findXInterval(const double x);
+	int findYInterval(const double y);
+	const double* coefficients() const;
+
+	double dx;
+	double dy;
+	int nx;
+	int ny;
+	double x0;
+	double y0;
+	int nfields;
+	Matrix cij;
+	AlignedFloatVector cij_single;
+	bool single_precision;
+	const double *mapped_cij;
+	std::shared_ptr<const void> mapped_storage;
+};
+
+/////////////////////////////////////////////////////////
+////              Chebyshev Expansions               ////
+/////////////////////////////////////////////////////////
+
+#define CHEBYSHEV_ORDER 16 // highest degree of a single piece
+#define CHEBYSHEV_MAX_DEPTH 200 // times a piece may be bisected
+
+// Piecewise Chebyshev expansion of a 1D function on [xmin, xmax]. Construction
+// starts from the given breakpoints (e.g., the nodes of a spline, where the
+// function may lose smoothness) and bisects every piece whose error, checked
+// against f between the fitting nodes, exceeds the tolerance. Each piece keeps
+// only the coefficients it needs and is summed with the Clenshaw recurrence,
+// so evaluation is polynomial arithmetic only. Beyond [xmin, xmax] the end
+// pieces are extrapolated
+class ChebyshevExpansion{
+public:
+	ChebyshevExpansion();
+	ChebyshevExpansion(std::function<double(double)> f, const Vector &breakpoints, double tolerance, int order = CHEBYSHEV_ORDER);
+
+	double evaluate(const double x) const;
+
+	double xmin() const;
+	double xmax() const;
+	int pieces() const;
+	// largest error found at the test points of the pieces. It only exceeds
+	// the tolerance where the tolerance is below the round-off of f or where
+	// CHEBYSHEV_MAX_DEPTH was reached
+	double maxError() const;
+
+private:
+	void fitPiece(std::function<double(double)> &f, double a, double b, int depth);
+	int findPiece(const double x) const;
+
+	int _order;
+	double _tolerance;
+	double _max_error;
+	Vector _breakpoints;
+	Vector _center;
+	Vector _inverse_half_width;
+	std::vector<int> _offset;
+	Vector _coefficients;
+};
+
+/////////////////////////////////////////////////////////
+////                  Lookup Tables                  ////
+/////////////////////////////////////////////////////////
+
+// Linear interpolation on a uniform grid, a cheaper and less accurate stand-in
+// for CubicSpline when many samples are needed. Queries beyond the grid are
+// clamped to its ends
+class LinearTable{
+public:
+	LinearTable();
+	LinearTable(double x0, double dx, const Vector &y);
+
+	double evaluate(const double x) const;
+	double derivative(const double x) const;
+	// batched evaluation over n points, vectorized across points
+	void evaluate(double y[], const double x[], int n) const;
+
+private:
+	double _x0;
+	double _dx;
+	double _inverse_dx;
+	int _nintervals;
+	AlignedVector _y;
+};
+
+// Bilinear interpolation on a uniform grid, with z[i*(ny + 1) + j] the value
+// at (x0 + i*dx, y0 + j*dy). Queries beyond the grid are clamped to its edges
+class BilinearTable{
+public:
+	BilinearTable();
+	BilinearTable(double x0, double dx, int nx, double y0, double dy, int ny, const Vector &z);
+
+	double evaluate(const double x, const double y) const;
+	double derivative_y(const double x, const double y) const;
+
+	// the table along y at fixed x, which reproduces the bilinear interpolant on that line
+	LinearTable reduce_x(const double x) const;
+
+private:
+	double _x0;
+	double _inverse_dx;
+	int _nx;
+	double _y0;
+	double _dy;
+	double _inverse_dy;
+	int _ny;
+	AlignedVector _z;
+};
+
+// cell of a uniform grid of n intervals containing u = (x - x0)/dx, and the
+// position t in [0, 1] within it. u is clamped to the grid without branches so
+// that batched loops can vectorize
+SPLINE_INLINE int uniform_cell(double &t, double u, int n){
+	u = std::max(0., std::min(u, double(n)));
+	int i = std::min(static_cast<int>(u), n - 1);
+	t = u - i;
+	return i;
+}
+
+SPLINE_INLINE double LinearTable::evaluate(const double x) const{
+	double t;
+	int i = uniform_cell(t, (x - _x0)*_inverse_dx, _nintervals);
+	return _y[i] + t*(_y[i + 1] - _y[i]);
+}
+
+#endif
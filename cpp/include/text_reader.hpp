@@ -0,0 +1,181 @@
+#ifndef TEXT_READER_HPP
+#define TEXT_READER_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <stdint.h>
+
+// Converts the number at p, which may be preceded by spaces or tabs, and moves
+// p past it. Returns false, leaving p unchanged, if the text at p up to end is
+// not a number followed by whitespace. Numbers whose decimal mantissa and power
+// of ten are both exact in double precision (at most 2^53 and 22) are converted
+// with a single multiplication or division, which is correctly rounded
+// (Clinger's fast path); all others are handed to strtod. Either way the result
+// is the correctly rounded double, as with operator>> of the standard streams
+inline bool parse_number(const char *&p, const char *end, double &x){
+	static const double powersOfTen[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	const char *s = p;
+	while(s < end && (*s == ' ' || *s == '\t' || *s == '\r')){
+		s++;
+	}
+	const char *q = s;
+	bool negative = false;
+	if(q < end && (*q == '-' || *q == '+')){
+		negative = (*q == '-');
+		q++;
+	}
+
+	// at most 19 significant digits fit in the mantissa. Further digits only
+	// shift the exponent, and such numbers always take the strtod path
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool anyDigit = false;
+	while(q < end && *q >= '0' && *q <= '9'){
+		if(digits < 19){
+			mantissa = 10*mantissa + (*q - '0');
+			digits += (mantissa > 0);
+		}else{
+			exponent++;
+		}
+		anyDigit = true;
+		q++;
+	}
+	if(q < end && *q == '.'){
+		q++;
+		while(q < end && *q >= '0' && *q <= '9'){
+			if(digits < 19){
+				mantissa = 10*mantissa + (*q - '0');
+				digits += (mantissa > 0);
+				exponent--;
+			}
+			anyDigit = true;
+			q++;
+		}
+	}
+	if(!anyDigit){
+		return false;
+	}
+	if(q < end && (*q == 'e' || *q == 'E')){
+		q++;
+		bool negativeExponent = false;
+		if(q < end && (*q == '-' || *q == '+')){
+			negativeExponent = (*q == '-');
+			q++;
+		}
+		if(q == end || *q < '0' || *q > '9'){
+			return false;
+		}
+		int e = 0;
+		while(q < end && *q >= '0' && *q <= '9'){
+			if(e < 100000){
+				e = 10*e + (*q - '0');
+			}
+			q++;
+		}
+		exponent += negativeExponent ? -e : e;
+	}
+	if(q < end && *q != ' ' && *q != '\t' && *q != '\r' && *q != '\n'){
+		return false;
+	}
+
+	if(mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22){
+		x = static_cast<double>(mantissa);
+		x = (exponent < 0) ? x/powersOfTen[-exponent] : x*powersOfTen[exponent];
+		if(negative){
+			x = -x;
+		}
+	}else{
+		// the buffers of TextFile are null-terminated and the number ends at q
+		x = strtod(s, nullptr);
+	}
+	p = q;
+	return true;
+}
+
+// A whitespace-separated text data file, read into memory with a single call.
+// The start of every line is indexed on loading, after which lines can be
+// parsed in any order and from several threads at once
+class TextFile{
+public:
+	TextFile(const std::string &filename): _open(false) {
+		std::ifstream inFile(filename, std::ios::binary | std::ios::ate);
+		if(!inFile){
+			return;
+		}
+		std::streamsize size = inFile.tellg();
+		inFile.seekg(0, std::ios::beg);
+		_buffer.resize(size);
+		if(size > 0 && !inFile.read(&_buffer[0], size)){
+			_buffer.clear();
+			return;
+		}
+		_open = true;
+
+		// line k spans [_line_start[k], _line_start[k + 1] - 1), which ends at its newline
+		const char *begin = _buffer.data();
+		const char *end = begin + _buffer.size();
+		_line_start.push_back(0);
+		for(const char *c = begin; (c = static_cast<const char*>(memchr(c, '\n', end - c))) != nullptr; c++){
+			_line_start.push_back(c - begin + 1);
+		}
+		_line_start.push_back(_buffer.size() + 1);
+	}
+
+	bool isOpen() const{
+		return _open;
+	}
+
+	// 0 if the file could not be read
+	size_t lines() const{
+		return _line_start.empty() ? 0 : _line_start.size() - 1;
+	}
+
+	// the first line that is not empty, a comment (#) or a text header, which
+	// is where the data files put their sample counts
+	size_t firstDataLine() const{
+		for(size_t k = 0; k < lines(); k++){
+			const char *c = lineBegin(k);
+			if(c < lineEnd(k) && *c != '#' && *c != '\r' && !isalpha(static_cast<unsigned char>(*c))){
+				return k;
+			}
+		}
+		return lines();
+	}
+
+	// parses the first n numbers of line k into values. Returns false if the
+	// line does not exist or does not start with n numbers
+	bool parseLine(size_t k, double values[], int n) const{
+		if(k >= lines()){
+			return false;
+		}
+		const char *p = lineBegin(k);
+		const char *end = lineEnd(k);
+		for(int i = 0; i < n; i++){
+			if(!parse_number(p, end, values[i])){
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	const char* lineBegin(size_t k) const{
+		return _buffer.data() + _line_start[k];
+	}
+
+	const char* lineEnd(size_t k) const{
+		return _buffer.data() + _line_start[k + 1] - 1;
+	}
+
+	bool _open;
+	std::string _buffer;
+	std::vector<size_t> _line_start;
+};
+
+#endif
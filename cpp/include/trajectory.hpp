@@ -6,9 +6,91 @@
 #include <fstream>
 #include <iostream>
 #include <cmath>
+#include <memory>
+#include <stdint.h>
 #include "spline.hpp"
+#include "lru_cache.hpp"
+#include "mapped_file.hpp"
+#include "text_reader.hpp"
+#include "execution_context.hpp"
 #include "omp.h"
 
+// spline groups of TrajectorySpline2D that can be stored in single precision,
+// combined as a bitmask when constructing the trajectory
+#define TRAJECTORY_FREQUENCY_DOMAIN_SINGLE_PRECISION 1 // time and phase on (chi, alpha)
+#define TRAJECTORY_FLUX_SINGLE_PRECISION 2
+#define TRAJECTORY_TIME_DOMAIN_SINGLE_PRECISION 4 // alpha, phase and frequency on (chi, beta)
+
+// number of spins whose reduced trajectory splines are kept by TrajectorySpline2D
+#define TRAJECTORY_SLICE_CACHE_SIZE 8
+// points per block in the array evaluations of the trajectory
+#define TRAJECTORY_BLOCK_SIZE 256
+
+// default tolerance of TrajectoryChebyshev, relative to the largest magnitude
+// of each function
+#define TRAJECTORY_CHEBYSHEV_TOLERANCE 1.e-13
+
+// engines that InspiralGenerator can step the inspiral with
+#define INSPIRAL_SPLINE_ENGINE 0
+#define INSPIRAL_CHEBYSHEV_ENGINE 1
+// number of spins whose Chebyshev evaluators are kept by InspiralGenerator
+#define INSPIRAL_CHEBYSHEV_CACHE_SIZE 8
+// sparse inspirals (a positive phase tolerance) start from this many intervals,
+// which are halved until alpha and the phase meet the tolerance. Pieces of at
+// most INSPIRAL_SPARSE_MIN_STEPS time steps are evaluated at every step instead
+#define INSPIRAL_SPARSE_INTERVALS 16
+#define INSPIRAL_SPARSE_MIN_STEPS 8
+// tolerances below this many round-off errors of the phase fall back to a dense inspiral
+#define INSPIRAL_SPARSE_ROUNDOFF 64
+// largest number of steps of a source that one thread takes in a batch of inspirals
+#define INSPIRAL_BATCH_BLOCK_STEPS 16384
+// default memory budget, in bytes, of the inspirals kept by InspiralGenerator,
+// which does not cache inspirals unless it is given a budget
+#define INSPIRAL_CACHE_BYTES 0
+// relative tolerance on the time to merger, and largest number of Newton
+// iterations, of InspiralGenerator::computeInitialRadius
+#define INITIAL_RADIUS_TOLERANCE 1.e-12
+#define INITIAL_RADIUS_MAX_ITERATIONS 50
+// samples per segment of a multirate sampling, and default number of samples
+// per cycle of the highest frequency that it resolves
+#define MULTIRATE_SEGMENT_STEPS 1024
+#define MULTIRATE_SAMPLES_PER_CYCLE 8.
+
+// Binary trajectory files hold the finished spline coefficients of a
+// TrajectorySpline2D, so that loading one maps the file instead of parsing the
+// text data and fitting the splines. A file consists of a TrajectoryBinaryHeader,
+// TRAJECTORY_BINARY_TABLES TrajectoryBinaryTable records (the frequency-domain
+// bundle, the flux spline and the time-domain bundle, in that order), and the
+// coefficients of each table starting at its offset, which is a multiple of
+// SPLINE_ALIGNMENT. Numbers are stored in the byte order of the machine that
+// wrote the file, which is checked on loading
+#define TRAJECTORY_BINARY_MAGIC "BHPWTRAJ"
+#define TRAJECTORY_BINARY_VERSION 1
+#define TRAJECTORY_BINARY_BYTE_ORDER 0x01020304
+#define TRAJECTORY_BINARY_TABLES 3
+
+typedef struct TrajectoryBinaryHeaderStruct{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t tables;
+	uint32_t reserved;
+	double time_norm_parameter;
+} TrajectoryBinaryHeader;
+
+typedef struct TrajectoryBinaryTableStruct{
+	double x0;
+	double dx;
+	double y0;
+	double dy;
+	int32_t nx;
+	int32_t ny;
+	int32_t nfields;
+	int32_t reserved;
+	uint64_t offset; // in bytes from the start of the file
+	uint64_t size; // number of coefficients
+} TrajectoryBinaryTable;
+
 typedef struct DataStruct{
 	Vector x;
 	Vector y;
@@ -37,13 +119,119 @@ public:
 Data read_data(const std::string& filename);
 TrajectoryData read_trajectory_data(std::string filename="data/trajectory.txt");
 
+// spline tables of a binary trajectory file, which point into its mapping
+class TrajectoryBinaryData{
+public:
+	std::shared_ptr<const MappedFile> file;
+	BicubicSplineData frequencyDomain;
+	BicubicSplineData flux;
+	BicubicSplineData timeDomain;
+	double timeNormParameter;
+};
+
+// maps a binary trajectory file and validates its header and tables. Throws
+// std::runtime_error if the file cannot be mapped or is not a valid trajectory file
+TrajectoryBinaryData read_trajectory_binary(std::string filename);
+// whether the file starts like a binary trajectory file
+bool is_trajectory_binary(std::string filename);
+// fits the splines of a text trajectory file and writes them in the binary format.
+// Returns 0 on success
+int convert_trajectory_file(std::string text_filename, std::string binary_filename);
+
+// The trajectory at a single chi, which is fixed along an inspiral. Each field
+// is reduced from its bicubic spline to a cubic spline in alpha or beta, so that
+// a query only evaluates a cubic polynomial, and the quantities that depend only
+// on the spin (the ISCO frequency, its cube root and the OMEGA_MIN terms of the
+// alpha(omega) map and the normalizations) are computed once. Built by
+// TrajectorySpline2D::slice, and its methods mirror the TrajectorySpline2D
+// methods of the same name at the spin of the slice
+class TrajectorySlice{
+public:
+	TrajectorySlice(double chi, double time_norm_parameter, CubicSpline time_spline, CubicSpline phase_spline, CubicSpline flux_spline, CubicSpline alpha_of_beta_spline, CubicSpline phase_of_beta_spline, CubicSpline frequency_of_beta_spline);
+
+	double getChi();
+	double getSpin();
+
+	// frequency domain
+	double time(double alpha);
+	double phase(double alpha);
+	double flux(double alpha);
+	double flux_norm(double alpha);
+	double orbital_frequency_time_derivative_from_flux(double alpha);
+	double time_of_alpha_omega_derivative(double alpha);
+
+	double time_of_omega(double omega);
+	double time_of_omega_derivative(double omega);
+	double phase_of_omega(double omega);
+	double phase_of_omega_derivative(double omega);
+	double flux_of_omega(double omega);
+	double orbital_frequency_time_derivative_from_flux_of_omega(double omega);
+
+	// the same at n values of alpha, vectorized across the values
+	void time(double t[], const double alpha[], int n);
+	void phase(double phase[], const double alpha[], int n);
+	void time_of_alpha_omega_derivative(double dtdo[], const double alpha[], int n);
+
+	// time domain
+	double orbital_alpha(double t);
+	double orbital_alpha_derivative(double t);
+	double phase_of_time(double t);
+	double phase_of_time_derivative(double t);
+	void orbital_alpha_phase_of_time(double &alpha, double &phase, double t);
+	double orbital_frequency(double t);
+	double orbital_frequency_derivative(double t);
+
+	// utility
+	double alpha_of_omega(double omega);
+	void alpha_of_omega(double alpha[], const double omega[], int n);
+	double omega_of_alpha(double alpha);
+	double orbital_frequency_isco();
+	double min_orbital_frequency();
+	double max_orbital_frequency();
+	double max_orbital_radius();
+	double max_time_before_merger();
+
+	// nodes of the reduced splines in alpha and in t, in increasing order
+	Vector alphaNodes();
+	Vector timeNodes();
+
+private:
+	double normalizeTime(double omega);
+	double normalizePhase(double omega);
+	double dalphaDomega(double omega);
+
+	double _chi;
+	double _a;
+	double _time_norm_parameter;
+	double _oisco; // |omega_ISCO|
+	double _oisco_third; // omega_ISCO^(1/3)
+	double _omega_min_third; // OMEGA_MIN^(1/3)
+	double _alpha_scale; // omega_ISCO^(1/3) - OMEGA_MIN^(1/3)
+	double _oisco_time_norm; // omega_ISCO^(-8/3)
+	double _oisco_phase_norm; // omega_ISCO^(-5/3)
+	CubicSpline _time_spline;
+	CubicSpline _phase_spline;
+	CubicSpline _flux_spline;
+	CubicSpline _alpha_of_beta_spline;
+	CubicSpline _phase_of_beta_spline;
+	CubicSpline _frequency_of_beta_spline;
+};
+
 class TrajectorySpline2D{
 public:
-	TrajectorySpline2D(std::string filename="data/trajectory.txt");
-	TrajectorySpline2D(TrajectoryData traj);
-  	TrajectorySpline2D(const Vector & chi, const Vector & alpha, const Vector & chiFlux, const Vector & alphaFlux, const Vector & beta, const Vector & t, const Vector & phi, const Vector & flux, const Vector & omega, const Vector & alphaOfT, const Vector & phaseOfT, const double & tMax);
+	// reads a text trajectory file, or maps a binary one
+	TrajectorySpline2D(std::string filename="data/trajectory.txt", int single_precision = 0);
+	TrajectorySpline2D(TrajectoryData traj, int single_precision = 0);
+  	TrajectorySpline2D(const Vector & chi, const Vector & alpha, const Vector & chiFlux, const Vector & alphaFlux, const Vector & beta, const Vector & t, const Vector & phi, const Vector & flux, const Vector & omega, const Vector & alphaOfT, const Vector & phaseOfT, const double & tMax, int single_precision = 0);
+	// evaluates in place on the mapped coefficients of a binary trajectory file,
+	// which are only copied if single_precision converts some of them
+	TrajectorySpline2D(const TrajectoryBinaryData &traj, int single_precision = 0);
   	~TrajectorySpline2D();
 
+	// writes the splines in the binary trajectory format. Returns 0 on success.
+	// Splines stored in single precision cannot be written
+	int writeBinary(std::string filename);
+
 	// frequency domain
 	double time(double chi, double alpha);
   	double phase(double chi, double alpha);
@@ -69,6 +257,7 @@ public:
 	double phase_of_time_derivative(double chi, double t);
 	double phase_of_a_time(double a, double t);
 	double phase_of_a_time_derivative(double a, double t);
+	void orbital_alpha_phase_of_time(double &alpha, double &phase, double chi, double t);
 
 	// utility
 	double orbital_frequency_isco(double chi);
@@ -78,22 +267,109 @@ public:
 	double max_orbital_radius(double a);
 	double max_time_before_merger(double a);
 
-	void flux_of_a_omega(double flux[], const double a[], const double omega[], int n, int num_threads=0);
+	// array versions of the queries above, out[i] = f(x[i], y[i]) for i < n.
+	// The points are split into blocks of TRAJECTORY_BLOCK_SIZE, which are
+	// shared between the threads of the context, and the Kerr functions of a
+	// block are evaluated with the array versions of the functions
+	void time(double t[], const double chi[], const double alpha[], int n, ExecutionContext context = ExecutionContext());
+	void phase(double phase[], const double chi[], const double alpha[], int n, ExecutionContext context = ExecutionContext());
+	void flux(double flux[], const double chi[], const double alpha[], int n, ExecutionContext context = ExecutionContext());
+	void flux_norm(double flux[], const double chi[], const double alpha[], int n, ExecutionContext context = ExecutionContext());
+
+	void time_of_a_omega(double t[], const double a[], const double omega[], int n, ExecutionContext context = ExecutionContext());
+	void time_of_a_omega_derivative(double dtdo[], const double a[], const double omega[], int n, ExecutionContext context = ExecutionContext());
+	void phase_of_a_omega(double phase[], const double a[], const double omega[], int n, ExecutionContext context = ExecutionContext());
+	void phase_of_a_omega_derivative(double dphido[], const double a[], const double omega[], int n, ExecutionContext context = ExecutionContext());
+	void flux_of_a_omega(double flux[], const double a[], const double omega[], int n, ExecutionContext context = ExecutionContext());
+
+	void orbital_frequency_time_derivative_from_flux(double dodt[], const double chi[], const double alpha[], int n, ExecutionContext context = ExecutionContext());
+	void orbital_frequency_time_derivative_from_flux_of_a_omega(double dodt[], const double a[], const double omega[], int n, ExecutionContext context = ExecutionContext());
+	void time_of_a_alpha_omega_derivative(double dtdo[], const double a[], const double alpha[], int n, ExecutionContext context = ExecutionContext());
+
+	void orbital_alpha(double alpha[], const double chi[], const double t[], int n, ExecutionContext context = ExecutionContext());
+	void orbital_alpha_derivative(double dalphadt[], const double chi[], const double t[], int n, ExecutionContext context = ExecutionContext());
+	void orbital_frequency(double omega[], const double a[], const double t[], int n, ExecutionContext context = ExecutionContext());
+	void orbital_frequency_derivative(double domegadt[], const double a[], const double t[], int n, ExecutionContext context = ExecutionContext());
+	void phase_of_time(double phase[], const double chi[], const double t[], int n, ExecutionContext context = ExecutionContext());
+	void phase_of_time_derivative(double dphidt[], const double chi[], const double t[], int n, ExecutionContext context = ExecutionContext());
+	void phase_of_a_time(double phase[], const double a[], const double t[], int n, ExecutionContext context = ExecutionContext());
+	void phase_of_a_time_derivative(double dphidt[], const double a[], const double t[], int n, ExecutionContext context = ExecutionContext());
+	void orbital_alpha_phase_of_time(double alpha[], double phase[], const double chi[], const double t[], int n, ExecutionContext context = ExecutionContext());
+
+	void orbital_frequency_isco(double oISCO[], const double chi[], int n, ExecutionContext context = ExecutionContext());
+	void orbital_frequency_isco_of_a(double oISCO[], const double a[], int n, ExecutionContext context = ExecutionContext());
+	void min_orbital_frequency(double omega[], const double a[], int n, ExecutionContext context = ExecutionContext());
+	void max_orbital_frequency(double omega[], const double a[], int n, ExecutionContext context = ExecutionContext());
+	void max_orbital_radius(double r[], const double a[], int n, ExecutionContext context = ExecutionContext());
+	void max_time_before_merger(double t[], const double a[], int n, ExecutionContext context = ExecutionContext());
+
+	// reduced splines at fixed chi. Slices are built on the first request for
+	// a chi and cached for the TRAJECTORY_SLICE_CACHE_SIZE most recent spins
+	std::shared_ptr<TrajectorySlice> slice(double chi);
+	std::shared_ptr<TrajectorySlice> slice_of_a(double a);
 
 private:
-  	BicubicSpline _time_spline;
-  	BicubicSpline _phase_spline;
+	// fits traj, or wraps the tables of binary if it maps a file
+	TrajectorySpline2D(TrajectoryData traj, const TrajectoryBinaryData &binary, int single_precision);
+	void convertToSinglePrecision(int single_precision);
+	// time (TIME_FIELD) or phase (PHASE_FIELD) of a block of points
+	void frequencyDomainBlock(int field, double out[], const double chi[], const double a[], const double alpha[], int n);
+	// derivative with respect to omega of the time or phase of a block of points
+	void frequencyDomainDerivativeBlock(int field, double out[], const double a[], const double omega[], int n);
+
+	BicubicSplineBundle _frequency_domain_splines; // time, phase on (chi, alpha)
   	BicubicSpline _flux_spline;
-  	BicubicSpline _alpha_spline;
-	BicubicSpline _frequency_spline;
-	BicubicSpline _phase_time_spline;
+	BicubicSplineBundle _time_domain_splines; // alpha, phase, frequency on (chi, beta)
 	double _time_norm_parameter;
+	LRUCache<double, TrajectorySlice> _slice_cache;
+};
+
+// Per-spin evaluator of the trajectory without transcendental functions. time
+// and phase are expanded in alpha, and orbital_alpha and phase_of_time in t, as
+// piecewise Chebyshev series of the full functions (spline and normalizations)
+// that start from the spline nodes. The absolute error of each expansion is
+// below tolerance times the largest magnitude of its function. With the default
+// tolerance, the expansions agree with the spline path to about 1e-13 in alpha
+// and relative to the phase and time (see cpp/tools/chebyshev_accuracy_report.cpp).
+// Queries outside the expanded domains fall back to the reduced splines
+class TrajectoryChebyshev{
+public:
+	TrajectoryChebyshev(TrajectorySpline2D &traj, double chi, double tolerance = TRAJECTORY_CHEBYSHEV_TOLERANCE);
+
+	double getChi();
+	double getTolerance();
+
+	double time(double alpha);
+	double phase(double alpha);
+	double orbital_alpha(double t);
+	double phase_of_time(double t);
+	void orbital_alpha_phase_of_time(double &alpha, double &phase, double t);
+
+	// largest error of each expansion at its test points
+	double timeError();
+	double phaseError();
+	double orbitalAlphaError();
+	double phaseOfTimeError();
+
+private:
+	double _chi;
+	double _tolerance;
+	std::shared_ptr<TrajectorySlice> _slice;
+	ChebyshevExpansion _time;
+	ChebyshevExpansion _phase;
+	ChebyshevExpansion _orbital_alpha;
+	ChebyshevExpansion _phase_of_time;
 };
 
 class InspiralContainer{
 public:
 	InspiralContainer(int inspiralSteps);
 	void setInspiralInitialConditions(double a, double massratio, double r0, double dt);
+	void resize(int inspiralSteps);
+	// number of the first step, which is 0 unless the container holds a segment
+	// of a longer inspiral
+	void setStartStep(int start);
+	int getStartStep() const;
 	void setTimeStep(int i, double alpha, double phase);
 	void setTimeStep(int i, double alpha, double phase, double dtdo);
 	
@@ -103,24 +379,24 @@ public:
 	Vector& getAlphaNonConstRef();
 	Vector& getPhaseNonConstRef();
 
-	double getAlpha(int i);
-	double getPhase(int i);
+	double getAlpha(int i) const;
+	double getPhase(int i) const;
 	double getTimeOmegaDeriv(int i);
-	double getTime(int i);
-	double getFrequency(int i);
-	double getRadius(int i);
-
-	double getSpin();
-	double getMassRatio();
-	double getInitialRadius();
-	double getFinalRadius();
-	double getInitialFrequency();
-	double getFinalFrequency();
-	double getTimeSpacing();
-	double getDuration();
-	double getISCOFrequency();
-	double getISCORadius();
-	int getSize();
+	double getTime(int i) const;
+	double getFrequency(int i) const;
+	double getRadius(int i) const;
+
+	double getSpin() const;
+	double getMassRatio() const;
+	double getInitialRadius() const;
+	double getFinalRadius() const;
+	double getInitialFrequency() const;
+	double getFinalFrequency() const;
+	double getTimeSpacing() const;
+	double getDuration() const;
+	double getISCOFrequency() const;
+	double getISCORadius() const;
+	int getSize() const;
 
 private:
 	double _a;
@@ -129,24 +405,201 @@ private:
 	double _dt;
 	double _risco;
 	double _oisco;
+	int _start;
 	Vector _alpha;
 	Vector _phase;
 };
 
+// An inspiral that is produced in segments of at most segmentSteps steps, so
+// that only one segment is held in memory at a time however long the inspiral.
+// Every step is evaluated from the same initial time and phase as in
+// InspiralGenerator::computeInspiral, so the phase is continuous across the
+// segments, which join up into exactly the full inspiral. The steps are always
+// taken densely. Obtained from InspiralGenerator::computeInspiralSegments
+class InspiralSegments{
+public:
+	InspiralSegments(std::shared_ptr<TrajectorySlice> slice, std::shared_ptr<TrajectoryChebyshev> expansion, double a, double massratio, double r0, double dt, double alpha_i, double t_i, int steps, int segmentSteps, ExecutionContext context = ExecutionContext());
+
+	// fills segment with the next segment and returns true, or returns false
+	// once every step has been produced
+	bool next(InspiralContainer &segment);
+	void reset();
+
+	// the first and last steps of the inspiral, which are all that mode
+	// selection needs from it
+	InspiralContainer getEndpoints();
+
+	int getSize() const;
+	int getSegmentSize() const;
+	int getSegmentNumber() const;
+
+private:
+	void fill(double alpha[], double phase[], int jmin, int jmax, int num_threads);
+
+	std::shared_ptr<TrajectorySlice> _slice;
+	std::shared_ptr<TrajectoryChebyshev> _expansion;
+	double _a;
+	double _massratio;
+	double _r0;
+	double _dt;
+	double _alpha_i;
+	double _t_i;
+	double _phase_i;
+	int _steps;
+	int _segment_steps;
+	ExecutionContext _context;
+	int _next;
+};
+
+// A piecewise-uniform sampling of an inspiral or a waveform. Every sample lies
+// on a uniform grid of spacing dt, starting with sample 0 at step 0 of the grid.
+// Segment k holds the samples offsets[k] <= i < offsets[k + 1], each of which
+// lies strides[k] steps of the grid after the sample before it, so that the
+// spacing can follow the frequency of the signal. Built by
+// InspiralGenerator::computeMultirateSampling
+class MultirateSampling{
+public:
+	MultirateSampling(double dt = 1.);
+	void addSegment(int stride, int steps);
+
+	int getSize() const;
+	int getSegmentNumber() const;
+	int getOffset(int k) const;
+	int getSegmentSize(int k) const;
+	int getStride(int k) const;
+	double getSegmentTimeSpacing(int k) const;
+
+	// step of the grid, and time, of sample i
+	int getStep(int i) const;
+	void getSteps(int steps[]) const;
+	double getTime(int i) const;
+	void getTimes(double t[]) const;
+
+	// the grid, which runs from the first to the last sample
+	double getTimeSpacing() const;
+	void setTimeSpacing(double dt);
+	int getUniformSize() const;
+	double getDuration() const;
+
+	// fills the getUniformSize() steps of the grid from the samples, which are
+	// copied at the steps where they lie and interpolated in between by the
+	// cubic through the four nearest samples. The interpolation error of a
+	// signal with n samples per cycle is about (2 pi/n)^4/40 of its amplitude
+	void resample(double uniform[], const double samples[]) const;
+
+private:
+	double _dt;
+	std::vector<int> _offsets;
+	std::vector<int> _strides;
+	std::vector<int> _starts; // step of the first sample of each segment
+};
+
+// parameters that determine a computed inspiral, compared exactly
+typedef struct InspiralCacheKeyStruct{
+	double a;
+	double massratio;
+	double r0;
+	double dt;
+	double T;
+	double phase_tolerance;
+	int engine;
+	double engine_tolerance;
+
+	bool operator==(const InspiralCacheKeyStruct &key) const{
+		return a == key.a && massratio == key.massratio && r0 == key.r0 && dt == key.dt && T == key.T
+			&& phase_tolerance == key.phase_tolerance && engine == key.engine && engine_tolerance == key.engine_tolerance;
+	}
+} InspiralCacheKey;
+
+// combines the hashes of the fields that InspiralCacheKey compares
+struct InspiralCacheKeyHash{
+	size_t operator()(const InspiralCacheKey &key) const{
+		std::hash<double> hashDouble;
+		size_t seed = std::hash<int>()(key.engine);
+		double fields[7] = {key.a, key.massratio, key.r0, key.dt, key.T, key.phase_tolerance, key.engine_tolerance};
+		for(int i = 0; i < 7; i++){
+			seed ^= hashDouble(fields[i]) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+		}
+		return seed;
+	}
+};
+
+// Every computation takes an ExecutionContext, which is a number of threads or,
+// by default, the threads shared through the pool of execution_context.hpp. A
+// call with the default context runs with the context of the generator, so a
+// generator constructed with a number of threads keeps using that number
 class InspiralGenerator{
 public:
-	InspiralGenerator(TrajectorySpline2D &traj, int num_threads=0);
-	InspiralContainer computeInspiral(double a, double massratio, double r0, double dt, double T, int num_threads = 0);
+	InspiralGenerator(TrajectorySpline2D &traj, ExecutionContext context = ExecutionContext());
+	// with a positive phase_tolerance (in radians), alpha and the phase are only
+	// evaluated on sparse nodes and interpolated to every time step
+	InspiralContainer computeInspiral(double a, double massratio, double r0, double dt, double T, ExecutionContext context = ExecutionContext(), double phase_tolerance = 0.);
 	void computeInitialConditions(double &chi, double &omega_i, double &alpha_i, double &t_i, double a, double massratio, double r0, double &T);
 	double computeTimeToMerger(double a, double massratio, double r0);
+	// the initial radius whose time to merger is T, the inverse of
+	// computeTimeToMerger. Durations beyond the range of the trajectory give
+	// the radius at the end of the range (max_orbital_radius or the radius of
+	// the largest orbital frequency)
+	double computeInitialRadius(double a, double massratio, double T);
+	void computeInitialRadii(double r0[], const double a[], const double massratio[], const double T[], int n, ExecutionContext context = ExecutionContext());
 	int computeTimeStepNumber(double a, double massratio, double r0, double dt, double T);
 	int computeTimeStepNumber(double dt, double T);
 
-	void computeInspiral(InspiralContainer &inspiral, double chi, double omega_i, double alpha_i, double t_i, double massratio, double dt, int num_threads=0);
+	void computeInspiral(InspiralContainer &inspiral, double chi, double omega_i, double alpha_i, double t_i, double massratio, double dt, ExecutionContext context = ExecutionContext(), double phase_tolerance = 0.);
+
+	// inspirals of n sources, each with its own spin, mass ratio, initial
+	// radius, time step and duration, computed by a single team of threads.
+	// Long sources are shared between threads, and the work is balanced by the
+	// number of steps. Source i fills steps[i] steps of alpha[i] and phase[i],
+	// as numbered by computeTimeStepNumbers
+	void computeTimeStepNumbers(int steps[], const double a[], const double massratio[], const double r0[], const double dt[], const double T[], int n);
+	void computeInspirals(double *alpha[], double *phase[], const int steps[], const double a[], const double massratio[], const double r0[], const double dt[], int n, ExecutionContext context = ExecutionContext(), double phase_tolerance = 0.);
+	// packed into one buffer, with source i at offsets[i] <= j < offsets[i + 1]
+	void computeInspirals(double alpha[], double phase[], const long offsets[], const double a[], const double massratio[], const double r0[], const double dt[], int n, ExecutionContext context = ExecutionContext(), double phase_tolerance = 0.);
+	std::vector<InspiralContainer> computeInspirals(const double a[], const double massratio[], const double r0[], const double dt[], const double T[], int n, ExecutionContext context = ExecutionContext(), double phase_tolerance = 0.);
 	TrajectorySpline2D& getTrajectorySpline();
 
+	// a multirate sampling of the inspiral of computeInspiral, whose grid is the
+	// uniform sampling with time step dt. Segments of MULTIRATE_SEGMENT_STEPS
+	// samples are spaced by the largest power-of-two multiple of dt, up to
+	// dt_max, that samples the frequency omega_factor*Omega at least
+	// samples_per_cycle times per cycle at the end of the segment
+	MultirateSampling computeMultirateSampling(double a, double massratio, double r0, double dt, double dt_max, double T, double omega_factor, double samples_per_cycle = MULTIRATE_SAMPLES_PER_CYCLE);
+	// the inspiral at the samples of a multirate sampling (in units of M), so
+	// that step i lies at sampling.getTime(i) and not at getTime(i)
+	InspiralContainer computeInspiral(double a, double massratio, double r0, const MultirateSampling &sampling, ExecutionContext context = ExecutionContext());
+
+	// the inspiral of computeInspiral, produced in segments of segment_steps steps
+	InspiralSegments computeInspiralSegments(double a, double massratio, double r0, double dt, double T, int segment_steps, ExecutionContext context = ExecutionContext());
+
+	// the same inspiral as computeInspiral, shared with the inspiral cache.
+	// Inspirals are cached by their exact parameters while they fit in the
+	// memory budget set by setInspiralCacheBytes, and are never modified once
+	// cached, so they can be used by several callers and threads at once
+	std::shared_ptr<const InspiralContainer> computeInspiralShared(double a, double massratio, double r0, double dt, double T, ExecutionContext context = ExecutionContext(), double phase_tolerance = 0.);
+	void setInspiralCacheBytes(size_t bytes);
+	size_t getInspiralCacheBytes();
+	size_t inspiralCacheSize();
+	size_t inspiralCacheHits();
+	size_t inspiralCacheMisses();
+	void clearInspiralCache();
+
+	// steps inspirals with the reduced splines (INSPIRAL_SPLINE_ENGINE, the
+	// default) or with TrajectoryChebyshev expansions built to the given
+	// tolerance (INSPIRAL_CHEBYSHEV_ENGINE), which are cached per spin
+	void setEngine(int engine, double tolerance = TRAJECTORY_CHEBYSHEV_TOLERANCE);
+	int getEngine();
+
 protected:
+	std::shared_ptr<TrajectoryChebyshev> chebyshevExpansion(double chi);
+	ExecutionContext resolveContext(ExecutionContext context);
+
 	TrajectorySpline2D& _traj;
+	ExecutionContext _context;
+	int _engine;
+	double _engine_tolerance;
+	LRUCache<double, TrajectoryChebyshev> _chebyshev_cache;
+	LRUCache<InspiralCacheKey, const InspiralContainer, InspiralCacheKeyHash> _inspiral_cache;
 };
 
 //////////////////////////////
@@ -193,6 +646,37 @@ double min_orbital_frequency(const double &a);
 double max_orbital_radius(const double &a);
 double min_orbital_radius(const double &a);
 
+double normalize_energy_flux(const double &omega);
+double normalize_time(const double &omega, const double &oISCO);
+double normalize_phase(const double &omega, const double &oISCO);
+double normalize_time_domega(const double &omega);
+double normalize_phase_domega(const double &omega);
+
+/////////////////////////////////////
+// Array versions of the functions //
+/////////////////////////////////////
+
+// out[i] = f(in[i]) for i < n, vectorized across i. Spin-dependent functions
+// take either the spin (or ISCO frequency) of every point or one for all points
+void kerr_geo_azimuthal_frequency_circ_time(double omega[], const double a[], const double r[], int n);
+void kerr_isco_frequency(double oISCO[], const double a[], int n);
+void alpha_of_a_omega(double alpha[], const double omega[], const double oISCO[], int n);
+void alpha_of_a_omega(double alpha[], const double omega[], double oISCO, int n);
+void omega_of_a_alpha(double omega[], const double alpha[], const double oISCO[], int n);
+void omega_of_a_alpha(double omega[], const double alpha[], double oISCO, int n);
+void spin_of_chi(double a[], const double chi[], int n);
+void chi_of_spin(double chi[], const double a[], int n);
+void kerr_geo_denergy_domega_circ(double dEdo[], const double a[], const double omega[], int n);
+void kerr_geo_denergy_domega_circ(double dEdo[], double a, const double omega[], int n);
+void normalize_energy_flux(double norm[], const double omega[], int n);
+void dalpha_domega_of_a_omega(double dalpha[], const double omega[], const double oISCO[], int n);
+void normalize_time(double norm[], const double omega[], const double oISCO[], int n);
+void normalize_time(double norm[], const double omega[], double oISCO, int n);
+void normalize_phase(double norm[], const double omega[], const double oISCO[], int n);
+void normalize_phase(double norm[], const double omega[], double oISCO, int n);
+void normalize_time_domega(double norm[], const double omega[], int n);
+void normalize_phase_domega(double norm[], const double omega[], int n);
+
 CubicSpline read_time_spline(double a);
 CubicSpline read_phase_spline(double a);
 CubicSpline read_flux_spline(double a);
@@ -16,11 +16,28 @@
 #define Mpc_const 1e3*kpc
 #define Gpc_const 1e3*Mpc
 #define yr_const 31558149.763545603 // in sec (sidereal year)
+#define WAVEFORM_BLOCK_SIZE 256 // time samples per batched harmonic evaluation
 
 typedef std::vector<float> FloatVector;
 typedef std::vector<Complex> ComplexVector;
 typedef std::vector<int> List;
 
+// fmod(x, 2*pi), bit for bit, without the cost of fmod on the large phases of
+// an inspiral. For |x| >= 4 both x and 2*pi are multiples of 2^-50, so with q
+// the truncated quotient the remainder x - q*2*pi fits in a double and a single
+// fma gives it exactly. When the division rounds q off by one the remainder
+// falls outside [0, 2*pi) (or (-2*pi, 0] for negative x), and fmod is used instead
+inline double fmod_2pi(double x){
+#ifdef FP_FAST_FMA
+  const double twopi = 2.*M_PI;
+  double r = std::fma(-std::trunc(x/twopi), twopi, x);
+  if(r != 0. && std::fabs(r) < twopi && (r < 0.) == (x < 0.)){
+    return r;
+  }
+#endif
+  return fmod(x, 2.*M_PI);
+}
+
 class WaveformContainer{
 public:
   WaveformContainer(int timeSteps);
@@ -45,6 +62,21 @@ protected:
   int _owner_flag;
 };
 
+// a waveform sampled piecewise uniformly, with its sampling in seconds
+class MultirateWaveformContainer: public WaveformContainer{
+public:
+  MultirateWaveformContainer(const MultirateSampling &sampling);
+  MultirateWaveformContainer(double *plus_ptr, double *cross_ptr, const MultirateSampling &sampling);
+
+  const MultirateSampling& getSampling() const;
+  // fills h, of size getSampling().getUniformSize(), with the waveform
+  // interpolated to the uniform grid of the sampling
+  void resample(WaveformContainer &h);
+
+private:
+  MultirateSampling _sampling;
+};
+
 class WaveformHarmonicsContainer{
 public:
   WaveformHarmonicsContainer(int modeNum, int timeSteps);
@@ -74,42 +106,44 @@ protected:
 
 class WaveformHarmonicOptions{
 public:
-  WaveformHarmonicOptions(): rescale(1.), num_threads(omp_get_max_threads()), pad_output(0), include_negative_m(1) {}
-  WaveformHarmonicOptions(double rescale, int num, int pad_output, int include_negative_m): rescale(rescale), num_threads(num), pad_output(pad_output), include_negative_m(include_negative_m) {}
+  WaveformHarmonicOptions(): rescale(1.), num_threads(0), pad_output(0), include_negative_m(1), phase_tolerance(0.), segment_steps(0) {}
+  WaveformHarmonicOptions(double rescale, int num, int pad_output, int include_negative_m, double phase_tolerance = 0., int segment_steps = 0): rescale(rescale), num_threads(num), pad_output(pad_output), include_negative_m(include_negative_m), phase_tolerance(phase_tolerance), segment_steps(segment_steps) {}
   
   Complex rescale;
-  int num_threads;
+  int num_threads; // threads of each call, or 0 to share the pool of execution_context.hpp
   int pad_output;
   int include_negative_m;
+  double phase_tolerance; // inspirals are interpolated from sparse nodes to this phase error (radians) if positive
+  int segment_steps; // if positive, time-domain waveforms are summed from dense inspiral segments of this many steps
 };
 
 class WaveformHarmonicGenerator{
 public:
   WaveformHarmonicGenerator(HarmonicAmplitudes &Alm, HarmonicOptions hOpts = HarmonicOptions(), WaveformHarmonicOptions wOpts = WaveformHarmonicOptions());
 
-  WaveformContainer computeWaveformHarmonic(int l, int m, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
-  void computeWaveformHarmonic(WaveformContainer &h, int l, int m, InspiralContainer &inspiral, double theta, double phi);
-  void computeWaveformHarmonic(WaveformContainer &h, int l, int m, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
+  WaveformContainer computeWaveformHarmonic(int l, int m, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
+  void computeWaveformHarmonic(WaveformContainer &h, int l, int m, const InspiralContainer &inspiral, double theta, double phi);
+  void computeWaveformHarmonic(WaveformContainer &h, int l, int m, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
 
-  WaveformContainer computeWaveformHarmonics(int l[], int m[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
-  void computeWaveformHarmonics(WaveformContainer &h, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
-  void computeWaveformHarmonics(WaveformContainer &h, InspiralContainer &inspiral, double theta, double phi, HarmonicOptions hOpts);
-  void computeWaveformHarmonics(WaveformContainer &h, InspiralContainer &inspiral, double theta, double phi, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts);  void computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
-  void computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
+  WaveformContainer computeWaveformHarmonics(int l[], int m[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
+  void computeWaveformHarmonics(WaveformContainer &h, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
+  void computeWaveformHarmonics(WaveformContainer &h, const InspiralContainer &inspiral, double theta, double phi, HarmonicOptions hOpts);
+  void computeWaveformHarmonics(WaveformContainer &h, const InspiralContainer &inspiral, double theta, double phi, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts);  void computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
+  void computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
 
-  void computeWaveformHarmonics(WaveformContainer &h, InspiralContainer &inspiral, double theta, double phi);
-  void computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, double theta, double phi);
-  void computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, double theta, double phi);
+  void computeWaveformHarmonics(WaveformContainer &h, const InspiralContainer &inspiral, double theta, double phi);
+  void computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, double theta, double phi);
+  void computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, double theta, double phi);
 
-  void computeWaveformHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
-  void computeWaveformHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
+  void computeWaveformHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
+  void computeWaveformHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
   
-  void computeWaveformHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);  
-  void computeWaveformHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
+  void computeWaveformHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);  
+  void computeWaveformHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts);
 
   HarmonicSelector& getModeSelector();
-  HarmonicModeContainer selectModes(InspiralContainer &inspiral, double theta);
-  HarmonicModeContainer selectModes(InspiralContainer &inspiral, double theta, HarmonicOptions opts);
+  HarmonicModeContainer selectModes(const InspiralContainer &inspiral, double theta);
+  HarmonicModeContainer selectModes(const InspiralContainer &inspiral, double theta, HarmonicOptions opts);
 
   WaveformHarmonicOptions getWaveformHarmonicOptions();
   HarmonicOptions getHarmonicOptions();  
@@ -144,6 +178,18 @@ public:
   void computeWaveformSourceFrame(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, double M, double mu, double a, double r0, double theta, double phi, double Phi_phi0, double dt, double T);
 
   void computeWaveformPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, double dt, double T, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts);
+
+  // Multirate waveforms are sampled more sparsely where the signal changes
+  // slowly. The sampling runs over the uniform samples of time step dt (in
+  // seconds), with segments spaced by power-of-two multiples of dt up to dt_max
+  // that sample the highest m*Omega of the selected modes samples_per_cycle
+  // times per cycle. The waveform is then computed at those samples
+  MultirateSampling computeMultirateSampling(double M, double mu, double a, double r0, double qS, double phiS, double qK, double phiK, double dt, double dt_max, double T, HarmonicOptions hOpts, double samples_per_cycle = MULTIRATE_SAMPLES_PER_CYCLE);
+  void computeWaveform(MultirateWaveformContainer &h, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts);
+
+  // the generator of the inspirals, which holds the inspiral cache
+  InspiralGenerator& getInspiralGenerator();
+
 private:
   InspiralGenerator _inspiralGen;
 };
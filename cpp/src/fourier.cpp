@@ -1,13 +1,48 @@
 #include "fourier.hpp"
 
+// Stationary phase approximation of a mode with |m| = mm at the frequency
+// samples freq[kmin], ..., freq[kmax - 1], with kmax - kmin at most
+// WAVEFORM_BLOCK_SIZE. Only the samples whose orbital frequency 2 pi f/mm lies
+// within [omega_min, omega_max] contribute. Their indices are packed into
+// index, with the SPA amplitude, the mode phase and the orbital phase
+// difference deltaPhase of each, and their number is returned
+static int stationary_phase_block(int index[], double amp[], double modePhase[], double deltaPhase[], const double freq[], int kmin, int kmax, int mm, HarmonicSpline *Alm, TrajectorySlice &trajSlice, double omega_min, double omega_max, double phase_i, double time_i, double massratio){
+	double twopi = 2.*M_PI;
+	double omega[WAVEFORM_BLOCK_SIZE], alpha[WAVEFORM_BLOCK_SIZE], phase[WAVEFORM_BLOCK_SIZE], time[WAVEFORM_BLOCK_SIZE], dtdo[WAVEFORM_BLOCK_SIZE];
+	int n = 0;
+	for(int i = kmin; i < kmax; i++){
+		double omega_i = twopi*freq[i]/mm; // from m\omega = 2\pi f
+		if(omega_i >= omega_min && omega_i <= omega_max){
+			index[n] = i;
+			omega[n] = omega_i;
+			n++;
+		}
+	}
+	if(n == 0){
+		return 0;
+	}
+
+	trajSlice.alpha_of_omega(alpha, omega, n);
+	trajSlice.phase(phase, alpha, n);
+	trajSlice.time(time, alpha, n);
+	trajSlice.time_of_alpha_omega_derivative(dtdo, alpha, n);
+	Alm->phase(modePhase, alpha, n);
+	Alm->amplitude(amp, alpha, n);
+	for(int k = 0; k < n; k++){
+		deltaPhase[k] = (phase[k] - omega[k]*time[k] - phase_i + omega[k]*time_i)/massratio;
+		amp[k] *= sqrt(twopi/mm*(fabs(dtdo[k])/massratio));
+	}
+	return n;
+}
+
 WaveformFourierHarmonicGenerator::WaveformFourierHarmonicGenerator(HarmonicAmplitudes &Alm, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts): _Alm(Alm), _mode_selector(Alm, hOpts), _opts(wOpts) {}
 
-void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformContainer &h, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, HarmonicOptions hOpts, int num_threads, double freq[], int fsamples){
+void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformContainer &h, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, HarmonicOptions hOpts, ExecutionContext context, double freq[], int fsamples){
 	HarmonicModeContainer modes = _mode_selector.selectModes(inspiral, theta, hOpts);
-	computeWaveformFourierHarmonics(h, modes.lmodes.data(), modes.mmodes.data(), modes.plusY.data(), modes.crossY.data(), modes.lmodes.size(), inspiral, traj, theta, phi, num_threads, freq, fsamples);
+	computeWaveformFourierHarmonics(h, modes.lmodes.data(), modes.mmodes.data(), modes.plusY.data(), modes.crossY.data(), modes.lmodes.size(), inspiral, traj, theta, phi, context, freq, fsamples);
 }
 
-void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, int num_threads, double freq[], int fsamples, int include_negative_m){
+void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, ExecutionContext context, double freq[], int fsamples, int include_negative_m){
   double plusY[modeNum];
   double crossY[modeNum];
   double sYlm, sYlmMinus;
@@ -32,10 +67,10 @@ void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformC
     	crossY[i] = 0.;
 	}
   }
-  computeWaveformFourierHarmonics(h, l, m, plusY, crossY, modeNum, inspiral, traj, theta, phi, num_threads, freq, fsamples);
+  computeWaveformFourierHarmonics(h, l, m, plusY, crossY, modeNum, inspiral, traj, theta, phi, context, freq, fsamples);
 }
 
-void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, int num_threads, double freq[], int fsamples, int include_negative_m){
+void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, ExecutionContext context, double freq[], int fsamples, int include_negative_m){
   double plusY[modeNum];
   double crossY[modeNum];
   double sYlm, sYlmMinus;
@@ -60,21 +95,29 @@ void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformH
     	crossY[i] = 0.;
 	}
   }
-  computeWaveformFourierHarmonics(h, l, m, plusY, crossY, modeNum, inspiral, traj, theta, phi, num_threads, freq, fsamples);
+  computeWaveformFourierHarmonics(h, l, m, plusY, crossY, modeNum, inspiral, traj, theta, phi, context, freq, fsamples);
 }
 
-void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, int num_threads, double freq[], int fsamples){
+void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, ExecutionContext context, double freq[], int fsamples){
     double mphi_mod_2pi[modeNum];
-    HarmonicSpline2D* Alms[modeNum];
+    HarmonicSpline* Alms[modeNum];
     double twopi = 2.*M_PI;
 	int maxM = 1;
 	int minM = 15;
 
+    // chi is fixed along the inspiral, so the modes and the trajectory are
+    // evaluated on their 1D splines in alpha, which are cached across calls
+    // with the same spin
+    double a = inspiral.getSpin();
+    double chi = chi_of_spin(a);
+    std::shared_ptr<HarmonicSlice> chiSlice = _Alm.slice(chi);
+    std::shared_ptr<TrajectorySlice> trajSlice = traj.slice(chi);
+
     // first compute mode-dependent but not time-step dependent information and store
     for(int i = 0; i < modeNum; i++){
 	  int mm = abs(m[i]);
       mphi_mod_2pi[i] = fmod(mm*phi, twopi);
-      Alms[i] = _Alm.getPointer(l[i], mm);
+      Alms[i] = chiSlice->getPointer(l[i], mm);
 	  if(mm > maxM){maxM = mm;}
 	  if(mm < minM){minM = mm;}
     }
@@ -89,20 +132,17 @@ void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformC
 		std::cout << "(FOURIER) Error: More frequency samples than waveform samples \n";
 	}
 
-    double a = inspiral.getSpin();
-    double chi = chi_of_spin(a);
     double omega_min = inspiral.getInitialFrequency();
     double omega_max = inspiral.getFinalFrequency();
-	double oisco = inspiral.getISCOFrequency();
 
 	// std::cout << "omega_min = " << omega_min << "\n";
 	// std::cout << "omega_max = " << omega_max << "\n";
 	// std::cout << "oisco = " << oisco << "\n";
 	// std::cout << "alpha_f = " << inspiral.getAlpha(inspiral.getSize() - 1) << "\n";
 
-    double alpha_i = alpha_of_a_omega(a, omega_min);
-    double phase_i = traj.phase(chi, alpha_i);
-	double time_i = traj.time(chi, alpha_i);
+    double alpha_i = trajSlice->alpha_of_omega(omega_min);
+    double phase_i = trajSlice->phase(alpha_i);
+	double time_i = trajSlice->time(alpha_i);
     double massratio = inspiral.getMassRatio();
 
     // for some reason creating arrays of this size was causing issues with OpenMP
@@ -131,31 +171,32 @@ void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformC
 
 	int freq_iter_samples = freq_max_iter - freq_min_iter + 1;
 
-    #pragma omp parallel num_threads(num_threads)
+	int blockNum = (freq_iter_samples + WAVEFORM_BLOCK_SIZE - 1)/WAVEFORM_BLOCK_SIZE;
+
+    ThreadLease lease(context);
+    #pragma omp parallel num_threads(lease.threads())
     {
-      int i, j, k;
-      double amp, modePhase, Phi, cPhi, sPhi, omega, alpha, dtdo, deltaPhase;
-      // first we calculate all of the mode data
-      #pragma omp for collapse(2)
-      for(k = 0; k < freq_iter_samples; k++){
-		for(j = 0; j < modeNum; j++){
+      int index[WAVEFORM_BLOCK_SIZE];
+      double amp[WAVEFORM_BLOCK_SIZE], modePhase[WAVEFORM_BLOCK_SIZE], deltaPhase[WAVEFORM_BLOCK_SIZE];
+      double Phi, cPhi, sPhi;
+      // first we calculate all of the mode data, one block of frequencies at a time
+      #pragma omp for collapse(2) schedule(static)
+      for(int j = 0; j < modeNum; j++){
+		for(int b = 0; b < blockNum; b++){
 		  int mm = abs(m[j]);
-		  i = freq_min_iter + k;
-		  omega = twopi*freq[i]/mm; // from m\omega = 2\pi f
-		  if(omega >= omega_min && omega <= omega_max){
-			alpha = alpha_of_a_omega(a, omega, oisco);
-			deltaPhase = (traj.phase(chi, alpha) - omega*traj.time(chi, alpha) - phase_i + omega*time_i)/massratio;
-			dtdo = abs(traj.time_of_a_alpha_omega_derivative(a, alpha))/massratio;
-			modePhase = Alms[j]->phase(chi, alpha);
-			amp = Alms[j]->amplitude(chi, alpha)*sqrt(twopi/mm*dtdo);
-
-			Phi = modePhase - fmod(mm*deltaPhase, twopi) + mphi_mod_2pi[j] - 0.25*M_PI;
+		  int kmin = freq_min_iter + b*WAVEFORM_BLOCK_SIZE;
+		  int kmax = std::min(kmin + WAVEFORM_BLOCK_SIZE, freq_max_iter + 1);
+		  int n = stationary_phase_block(index, amp, modePhase, deltaPhase, freq, kmin, kmax, mm, Alms[j], *trajSlice, omega_min, omega_max, phase_i, time_i, massratio);
+		  for(int k = 0; k < n; k++){
+			int i = index[k];
+
+			Phi = modePhase[k] - fmod(mm*deltaPhase[k], twopi) + mphi_mod_2pi[j] - 0.25*M_PI;
 			cPhi = std::cos(Phi);
 			sPhi = std::sin(Phi);
-			hplusReal[j + i*modeNum] = 0.5*amp*plusY[j]*cPhi;
-			hplusImag[j + i*modeNum] = 0.5*amp*plusY[j]*sPhi;
-			hcrossReal[j + i*modeNum] = -0.5*amp*crossY[j]*sPhi;
-			hcrossImag[j + i*modeNum] = 0.5*amp*crossY[j]*cPhi;
+			hplusReal[j + i*modeNum] = 0.5*amp[k]*plusY[j]*cPhi;
+			hplusImag[j + i*modeNum] = 0.5*amp[k]*plusY[j]*sPhi;
+			hcrossReal[j + i*modeNum] = -0.5*amp[k]*crossY[j]*sPhi;
+			hcrossImag[j + i*modeNum] = 0.5*amp[k]*crossY[j]*cPhi;
 		  }
         }
       }
@@ -171,18 +212,26 @@ void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformC
     }
 }
 
-void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, int num_threads, double freq[], int fsamples){
+void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, ExecutionContext context, double freq[], int fsamples){
     double mphi_mod_2pi[modeNum];
-    HarmonicSpline2D* Alms[modeNum];
+    HarmonicSpline* Alms[modeNum];
     double twopi = 2.*M_PI;
 	int maxM = 1;
 	int minM = 15;
 
+    // chi is fixed along the inspiral, so the modes and the trajectory are
+    // evaluated on their 1D splines in alpha, which are cached across calls
+    // with the same spin
+    double a = inspiral.getSpin();
+    double chi = chi_of_spin(a);
+    std::shared_ptr<HarmonicSlice> chiSlice = _Alm.slice(chi);
+    std::shared_ptr<TrajectorySlice> trajSlice = traj.slice(chi);
+
     // first compute mode-dependent but not time-step dependent information and store
     for(int i = 0; i < modeNum; i++){
 	  int mm = abs(m[i]);
       mphi_mod_2pi[i] = fmod(mm*phi, twopi);
-      Alms[i] = _Alm.getPointer(l[i], mm);
+      Alms[i] = chiSlice->getPointer(l[i], mm);
 	  if(mm > maxM){maxM = mm;}
 	  if(mm < minM){minM = mm;}
     }
@@ -197,20 +246,17 @@ void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformH
 		std::cout << "(FOURIER) Error: More frequency samples than waveform samples \n";
 	}
 
-    double a = inspiral.getSpin();
-    double chi = chi_of_spin(a);
     double omega_min = inspiral.getInitialFrequency();
     double omega_max = inspiral.getFinalFrequency();
-	double oisco = inspiral.getISCOFrequency();
 
 	// std::cout << "omega_min = " << omega_min << "\n";
 	// std::cout << "omega_max = " << omega_max << "\n";
 	// std::cout << "oisco = " << oisco << "\n";
 	// std::cout << "alpha_f = " << inspiral.getAlpha(inspiral.getSize() - 1) << "\n";
 
-    double alpha_i = alpha_of_a_omega(a, omega_min);
-    double phase_i = traj.phase(chi, alpha_i);
-	double time_i = traj.time(chi, alpha_i);
+    double alpha_i = trajSlice->alpha_of_omega(omega_min);
+    double phase_i = trajSlice->phase(alpha_i);
+	double time_i = trajSlice->time(alpha_i);
     double massratio = inspiral.getMassRatio();
 
     // for some reason creating arrays of this size was causing issues with OpenMP
@@ -239,31 +285,32 @@ void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformH
 
 	int freq_iter_samples = freq_max_iter - freq_min_iter + 1;
 
-    #pragma omp parallel num_threads(num_threads)
+	int blockNum = (freq_iter_samples + WAVEFORM_BLOCK_SIZE - 1)/WAVEFORM_BLOCK_SIZE;
+
+    ThreadLease lease(context);
+    #pragma omp parallel num_threads(lease.threads())
     {
-      int i, j, k;
-      double amp, modePhase, Phi, cPhi, sPhi, omega, alpha, dtdo, deltaPhase;
-      // first we calculate all of the mode data
-      #pragma omp for collapse(2)
-      for(k = 0; k < freq_iter_samples; k++){
-		for(j = 0; j < modeNum; j++){
+      int index[WAVEFORM_BLOCK_SIZE];
+      double amp[WAVEFORM_BLOCK_SIZE], modePhase[WAVEFORM_BLOCK_SIZE], deltaPhase[WAVEFORM_BLOCK_SIZE];
+      double Phi, cPhi, sPhi;
+      // first we calculate all of the mode data, one block of frequencies at a time
+      #pragma omp for collapse(2) schedule(static)
+      for(int j = 0; j < modeNum; j++){
+		for(int b = 0; b < blockNum; b++){
 		  int mm = abs(m[j]);
-		  i = freq_min_iter + k;
-		  omega = twopi*freq[i]/mm; // from m\omega = 2\pi f
-		  if(omega >= omega_min && omega <= omega_max){
-			alpha = alpha_of_a_omega(a, omega, oisco);
-			deltaPhase = (traj.phase(chi, alpha) - omega*traj.time(chi, alpha) - phase_i + omega*time_i)/massratio;
-			dtdo = abs(traj.time_of_a_alpha_omega_derivative(a, alpha))/massratio;
-			modePhase = Alms[j]->phase(chi, alpha);
-			amp = Alms[j]->amplitude(chi, alpha)*sqrt(twopi/mm*dtdo);
-
-			Phi = modePhase - fmod(mm*deltaPhase, twopi) + mphi_mod_2pi[j] - 0.25*M_PI;
+		  int kmin = freq_min_iter + b*WAVEFORM_BLOCK_SIZE;
+		  int kmax = std::min(kmin + WAVEFORM_BLOCK_SIZE, freq_max_iter + 1);
+		  int n = stationary_phase_block(index, amp, modePhase, deltaPhase, freq, kmin, kmax, mm, Alms[j], *trajSlice, omega_min, omega_max, phase_i, time_i, massratio);
+		  for(int k = 0; k < n; k++){
+			int i = index[k];
+
+			Phi = modePhase[k] - fmod(mm*deltaPhase[k], twopi) + mphi_mod_2pi[j] - 0.25*M_PI;
 			cPhi = std::cos(Phi);
 			sPhi = std::sin(Phi);
-			hplusReal[j + i*modeNum] = 0.5*amp*plusY[j]*cPhi;
-			hplusImag[j + i*modeNum] = 0.5*amp*plusY[j]*sPhi;
-			hcrossReal[j + i*modeNum] = -0.5*amp*crossY[j]*sPhi;
-			hcrossImag[j + i*modeNum] = 0.5*amp*crossY[j]*cPhi;
+			hplusReal[j + i*modeNum] = 0.5*amp[k]*plusY[j]*cPhi;
+			hplusImag[j + i*modeNum] = 0.5*amp[k]*plusY[j]*sPhi;
+			hcrossReal[j + i*modeNum] = -0.5*amp[k]*crossY[j]*sPhi;
+			hcrossImag[j + i*modeNum] = 0.5*amp[k]*crossY[j]*cPhi;
 		  }
         }
       }
@@ -279,7 +326,7 @@ void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonics(WaveformH
     }
 }
 
-void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, int num_threads, double freq[], int fsamples){
+void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, ExecutionContext context, double freq[], int fsamples){
   double plusY[modeNum];
   double crossY[modeNum];
   double sYlm, sYlmMinus;
@@ -291,21 +338,29 @@ void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonicsPhaseAmpli
 	plusY[i] = sYlm;
 	crossY[i] = sYlmMinus;
   }
-  computeWaveformFourierHarmonicsPhaseAmplitude(h, l, m, plusY, crossY, modeNum, inspiral, traj, theta, phi, num_threads, freq, fsamples);
+  computeWaveformFourierHarmonicsPhaseAmplitude(h, l, m, plusY, crossY, modeNum, inspiral, traj, theta, phi, context, freq, fsamples);
 }
 
-void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, int num_threads, double freq[], int fsamples){
+void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, TrajectorySpline2D &traj, double theta, double phi, ExecutionContext context, double freq[], int fsamples){
     // double mphi_mod_2pi[modeNum];
-    HarmonicSpline2D* Alms[modeNum];
+    HarmonicSpline* Alms[modeNum];
     double twopi = 2.*M_PI;
 	int maxM = 1;
 	int minM = 15;
 
+    // chi is fixed along the inspiral, so the modes and the trajectory are
+    // evaluated on their 1D splines in alpha, which are cached across calls
+    // with the same spin
+    double a = inspiral.getSpin();
+    double chi = chi_of_spin(a);
+    std::shared_ptr<HarmonicSlice> chiSlice = _Alm.slice(chi);
+    std::shared_ptr<TrajectorySlice> trajSlice = traj.slice(chi);
+
     // first compute mode-dependent but not time-step dependent information and store
     for(int i = 0; i < modeNum; i++){
 	  int mm = abs(m[i]);
     //   mphi_mod_2pi[i] = fmod(mm*phi, twopi);
-      Alms[i] = _Alm.getPointer(l[i], mm);
+      Alms[i] = chiSlice->getPointer(l[i], mm);
 	  if(mm > maxM){maxM = mm;}
 	  if(mm < minM){minM = mm;}
     }
@@ -320,20 +375,17 @@ void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonicsPhaseAmpli
 		std::cout << "(FOURIER) Error: More frequency samples than waveform samples \n";
 	}
 
-    double a = inspiral.getSpin();
-    double chi = chi_of_spin(a);
     double omega_min = inspiral.getInitialFrequency();
     double omega_max = inspiral.getFinalFrequency();
-	double oisco = inspiral.getISCOFrequency();
 
 	// std::cout << "omega_min = " << omega_min << "\n";
 	// std::cout << "omega_max = " << omega_max << "\n";
 	// std::cout << "oisco = " << oisco << "\n";
 	// std::cout << "alpha_f = " << inspiral.getAlpha(inspiral.getSize() - 1) << "\n";
 
-    double alpha_i = alpha_of_a_omega(a, omega_min);
-    double phase_i = traj.phase(chi, alpha_i);
-	double time_i = traj.time(chi, alpha_i);
+    double alpha_i = trajSlice->alpha_of_omega(omega_min);
+    double phase_i = trajSlice->phase(alpha_i);
+	double time_i = trajSlice->time(alpha_i);
     double massratio = inspiral.getMassRatio();
 
     // for some reason creating arrays of this size was causing issues with OpenMP
@@ -362,28 +414,29 @@ void WaveformFourierHarmonicGenerator::computeWaveformFourierHarmonicsPhaseAmpli
 
 	int freq_iter_samples = freq_max_iter - freq_min_iter + 1;
 
-    #pragma omp parallel num_threads(num_threads)
+	int blockNum = (freq_iter_samples + WAVEFORM_BLOCK_SIZE - 1)/WAVEFORM_BLOCK_SIZE;
+
+    ThreadLease lease(context);
+    #pragma omp parallel num_threads(lease.threads())
     {
-      int i, j, k;
-      double amp, modePhase, Phi, cPhi, sPhi, omega, alpha, dtdo, deltaPhase;
-      // first we calculate all of the mode data
-      #pragma omp for collapse(2)
-      for(k = 0; k < freq_iter_samples; k++){
-		for(j = 0; j < modeNum; j++){
+      int index[WAVEFORM_BLOCK_SIZE];
+      double amp[WAVEFORM_BLOCK_SIZE], modePhase[WAVEFORM_BLOCK_SIZE], deltaPhase[WAVEFORM_BLOCK_SIZE];
+      double Phi;
+      // first we calculate all of the mode data, one block of frequencies at a time
+      #pragma omp for collapse(2) schedule(static)
+      for(int j = 0; j < modeNum; j++){
+		for(int b = 0; b < blockNum; b++){
 		  int mm = abs(m[j]);
-		  i = freq_min_iter + k;
-		  omega = twopi*freq[i]/mm; // from m\omega = 2\pi f
-		  if(omega >= omega_min && omega <= omega_max){
-			alpha = alpha_of_a_omega(a, omega, oisco);
-			deltaPhase = (traj.phase(chi, alpha) - omega*traj.time(chi, alpha) - phase_i + omega*time_i)/massratio;
-			dtdo = abs(traj.time_of_a_alpha_omega_derivative(a, alpha))/massratio;
-			modePhase = Alms[j]->phase(chi, alpha);
-			amp = Alms[j]->amplitude(chi, alpha)*sqrt(twopi/mm*dtdo);
-			Phi = modePhase - mm*(deltaPhase - phi) - 0.25*M_PI;
+		  int kmin = freq_min_iter + b*WAVEFORM_BLOCK_SIZE;
+		  int kmax = std::min(kmin + WAVEFORM_BLOCK_SIZE, freq_max_iter + 1);
+		  int n = stationary_phase_block(index, amp, modePhase, deltaPhase, freq, kmin, kmax, mm, Alms[j], *trajSlice, omega_min, omega_max, phase_i, time_i, massratio);
+		  for(int k = 0; k < n; k++){
+			int i = index[k];
+			Phi = modePhase[k] - mm*(deltaPhase[k] - phi) - 0.25*M_PI;
 			// Phi = modePhase - fmod(mm*deltaPhase, twopi) + mphi_mod_2pi[j] - 0.25*M_PI;
 
-			h.setTimeStep(2*j, i, amp*plusY[j], Phi); // \tilde{h}_{lm}(f)
-			h.setTimeStep(2*j + 1, i, amp*crossY[j],  - Phi - l[j]*M_PI); // \tilde{h}_{l-m}(-f)
+			h.setTimeStep(2*j, i, amp[k]*plusY[j], Phi); // \tilde{h}_{lm}(f)
+			h.setTimeStep(2*j + 1, i, amp[k]*crossY[j],  - Phi - l[j]*M_PI); // \tilde{h}_{l-m}(-f)
 			// hplusAmp[j + i*modeNum] = 0.5*amp*plusY[j];
 			// hplusPhase[j + i*modeNum] = Phi;
 			// hminusAmp[j + i*modeNum] = 0.5*amp*crossY[j];
@@ -407,11 +460,11 @@ HarmonicSelector& WaveformFourierHarmonicGenerator::getModeSelector(){
 	return _mode_selector;
 }
 
-HarmonicModeContainer WaveformFourierHarmonicGenerator::selectModes(InspiralContainer &inspiral, double theta){
+HarmonicModeContainer WaveformFourierHarmonicGenerator::selectModes(const InspiralContainer &inspiral, double theta){
 	return _mode_selector.selectModes(inspiral, theta);
 }
 
-HarmonicModeContainer WaveformFourierHarmonicGenerator::selectModes(InspiralContainer &inspiral, double theta, HarmonicOptions opts){
+HarmonicModeContainer WaveformFourierHarmonicGenerator::selectModes(const InspiralContainer &inspiral, double theta, HarmonicOptions opts){
 	return _mode_selector.selectModes(inspiral, theta, opts);
 }
 
@@ -456,6 +509,7 @@ int WaveformFourierGenerator::computeTimeStepNumber(double M, double mu, double
 }
 
 void WaveformFourierGenerator::computeFourierWaveform(WaveformContainer &h, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, double frequencies[], double T, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts){
+	ThreadLease lease(wOpts.num_threads);
 	double theta, phi;
 	sourceAngles(theta, phi, qS, phiS, qK, phiK);
 	
@@ -478,7 +532,8 @@ void WaveformFourierGenerator::computeFourierWaveform(WaveformContainer &h, doub
 	double Tmerge = _inspiralGen.computeTimeToMerger(a, mu/M, r0);
 	T = (T > Tmerge) ? Tmerge : T;
 	double dt = T/(hOpts.max_samples - 1);
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, 1);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, 1);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	// watch.stop();
 	// watch.print();
 	// watch.reset();
@@ -490,7 +545,7 @@ void WaveformFourierGenerator::computeFourierWaveform(WaveformContainer &h, doub
 	// if the rescaling factor is purely real, then just rescale both polarizations by the same amplitude
 	// else, then we get a mixing of the plus and cross polarizations that gives us new polarization amplitudes
 	// watch.start();
-	#pragma omp parallel num_threads(wOpts.num_threads)
+	#pragma omp parallel num_threads(lease.threads())
 	{
 		// total_td = omp_get_num_threads();
 		int i;
@@ -514,6 +569,7 @@ void WaveformFourierGenerator::computeFourierWaveform(WaveformContainer &h, doub
 }
 
 void WaveformFourierGenerator::computeFourierWaveform(WaveformContainer &h, int l[], int m[], int modeNum, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, double frequencies[], double T, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts){
+	ThreadLease lease(wOpts.num_threads);
 	double theta, phi;
 	sourceAngles(theta, phi, qS, phiS, qK, phiK);
 
@@ -536,7 +592,8 @@ void WaveformFourierGenerator::computeFourierWaveform(WaveformContainer &h, int
 	double Tmerge = _inspiralGen.computeTimeToMerger(a, mu/M, r0);
 	T = (T > Tmerge) ? Tmerge : T;
 	double dt = T/(hOpts.max_samples - 1);
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, 1);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, 1);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	// watch.stop();
 	// watch.print();
 	// watch.reset();
@@ -549,7 +606,7 @@ void WaveformFourierGenerator::computeFourierWaveform(WaveformContainer &h, int
 	// else, then we get a mixing of the plus and cross polarizations that gives us new polarization amplitudes
 	// watch.start();
 
-	#pragma omp parallel num_threads(wOpts.num_threads)
+	#pragma omp parallel num_threads(lease.threads())
 	{
 		// total_td = omp_get_num_threads();
 		int i;
@@ -573,6 +630,7 @@ void WaveformFourierGenerator::computeFourierWaveform(WaveformContainer &h, int
 }
 
 void WaveformFourierGenerator::computeFourierWaveform(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, double frequencies[], double T, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts){
+	ThreadLease lease(wOpts.num_threads);
 	double theta, phi;
 	sourceAngles(theta, phi, qS, phiS, qK, phiK);
 
@@ -592,7 +650,8 @@ void WaveformFourierGenerator::computeFourierWaveform(WaveformHarmonicsContainer
 	double Tmerge = _inspiralGen.computeTimeToMerger(a, mu/M, r0);
 	T = (T > Tmerge) ? Tmerge : T;
 	double dt = T/(hOpts.max_samples - 1);
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, 1);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, 1);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	computeWaveformFourierHarmonics(h, l, m, modeNum, inspiral, _inspiralGen.getTrajectorySpline(), theta, phi - Phi_phi0, wOpts.num_threads, &freq[0], imaxf, wOpts.include_negative_m);
 	
 	double rescaleRe, rescaleIm;
@@ -601,7 +660,7 @@ void WaveformFourierGenerator::computeFourierWaveform(WaveformHarmonicsContainer
 	// if the rescaling factor is purely real, then just rescale both polarizations by the same amplitude
 	// else, then we get a mixing of the plus and cross polarizations that gives us new polarization amplitudes
 
-	#pragma omp parallel num_threads(wOpts.num_threads)
+	#pragma omp parallel num_threads(lease.threads())
 	{
 		int i;
 		double hplusRe, hcrossRe, hplusIm, hcrossIm;
@@ -620,6 +679,7 @@ void WaveformFourierGenerator::computeFourierWaveform(WaveformHarmonicsContainer
 }
 
 void WaveformFourierGenerator::computeFourierWaveformPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, double frequencies[], double T, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts){
+	ThreadLease lease(wOpts.num_threads);
 	double theta, phi;
 	sourceAngles(theta, phi, qS, phiS, qK, phiK);
 
@@ -643,7 +703,8 @@ void WaveformFourierGenerator::computeFourierWaveformPhaseAmplitude(WaveformHarm
 	double Tmerge = _inspiralGen.computeTimeToMerger(a, mu/M, r0);
 	T = (T > Tmerge) ? Tmerge : T;
 	double dt = T/(hOpts.max_samples - 1);
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, 1);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, 1);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	computeWaveformFourierHarmonicsPhaseAmplitude(h, l, m, modeNum, inspiral, _inspiralGen.getTrajectorySpline(), theta, phi - Phi_phi0, wOpts.num_threads, &freq[0], imaxf);
 	
 	double rescaleAmp, rescalePhase;
@@ -652,7 +713,7 @@ void WaveformFourierGenerator::computeFourierWaveformPhaseAmplitude(WaveformHarm
 	// if the rescaling factor is purely real, then just rescale both polarizations by the same amplitude
 	// else, then we get a mixing of the plus and cross polarizations that gives us new polarization amplitudes
 
-	#pragma omp parallel num_threads(wOpts.num_threads)
+	#pragma omp parallel num_threads(lease.threads())
 	{
 		int i, j;
 		double amp, phase;
@@ -682,15 +743,17 @@ void WaveformFourierGenerator::computeFourierWaveformSourceFrame(WaveformContain
 	T = convertTime(years_to_seconds(T), M);
 	WaveformHarmonicOptions opts = getWaveformHarmonicOptions();
 	HarmonicOptions hOpts = getHarmonicOptions();
+	ThreadLease lease(opts.num_threads);
 
 	double Tmerge = _inspiralGen.computeTimeToMerger(a, mu/M, r0);
 	T = (T > Tmerge) ? Tmerge : T;
 	double dt = T/(hOpts.max_samples - 1);
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, 1);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, 1);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	computeWaveformFourierHarmonics(h, inspiral, _inspiralGen.getTrajectorySpline(), theta, phi - Phi_phi0, getHarmonicOptions(), opts.num_threads, &freq[0], imaxf);
 
 	double amplitude_correction = solar_mass_to_seconds(M);
-	#pragma omp parallel num_threads(opts.num_threads)
+	#pragma omp parallel num_threads(lease.threads())
 	{
 		// total_td = omp_get_num_threads();
 		int i;
@@ -714,15 +777,17 @@ void WaveformFourierGenerator::computeFourierWaveformSourceFrame(WaveformContain
 	T = convertTime(years_to_seconds(T), M);
 	WaveformHarmonicOptions opts = getWaveformHarmonicOptions();
 	HarmonicOptions hOpts = getHarmonicOptions();
+	ThreadLease lease(opts.num_threads);
 
 	double Tmerge = _inspiralGen.computeTimeToMerger(a, mu/M, r0);
 	T = (T > Tmerge) ? Tmerge : T;
 	double dt = T/(hOpts.max_samples - 1);
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, 1);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, 1);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	computeWaveformFourierHarmonics(h, l, m, modeNum, inspiral, _inspiralGen.getTrajectorySpline(), theta, phi - Phi_phi0, opts.num_threads, &freq[0], imaxf, opts.include_negative_m);
 
 	double amplitude_correction = solar_mass_to_seconds(M);
-	#pragma omp parallel num_threads(opts.num_threads)
+	#pragma omp parallel num_threads(lease.threads())
 	{
 		// total_td = omp_get_num_threads();
 		int i;
@@ -746,15 +811,17 @@ void WaveformFourierGenerator::computeFourierWaveformSourceFrame(WaveformHarmoni
 	T = convertTime(years_to_seconds(T), M);
 	WaveformHarmonicOptions opts = getWaveformHarmonicOptions();
 	HarmonicOptions hOpts = getHarmonicOptions();
+	ThreadLease lease(opts.num_threads);
 
 	double Tmerge = _inspiralGen.computeTimeToMerger(a, mu/M, r0);
 	T = (T > Tmerge) ? Tmerge : T;
 	double dt = T/(hOpts.max_samples - 1);
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, 1);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, 1);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	computeWaveformFourierHarmonics(h, l, m, modeNum, inspiral, _inspiralGen.getTrajectorySpline(), theta, phi - Phi_phi0, opts.num_threads, &freq[0], imaxf, opts.include_negative_m);
 
 	double amplitude_correction = solar_mass_to_seconds(M);
-	#pragma omp parallel num_threads(opts.num_threads)
+	#pragma omp parallel num_threads(lease.threads())
 	{
 		int i, j;
 		#pragma omp for
@@ -766,6 +833,10 @@ void WaveformFourierGenerator::computeFourierWaveformSourceFrame(WaveformHarmoni
 	}
 }
 
+InspiralGenerator& WaveformFourierGenerator::getInspiralGenerator(){
+	return _inspiralGen;
+}
+
 HarmonicModeContainer WaveformFourierGenerator::selectModes(double M, double mu, double a, double r0, double qS, double phiS, double qK, double phiK, double Phi_phi0, double T){
 	return selectModes(M, mu, a, r0, qS, phiS, qK, phiK, Phi_phi0, T, getHarmonicOptions());
 }
@@ -779,7 +850,8 @@ HarmonicModeContainer WaveformFourierGenerator::selectModes(double M, double mu,
 	double Tmerge = _inspiralGen.computeTimeToMerger(a, mu/M, r0);
 	T = (T > Tmerge) ? Tmerge : T;
 	double dt = T/(opts.max_samples - 1);
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, 1);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, 1);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	return WaveformFourierHarmonicGenerator::selectModes(inspiral, theta, opts);
 }
 
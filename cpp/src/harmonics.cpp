@@ -1,103 +1,320 @@
 #include "harmonics.hpp"
+#include <cstring>
+#include <stdexcept>
 
 HarmonicModeData read_harmonic_mode_data(int L, int m, std::string filepath_base){
 	std::string filepath = filepath_base + "_" + std::to_string(L) + "_" + std::to_string(m) + ".txt";
-	double chi, alpha, Alm, Philm;
-	std::istringstream lin;
-	std::ifstream inFile(filepath);
-	std::string line;
-	std::getline(inFile, line);
-	lin.clear();
-	lin.str(line);
-	int chiSample, alphaSample;
-	while(line.front() == '#' || line.empty() || isalpha(line.front())){
-		std::getline(inFile, line);
-		lin.clear();
-		lin.str(line);
-	}
-	lin >> chiSample >> alphaSample;
+	TextFile file(filepath);
+	double samples[2];
+	HarmonicModeData mode;
+	if(!file.isOpen()){
+		std::cout << "ERROR: No harmonic mode data for filename = " << filepath << "\n";
+		return mode;
+	}
+	size_t header = file.firstDataLine();
+	if(!file.parseLine(header, samples, 2)){
+		std::cout << "ERROR: No harmonic mode data for filename = " << filepath << "\n";
+		return mode;
+	}
+	int chiSample = static_cast<int>(samples[0]);
+	int alphaSample = static_cast<int>(samples[1]);
 	int n = chiSample*alphaSample;
-	Vector chiA(n), alphaA(n), AlmA(n), PhilmA(n);
-	int i = 0;
 
-	for(std::string line; std::getline(inFile, line);){
-		lin.clear();
-		lin.str(line);
-		if(lin >> chi >> alpha >> Alm >> Philm){
-			chiA[i] = chi;
-			alphaA[i] = alpha;
-			AlmA[i] = log(Alm);
-			PhilmA[i] = Philm;
+	// rows run over alpha first, so the grids are read off the first row of
+	// each block and the first block
+	mode.chi.resize(chiSample);
+	mode.alpha.resize(alphaSample);
+	mode.A.resize(n);
+	mode.Phi.resize(n);
+	double row[4];
+	int i = 0;
+	for(size_t k = header + 1; k < file.lines() && i < n; k++){
+		if(file.parseLine(k, row, 4)){
+			if(i % alphaSample == 0){
+				mode.chi[i/alphaSample] = row[0];
+			}
+			if(i < alphaSample){
+				mode.alpha[i] = row[1];
+			}
+			mode.A[i] = log(row[2]);
+			mode.Phi[i] = row[3];
 			i++;
 		}
 	}
+	if(i < n){
+		std::cout << "ERROR: File " << filepath << " has " << i << " of " << n << " samples \n";
+	}
+
+	return mode;
+}
 
-	Vector alphaAReduce(alphaSample);
-	for(int i = 0; i < alphaSample; i++){
-		alphaAReduce[i] = alphaA[i];
+HarmonicBinaryData read_harmonic_binary(std::string filename){
+	std::shared_ptr<const MappedFile> file = std::make_shared<const MappedFile>(filename);
+	if(!file->isOpen()){
+		throw std::runtime_error("Could not map harmonic file " + filename);
 	}
-	Vector chiAReduce(chiSample);
-	for(int i = 0; i < chiSample; i++){
-		chiAReduce[i] = chiA[i*alphaSample];
+	if(file->size() < sizeof(HarmonicBinaryHeader)){
+		throw std::runtime_error("Harmonic file " + filename + " is too short");
+	}
+	const HarmonicBinaryHeader *header = reinterpret_cast<const HarmonicBinaryHeader*>(file->data());
+	if(memcmp(header->magic, HARMONIC_BINARY_MAGIC, sizeof(header->magic)) != 0){
+		throw std::runtime_error(filename + " is not a binary harmonic file");
+	}
+	if(header->byte_order != HARMONIC_BINARY_BYTE_ORDER){
+		throw std::runtime_error("Harmonic file " + filename + " was written with a different byte order");
+	}
+	if(header->version != HARMONIC_BINARY_VERSION){
+		throw std::runtime_error("Harmonic file " + filename + " has version " + std::to_string(header->version) + ", expected " + std::to_string(HARMONIC_BINARY_VERSION));
+	}
+	if(file->size() < sizeof(HarmonicBinaryHeader) + uint64_t(header->modes)*sizeof(HarmonicBinaryMode)){
+		throw std::runtime_error("Harmonic file " + filename + " is too short for " + std::to_string(header->modes) + " modes");
 	}
 
-	HarmonicModeData mode = {
-    	.chi = chiAReduce,
-		.alpha = alphaAReduce,
-		.A = AlmA,
-		.Phi = PhilmA
-	};
+	const HarmonicBinaryMode *modes = reinterpret_cast<const HarmonicBinaryMode*>(file->data() + sizeof(HarmonicBinaryHeader));
+	HarmonicBinaryData harm;
+	harm.file = file;
+	for(uint32_t k = 0; k < header->modes; k++){
+		const HarmonicBinaryMode &mode = modes[k];
+		BicubicSplineData amplitude = {mode.x0, mode.dx, mode.nx, mode.y0, mode.dy, mode.ny, 1, nullptr};
+		BicubicSplineData phase = amplitude;
+		bool valid = valid_spline_data(amplitude, mode.size);
+		valid = valid && (mode.amplitude_offset % SPLINE_ALIGNMENT == 0) && file->contains(mode.amplitude_offset, mode.size, sizeof(double));
+		valid = valid && (mode.phase_offset % SPLINE_ALIGNMENT == 0) && file->contains(mode.phase_offset, mode.size, sizeof(double));
+		if(!valid){
+			throw std::runtime_error("Harmonic file " + filename + " has an invalid record for mode (" + std::to_string(mode.l) + ", " + std::to_string(mode.m) + ")");
+		}
+		amplitude.coefficients = reinterpret_cast<const double*>(file->data() + mode.amplitude_offset);
+		phase.coefficients = reinterpret_cast<const double*>(file->data() + mode.phase_offset);
+		harm.lmodes.push_back(mode.l);
+		harm.mmodes.push_back(mode.m);
+		harm.amplitude.push_back(amplitude);
+		harm.phase.push_back(phase);
+	}
+	return harm;
+}
 
-	return mode;
+bool is_harmonic_binary(std::string filename){
+	char magic[sizeof(HARMONIC_BINARY_MAGIC) - 1];
+	std::ifstream inFile(filename, std::ios::binary);
+	if(!inFile.read(magic, sizeof(magic))){
+		return false;
+	}
+	return memcmp(magic, HARMONIC_BINARY_MAGIC, sizeof(magic)) == 0;
 }
 
-HarmonicSpline::HarmonicSpline(double chi, const Vector & alpha, const Vector & A, const Vector & Phi): _spin(spin_of_chi(chi)), _amplitude_spline(alpha, A), _phase_spline(alpha, Phi) {}
-HarmonicSpline::HarmonicSpline(double spin, CubicSpline amplitude_spline, CubicSpline phase_spline): _spin(spin), _amplitude_spline(amplitude_spline), _phase_spline(phase_spline) {}
+int convert_harmonic_files(int lmodes[], int mmodes[], int modeNum, std::string filepath_base, std::string binary_filename){
+	HarmonicAmplitudes harm(lmodes, mmodes, modeNum, filepath_base);
+	return harm.writeBinary(binary_filename);
+}
+
+int convert_harmonic_files(std::vector<int> &lmodes, std::vector<int> &mmodes, std::string filepath_base, std::string binary_filename){
+	return convert_harmonic_files(lmodes.data(), mmodes.data(), std::min(lmodes.size(), mmodes.size()), filepath_base, binary_filename);
+}
+
+HarmonicSpline::HarmonicSpline(double chi, const Vector & alpha, const Vector & A, const Vector & Phi): _spin(spin_of_chi(chi)), _amplitude_spline(alpha, A), _phase_spline(alpha, Phi), _lookup(false) {}
+HarmonicSpline::HarmonicSpline(double spin, CubicSpline amplitude_spline, CubicSpline phase_spline): _spin(spin), _amplitude_spline(amplitude_spline), _phase_spline(phase_spline), _lookup(false) {}
+HarmonicSpline::HarmonicSpline(double spin, LinearTable amplitude_table, LinearTable phase_table): _spin(spin), _lookup(true), _amplitude_table(amplitude_table), _phase_table(phase_table) {}
 HarmonicSpline::~HarmonicSpline() {}
 
+// the splines interpolate the log of the amplitude, while the lookup tables
+// store the amplitude itself so that their evaluation avoids the exponential
 double HarmonicSpline::amplitude(double alpha){
+  if(_lookup){
+    return _amplitude_table.evaluate(alpha);
+  }
   return exp(_amplitude_spline.evaluate(alpha));
 }
 
 double HarmonicSpline::phase(double alpha){
+  if(_lookup){
+    return _phase_table.evaluate(alpha);
+  }
   return _phase_spline.evaluate(alpha);
 }
 
+void HarmonicSpline::amplitude(double amp[], const double alpha[], int n){
+  if(_lookup){
+    _amplitude_table.evaluate(amp, alpha, n);
+    return;
+  }
+  _amplitude_spline.evaluate(amp, alpha, n);
+  for(int i = 0; i < n; i++){
+    amp[i] = exp(amp[i]);
+  }
+}
+
+void HarmonicSpline::phase(double phase[], const double alpha[], int n){
+  if(_lookup){
+    _phase_table.evaluate(phase, alpha, n);
+    return;
+  }
+  _phase_spline.evaluate(phase, alpha, n);
+}
+
 double HarmonicSpline::amplitude_of_omega(double omega){
-  return exp(_amplitude_spline.evaluate(alpha_of_a_omega(_spin, omega)));
+  return amplitude(alpha_of_a_omega(_spin, omega));
 }
 
 double HarmonicSpline::phase_of_omega(double omega){
-  return _phase_spline.evaluate(alpha_of_a_omega(_spin, omega));
+  return phase(alpha_of_a_omega(_spin, omega));
 }
 
 double HarmonicSpline::phase_of_omega_derivative(double omega){
-  return _phase_spline.derivative(alpha_of_a_omega(_spin, omega))*dalpha_domega_of_a_omega(_spin, omega, abs(kerr_isco_frequency(_spin)));
+  double alpha = alpha_of_a_omega(_spin, omega);
+  double dPhi_dalpha = _lookup ? _phase_table.derivative(alpha) : _phase_spline.derivative(alpha);
+  return dPhi_dalpha*dalpha_domega_of_a_omega(_spin, omega, fabs(kerr_isco_frequency(_spin)));
 }
 
 HarmonicSpline2D::HarmonicSpline2D(int L, int m, std::string filepath_base): HarmonicSpline2D(read_harmonic_mode_data(L, m, filepath_base)) {}
-HarmonicSpline2D::HarmonicSpline2D(HarmonicModeData mode): _amplitude_spline(mode.chi, mode.alpha, mode.A), _phase_spline(mode.chi, mode.alpha, mode.Phi) { }
-HarmonicSpline2D::HarmonicSpline2D(const Vector & chi, const Vector & alpha, const Vector & Amp, const Vector & Phi): _amplitude_spline(chi, alpha, Amp), _phase_spline(chi, alpha, Phi) { }
+HarmonicSpline2D::HarmonicSpline2D(HarmonicModeData mode): _amplitude_spline(mode.chi, mode.alpha, mode.A), _phase_spline(mode.chi, mode.alpha, mode.Phi), _lookup(false), _amplitude_error(0.), _phase_error(0.) { }
+HarmonicSpline2D::HarmonicSpline2D(const Vector & chi, const Vector & alpha, const Vector & Amp, const Vector & Phi): _amplitude_spline(chi, alpha, Amp), _phase_spline(chi, alpha, Phi), _lookup(false), _amplitude_error(0.), _phase_error(0.) { }
+HarmonicSpline2D::HarmonicSpline2D(const BicubicSplineData &amplitude, const BicubicSplineData &phase, std::shared_ptr<const void> storage): _amplitude_spline(amplitude, storage), _phase_spline(phase, storage), _lookup(false), _amplitude_error(0.), _phase_error(0.) { }
 HarmonicSpline2D::~HarmonicSpline2D() {}
 
 double HarmonicSpline2D::amplitude(double chi, double alpha){
+  if(_lookup){
+    return _amplitude_table.evaluate(chi, alpha);
+  }
   return exp(_amplitude_spline.evaluate(chi, alpha));
 }
 
 double HarmonicSpline2D::phase(double chi, double alpha){
+  if(_lookup){
+    return _phase_table.evaluate(chi, alpha);
+  }
   return _phase_spline.evaluate(chi, alpha);
 }
 
+// alpha arrays are typically sampled along an inspiral, so the batched
+// evaluations sweep a fixed-chi cursor through them
+void HarmonicSpline2D::amplitude(double amp[], double chi, const double alpha[], int n){
+  if(_lookup){
+    _amplitude_table.reduce_x(chi).evaluate(amp, alpha, n);
+    return;
+  }
+  BicubicSplineCursor cursor(_amplitude_spline, chi);
+  for(int i = 0; i < n; i++){
+    amp[i] = exp(cursor.evaluate(alpha[i]));
+  }
+}
+
+void HarmonicSpline2D::phase(double phase[], double chi, const double alpha[], int n){
+  if(_lookup){
+    _phase_table.reduce_x(chi).evaluate(phase, alpha, n);
+    return;
+  }
+  BicubicSplineCursor cursor(_phase_spline, chi);
+  for(int i = 0; i < n; i++){
+    phase[i] = cursor.evaluate(alpha[i]);
+  }
+}
+
 double HarmonicSpline2D::amplitude_of_a_omega(double a, double omega){
-  return exp(_amplitude_spline.evaluate(chi_of_spin(a), alpha_of_a_omega(a, omega)));
+  return amplitude(chi_of_spin(a), alpha_of_a_omega(a, omega));
 }
 
 double HarmonicSpline2D::phase_of_a_omega(double a, double omega){
-  return _phase_spline.evaluate(chi_of_spin(a), alpha_of_a_omega(a, omega));
+  return phase(chi_of_spin(a), alpha_of_a_omega(a, omega));
 }
 
 double HarmonicSpline2D::phase_of_a_omega_derivative(double a, double omega){
-  return _phase_spline.derivative_y(chi_of_spin(a), alpha_of_a_omega(a, omega))*dalpha_domega_of_a_omega(a, omega, abs(kerr_isco_frequency(a)));
+  double chi = chi_of_spin(a);
+  double alpha = alpha_of_a_omega(a, omega);
+  double dPhi_dalpha = _lookup ? _phase_table.derivative_y(chi, alpha) : _phase_spline.derivative_y(chi, alpha);
+  return dPhi_dalpha*dalpha_domega_of_a_omega(a, omega, fabs(kerr_isco_frequency(a)));
+}
+
+void HarmonicSpline2D::convertToSinglePrecision(bool amplitude, bool phase){
+  if(amplitude){
+    _amplitude_spline.convertToSinglePrecision();
+  }
+  if(phase){
+    _phase_spline.convertToSinglePrecision();
+  }
+}
+
+BicubicSplineData HarmonicSpline2D::amplitudeData() const{
+  return _amplitude_spline.data();
+}
+
+BicubicSplineData HarmonicSpline2D::phaseData() const{
+  return _phase_spline.data();
+}
+
+void HarmonicSpline2D::convertToLookupTables(int chi_samples, int alpha_samples){
+  if(chi_samples < 1 || alpha_samples < 1){
+    std::cout << "ERROR: Lookup tables require at least one interval in chi and alpha \n";
+    return;
+  }
+  double chi0 = _amplitude_spline.xmin();
+  double dchi = (_amplitude_spline.xmax() - chi0)/chi_samples;
+  double alpha0 = _amplitude_spline.ymin();
+  double dalpha = (_amplitude_spline.ymax() - alpha0)/alpha_samples;
+
+  Vector amplitudeGrid((chi_samples + 1)*(alpha_samples + 1));
+  Vector phaseGrid((chi_samples + 1)*(alpha_samples + 1));
+  Vector alpha(alpha_samples + 1);
+  for(int j = 0; j <= alpha_samples; j++){
+    alpha[j] = alpha0 + j*dalpha;
+  }
+  for(int i = 0; i <= chi_samples; i++){
+    double chi = chi0 + i*dchi;
+    double *amplitudeRow = &amplitudeGrid[i*(alpha_samples + 1)];
+    _amplitude_spline.evaluate(amplitudeRow, chi, alpha.data(), alpha_samples + 1);
+    for(int j = 0; j <= alpha_samples; j++){
+      amplitudeRow[j] = exp(amplitudeRow[j]);
+    }
+    _phase_spline.evaluate(&phaseGrid[i*(alpha_samples + 1)], chi, alpha.data(), alpha_samples + 1);
+  }
+  _amplitude_table = BilinearTable(chi0, dchi, chi_samples, alpha0, dalpha, alpha_samples, amplitudeGrid);
+  _phase_table = BilinearTable(chi0, dchi, chi_samples, alpha0, dalpha, alpha_samples, phaseGrid);
+
+  // bilinear interpolation errors peak near the centers of the cells
+  _amplitude_error = 0.;
+  _phase_error = 0.;
+  for(int j = 0; j < alpha_samples; j++){
+    alpha[j] = alpha0 + (j + 0.5)*dalpha;
+  }
+  Vector logAmplitude(alpha_samples), phase(alpha_samples);
+  for(int i = 0; i < chi_samples; i++){
+    double chi = chi0 + (i + 0.5)*dchi;
+    _amplitude_spline.evaluate(logAmplitude.data(), chi, alpha.data(), alpha_samples);
+    _phase_spline.evaluate(phase.data(), chi, alpha.data(), alpha_samples);
+    for(int j = 0; j < alpha_samples; j++){
+      _amplitude_error = std::max(_amplitude_error, fabs(_amplitude_table.evaluate(chi, alpha[j])*exp(-logAmplitude[j]) - 1.));
+      _phase_error = std::max(_phase_error, fabs(_phase_table.evaluate(chi, alpha[j]) - phase[j]));
+    }
+  }
+  _lookup = true;
+}
+
+bool HarmonicSpline2D::lookupTables() const{
+  return _lookup;
+}
+
+double HarmonicSpline2D::lookupAmplitudeError() const{
+  return _amplitude_error;
+}
+
+double HarmonicSpline2D::lookupPhaseError() const{
+  return _phase_error;
+}
+
+HarmonicSpline HarmonicSpline2D::reduce(double chi){
+  if(_lookup){
+    return HarmonicSpline(spin_of_chi(chi), _amplitude_table.reduce_x(chi), _phase_table.reduce_x(chi));
+  }
+  return HarmonicSpline(spin_of_chi(chi), _amplitude_spline.reduce_x(chi), _phase_spline.reduce_x(chi));
+}
+
+HarmonicSplineCursor::HarmonicSplineCursor(const HarmonicSpline2D &harm, double chi): _amplitude_cursor(harm._amplitude_spline, chi), _phase_cursor(harm._phase_spline, chi) {}
+
+double HarmonicSplineCursor::amplitude(double alpha){
+  return exp(_amplitude_cursor.evaluate(alpha));
+}
+
+double HarmonicSplineCursor::phase(double alpha){
+  return _phase_cursor.evaluate(alpha);
 }
 
 ///////////////////////////////////////////////////////
@@ -105,23 +322,212 @@ double HarmonicSpline2D::phase_of_a_omega_derivative(double a, double omega){
 ///////////////////////////////////////////////////////
 
 // A Harmonic class that holds several different modes
-HarmonicAmplitudes::HarmonicAmplitudes(std::vector<int> &lmodes, std::vector<int> &mmodes, std::string filepath_base): 
-	HarmonicAmplitudes(lmodes.data(), mmodes.data(), lmodes.size(), filepath_base) {}
+HarmonicAmplitudes::HarmonicAmplitudes(std::vector<int> &lmodes, std::vector<int> &mmodes, std::string filepath_base, int single_precision): 
+	HarmonicAmplitudes(lmodes.data(), mmodes.data(), lmodes.size(), filepath_base, single_precision) {}
 
-HarmonicAmplitudes::HarmonicAmplitudes(int lmodes[], int mmodes[], int modeNum, std::string filepath_base): _modeNum(modeNum), _harmonics(modeNum) {
+HarmonicAmplitudes::HarmonicAmplitudes(int lmodes[], int mmodes[], int modeNum, std::string filepath_base, int single_precision): _modeNum(modeNum), _lmodes(lmodes, lmodes + modeNum), _mmodes(mmodes, mmodes + modeNum), _filepath_base(filepath_base), _single_precision(single_precision), _lookup_chi_samples(0), _lookup_alpha_samples(0), _arena(new HarmonicSpline2DStorage[modeNum]), _harmonics(new std::atomic<HarmonicSpline2D*>[modeNum]), _load_flags(new std::once_flag[modeNum]), _lmax(-1), _slice_cache(HARMONIC_SLICE_CACHE_SIZE) {
 	for(int i = 0; i < _modeNum; i++){
-		_harmonics[i] = new HarmonicSpline2D(lmodes[i], mmodes[i], filepath_base);
-		_position_map[std::pair<int, int>(lmodes[i], mmodes[i])] = i;
+		_harmonics[i].store(nullptr);
+		_lmax = std::max(_lmax, lmodes[i]);
+	}
+	_mode_index.assign((_lmax + 1)*(_lmax + 1), -1);
+	for(int i = 0; i < _modeNum; i++){
+		if(lmodes[i] < 0 || abs(mmodes[i]) > lmodes[i]){
+			std::cout << "ERROR: Harmonic mode (" << lmodes[i] << ", " << mmodes[i] << ") does not satisfy |m| <= l \n";
+		}else{
+			_mode_index[lmodes[i]*(lmodes[i] + 1) + mmodes[i]] = i;
+		}
 	}
 }
+// the listed modes are only read by the constructor, so the const mode lists
+// of the file are passed on
+HarmonicAmplitudes::HarmonicAmplitudes(const HarmonicBinaryData &harm, int single_precision):
+	HarmonicAmplitudes(const_cast<int*>(harm.lmodes.data()), const_cast<int*>(harm.mmodes.data()), harm.lmodes.size(), harm, single_precision) {}
+
+HarmonicAmplitudes::HarmonicAmplitudes(int lmodes[], int mmodes[], int modeNum, const HarmonicBinaryData &harm, int single_precision): HarmonicAmplitudes(lmodes, mmodes, modeNum, "", single_precision) {
+	std::map<std::pair<int,int>,int> fileModes;
+	for(size_t k = 0; k < harm.lmodes.size(); k++){
+		fileModes[std::pair<int, int>(harm.lmodes[k], harm.mmodes[k])] = k;
+	}
+	_file = harm.file;
+	_amplitude_data.resize(_modeNum);
+	_phase_data.resize(_modeNum);
+	for(int i = 0; i < _modeNum; i++){
+		std::map<std::pair<int,int>,int>::const_iterator it = fileModes.find(std::pair<int, int>(lmodes[i], mmodes[i]));
+		if(it == fileModes.end()){
+			throw std::runtime_error("No harmonic mode data for mode (" + std::to_string(lmodes[i]) + ", " + std::to_string(mmodes[i]) + ") in the binary harmonic file");
+		}
+		_amplitude_data[i] = harm.amplitude[it->second];
+		_phase_data[i] = harm.phase[it->second];
+	}
+}
+
 HarmonicAmplitudes::~HarmonicAmplitudes() {
+	// the slices refer back to the modes, so they go first
+	_slice_cache.clear();
 	for(int i = 0; i < _modeNum; i++){
-		delete _harmonics[i];
+		HarmonicSpline2D* harm = _harmonics[i].load();
+		if(harm != nullptr){
+			harm->~HarmonicSpline2D();
+		}
+	}
+}
+
+int HarmonicAmplitudes::getModeIndex(int l, int m) const{
+	if(l < 0 || l > _lmax || m < -l || m > l){
+		return -1;
+	}
+	return _mode_index[l*(l + 1) + m];
+}
+
+HarmonicSpline2D* HarmonicAmplitudes::getModePointer(int i) const{
+	if(i < 0 || i >= _modeNum){
+		return nullptr;
 	}
+	return loadMode(i);
+}
+
+HarmonicSpline2D* HarmonicAmplitudes::findPointer(int l, int m) const{
+	return getModePointer(getModeIndex(l, m));
+}
+
+int HarmonicAmplitudes::position(int l, int m) const{
+	int i = getModeIndex(l, m);
+	if(i < 0){
+		std::cout << "ERROR: Harmonic mode (" << l << ", " << m << ") is not held, the first mode is used instead \n";
+		return 0;
+	}
+	return i;
+}
+
+HarmonicSpline2D* HarmonicAmplitudes::loadMode(int i) const{
+	// after the first load a mode costs a single atomic read. Threads that
+	// request a mode while it loads wait for it, while other modes load in parallel
+	HarmonicSpline2D* harm = _harmonics[i].load(std::memory_order_acquire);
+	if(harm == nullptr){
+		std::call_once(_load_flags[i], [this, i](){
+			HarmonicSpline2D* mode;
+			if(_file){
+				mode = new(&_arena[i]) HarmonicSpline2D(_amplitude_data[i], _phase_data[i], _file);
+			}else{
+				mode = new(&_arena[i]) HarmonicSpline2D(_lmodes[i], _mmodes[i], _filepath_base);
+			}
+			mode->convertToSinglePrecision(_single_precision & HARMONIC_AMPLITUDE_SINGLE_PRECISION, _single_precision & HARMONIC_PHASE_SINGLE_PRECISION);
+			if(_lookup_chi_samples > 0){
+				mode->convertToLookupTables(_lookup_chi_samples, _lookup_alpha_samples);
+			}
+			_harmonics[i].store(mode, std::memory_order_release);
+		});
+		harm = _harmonics[i].load(std::memory_order_acquire);
+	}
+	return harm;
+}
+
+void HarmonicAmplitudes::preload(){
+	// every mode is read and fit on its own, so the files are loaded in parallel
+	#pragma omp parallel for schedule(dynamic)
+	for(int i = 0; i < _modeNum; i++){
+		loadMode(i);
+	}
+}
+
+void HarmonicAmplitudes::preload(int lmodes[], int mmodes[], int modeNum){
+	#pragma omp parallel for schedule(dynamic)
+	for(int i = 0; i < modeNum; i++){
+		findPointer(lmodes[i], mmodes[i]);
+	}
+}
+
+void HarmonicAmplitudes::preload(std::vector<int> &lmodes, std::vector<int> &mmodes){
+	preload(lmodes.data(), mmodes.data(), std::min(lmodes.size(), mmodes.size()));
+}
+
+static uint64_t aligned_offset(uint64_t offset){
+	return ((offset + SPLINE_ALIGNMENT - 1)/SPLINE_ALIGNMENT)*SPLINE_ALIGNMENT;
+}
+
+int HarmonicAmplitudes::writeBinary(std::string filename){
+	if(_single_precision){
+		std::cout << "ERROR: Harmonic splines in single precision cannot be written to " << filename << "\n";
+		return 1;
+	}
+	preload();
+
+	HarmonicBinaryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, HARMONIC_BINARY_MAGIC, sizeof(header.magic));
+	header.version = HARMONIC_BINARY_VERSION;
+	header.byte_order = HARMONIC_BINARY_BYTE_ORDER;
+	header.modes = _modeNum;
+
+	std::vector<HarmonicBinaryMode> modes(_modeNum);
+	std::vector<BicubicSplineData> amplitude(_modeNum);
+	std::vector<BicubicSplineData> phase(_modeNum);
+	uint64_t offset = aligned_offset(sizeof(header) + _modeNum*sizeof(HarmonicBinaryMode));
+	for(int i = 0; i < _modeNum; i++){
+		amplitude[i] = loadMode(i)->amplitudeData();
+		phase[i] = loadMode(i)->phaseData();
+		HarmonicBinaryMode &mode = modes[i];
+		memset(&mode, 0, sizeof(mode));
+		mode.l = _lmodes[i];
+		mode.m = _mmodes[i];
+		mode.nx = amplitude[i].nx;
+		mode.ny = amplitude[i].ny;
+		mode.x0 = amplitude[i].x0;
+		mode.dx = amplitude[i].dx;
+		mode.y0 = amplitude[i].y0;
+		mode.dy = amplitude[i].dy;
+		mode.size = 16*uint64_t(mode.nx)*mode.ny;
+		mode.amplitude_offset = offset;
+		mode.phase_offset = aligned_offset(offset + mode.size*sizeof(double));
+		offset = aligned_offset(mode.phase_offset + mode.size*sizeof(double));
+		// both splines of a mode are fit on the same grid
+		if(phase[i].nx != mode.nx || phase[i].ny != mode.ny || amplitude[i].nx <= 0 || amplitude[i].ny <= 0){
+			std::cout << "ERROR: Harmonic mode (" << mode.l << ", " << mode.m << ") has no spline to write to " << filename << "\n";
+			return 1;
+		}
+	}
+
+	std::ofstream outFile(filename, std::ios::binary | std::ios::trunc);
+	if(!outFile){
+		std::cout << "ERROR: Could not open " << filename << " for writing \n";
+		return 1;
+	}
+	outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	outFile.write(reinterpret_cast<const char*>(modes.data()), _modeNum*sizeof(HarmonicBinaryMode));
+	uint64_t position = sizeof(header) + _modeNum*sizeof(HarmonicBinaryMode);
+	const char padding[SPLINE_ALIGNMENT] = {0};
+	for(int i = 0; i < _modeNum; i++){
+		outFile.write(padding, modes[i].amplitude_offset - position);
+		outFile.write(reinterpret_cast<const char*>(amplitude[i].coefficients), modes[i].size*sizeof(double));
+		position = modes[i].amplitude_offset + modes[i].size*sizeof(double);
+		outFile.write(padding, modes[i].phase_offset - position);
+		outFile.write(reinterpret_cast<const char*>(phase[i].coefficients), modes[i].size*sizeof(double));
+		position = modes[i].phase_offset + modes[i].size*sizeof(double);
+	}
+	if(!outFile){
+		std::cout << "ERROR: Could not write " << filename << "\n";
+		return 1;
+	}
+	return 0;
+}
+
+int HarmonicAmplitudes::getModeNumber(){
+	return _modeNum;
+}
+
+int HarmonicAmplitudes::loadedModeNumber(){
+	int loaded = 0;
+	for(int i = 0; i < _modeNum; i++){
+		if(_harmonics[i].load(std::memory_order_acquire) != nullptr){
+			loaded++;
+		}
+	}
+	return loaded;
 }
 
 int HarmonicAmplitudes::key_check(std::pair<int, int> key){
-	if(_position_map.count(key) > 0){
+	if(getModeIndex(key.first, key.second) >= 0){
 		return 1;
 	}else{
 		return 0;
@@ -129,51 +535,134 @@ int HarmonicAmplitudes::key_check(std::pair<int, int> key){
 }
 
 double HarmonicAmplitudes::amplitude(int l, int m, double chi, double alpha){
-	std::pair<int, int> key(l, m);
-	return _harmonics[_position_map[key]]->amplitude(chi, alpha);
+	return getPointer(l, m)->amplitude(chi, alpha);
 }
 
 double HarmonicAmplitudes::phase(int l, int m, double chi, double alpha){
-	std::pair<int, int> key(l, m);
-	return _harmonics[_position_map[key]]->phase(chi, alpha);
+	return getPointer(l, m)->phase(chi, alpha);
 }
 
 double HarmonicAmplitudes::amplitude_of_a_omega(int l, int m, double a, double omega){
-	std::pair<int, int> key(l, m);
-	return _harmonics[_position_map[key]]->amplitude_of_a_omega(a, omega);
+	return getPointer(l, m)->amplitude_of_a_omega(a, omega);
 }
 
 double HarmonicAmplitudes::phase_of_a_omega(int l, int m, double a, double omega){
-	std::pair<int, int> key(l, m);
-	return _harmonics[_position_map[key]]->phase_of_a_omega(a, omega);
+	return getPointer(l, m)->phase_of_a_omega(a, omega);
 }
 
 double HarmonicAmplitudes::phase_of_a_omega_derivative(int l, int m, double a, double omega){
-	std::pair<int, int> key(l, m);
-	return _harmonics[_position_map[key]]->phase_of_a_omega_derivative(a, omega);
+	return getPointer(l, m)->phase_of_a_omega_derivative(a, omega);
 }
 
 HarmonicSpline2D* HarmonicAmplitudes::getPointer(int l, int m){
-	std::pair<int, int> key(l, m);
-	return _harmonics[_position_map[key]];
+	return loadMode(position(l, m));
+}
+
+void HarmonicAmplitudes::useLookupTables(int chi_samples, int alpha_samples){
+	// modes that load from here on are converted by loadMode, which is not
+	// safe to call while this runs
+	_lookup_chi_samples = chi_samples;
+	_lookup_alpha_samples = alpha_samples;
+	#pragma omp parallel for schedule(dynamic)
+	for(int i = 0; i < _modeNum; i++){
+		HarmonicSpline2D* harm = _harmonics[i].load(std::memory_order_acquire);
+		if(harm != nullptr){
+			harm->convertToLookupTables(chi_samples, alpha_samples);
+		}
+	}
+	// slices built before the conversion still hold the splines
+	_slice_cache.clear();
+}
+
+int HarmonicAmplitudes::lookupTables(){
+	if(_modeNum > 0 && _lookup_chi_samples > 0){
+		return 1;
+	}else{
+		return 0;
+	}
+}
+
+double HarmonicAmplitudes::lookupAmplitudeError(int l, int m){
+	return getPointer(l, m)->lookupAmplitudeError();
+}
+
+double HarmonicAmplitudes::lookupPhaseError(int l, int m){
+	return getPointer(l, m)->lookupPhaseError();
+}
+
+std::shared_ptr<HarmonicSlice> HarmonicAmplitudes::slice(double chi){
+	std::shared_ptr<HarmonicSlice> chiSlice = _slice_cache.find(chi);
+	if(!chiSlice){
+		// two threads that miss on the same chi both build the slice, and the
+		// second insertion replaces the first. The modes are only reduced when
+		// they are requested from the slice
+		chiSlice = std::make_shared<HarmonicSlice>(chi, *this);
+		_slice_cache.insert(chi, chiSlice);
+	}
+	return chiSlice;
+}
+
+///////////////////////////////////////////////////////
+//////////          HarmonicSlice        //////////////
+///////////////////////////////////////////////////////
+
+HarmonicSlice::HarmonicSlice(double chi, HarmonicAmplitudes &harm): _chi(chi), _harm(harm), _arena(new HarmonicSplineStorage[harm._modeNum]), _harmonics(new std::atomic<HarmonicSpline*>[harm._modeNum]), _reduce_flags(new std::once_flag[harm._modeNum]) {
+	for(int i = 0; i < _harm._modeNum; i++){
+		_harmonics[i].store(nullptr);
+	}
+}
+
+HarmonicSlice::~HarmonicSlice(){
+	for(int i = 0; i < _harm._modeNum; i++){
+		HarmonicSpline* harm = _harmonics[i].load();
+		if(harm != nullptr){
+			harm->~HarmonicSpline();
+		}
+	}
+}
+
+double HarmonicSlice::getChi(){
+	return _chi;
+}
+
+double HarmonicSlice::amplitude(int l, int m, double alpha){
+	return getPointer(l, m)->amplitude(alpha);
+}
+
+double HarmonicSlice::phase(int l, int m, double alpha){
+	return getPointer(l, m)->phase(alpha);
+}
+
+HarmonicSpline* HarmonicSlice::getPointer(int l, int m){
+	// a slice is shared between threads, so modes are reduced once, like the
+	// modes of HarmonicAmplitudes::loadMode
+	int i = _harm.position(l, m);
+	HarmonicSpline* harm = _harmonics[i].load(std::memory_order_acquire);
+	if(harm == nullptr){
+		std::call_once(_reduce_flags[i], [this, i](){
+			_harmonics[i].store(new(&_arena[i]) HarmonicSpline(_harm.loadMode(i)->reduce(_chi)), std::memory_order_release);
+		});
+		harm = _harmonics[i].load(std::memory_order_acquire);
+	}
+	return harm;
 }
 
 HarmonicSelector::HarmonicSelector(HarmonicAmplitudes &harm, HarmonicOptions opts): _harm(harm), _opts(opts) {}
 
-double HarmonicSelector::modePower(int l, int m, InspiralContainer &inspiral){
+double HarmonicSelector::modePower(int l, int m, const InspiralContainer &inspiral){
 	return modePower(l, m, inspiral, _opts);
 }
-int HarmonicSelector::gradeMode(int l, int m, InspiralContainer &inspiral, double power22){
+int HarmonicSelector::gradeMode(int l, int m, const InspiralContainer &inspiral, double power22){
 	return gradeMode(l, m, inspiral, power22, _opts);
 }
-int HarmonicSelector::gradeMode(int l, int m, InspiralContainer &inspiral, double power22, double &plusYlm, double &crossYlm, double theta){
+int HarmonicSelector::gradeMode(int l, int m, const InspiralContainer &inspiral, double power22, double &plusYlm, double &crossYlm, double theta){
 	return gradeMode(l, m, inspiral, power22, plusYlm, crossYlm, theta, _opts);
 }
-HarmonicModeContainer HarmonicSelector::selectModes(InspiralContainer &inspiral, double theta){
+HarmonicModeContainer HarmonicSelector::selectModes(const InspiralContainer &inspiral, double theta){
 	return selectModes(inspiral, theta, _opts);
 }
 
-double HarmonicSelector::modePower(int l, int m, InspiralContainer &inspiral, HarmonicOptions opts){
+double HarmonicSelector::modePower(int l, int m, const InspiralContainer &inspiral, HarmonicOptions opts){
 	double power = 0.;
 	int timeSteps = inspiral.getSize();
 	int stepSize = 1;
@@ -200,7 +689,7 @@ double HarmonicSelector::modePower(int l, int m, InspiralContainer &inspiral, Ha
 	return power;
 }
 
-int HarmonicSelector::gradeMode(int l, int m, InspiralContainer &inspiral, double power22, HarmonicOptions opts){
+int HarmonicSelector::gradeMode(int l, int m, const InspiralContainer &inspiral, double power22, HarmonicOptions opts){
 	double powerLM = modePower(l, m, inspiral, opts);
 	power22 += powerLM;
 	if(powerLM/power22 > opts.epsilon){
@@ -210,7 +699,7 @@ int HarmonicSelector::gradeMode(int l, int m, InspiralContainer &inspiral, doubl
 	}
 }
 
-int HarmonicSelector::gradeMode(int l, int m, InspiralContainer &inspiral, double power22, double &plusYlm, double &crossYlm, double theta, HarmonicOptions opts){
+int HarmonicSelector::gradeMode(int l, int m, const InspiralContainer &inspiral, double power22, double &plusYlm, double &crossYlm, double theta, HarmonicOptions opts){
 	double powerLM = modePower(l, m, inspiral, opts);
 	Yslm_plus_cross_polarization(plusYlm, crossYlm, l, m, theta);
 	power22 += powerLM*(pow(plusYlm, 2) + pow(crossYlm, 2));
@@ -221,7 +710,7 @@ int HarmonicSelector::gradeMode(int l, int m, InspiralContainer &inspiral, doubl
 	}
 }
 
-HarmonicModeContainer HarmonicSelector::selectModes(InspiralContainer &inspiral, double theta, HarmonicOptions opts){
+HarmonicModeContainer HarmonicSelector::selectModes(const InspiralContainer &inspiral, double theta, HarmonicOptions opts){
 	HarmonicModeContainer harmonics;
 	double plusY, crossY, power22;
 	int l, m;
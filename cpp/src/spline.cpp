@@ -1,7 +1,10 @@
 #include "spline.hpp"
 #include <iostream>
+#include <cfloat>
 
 #define ENDPOINT_TOL 1.e-10
+#define SPLINE_BLOCK_SIZE 64 // right-hand sides per block in the batched tridiagonal solves
+#define SPLINE_PARALLEL_MIN 16384 // smallest problem size that is worth threading
 
 ///////////////////////////////////////////////////////////////////
 //////////////              Matrix Class           ////////////////
@@ -12,7 +15,7 @@ Matrix::Matrix(int n): _n(n), _m(n), _A(n*n) {}
 Matrix::Matrix(int n, int m): _n(n), _m(m), _A(n*m) {}
 Matrix::Matrix(int n, int m, Vector A): _n(n), _m(m), _A(n*m) {
 	if(A.size() == _A.size()){
-		_A = A;
+		_A.assign(A.begin(), A.end());
 	}
 }
 Matrix::Matrix(int n, int m, double val): _n(n), _m(m), _A(n*m, val) {}
@@ -59,7 +62,11 @@ void Matrix::reshape(int n, int m){
 }
 
 Matrix Matrix::reshaped(int n, int m) const{
-	return Matrix(n, m , _A);
+	Matrix A(n, m);
+	if(A._A.size() == _A.size()){
+		A._A = _A;
+	}
+	return A;
 }
 
 Matrix Matrix::transpose() const{
@@ -101,13 +108,6 @@ void Matrix::set_value(int i, int j, double val){
 	_A[i*_m + j] = val;
 }
 
-double& Matrix::operator()(int i, int j){
-	return _A[i*_m + j];
-}
-const double& Matrix::operator()(int i, int j) const{
-	return _A[i*_m + j];
-}
-
 StopWatch::StopWatch():time_elapsed(0.), t1(std::chrono::high_resolution_clock::now()), t2(t1) {}
 void StopWatch::start(){
 	t1 = std::chrono::high_resolution_clock::now();
@@ -143,7 +143,7 @@ double StopWatch::time(){
 //////////////////////////////////////////////////////////////////
 
 BicubicSpline::BicubicSpline(const Vector &x, const Vector &y, Matrix &z, int method): BicubicSpline(x[0], x[1] - x[0], x.size() - 1, y[0], y[1] - y[0], y.size() - 1, z) {}
-BicubicSpline::BicubicSpline(double x0, double dx, int nx, double y0, double dy, int ny, Matrix &z, int method): dx(dx), dy(dy), nx(nx), ny(ny), x0(x0), y0(y0), cij(nx, 16*ny) {
+BicubicSpline::BicubicSpline(double x0, double dx, int nx, double y0, double dy, int ny, Matrix &z, int method): dx(dx), dy(dy), nx(nx), ny(ny), x0(x0), y0(y0), cij(nx, 16*ny), single_precision(false), mapped_cij(nullptr) {
 	if(nx + 1 != z.rows() && ny + 1 != z.cols()){
 		if(nx + 1 == z.cols() && ny + 1 == z.rows()){
 			// switch x and y
@@ -160,8 +160,22 @@ BicubicSpline::BicubicSpline(double x0, double dx, int nx, double y0, double dy,
 	}
 }
 
+BicubicSpline::BicubicSpline(const BicubicSplineData &data, std::shared_ptr<const void> storage): dx(data.dx), dy(data.dy), nx(data.nx), ny(data.ny), x0(data.x0), y0(data.y0), cij(0, 0), single_precision(false), mapped_cij(data.coefficients), mapped_storage(storage) {
+	if(data.nfields != 1){
+		std::cout << "ERROR: BicubicSpline cannot wrap the coefficients of " << data.nfields << " fields \n";
+	}
+}
+
+BicubicSplineData BicubicSpline::data() const{
+	if(single_precision){
+		std::cout << "ERROR: Spline coefficients are stored in single precision \n";
+	}
+	BicubicSplineData splineData = {x0, dx, nx, y0, dy, ny, 1, single_precision ? nullptr : coefficients()};
+	return splineData;
+}
+
 BicubicSpline::BicubicSpline(const Vector &x, const Vector &y, const Vector &z, int method): BicubicSpline(x[0], x[1] - x[0], x.size() - 1, y[0], y[1] - y[0], y.size() - 1, z) {}
-BicubicSpline::BicubicSpline(double x0, double dx, int nx, double y0, double dy, int ny, const Vector &z_vec, int method): dx(dx), dy(dy), nx(nx), ny(ny), x0(x0), y0(y0), cij(nx, 16*ny) {
+BicubicSpline::BicubicSpline(double x0, double dx, int nx, double y0, double dy, int ny, const Vector &z_vec, int method): dx(dx), dy(dy), nx(nx), ny(ny), x0(x0), y0(y0), cij(nx, 16*ny), single_precision(false), mapped_cij(nullptr) {
 	Matrix z(nx+1, ny+1, z_vec);
 	if(nx + 1 != z.rows() && ny + 1 != z.cols()){
 		if(nx + 1 == z.cols() && ny + 1 == z.rows()){
@@ -179,157 +193,310 @@ BicubicSpline::BicubicSpline(double x0, double dx, int nx, double y0, double dy,
 	}
 }
 
-double BicubicSpline::evaluate(const double x, const double y){
-	int i = findXInterval(x);
-	int j = findYInterval(y);
-	return evaluateInterval(i, j, x, y);
+// Batched evaluation. Each loop is written so that the compiler can vectorize
+// across points: the cell search is branch-free after inlining and the 16
+// coefficients of each point's cell are fetched with gathered loads. The
+// kernels are templated on the storage type of the coefficients
+template <typename T>
+void BicubicSpline::evaluateBatch(const T *c, double z[], const double x[], const double y[], int n){
+	const int stride = 16*ny;
+	#pragma omp simd
+	for(int k = 0; k < n; k++){
+		int i = findXInterval(x[k]);
+		int j = findYInterval(y[k]);
+		double xbar = (x[k] - x0 - i*dx)/dx;
+		double ybar = (y[k] - y0 - j*dy)/dy;
+		const int cell = i*stride + 16*j;
+		z[k] = bicubic_cell<0, 0>(c, cell, xbar, ybar);
+	}
 }
 
-double BicubicSpline::derivative_x(const double x, const double y){
+template <typename T>
+void BicubicSpline::evaluateBatch(const T *c, double z[], const double x, const double y[], int n){
 	int i = findXInterval(x);
-	int j = findYInterval(y);
-	return evaluateDerivativeXInterval(i, j, x, y)/dx;
+	double xbar = (x - x0 - i*dx)/dx;
+	const int row = i*16*ny;
+	#pragma omp simd
+	for(int k = 0; k < n; k++){
+		int j = findYInterval(y[k]);
+		double ybar = (y[k] - y0 - j*dy)/dy;
+		const int cell = row + 16*j;
+		z[k] = bicubic_cell<0, 0>(c, cell, xbar, ybar);
+	}
 }
 
-double BicubicSpline::derivative_y(const double x, const double y){
-	int i = findXInterval(x);
-	int j = findYInterval(y);
-	return evaluateDerivativeYInterval(i, j, x, y)/dy;
+template <typename T>
+void BicubicSpline::derivativeXBatch(const T *c, double dzdx[], const double x[], const double y[], int n){
+	const int stride = 16*ny;
+	#pragma omp simd
+	for(int k = 0; k < n; k++){
+		int i = findXInterval(x[k]);
+		int j = findYInterval(y[k]);
+		double xbar = (x[k] - x0 - i*dx)/dx;
+		double ybar = (y[k] - y0 - j*dy)/dy;
+		const int cell = i*stride + 16*j;
+		dzdx[k] = bicubic_cell<1, 0>(c, cell, xbar, ybar)/dx;
+	}
 }
 
-double BicubicSpline::derivative_xy(const double x, const double y){
-	int i = findXInterval(x);
-	int j = findYInterval(y);
-	return evaluateDerivativeXYInterval(i, j, x, y)/dx/dy;
+template <typename T>
+void BicubicSpline::derivativeYBatch(const T *c, double dzdy[], const double x[], const double y[], int n){
+	const int stride = 16*ny;
+	#pragma omp simd
+	for(int k = 0; k < n; k++){
+		int i = findXInterval(x[k]);
+		int j = findYInterval(y[k]);
+		double xbar = (x[k] - x0 - i*dx)/dx;
+		double ybar = (y[k] - y0 - j*dy)/dy;
+		const int cell = i*stride + 16*j;
+		dzdy[k] = bicubic_cell<0, 1>(c, cell, xbar, ybar)/dy;
+	}
 }
 
-double BicubicSpline::derivative_xx(const double x, const double y){
+template <typename T>
+void BicubicSpline::derivativeYBatch(const T *c, double dzdy[], const double x, const double y[], int n){
 	int i = findXInterval(x);
-	int j = findYInterval(y);
-	return evaluateDerivativeXXInterval(i, j, x, y)/dx/dx;
+	double xbar = (x - x0 - i*dx)/dx;
+	const int row = i*16*ny;
+	#pragma omp simd
+	for(int k = 0; k < n; k++){
+		int j = findYInterval(y[k]);
+		double ybar = (y[k] - y0 - j*dy)/dy;
+		const int cell = row + 16*j;
+		dzdy[k] = bicubic_cell<0, 1>(c, cell, xbar, ybar)/dy;
+	}
 }
 
-double BicubicSpline::derivative_yy(const double x, const double y){
-	int i = findXInterval(x);
-	int j = findYInterval(y);
-	return evaluateDerivativeYYInterval(i, j, x, y)/dy/dy;
+template <typename T>
+void BicubicSpline::gradientBatch(const T *c, double z[], double dzdx[], double dzdy[], const double x[], const double y[], int n){
+	const int stride = 16*ny;
+	#pragma omp simd
+	for(int k = 0; k < n; k++){
+		int i = findXInterval(x[k]);
+		int j = findYInterval(y[k]);
+		double xbar = (x[k] - x0 - i*dx)/dx;
+		double ybar = (y[k] - y0 - j*dy)/dy;
+		const int cell = i*stride + 16*j;
+		bicubic_cell_gradient(z[k], dzdx[k], dzdy[k], c, cell, xbar, ybar);
+		dzdx[k] /= dx;
+		dzdy[k] /= dy;
+	}
+}
+
+void BicubicSpline::evaluate(double z[], const double x[], const double y[], int n){
+	if(single_precision){
+		evaluateBatch(cij_single.data(), z, x, y, n);
+	}else{
+		evaluateBatch(coefficients(), z, x, y, n);
+	}
+}
+
+void BicubicSpline::evaluate(double z[], const double x, const double y[], int n){
+	if(single_precision){
+		evaluateBatch(cij_single.data(), z, x, y, n);
+	}else{
+		evaluateBatch(coefficients(), z, x, y, n);
+	}
+}
+
+void BicubicSpline::derivative_x(double dzdx[], const double x[], const double y[], int n){
+	if(single_precision){
+		derivativeXBatch(cij_single.data(), dzdx, x, y, n);
+	}else{
+		derivativeXBatch(coefficients(), dzdx, x, y, n);
+	}
+}
+
+void BicubicSpline::derivative_y(double dzdy[], const double x[], const double y[], int n){
+	if(single_precision){
+		derivativeYBatch(cij_single.data(), dzdy, x, y, n);
+	}else{
+		derivativeYBatch(coefficients(), dzdy, x, y, n);
+	}
+}
+
+void BicubicSpline::derivative_y(double dzdy[], const double x, const double y[], int n){
+	if(single_precision){
+		derivativeYBatch(cij_single.data(), dzdy, x, y, n);
+	}else{
+		derivativeYBatch(coefficients(), dzdy, x, y, n);
+	}
+}
+
+void BicubicSpline::evaluate_gradient(double z[], double dzdx[], double dzdy[], const double x[], const double y[], int n){
+	if(single_precision){
+		gradientBatch(cij_single.data(), z, dzdx, dzdy, x, y, n);
+	}else{
+		gradientBatch(coefficients(), z, dzdx, dzdy, x, y, n);
+	}
+}
+
+// Node first-derivatives, in units of the grid spacing, of the cubic splines
+// through each column of y, where row i of y holds node i of every data set.
+// All columns share the same tridiagonal matrix, so it is factorized once and
+// the sweeps are then applied to blocks of right-hand sides, vectorized
+// across columns and threaded across blocks. Supports methods 1-4 of CubicSpline
+static void cubic_spline_node_derivatives(Matrix &ydx, const Matrix &y, int method){
+	int n = y.rows();
+	int nrhs = y.cols();
+
+	// rows 0 and n - 1 of the system depend on the boundary condition,
+	// the interior rows are always (1, 4, 1)
+	double b0, c0;
+	if(method == 2){
+		b0 = 1.;
+		c0 = 0.;
+	}else if(method == 3){
+		b0 = 6.;
+		c0 = 18.;
+	}else if(method == 4){
+		b0 = 2.;
+		c0 = 1.;
+	}else{
+		b0 = 2.;
+		c0 = 4.;
+	}
+
+	Vector b(n, 4.);
+	Vector w(n, 0.);
+	Vector c(n, 1.);
+	b[0] = b0;
+	c[0] = c0;
+	b[n - 1] = b0;
+	for(int i = 1; i < n; i++){
+		double a = (i == n - 1) ? c0 : 1.;
+		w[i] = a/b[i - 1];
+		b[i] = b[i] - w[i]*c[i - 1];
+	}
+
+	const double *yp = y.data();
+	double *d = ydx.data();
+	#pragma omp parallel for schedule(static) if(n*nrhs > SPLINE_PARALLEL_MIN)
+	for(int jb = 0; jb < nrhs; jb += SPLINE_BLOCK_SIZE){
+		int jmax = std::min(jb + SPLINE_BLOCK_SIZE, nrhs);
+		int N = n - 1;
+		for(int i = 1; i < N; i++){
+			#pragma omp simd
+			for(int j = jb; j < jmax; j++){
+				d[i*nrhs + j] = 3.*(yp[(i + 1)*nrhs + j] - yp[(i - 1)*nrhs + j]);
+			}
+		}
+		#pragma omp simd
+		for(int j = jb; j < jmax; j++){
+			if(method == 2){
+				d[j] = 0.;
+				d[N*nrhs + j] = 0.;
+			}else if(method == 3){
+				d[j] = -yp[3*nrhs + j] + 9.*yp[2*nrhs + j] + 9.*yp[nrhs + j] - 17.*yp[j];
+				d[N*nrhs + j] = yp[(N - 3)*nrhs + j] - 9.*yp[(N - 2)*nrhs + j] - 9.*yp[(N - 1)*nrhs + j] + 17.*yp[N*nrhs + j];
+			}else if(method == 4){
+				d[j] = 3.*(yp[nrhs + j] - yp[j]);
+				d[N*nrhs + j] = 3.*(yp[N*nrhs + j] - yp[(N - 1)*nrhs + j]);
+			}else{
+				d[j] = yp[2*nrhs + j] + 4.*yp[nrhs + j] - 5.*yp[j];
+				d[N*nrhs + j] = 5.*yp[N*nrhs + j] - 4.*yp[(N - 1)*nrhs + j] - yp[(N - 2)*nrhs + j];
+			}
+		}
+		// forward sweep
+		for(int i = 1; i < n; i++){
+			#pragma omp simd
+			for(int j = jb; j < jmax; j++){
+				d[i*nrhs + j] -= w[i]*d[(i - 1)*nrhs + j];
+			}
+		}
+		// back substitution
+		#pragma omp simd
+		for(int j = jb; j < jmax; j++){
+			d[N*nrhs + j] /= b[N];
+		}
+		for(int i = N - 1; i >= 0; i--){
+			#pragma omp simd
+			for(int j = jb; j < jmax; j++){
+				d[i*nrhs + j] = (d[i*nrhs + j] - c[i]*d[(i + 1)*nrhs + j])/b[i];
+			}
+		}
+	}
+}
+
+// Closed form of L*D*L^T for the bicubic Hermite basis, where D holds
+// (f, fy, fx, fxy) at the four corners of a cell in the layout used by
+// computeSplineCoefficients
+static inline void bicubic_cell_coefficients(double cell[16], const double D[16]){
+	double T[16];
+	for(int n = 0; n < 4; n++){
+		T[n] = D[n];
+		T[4 + n] = D[8 + n];
+		T[8 + n] = -3.*D[n] + 3.*D[4 + n] - 2.*D[8 + n] - D[12 + n];
+		T[12 + n] = 2.*D[n] - 2.*D[4 + n] + D[8 + n] + D[12 + n];
+	}
+	for(int k = 0; k < 4; k++){
+		cell[4*k] = T[4*k];
+		cell[4*k + 1] = T[4*k + 2];
+		cell[4*k + 2] = -3.*T[4*k] + 3.*T[4*k + 1] - 2.*T[4*k + 2] - T[4*k + 3];
+		cell[4*k + 3] = 2.*T[4*k] - 2.*T[4*k + 1] + T[4*k + 2] + T[4*k + 3];
+	}
 }
 
 Matrix BicubicSpline::computeSplineCoefficientsDY(Matrix &m_z, int method){
 	int Nx = m_z.rows();
 	int Ny = m_z.cols();
 	Matrix m_zdy(Nx, Ny);
-	for(int i = 0; i < Nx; i++){
-		Vector z_xi = m_z.row(i);
-		CubicSpline f_xi = CubicSpline(y0, dy, z_xi, method);
-		for(int j = 0; j < Ny; j++){
-			m_zdy(i, j) = dy*f_xi.derivative(y0 + j*dy);
+	if(method == 0){
+		// natural splines solve for second derivatives, so they keep the row-by-row construction
+		for(int i = 0; i < Nx; i++){
+			Vector z_xi = m_z.row(i);
+			CubicSpline f_xi = CubicSpline(y0, dy, z_xi, method);
+			for(int j = 0; j < Ny; j++){
+				m_zdy(i, j) = dy*f_xi.derivative(y0 + j*dy);
+			}
 		}
+		return m_zdy;
 	}
-	return m_zdy; 
+	// the solver runs along rows, so we work with the transpose
+	Matrix m_zT = m_z.transpose();
+	Matrix m_zdyT(Ny, Nx);
+	cubic_spline_node_derivatives(m_zdyT, m_zT, method);
+	return m_zdyT.transpose();
 }
 
 Matrix BicubicSpline::computeSplineCoefficientsDX(Matrix &m_z, int method){
 	int Nx = m_z.rows();
 	int Ny = m_z.cols();
 	Matrix m_zdx(Nx, Ny);
-	for(int j = 0; j < Ny; j++){
-		Vector z_yj = m_z.col(j);
-		CubicSpline f_yj = CubicSpline(x0, dx, z_yj, method);
-		for(int i = 0; i < Nx; i++){
-			m_zdx(i, j) = dx*f_yj.derivative(x0 + i*dx);
+	if(method == 0){
+		for(int j = 0; j < Ny; j++){
+			Vector z_yj = m_z.col(j);
+			CubicSpline f_yj = CubicSpline(x0, dx, z_yj, method);
+			for(int i = 0; i < Nx; i++){
+				m_zdx(i, j) = dx*f_yj.derivative(x0 + i*dx);
+			}
 		}
+		return m_zdx;
 	}
-	return m_zdx; 
+	cubic_spline_node_derivatives(m_zdx, m_z, method);
+	return m_zdx;
 }
 
 void BicubicSpline::computeSplineCoefficients(Matrix &m_z, int method){
-	// StopWatch watch;
-
-	Matrix lmat(4, 4, 0.);
-	lmat(0, 0) = 1.;
-	lmat(1, 2) = 1.;
-	lmat(2, 0) = -3.;
-	lmat(2, 1) = 3.;
-	lmat(2, 2) = -2.;
-	lmat(2, 3) = -1.;
-	lmat(3, 0) = 2.;
-	lmat(3, 1) = -2.;
-	lmat(3, 2) = 1.;
-	lmat(3, 3) = 1.;
-	
 	Matrix m_zdx = computeSplineCoefficientsDX(m_z, method);
 	Matrix m_zdy = computeSplineCoefficientsDY(m_z, method);
 	Matrix m_zdxdy = computeSplineCoefficientsDY(m_zdx, method);
-	// Matrix m_zdxdy2 = computeSplineCoefficientsDX(m_zdy);
-
-	// int Nx = m_z.rows();
-	// int Ny = m_z.cols();
-	// for(int i = 0; i < Nx; i++){
-	// 	for(int j = 0; j < Ny; j++){
-	// 		// if(j == 0){
-	// 		// 	std::cout << "dx = " << m_zdx(i, j) << "\n";
-	// 		// }
-	// 		// if(i == 0){
-	// 		// 	std::cout << "dy = " << m_zdy(i, j) << "\n";
-	// 		// }
-	// 		std::cout << m_zdxdy2(i, j) << "\n";
-	// 		std::cout << m_zdxdy(i, j) << "\n";
-	// 	}
-	// }
-
-	// now this part we just have to accept as being inefficient because we
-	// are mixing rows and columns no matter what. The important thing is that
-	// we will store the relevant cofficients close to one another in memory
-
-	// watch.start();
-	#pragma omp parallel
-	{
-		#pragma omp for collapse(2) schedule(dynamic, 16)
-			for(int i = 0; i < nx; i++){
-				for(int j = 0; j < ny; j++){
-					Matrix dmat(4, 4);
-					dmat(0, 0) = m_z(i, j); // f(0,0)
-					dmat(0, 1) = m_z(i, j + 1); // f(0,1)
-					dmat(0, 2) = m_zdy(i, j); // fy(0,0)
-					dmat(0, 3) = m_zdy(i, j + 1); // fy(0,1)
-					dmat(1, 0) = m_z(i + 1, j); // f(1,0)
-					dmat(1, 1) = m_z(i + 1, j + 1); // f(1,1)
-					dmat(1, 2) = m_zdy(i + 1, j); // fy(1,0)
-					dmat(1, 3) = m_zdy(i + 1, j + 1); // fy(1,1)
-					dmat(2, 0) = m_zdx(i, j); // fx(0,0)
-					dmat(2, 1) = m_zdx(i, j + 1); // fx(0,1)
-					dmat(2, 2) = m_zdxdy(i, j); // fxy(0,0)
-					dmat(2, 3) = m_zdxdy(i, j + 1); // fxy(0,1)
-					dmat(3, 0) = m_zdx(i + 1, j); // fx(1,0)
-					dmat(3, 1) = m_zdx(i + 1, j + 1); // fx(1,1)
-					dmat(3, 2) = m_zdxdy(i + 1, j); // fxy(1,0)
-					dmat(3, 3) = m_zdxdy(i + 1, j + 1); // fxy(1,1)
-
-					// this part is slow. Just lots of matrix multiplication
-					Matrix Dmat(4, 4);
-					for(int k = 0; k < 4; k++){
-						for(int l = 0; l < 4; l++){
-							for(int m = 0; m < 4; m++){
-								Dmat(k, l) += dmat(k, m)*lmat(l, m); // need transpose of lmat
-							}
-						}
-					}
-					for(int k = 0; k < 4; k++){
-						for(int l = 0; l < 4; l++){
-							for(int m = 0; m < 4; m++){
-								cij(i, 16*j + 4*k + l) += lmat(k, m)*Dmat(m, l);
-							}
-						}
-					}
-				}
-			}
+
+	// the coefficients of neighbouring cells are stored next to one another,
+	// so each thread fills a contiguous set of rows
+	#pragma omp parallel for schedule(static) if(nx*ny > SPLINE_PARALLEL_MIN)
+	for(int i = 0; i < nx; i++){
+		for(int j = 0; j < ny; j++){
+			double D[16] = {
+				m_z(i, j), m_z(i, j + 1), m_zdy(i, j), m_zdy(i, j + 1), // f(0,0), f(0,1), fy(0,0), fy(0,1)
+				m_z(i + 1, j), m_z(i + 1, j + 1), m_zdy(i + 1, j), m_zdy(i + 1, j + 1), // f(1,0), f(1,1), fy(1,0), fy(1,1)
+				m_zdx(i, j), m_zdx(i, j + 1), m_zdxdy(i, j), m_zdxdy(i, j + 1), // fx(0,0), fx(0,1), fxy(0,0), fxy(0,1)
+				m_zdx(i + 1, j), m_zdx(i + 1, j + 1), m_zdxdy(i + 1, j), m_zdxdy(i + 1, j + 1) // fx(1,0), fx(1,1), fxy(1,0), fxy(1,1)
+			};
+			bicubic_cell_coefficients(&cij(i, 16*j), D);
+		}
 	}
-	// watch.stop();
-	// watch.print();
-	// watch.reset();
 }
-
 // void BicubicSpline::computeSplineCoefficients(Matrix &m_z){
 // 	StopWatch watch;
 
@@ -545,262 +712,403 @@ void BicubicSpline::computeSplineCoefficients(Matrix &m_z, int method){
 // 	watch.reset();
 // }
 
-double BicubicSpline::evaluateInterval(int i, int j, const double x, const double y){
-	double xbar = (x - x0 - i*dx)/dx;
-	double ybar = (y - y0 - j*dy)/dy;
-	// double xvec[4] = {1, xbar, xbar*xbar, xbar*xbar*xbar};
-	// double yvec[4] = {1, ybar, ybar*ybar, ybar*ybar*ybar};
-	// double zvec[4] = {0., 0., 0., 0.};
-	// double result = 0.;
-	double zvec[4];
-	double result;
-
-	// // zj = cij*yi
-	// for(int k = 0; k < 4; k++){
-	// 	for(int l = 0; l < 4; l++){
-	// 		zvec[k] += cij(i, 16*j + 4*k + l)*yvec[l];
-	// 	}
-	// }
-
-	// // result = xj*zj
-	// for(int k = 0; k < 4; k++){
-	// 	result += xvec[k]*zvec[k];
-	// }
+void BicubicSpline::convertToSinglePrecision(){
+	if(single_precision){
+		return;
+	}
+	const double *c = coefficients();
+	cij_single.assign(c, c + 16*nx*ny);
+	cij = Matrix(0, 0);
+	mapped_cij = nullptr;
+	mapped_storage.reset();
+	single_precision = true;
+}
 
-	for(int k = 0; k < 4; k++){
-		zvec[k] = cij(i, 16*j + 4*k + 0) + ybar*(cij(i, 16*j + 4*k + 1) + ybar*(cij(i, 16*j + 4*k + 2) + cij(i, 16*j + 4*k + 3)*ybar));
+bool BicubicSpline::singlePrecision() const{
+	return single_precision;
+}
+
+double BicubicSpline::xmin() const{
+	return x0;
+}
+
+double BicubicSpline::xmax() const{
+	return x0 + nx*dx;
+}
+
+double BicubicSpline::ymin() const{
+	return y0;
+}
+
+double BicubicSpline::ymax() const{
+	return y0 + ny*dy;
+}
+
+// Reduces n bicubic cells, spaced stride elements apart starting at c[cell],
+// to cubics in the other coordinate by fixing xbar (fix_x) or ybar. The cells
+// are written in normalized coordinates, while CubicSpline takes the offset
+// from the start of the interval, so the coefficient of t^l is divided by h^l,
+// with h the spacing of the remaining coordinate
+template <typename T>
+static Matrix reduced_cell_coefficients(const T *c, int cell, int stride, int n, bool fix_x, const double bar, const double h){
+	Matrix cubicCij(n, 4);
+	for(int i = 0; i < n; i++){
+		const int ci = cell + i*stride;
+		double r[4];
+		for(int l = 0; l < 4; l++){
+			if(fix_x){
+				r[l] = cubic_polynomial_derivative<0>(c[ci + l], c[ci + 4 + l], c[ci + 8 + l], c[ci + 12 + l], bar);
+			}else{
+				r[l] = cubic_polynomial_derivative<0>(c[ci + 4*l], c[ci + 4*l + 1], c[ci + 4*l + 2], c[ci + 4*l + 3], bar);
+			}
+		}
+		cubicCij(i, 0) = r[0];
+		cubicCij(i, 1) = r[1]/h;
+		cubicCij(i, 2) = r[2]/(h*h);
+		cubicCij(i, 3) = r[3]/(h*h*h);
 	}
+	return cubicCij;
+}
 
-	result = zvec[0] + xbar*(zvec[1] + xbar*(zvec[2] + zvec[3]*xbar));
+CubicSpline BicubicSpline::reduce_x(const double x){
+    int i = findXInterval(x);
+    double xbar = (x - x0 - i*dx)/dx;
+	if(single_precision){
+		return CubicSpline(y0, dy, ny, reduced_cell_coefficients(cij_single.data(), cellIndex(i, 0), 16, ny, true, xbar, dy));
+	}
+	return CubicSpline(y0, dy, ny, reduced_cell_coefficients(coefficients(), cellIndex(i, 0), 16, ny, true, xbar, dy));
+}
 
-	return result;
+CubicSpline BicubicSpline::reduce_y(const double y){
+    int j = findYInterval(y);
+    double ybar = (y - y0 - j*dy)/dy;
+	if(single_precision){
+		return CubicSpline(x0, dx, nx, reduced_cell_coefficients(cij_single.data(), cellIndex(0, j), 16*ny, nx, false, ybar, dx));
+	}
+	return CubicSpline(x0, dx, nx, reduced_cell_coefficients(coefficients(), cellIndex(0, j), 16*ny, nx, false, ybar, dx));
 }
 
-double BicubicSpline::evaluateDerivativeXInterval(int i, int j, const double x, const double y){
-	double xbar = (x - x0 - i*dx)/dx;
-	double ybar = (y - y0 - j*dy)/dy;
-	
-	// double xvec[3] = {1., 2.*xbar, 3.*xbar*xbar};
-	// double yvec[4] = {1, ybar, ybar*ybar, ybar*ybar*ybar};
-	// double zvec[3] = {0., 0., 0.};
-	// double result = 0.;
-
-	double zvec[4];
-	double result;
-
-	// // zj = cij*yi
-	// for(int k = 0; k < 3; k++){
-	// 	for(int l = 0; l < 4; l++){
-	// 		zvec[k] += cij(i, 16*j + 4*(1 + k) + l)*yvec[l];
-	// 	}
-	// }
-
-	// // result = xj*zj
-	// for(int k = 0; k < 3; k++){
-	// 	result += xvec[k]*zvec[k];
-	// }
+//////////////////////////////////////////////////////////////////
+//////////////         Spline Cursors       ////////////////
+//////////////////////////////////////////////////////////////////
 
-	for(int k = 0; k < 4; k++){
-		zvec[k] = cij(i, 16*j + 4*k + 0) + ybar*(cij(i, 16*j + 4*k + 1) + ybar*(cij(i, 16*j + 4*k + 2) + cij(i, 16*j + 4*k + 3)*ybar));
+CubicSplineCursor::CubicSplineCursor(const CubicSpline &spline): _spline(spline), _i(-1), _xlow(HUGE_VAL), _xhigh(-HUGE_VAL) {}
+
+void CubicSplineCursor::locate(const double x){
+	// the outermost cells extend to infinity, mirroring the clamp in findInterval
+	int i = static_cast<int>((x - _spline.x0)/_spline.dx);
+	if(i >= _spline.nintervals){
+		i = _spline.nintervals - 1;
+	}
+	if(i < 0){
+		i = 0;
 	}
+	if(i != _i){
+		_i = i;
+		for(int k = 0; k < 4; k++){
+			_c[k] = _spline.coefficient(i, k);
+		}
+	}
+	_xlow = (i == 0) ? -HUGE_VAL : _spline.x0 + i*_spline.dx;
+	_xhigh = (i == _spline.nintervals - 1) ? HUGE_VAL : _spline.x0 + (i + 1)*_spline.dx;
+}
 
-	result = (zvec[1] + xbar*(2.*zvec[2] + 3.*zvec[3]*xbar));
+double CubicSplineCursor::evaluate(const double x){
+	if(!(x >= _xlow && x < _xhigh)){
+		locate(x);
+	}
+	double xbar = (x - _spline.x0 - _i*_spline.dx);
+	return _c[0] + xbar*(_c[1] + xbar*(_c[2] + _c[3]*xbar));
+}
 
-	return result;
+double CubicSplineCursor::derivative(const double x){
+	if(!(x >= _xlow && x < _xhigh)){
+		locate(x);
+	}
+	double xbar = (x - _spline.x0 - _i*_spline.dx);
+	return _c[1] + xbar*(2.0*_c[2] + 3.0*_c[3]*xbar);
 }
 
-double BicubicSpline::evaluateDerivativeYInterval(int i, int j, const double x, const double y){
-	double xbar = (x - x0 - i*dx)/dx;
-	double ybar = (y - y0 - j*dy)/dy;
+double CubicSplineCursor::derivative2(const double x){
+	if(!(x >= _xlow && x < _xhigh)){
+		locate(x);
+	}
+	double xbar = (x - _spline.x0 - _i*_spline.dx);
+	return 2.0*(_c[2] + 3.0*_c[3]*xbar);
+}
 
-	// double xvec[4] = {1, xbar, xbar*xbar, xbar*xbar*xbar};
-	// double yvec[3] = {1., 2.*ybar, 3.*ybar*ybar};
-	// double zvec[4] = {0., 0., 0., 0.};
-	// double result = 0.;
-
-	double zvec[4];
-	double result;
-
-	// zj = cij*yi
-	// for(int k = 0; k < 4; k++){
-	// 	for(int l = 0; l < 3; l++){
-	// 		zvec[k] += cij(i, 16*j + 4*k + (l + 1))*yvec[l];
-	// 	}
-	// }
-
-	// // result = xj*zj
-	// for(int k = 0; k < 4; k++){
-	// 	result += xvec[k]*zvec[k];
-	// }
-	for(int k = 0; k < 4; k++){
-		zvec[k] = cij(i, 16*j + 4*k + 1) + ybar*(2.*cij(i, 16*j + 4*k + 2) + 3.*cij(i, 16*j + 4*k + 3)*ybar);
+BicubicSplineCursor::BicubicSplineCursor(const BicubicSpline &spline): _spline(spline), _i(-1), _j(-1), _xlow(HUGE_VAL), _xhigh(-HUGE_VAL), _ylow(HUGE_VAL), _yhigh(-HUGE_VAL), _ifixed(0), _jfixed(-1), _xbar(0.), _yfixedlow(HUGE_VAL), _yfixedhigh(-HUGE_VAL) {}
+BicubicSplineCursor::BicubicSplineCursor(const BicubicSpline &spline, const double x): BicubicSplineCursor(spline) {
+	int i = static_cast<int>((x - spline.x0)/spline.dx);
+	if(i >= spline.nx){
+		i = spline.nx - 1;
+	}
+	if(i < 0){
+		i = 0;
 	}
+	_ifixed = i;
+	_xbar = (x - spline.x0 - i*spline.dx)/spline.dx;
+}
 
-	result = zvec[0] + xbar*(zvec[1] + xbar*(zvec[2] + zvec[3]*xbar));
-	
-	return result;
+void BicubicSplineCursor::locate(const double x, const double y){
+	int i = static_cast<int>((x - _spline.x0)/_spline.dx);
+	if(i >= _spline.nx){
+		i = _spline.nx - 1;
+	}
+	if(i < 0){
+		i = 0;
+	}
+	int j = static_cast<int>((y - _spline.y0)/_spline.dy);
+	if(j >= _spline.ny){
+		j = _spline.ny - 1;
+	}
+	if(j < 0){
+		j = 0;
+	}
+	if(i != _i || j != _j){
+		if(j != _j){
+			_spline.prefetchCell(i, (j > _j) ? j + 1 : j - 1);
+		}else{
+			_spline.prefetchCell((i > _i) ? i + 1 : i - 1, j);
+		}
+		_i = i;
+		_j = j;
+		for(int k = 0; k < 16; k++){
+			_c[k] = _spline.coefficient(i, 16*j + k);
+		}
+	}
+	_xlow = (i == 0) ? -HUGE_VAL : _spline.x0 + i*_spline.dx;
+	_xhigh = (i == _spline.nx - 1) ? HUGE_VAL : _spline.x0 + (i + 1)*_spline.dx;
+	_ylow = (j == 0) ? -HUGE_VAL : _spline.y0 + j*_spline.dy;
+	_yhigh = (j == _spline.ny - 1) ? HUGE_VAL : _spline.y0 + (j + 1)*_spline.dy;
 }
 
-double BicubicSpline::evaluateDerivativeXYInterval(int i, int j, const double x, const double y){
-	double xbar = (x - x0 - i*dx)/dx;
-	double ybar = (y - y0 - j*dy)/dy;
-	
-	// double xvec[3] = {1., 2.*xbar, 3.*xbar*xbar};
-	// double yvec[3] = {1., 2.*ybar, 3.*ybar*ybar};
-	// double zvec[3] = {0., 0., 0.};
-	// double result = 0.;
-	double zvec[4];
-	double result;
-
-	// zj = cij*yi
-	// for(int k = 0; k < 3; k++){
-	// 	for(int l = 0; l < 3; l++){
-	// 		zvec[k] += cij(i, 16*j + 4*(k + 1) + (l + 1))*yvec[l];
-	// 	}
-	// }
-
-	// // result = xj*zj
-	// for(int k = 0; k < 3; k++){
-	// 	result += xvec[k]*zvec[k];
-	// }
+void BicubicSplineCursor::locate(const double y){
+	int j = static_cast<int>((y - _spline.y0)/_spline.dy);
+	if(j >= _spline.ny){
+		j = _spline.ny - 1;
+	}
+	if(j < 0){
+		j = 0;
+	}
+	if(j != _jfixed){
+		_spline.prefetchCell(_ifixed, (j > _jfixed) ? j + 1 : j - 1);
+		// r_l = sum_k c_kl xbar^k
+		_jfixed = j;
+		for(int l = 0; l < 4; l++){
+			_r[l] = _spline.coefficient(_ifixed, 16*j + l) + _xbar*(_spline.coefficient(_ifixed, 16*j + 4 + l) + _xbar*(_spline.coefficient(_ifixed, 16*j + 8 + l) + _spline.coefficient(_ifixed, 16*j + 12 + l)*_xbar));
+		}
+	}
+	_yfixedlow = (j == 0) ? -HUGE_VAL : _spline.y0 + j*_spline.dy;
+	_yfixedhigh = (j == _spline.ny - 1) ? HUGE_VAL : _spline.y0 + (j + 1)*_spline.dy;
+}
 
-	for(int k = 0; k < 4; k++){
-		zvec[k] = (cij(i, 16*j + 4*k + 1) + ybar*(2.*cij(i, 16*j + 4*k + 2) + 3.*cij(i, 16*j + 4*k + 3)*ybar));
+double BicubicSplineCursor::evaluate(const double x, const double y){
+	if(!(x >= _xlow && x < _xhigh && y >= _ylow && y < _yhigh)){
+		locate(x, y);
 	}
+	double xbar = (x - _spline.x0 - _i*_spline.dx)/_spline.dx;
+	double ybar = (y - _spline.y0 - _j*_spline.dy)/_spline.dy;
+	return bicubic_cell<0, 0>(_c, 0, xbar, ybar);
+}
 
-	result = (zvec[1] + xbar*(2.*zvec[2] + 3.*zvec[3]*xbar));
-	
-	return result;
+double BicubicSplineCursor::derivative_x(const double x, const double y){
+	if(!(x >= _xlow && x < _xhigh && y >= _ylow && y < _yhigh)){
+		locate(x, y);
+	}
+	double xbar = (x - _spline.x0 - _i*_spline.dx)/_spline.dx;
+	double ybar = (y - _spline.y0 - _j*_spline.dy)/_spline.dy;
+	return bicubic_cell<1, 0>(_c, 0, xbar, ybar)/_spline.dx;
 }
 
-double BicubicSpline::evaluateDerivativeXXInterval(int i, int j, const double x, const double y){
+double BicubicSplineCursor::derivative_y(const double x, const double y){
+	if(!(x >= _xlow && x < _xhigh && y >= _ylow && y < _yhigh)){
+		locate(x, y);
+	}
+	double xbar = (x - _spline.x0 - _i*_spline.dx)/_spline.dx;
+	double ybar = (y - _spline.y0 - _j*_spline.dy)/_spline.dy;
+	return bicubic_cell<0, 1>(_c, 0, xbar, ybar)/_spline.dy;
+}
+
+double BicubicSplineCursor::evaluate(const double y){
+	if(!(y >= _yfixedlow && y < _yfixedhigh)){
+		locate(y);
+	}
+	double ybar = (y - _spline.y0 - _jfixed*_spline.dy)/_spline.dy;
+	return _r[0] + ybar*(_r[1] + ybar*(_r[2] + _r[3]*ybar));
+}
+
+double BicubicSplineCursor::derivative_y(const double y){
+	if(!(y >= _yfixedlow && y < _yfixedhigh)){
+		locate(y);
+	}
+	double ybar = (y - _spline.y0 - _jfixed*_spline.dy)/_spline.dy;
+	return (_r[1] + ybar*(2.*_r[2] + 3.*_r[3]*ybar))/_spline.dy;
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////       BicubicSplineBundle    ////////////////
+//////////////////////////////////////////////////////////////////
+
+BicubicSplineBundle::BicubicSplineBundle(const Vector &x, const Vector &y, const std::vector<Vector> &z, int method): BicubicSplineBundle(x[0], x[1] - x[0], x.size() - 1, y[0], y[1] - y[0], y.size() - 1, z, method) {}
+BicubicSplineBundle::BicubicSplineBundle(double x0, double dx, int nx, double y0, double dy, int ny, const std::vector<Vector> &z, int method): dx(dx), dy(dy), nx(nx), ny(ny), x0(x0), y0(y0), nfields(z.size()), cij(nx, 16*z.size()*ny), single_precision(false), mapped_cij(nullptr) {
+	// each field is fit on its own and its coefficients are then interleaved so
+	// that cell (i, j) of field k starts at column 16*(nfields*j + k)
+	for(int k = 0; k < nfields; k++){
+		BicubicSpline spline(x0, dx, nx, y0, dy, ny, z[k], method);
+		for(int i = 0; i < nx; i++){
+			for(int j = 0; j < ny; j++){
+				for(int l = 0; l < 16; l++){
+					cij(i, 16*(nfields*j + k) + l) = spline.cij(i, 16*j + l);
+				}
+			}
+		}
+	}
+}
+
+BicubicSplineBundle::BicubicSplineBundle(const BicubicSplineData &data, std::shared_ptr<const void> storage): dx(data.dx), dy(data.dy), nx(data.nx), ny(data.ny), x0(data.x0), y0(data.y0), nfields(data.nfields), cij(0, 0), single_precision(false), mapped_cij(data.coefficients), mapped_storage(storage) {}
+
+BicubicSplineData BicubicSplineBundle::data() const{
+	if(single_precision){
+		std::cout << "ERROR: Spline coefficients are stored in single precision \n";
+	}
+	BicubicSplineData splineData = {x0, dx, nx, y0, dy, ny, nfields, single_precision ? nullptr : coefficients()};
+	return splineData;
+}
+
+int BicubicSplineBundle::fields() const{
+	return nfields;
+}
+
+const double* BicubicSplineBundle::coefficients() const{
+	return mapped_cij ? mapped_cij : cij.data();
+}
+
+void BicubicSplineBundle::evaluate(double z[], const double x, const double y){
+	int i = findXInterval(x);
+	int j = findYInterval(y);
 	double xbar = (x - x0 - i*dx)/dx;
 	double ybar = (y - y0 - j*dy)/dy;
-	
-	// double xvec[2] = {2., 6.*xbar};
-	// double yvec[4] = {1, ybar, ybar*ybar, ybar*ybar*ybar};
-	// double zvec[2] = {0., 0.};
-	// double result = 0.;
-	double zvec[4];
-	double result;
-
-	// // zj = cij*yi
-	// for(int k = 0; k < 2; k++){
-	// 	for(int l = 0; l < 4; l++){
-	// 		zvec[k] += cij(i, 16*j + 4*(2 + k) + l)*yvec[l];
-	// 	}
-	// }
-
-	// // result = xj*zj
-	// for(int k = 0; k < 2; k++){
-	// 	result += xvec[k]*zvec[k];
-	// }
+	// cell (i, j) of field k starts at element 16*(nfields*(i*ny + j) + k)
+	const int cell = 16*nfields*(i*ny + j);
+	if(single_precision){
+		for(int k = 0; k < nfields; k++){
+			z[k] = bicubic_cell<0, 0>(cij_single.data(), cell + 16*k, xbar, ybar);
+		}
+	}else{
+		const double *c = coefficients();
+		for(int k = 0; k < nfields; k++){
+			z[k] = bicubic_cell<0, 0>(c, cell + 16*k, xbar, ybar);
+		}
+	}
+}
 
-	for(int k = 0; k < 4; k++){
-		zvec[k] = cij(i, 16*j + 4*k + 0) + ybar*(cij(i, 16*j + 4*k + 1) + ybar*(cij(i, 16*j + 4*k + 2) + cij(i, 16*j + 4*k + 3)*ybar));
+double BicubicSplineBundle::evaluate(int k, const double x, const double y){
+	int i = findXInterval(x);
+	int j = findYInterval(y);
+	double xbar = (x - x0 - i*dx)/dx;
+	double ybar = (y - y0 - j*dy)/dy;
+	const int cell = 16*(nfields*(i*ny + j) + k);
+	if(single_precision){
+		return bicubic_cell<0, 0>(cij_single.data(), cell, xbar, ybar);
 	}
+	return bicubic_cell<0, 0>(coefficients(), cell, xbar, ybar);
+}
 
-	result = 2.*(zvec[2] + 3.*zvec[3]*xbar);
+double BicubicSplineBundle::derivative_x(int k, const double x, const double y){
+	int i = findXInterval(x);
+	int j = findYInterval(y);
+	double xbar = (x - x0 - i*dx)/dx;
+	double ybar = (y - y0 - j*dy)/dy;
+	const int cell = 16*(nfields*(i*ny + j) + k);
+	if(single_precision){
+		return bicubic_cell<1, 0>(cij_single.data(), cell, xbar, ybar)/dx;
+	}
+	return bicubic_cell<1, 0>(coefficients(), cell, xbar, ybar)/dx;
+}
 
-	return result;
+double BicubicSplineBundle::derivative_y(int k, const double x, const double y){
+	int i = findXInterval(x);
+	int j = findYInterval(y);
+	double xbar = (x - x0 - i*dx)/dx;
+	double ybar = (y - y0 - j*dy)/dy;
+	const int cell = 16*(nfields*(i*ny + j) + k);
+	if(single_precision){
+		return bicubic_cell<0, 1>(cij_single.data(), cell, xbar, ybar)/dy;
+	}
+	return bicubic_cell<0, 1>(coefficients(), cell, xbar, ybar)/dy;
 }
 
-double BicubicSpline::evaluateDerivativeYYInterval(int i, int j, const double x, const double y){
+void BicubicSplineBundle::evaluateAll(int k, double &z, double &dzdx, double &dzdy, const double x, const double y){
+	int i = findXInterval(x);
+	int j = findYInterval(y);
 	double xbar = (x - x0 - i*dx)/dx;
 	double ybar = (y - y0 - j*dy)/dy;
-	
-	// double xvec[4] = {1, xbar, xbar*xbar, xbar*xbar*xbar};
-	// double yvec[2] = {2., 6.*ybar};
-	// double zvec[4] = {0., 0., 0., 0.};
-	// double result = 0.;
-	double zvec[4];
-	double result;
-
-	// zj = cij*yi
-	// for(int k = 0; k < 4; k++){
-	// 	for(int l = 0; l < 2; l++){
-	// 		zvec[k] += cij(i, 16*j + 4*k + (l + 2))*yvec[l];
-	// 	}
-	// }
-
-	// // result = xj*zj
-	// for(int k = 0; k < 4; k++){
-	// 	result += xvec[k]*zvec[k];
-	// }
+	const int cell = 16*(nfields*(i*ny + j) + k);
+	if(single_precision){
+		bicubic_cell_gradient(z, dzdx, dzdy, cij_single.data(), cell, xbar, ybar);
+	}else{
+		bicubic_cell_gradient(z, dzdx, dzdy, coefficients(), cell, xbar, ybar);
+	}
+	dzdx /= dx;
+	dzdy /= dy;
+}
 
-	for(int k = 0; k < 4; k++){
-		zvec[k] = 2.*(cij(i, 16*j + 4*k + 2) + 3.*cij(i, 16*j + 4*k + 3)*ybar);
+CubicSpline BicubicSplineBundle::reduce_x(int k, const double x){
+	int i = findXInterval(x);
+	double xbar = (x - x0 - i*dx)/dx;
+	const int cell = 16*(nfields*i*ny + k);
+	if(single_precision){
+		return CubicSpline(y0, dy, ny, reduced_cell_coefficients(cij_single.data(), cell, 16*nfields, ny, true, xbar, dy));
 	}
+	return CubicSpline(y0, dy, ny, reduced_cell_coefficients(coefficients(), cell, 16*nfields, ny, true, xbar, dy));
+}
 
-	result = zvec[0] + xbar*(zvec[1] + xbar*(zvec[2] + zvec[3]*xbar));
-	
-	return result;
+void BicubicSplineBundle::convertToSinglePrecision(){
+	if(single_precision){
+		return;
+	}
+	const double *c = coefficients();
+	cij_single.assign(c, c + 16*nfields*nx*ny);
+	cij = Matrix(0, 0);
+	mapped_cij = nullptr;
+	mapped_storage.reset();
+	single_precision = true;
+}
+
+bool BicubicSplineBundle::singlePrecision() const{
+	return single_precision;
 }
 
-int BicubicSpline::findXInterval(const double x){
+int BicubicSplineBundle::findXInterval(const double x){
 	int i = static_cast<int>((x-x0)/dx);
     if(i >= nx){
-        return nx - 1;
+        i = nx - 1;
     }
-	if( i < 0){
-		return 0;
+	if(i < 0){
+		i = 0;
 	}
 	return i;
 }
 
-int BicubicSpline::findYInterval(const double y){
+int BicubicSplineBundle::findYInterval(const double y){
 	int i = static_cast<int>((y-y0)/dy);
     if(i >= ny){
-        return ny - 1;
+        i = ny - 1;
     }
-	if( i < 0){
-		return 0;
+	if(i < 0){
+		i = 0;
 	}
 	return i;
 }
 
-CubicSpline BicubicSpline::reduce_x(const double x){
-    int i = findXInterval(x);
-    double xbar = (x - x0 - i*dx)/dx;
-
-	Matrix cubicCij(ny, 4);
-	double xvec[4] = {1., xbar, xbar*xbar, xbar*xbar*xbar};
-
-	// zj = xi*cij
-	for(int j = 0; j < ny; j++){
-		for(int k = 0; k < 4; k++){
-			for(int l = 0; l < 4; l++){
-				cubicCij(j, k) += cij(i, 16*j + 4*l + k)*xvec[l];
-			}
-		}
-	}
-
-    return CubicSpline(y0, dy, ny, cubicCij);
-}
-
-CubicSpline BicubicSpline::reduce_y(const double y){
-    int j = findYInterval(y);
-    double ybar = (y - y0 - j*dy)/dy;
-	Matrix cubicCij(nx, 4);
-	double yvec[4] = {1., ybar, ybar*ybar, ybar*ybar*ybar};
-
-	// zj = xi*cij
-	for(int i = 0; i < nx; i++){
-		for(int k = 0; k < 4; k++){
-			for(int l = 0; l < 4; l++){
-				cubicCij(i, k) += cij(i, 16*j + 4*k + l)*yvec[l];
-			}
-		}
-	}
-
-    return CubicSpline(x0, dx, nx, cubicCij);
-}
-
 //////////////////////////////////////////////////////////////////
 //////////////           CubicSpline        ////////////////
 //////////////////////////////////////////////////////////////////
 
-CubicSpline::CubicSpline(double x0, double dx, const Vector &y, int method): dx(dx), nintervals(y.size()-1), x0(x0), cij(y.size()-1, 4) {
+CubicSpline::CubicSpline(): dx(1.), nintervals(0), x0(0.), cij(0, 4), single_precision(false) {}
+
+CubicSpline::CubicSpline(double x0, double dx, const Vector &y, int method): dx(dx), nintervals(y.size()-1), x0(x0), cij(y.size()-1, 4), single_precision(false) {
 	if(method == 0){
 		computeSplineCoefficients(dx, y);
 	}else if(method == 1){
@@ -816,7 +1124,7 @@ CubicSpline::CubicSpline(double x0, double dx, const Vector &y, int method): dx(
 	}
 }
 
-CubicSpline::CubicSpline(const Vector &x, const Vector &y, int method): dx(x[1] - x[0]), nintervals(x.size() - 1), x0(x[0]), cij(x.size() - 1, 4) {
+CubicSpline::CubicSpline(const Vector &x, const Vector &y, int method): dx(x[1] - x[0]), nintervals(x.size() - 1), x0(x[0]), cij(x.size() - 1, 4), single_precision(false) {
 	if(x.size() != y.size()){
 		std::cout << "ERROR: Size of x and y vectors do not match \n";
 	}
@@ -835,10 +1143,39 @@ CubicSpline::CubicSpline(const Vector &x, const Vector &y, int method): dx(x[1]
 	}
 }
 
-CubicSpline::CubicSpline(double x0, double dx, int nx, Matrix cij): dx(dx), nintervals(nx), x0(x0), cij(cij) {}
+CubicSpline::CubicSpline(double x0, double dx, int nx, Matrix cij): dx(dx), nintervals(nx), x0(x0), cij(cij), single_precision(false) {}
+
+Vector CubicSpline::nodes() const{
+	Vector x(nintervals + 1);
+	for(int i = 0; i <= nintervals; i++){
+		x[i] = x0 + i*dx;
+	}
+	return x;
+}
 
 double CubicSpline::getSplineCoefficient(int i, int j){
-	return cij(i, j);
+	return coefficient(i, j);
+}
+
+void CubicSpline::convertToSinglePrecision(){
+	if(single_precision){
+		return;
+	}
+	const double *c = cij.data();
+	cij_single.assign(c, c + cij.size());
+	cij = Matrix(0, 0);
+	single_precision = true;
+}
+
+bool CubicSpline::singlePrecision() const{
+	return single_precision;
+}
+
+double CubicSpline::coefficient(int i, int k) const{
+	if(single_precision){
+		return cij_single[4*i + k];
+	}
+	return cij(i, k);
 }
 
 double CubicSpline::evaluate(const double x){
@@ -846,6 +1183,24 @@ double CubicSpline::evaluate(const double x){
 	return evaluateInterval(i, x);
 }
 
+template <typename T>
+void CubicSpline::evaluateBatch(const T *c, double y[], const double x[], int n){
+	#pragma omp simd
+	for(int k = 0; k < n; k++){
+		int i = findInterval(x[k]);
+		double xbar = (x[k] - x0 - i*dx);
+		y[k] = cubic_polynomial_derivative<0>(c[4*i], c[4*i + 1], c[4*i + 2], c[4*i + 3], xbar);
+	}
+}
+
+void CubicSpline::evaluate(double y[], const double x[], int n){
+	if(single_precision){
+		evaluateBatch(cij_single.data(), y, x, n);
+	}else{
+		evaluateBatch(cij.data(), y, x, n);
+	}
+}
+
 double CubicSpline::derivative(const double x){
 	int i = findInterval(x);
 	return evaluateDerivativeInterval(i, x);
@@ -1093,26 +1448,213 @@ void CubicSpline::computeSplineCoefficientsNotAKnot(double dx, const Vector &y){
 
 double CubicSpline::evaluateInterval(int i, const double x){
 	double xbar = (x - x0 - i*dx);
-	return cij(i, 0) + xbar*(cij(i, 1) + xbar*(cij(i, 2) + cij(i, 3)*xbar));
+	return coefficient(i, 0) + xbar*(coefficient(i, 1) + xbar*(coefficient(i, 2) + coefficient(i, 3)*xbar));
 }
 
 double CubicSpline::evaluateDerivativeInterval(int i, const double x){
 	double xbar = (x - x0 - i*dx);
-	return cij(i, 1) + xbar*(2.0*cij(i, 2) + 3.0*cij(i, 3)*xbar);
+	return coefficient(i, 1) + xbar*(2.0*coefficient(i, 2) + 3.0*coefficient(i, 3)*xbar);
 }
 
 double CubicSpline::evaluateSecondDerivativeInterval(int i, const double x){
 	double xbar = (x - x0 - i*dx);
-	return 2.0*(cij(i, 2) + 3.0*cij(i, 3)*xbar);
+	return 2.0*(coefficient(i, 2) + 3.0*coefficient(i, 3)*xbar);
 }
 
-int CubicSpline::findInterval(const double x){
-	int i = static_cast<int>((x-x0)/dx);
-    if(i >= nintervals){
-        return nintervals - 1;
-    }
-	if(i < 0){
-		return 0;
+//////////////////////////////////////////////////////////////////
+//////////////      ChebyshevExpansion      ////////////////
+//////////////////////////////////////////////////////////////////
+
+// sum_k c[k] T_k(u) for k = 0, ..., n - 1
+static double clenshaw(const double *c, int n, const double u){
+	double b1 = 0., b2 = 0.;
+	for(int k = n - 1; k > 0; k--){
+		double b0 = c[k] + 2.*u*b1 - b2;
+		b2 = b1;
+		b1 = b0;
 	}
-	return i;
+	return c[0] + u*b1 - b2;
+}
+
+ChebyshevExpansion::ChebyshevExpansion(): _order(CHEBYSHEV_ORDER), _tolerance(0.), _max_error(0.), _breakpoints(2, 0.), _center(1, 0.), _inverse_half_width(1, 0.), _offset(2, 0), _coefficients(1, 0.) {
+	_offset[1] = 1;
+}
+
+ChebyshevExpansion::ChebyshevExpansion(std::function<double(double)> f, const Vector &breakpoints, double tolerance, int order): _order(order), _tolerance(tolerance), _max_error(0.) {
+	if(breakpoints.size() < 2){
+		std::cout << "ERROR: ChebyshevExpansion needs at least two breakpoints \n";
+		*this = ChebyshevExpansion();
+		return;
+	}
+	// a tolerance below the round-off of f cannot be met by bisection
+	double scale = 0.;
+	for(size_t i = 0; i < breakpoints.size(); i++){
+		scale = std::max(scale, fabs(f(breakpoints[i])));
+	}
+	_tolerance = std::max(tolerance, 64.*DBL_EPSILON*scale);
+
+	_offset.push_back(0);
+	for(size_t i = 0; i < breakpoints.size() - 1; i++){
+		fitPiece(f, breakpoints[i], breakpoints[i + 1], 0);
+	}
+	_breakpoints.push_back(breakpoints.back());
+}
+
+void ChebyshevExpansion::fitPiece(std::function<double(double)> &f, double a, double b, int depth){
+	const int n = _order + 1;
+	const double center = 0.5*(a + b);
+	const double halfWidth = 0.5*(b - a);
+
+	// interpolate at the Chebyshev nodes of the first kind
+	Vector fx(n);
+	for(int j = 0; j < n; j++){
+		fx[j] = f(center + halfWidth*cos(M_PI*(j + 0.5)/n));
+	}
+	Vector c(n);
+	for(int k = 0; k < n; k++){
+		double sum = 0.;
+		for(int j = 0; j < n; j++){
+			sum += fx[j]*cos(M_PI*k*(j + 0.5)/n);
+		}
+		c[k] = 2.*sum/n;
+	}
+	c[0] *= 0.5;
+
+	// drop the trailing coefficients that are well below the tolerance
+	int terms = n;
+	double dropped = 0.;
+	while(terms > 1 && dropped + fabs(c[terms - 1]) < 0.125*_tolerance){
+		dropped += fabs(c[terms - 1]);
+		terms--;
+	}
+
+	// check the truncated series between the nodes, including the endpoints
+	double error = 0.;
+	for(int j = 0; j <= n; j++){
+		double u = cos(M_PI*j/n);
+		error = std::max(error, fabs(clenshaw(c.data(), terms, u) - f(center + halfWidth*u)));
+	}
+
+	if(error > _tolerance && depth < CHEBYSHEV_MAX_DEPTH && center > a && center < b){
+		fitPiece(f, a, center, depth + 1);
+		fitPiece(f, center, b, depth + 1);
+		return;
+	}
+
+	_max_error = std::max(_max_error, error);
+	_breakpoints.push_back(a);
+	_center.push_back(center);
+	_inverse_half_width.push_back(1./halfWidth);
+	_coefficients.insert(_coefficients.end(), c.begin(), c.begin() + terms);
+	_offset.push_back(_coefficients.size());
+}
+
+int ChebyshevExpansion::findPiece(const double x) const{
+	// the pieces are sorted, and the outermost ones extend to infinity
+	int low = 0;
+	int high = _center.size() - 1;
+	while(low < high){
+		int mid = (low + high + 1)/2;
+		if(x < _breakpoints[mid]){
+			high = mid - 1;
+		}else{
+			low = mid;
+		}
+	}
+	return low;
+}
+
+double ChebyshevExpansion::evaluate(const double x) const{
+	int k = findPiece(x);
+	double u = (x - _center[k])*_inverse_half_width[k];
+	return clenshaw(&_coefficients[_offset[k]], _offset[k + 1] - _offset[k], u);
+}
+
+double ChebyshevExpansion::xmin() const{
+	return _breakpoints.front();
+}
+
+double ChebyshevExpansion::xmax() const{
+	return _breakpoints.back();
+}
+
+int ChebyshevExpansion::pieces() const{
+	return _center.size();
+}
+
+double ChebyshevExpansion::maxError() const{
+	return _max_error;
+}
+
+///////////////////////////////////////////////////////////////////
+//////////////         Lookup Tables        ////////////////
+///////////////////////////////////////////////////////////////////
+
+LinearTable::LinearTable(): _x0(0.), _dx(1.), _inverse_dx(1.), _nintervals(1), _y(2, 0.) {}
+
+LinearTable::LinearTable(double x0, double dx, const Vector &y): _x0(x0), _dx(dx), _inverse_dx(1./dx), _nintervals(y.size() - 1), _y(y.begin(), y.end()) {
+	if(y.size() < 2){
+		std::cout << "ERROR: LinearTable requires at least two samples \n";
+		_nintervals = 1;
+		_y.assign(2, y.empty() ? 0. : y[0]);
+	}
+}
+
+double LinearTable::derivative(const double x) const{
+	double t;
+	int i = uniform_cell(t, (x - _x0)*_inverse_dx, _nintervals);
+	return (_y[i + 1] - _y[i])*_inverse_dx;
+}
+
+void LinearTable::evaluate(double y[], const double x[], int n) const{
+	const double *yTable = _y.data();
+	#pragma omp simd
+	for(int k = 0; k < n; k++){
+		double t;
+		int i = uniform_cell(t, (x[k] - _x0)*_inverse_dx, _nintervals);
+		y[k] = yTable[i] + t*(yTable[i + 1] - yTable[i]);
+	}
+}
+
+BilinearTable::BilinearTable(): _x0(0.), _inverse_dx(1.), _nx(1), _y0(0.), _dy(1.), _inverse_dy(1.), _ny(1), _z(4, 0.) {}
+
+BilinearTable::BilinearTable(double x0, double dx, int nx, double y0, double dy, int ny, const Vector &z): _x0(x0), _inverse_dx(1./dx), _nx(nx), _y0(y0), _dy(dy), _inverse_dy(1./dy), _ny(ny), _z(z.begin(), z.end()) {
+	if(nx < 1 || ny < 1 || z.size() != static_cast<size_t>((nx + 1)*(ny + 1))){
+		std::cout << "ERROR: BilinearTable grid of " << nx << " x " << ny << " intervals does not match " << z.size() << " samples \n";
+		_nx = 1;
+		_ny = 1;
+		_z.assign(4, 0.);
+	}
+}
+
+double BilinearTable::evaluate(const double x, const double y) const{
+	double tx, ty;
+	int i = uniform_cell(tx, (x - _x0)*_inverse_dx, _nx);
+	int j = uniform_cell(ty, (y - _y0)*_inverse_dy, _ny);
+	const double *z0 = &_z[i*(_ny + 1) + j];
+	const double *z1 = z0 + _ny + 1;
+	double zLower = z0[0] + ty*(z0[1] - z0[0]);
+	double zUpper = z1[0] + ty*(z1[1] - z1[0]);
+	return zLower + tx*(zUpper - zLower);
+}
+
+double BilinearTable::derivative_y(const double x, const double y) const{
+	double tx, ty;
+	int i = uniform_cell(tx, (x - _x0)*_inverse_dx, _nx);
+	int j = uniform_cell(ty, (y - _y0)*_inverse_dy, _ny);
+	const double *z0 = &_z[i*(_ny + 1) + j];
+	const double *z1 = z0 + _ny + 1;
+	return ((1. - tx)*(z0[1] - z0[0]) + tx*(z1[1] - z1[0]))*_inverse_dy;
+}
+
+LinearTable BilinearTable::reduce_x(const double x) const{
+	double tx;
+	int i = uniform_cell(tx, (x - _x0)*_inverse_dx, _nx);
+	const double *z0 = &_z[i*(_ny + 1)];
+	const double *z1 = z0 + _ny + 1;
+	Vector row(_ny + 1);
+	for(int j = 0; j <= _ny; j++){
+		row[j] = z0[j] + tx*(z1[j] - z0[j]);
+	}
+	return LinearTable(_y0, _dy, row);
 }
@@ -1,9 +1,20 @@
 #include "trajectory.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <cfloat>
 
 #define ALPHA_MIN 0.
 #define ALPHA_MAX 1.
 #define A_MAX 0.9999
 #define OMEGA_MIN 2.e-3
+
+// field indices of the frequency-domain (chi, alpha) spline bundle
+#define TIME_FIELD 0
+#define PHASE_FIELD 1
+// field indices of the time-domain (chi, beta) spline bundle
+#define ALPHA_FIELD 0
+#define PHASE_TIME_FIELD 1
+#define FREQUENCY_FIELD 2
 //////////////////////////////
 // Circular Geodesic Orbits //
 //////////////////////////////
@@ -218,9 +229,234 @@ double normalize_phase_domega(const double &omega){
   return  (-5./3.)*pow(fabs(omega), -8./3.);
 }
 
+/////////////////////////////////////
+// Array versions of the functions //
+/////////////////////////////////////
+
+// The array versions evaluate the functions above at n points. The fractional
+// powers are rewritten in terms of cube roots and square roots, e.g.
+// omega^(10/3) = omega^3*cbrt(omega), and the cube roots are taken with
+// cbrt_simd below, so that every loop is vectorized across the points (the
+// loops with square roots only when compiled with -fno-math-errno, as in
+// setup.py). They are at least as accurate as the scalar functions, which is
+// measured by cpp/tools/kerr_math_report.cpp
+
+// cube root of x from a bit-level estimate of the high word (as in fdlibm),
+// refined by two Halley steps and a Newton step with an exact residual. Unlike
+// cbrt, it can be inlined into vectorized loops. It is accurate to 1 ulp for
+// normal numbers, but does not handle infinities, NaNs or subnormal numbers
+static inline double cbrt_simd(double x){
+	double ax = fabs(x);
+	uint64_t bits;
+	memcpy(&bits, &ax, sizeof(double));
+	uint32_t high = static_cast<uint32_t>(bits >> 32)/3 + 715094163u;
+	bits = static_cast<uint64_t>(high) << 32;
+	double t;
+	memcpy(&t, &bits, sizeof(double));
+
+	double t3 = t*t*t;
+	t = t*(t3 + 2.*ax)/(2.*t3 + ax);
+	t3 = t*t*t;
+	t = t*(t3 + 2.*ax)/(2.*t3 + ax);
+	double t2 = t*t;
+	double residual = fma(t2, t, -ax) + fma(t, t, -t2)*t;
+	t -= residual/(3.*t2);
+
+	t = (ax == 0.) ? 0. : t;
+	return copysign(t, x);
+}
+
+static inline double kerr_isco_frequency_simd(double a){
+	double sgnX = (a < 0.) ? -1. : 1.;
+	a = fabs(a);
+	double z1 = 1. + cbrt_simd(1. - a*a)*(cbrt_simd(1. - a) + cbrt_simd(1. + a));
+	double z2 = sqrt(3.*a*a + z1*z1);
+	double r = 3. + z2 - sgnX*sqrt((3. - z1)*(3. + z1 + 2.*z2));
+	double v = 1./sqrt(r);
+	double v3 = v*v*v;
+	return v3/(1. + sgnX*a*v3);
+}
+
+static inline double alpha_of_omega_simd(double omega, double oISCO){
+	double oISCOThird = cbrt_simd(oISCO);
+	double alpha = sqrt(fabs(oISCOThird - cbrt_simd(omega))/(oISCOThird - cbrt_simd(OMEGA_MIN)));
+	return (fabs(oISCO - omega) < 1.e-13) ? 0. : alpha;
+}
+
+static inline double omega_of_alpha_simd(double alpha, double oISCO){
+	double oISCOThird = cbrt_simd(oISCO);
+	double omegaThird = oISCOThird - alpha*alpha*(oISCOThird - cbrt_simd(OMEGA_MIN));
+	return omegaThird*omegaThird*omegaThird;
+}
+
+// the product of denergy_dr and dr_domega at r = kerr_geo_radius_circ(a, omega),
+// for omega > 0, where v = 1/sqrt(r) = cbrt(omega/(1 - a*omega))
+static inline double kerr_geo_denergy_domega_circ_simd(double a, double omega){
+	double q = 1. - a*omega;
+	double v = cbrt_simd(omega/q);
+	double v2 = v*v;
+	double v4 = v2*v2;
+	double base = 1. + v2*(2.*a*v - 3.);
+	double denergy = 0.5*v4*(1. - 6.*v2 + 8.*a*v2*v - 3.*a*a*v4)/(base*sqrt(base));
+	double dr = -2./(3.*omega*cbrt_simd(omega*omega*q));
+	return denergy*dr;
+}
+
+// |omega|^(-2/3)
+static inline double inverse_two_thirds_power_simd(double omega){
+	return 1./cbrt_simd(omega*omega);
+}
+
+void kerr_geo_azimuthal_frequency_circ_time(double omega[], const double a[], const double r[], int n){
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		double v = 1./sqrt(r[i]);
+		double v3 = v*v*v;
+		omega[i] = v3/(1. + a[i]*v3);
+	}
+}
+
+void kerr_isco_frequency(double oISCO[], const double a[], int n){
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		oISCO[i] = kerr_isco_frequency_simd(a[i]);
+	}
+}
+
+void alpha_of_a_omega(double alpha[], const double omega[], const double oISCO[], int n){
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		alpha[i] = alpha_of_omega_simd(omega[i], oISCO[i]);
+	}
+}
+
+void alpha_of_a_omega(double alpha[], const double omega[], double oISCO, int n){
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		alpha[i] = alpha_of_omega_simd(omega[i], oISCO);
+	}
+}
+
+void omega_of_a_alpha(double omega[], const double alpha[], const double oISCO[], int n){
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		omega[i] = omega_of_alpha_simd(alpha[i], oISCO[i]);
+	}
+}
+
+void omega_of_a_alpha(double omega[], const double alpha[], double oISCO, int n){
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		omega[i] = omega_of_alpha_simd(alpha[i], oISCO);
+	}
+}
+
+void dalpha_domega_of_a_omega(double dalpha[], const double omega[], const double oISCO[], int n){
+	double omegaMinThird = cbrt_simd(OMEGA_MIN);
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		double oISCOThird = cbrt_simd(oISCO[i]);
+		double domega = -6.*sqrt((oISCOThird - omegaMinThird)*(oISCOThird - cbrt_simd(omega[i])))*cbrt_simd(omega[i]*omega[i]);
+		dalpha[i] = 1./((fabs(oISCO[i] - omega[i]) < 1.e-13) ? 0. : domega);
+	}
+}
+
+void spin_of_chi(double a[], const double chi[], int n){
+	double chiMax = cbrt_simd(1. - A_MAX);
+	double chiRange = cbrt_simd(1. + A_MAX) - chiMax;
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		double b = chiMax + chi[i]*chi[i]*chiRange;
+		a[i] = 1. - b*b*b;
+	}
+}
+
+void chi_of_spin(double chi[], const double a[], int n){
+	double chiMax = cbrt_simd(1. - A_MAX);
+	double chiRange = cbrt_simd(1. + A_MAX) - chiMax;
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		chi[i] = sqrt((cbrt_simd(1. - a[i]) - chiMax)/chiRange);
+	}
+}
+
+void kerr_geo_denergy_domega_circ(double dEdo[], const double a[], const double omega[], int n){
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		dEdo[i] = kerr_geo_denergy_domega_circ_simd(a[i], omega[i]);
+	}
+}
+
+void kerr_geo_denergy_domega_circ(double dEdo[], double a, const double omega[], int n){
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		dEdo[i] = kerr_geo_denergy_domega_circ_simd(a, omega[i]);
+	}
+}
+
+void normalize_energy_flux(double norm[], const double omega[], int n){
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		double om = fabs(omega[i]);
+		norm[i] = om*om*om*cbrt_simd(om);
+	}
+}
+
+void normalize_time(double norm[], const double omega[], const double oISCO[], int n){
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		double om = fabs(omega[i]);
+		double oISCONorm = inverse_two_thirds_power_simd(oISCO[i])/(oISCO[i]*oISCO[i]);
+		norm[i] = inverse_two_thirds_power_simd(om)/(om*om) - oISCONorm + 1.e-6;
+	}
+}
+
+void normalize_time(double norm[], const double omega[], double oISCO, int n){
+	double oISCONorm = inverse_two_thirds_power_simd(oISCO)/(oISCO*oISCO);
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		double om = fabs(omega[i]);
+		norm[i] = inverse_two_thirds_power_simd(om)/(om*om) - oISCONorm + 1.e-6;
+	}
+}
+
+void normalize_phase(double norm[], const double omega[], const double oISCO[], int n){
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		double om = fabs(omega[i]);
+		double oISCONorm = inverse_two_thirds_power_simd(oISCO[i])/fabs(oISCO[i]);
+		norm[i] = inverse_two_thirds_power_simd(om)/om - oISCONorm + 1.e-6;
+	}
+}
+
+void normalize_phase(double norm[], const double omega[], double oISCO, int n){
+	double oISCONorm = inverse_two_thirds_power_simd(oISCO)/fabs(oISCO);
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		double om = fabs(omega[i]);
+		norm[i] = inverse_two_thirds_power_simd(om)/om - oISCONorm + 1.e-6;
+	}
+}
+
+void normalize_time_domega(double norm[], const double omega[], int n){
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		double om = fabs(omega[i]);
+		norm[i] = (-8./3.)*inverse_two_thirds_power_simd(om)/(om*om*om);
+	}
+}
+
+void normalize_phase_domega(double norm[], const double omega[], int n){
+	#pragma omp simd
+	for(int i = 0; i < n; i++){
+		double om = fabs(omega[i]);
+		norm[i] = (-5./3.)*inverse_two_thirds_power_simd(om)/(om*om);
+	}
+}
+
 // Trajectory Class
 
-InspiralContainer::InspiralContainer(int inspiralSteps): _alpha(inspiralSteps), _phase(inspiralSteps) {}
+InspiralContainer::InspiralContainer(int inspiralSteps): _start(0), _alpha(inspiralSteps), _phase(inspiralSteps) {}
 void InspiralContainer::setInspiralInitialConditions(double a, double massratio, double r0, double dt){
   _a = a;
   _massratio = massratio;
@@ -229,6 +465,16 @@ void InspiralContainer::setInspiralInitialConditions(double a, double massratio,
   _risco = kerr_isco_radius(_a);
   _oisco = kerr_isco_frequency(_a);
 }
+void InspiralContainer::resize(int inspiralSteps){
+  _alpha.resize(inspiralSteps);
+  _phase.resize(inspiralSteps);
+}
+void InspiralContainer::setStartStep(int start){
+  _start = start;
+}
+int InspiralContainer::getStartStep() const{
+  return _start;
+}
 void InspiralContainer::setTimeStep(int i, double alpha, double phase){
   _alpha[i] = alpha;
   _phase[i] = phase;
@@ -252,457 +498,1281 @@ Vector& InspiralContainer::getPhaseNonConstRef(){
   return _phase;
 }
 
-double InspiralContainer::getAlpha(int i){
+double InspiralContainer::getAlpha(int i) const{
   return _alpha[i];
 }
-double InspiralContainer::getPhase(int i){
+double InspiralContainer::getPhase(int i) const{
   return _phase[i];
 }
 
-double InspiralContainer::getTime(int i){
-	return i*_dt;
+double InspiralContainer::getTime(int i) const{
+	return (_start + i)*_dt;
 }
-double InspiralContainer::getFrequency(int i){
+double InspiralContainer::getFrequency(int i) const{
 	return omega_of_a_alpha(_a, fabs(_alpha[i]));
 }
-double InspiralContainer::getRadius(int i){
+double InspiralContainer::getRadius(int i) const{
 	return kerr_geo_radius_circ(_a, omega_of_a_alpha(_a, fabs(_alpha[i])));
 }
 
-double InspiralContainer::getSpin(){
+double InspiralContainer::getSpin() const{
   return _a;
 }
-double InspiralContainer::getISCORadius(){
+double InspiralContainer::getISCORadius() const{
   return _risco;
 }
-double InspiralContainer::getISCOFrequency(){
+double InspiralContainer::getISCOFrequency() const{
   return _oisco;
 }
 
-double InspiralContainer::getMassRatio(){
+double InspiralContainer::getMassRatio() const{
   return _massratio;
 }
 
-double InspiralContainer::getInitialRadius(){
+double InspiralContainer::getInitialRadius() const{
   return _r0;
 }
 
-double InspiralContainer::getInitialFrequency(){
+double InspiralContainer::getInitialFrequency() const{
   return kerr_geo_azimuthal_frequency_circ_time(_a, _r0);
 }
 
-double InspiralContainer::getFinalFrequency(){
+double InspiralContainer::getFinalFrequency() const{
   return omega_of_a_alpha(_a, fabs(_alpha[getSize() - 1]), _oisco);
 }
 
-double InspiralContainer::getFinalRadius(){
+double InspiralContainer::getFinalRadius() const{
   return kerr_geo_radius_circ(_a, getFinalFrequency());
 }
 
-double InspiralContainer::getTimeSpacing(){
+double InspiralContainer::getTimeSpacing() const{
   return _dt;
 }
-double InspiralContainer::getDuration(){
+double InspiralContainer::getDuration() const{
 	return (getSize() - 1)*_dt;
 }
 
-int InspiralContainer::getSize(){
+int InspiralContainer::getSize() const{
   return _alpha.size();
 }
 
-InspiralGenerator::InspiralGenerator(TrajectorySpline2D &traj, int num_threads): _traj(traj){
-  if(num_threads > 0){
-    omp_set_num_threads(num_threads);
-  }
+InspiralGenerator::InspiralGenerator(TrajectorySpline2D &traj, ExecutionContext context): _traj(traj), _context(context), _engine(INSPIRAL_SPLINE_ENGINE), _engine_tolerance(TRAJECTORY_CHEBYSHEV_TOLERANCE), _chebyshev_cache(INSPIRAL_CHEBYSHEV_CACHE_SIZE), _inspiral_cache(INSPIRAL_CACHE_BYTES){}
+
+ExecutionContext InspiralGenerator::resolveContext(ExecutionContext context){
+	return context.isShared() ? _context : context;
 }
 
-InspiralContainer InspiralGenerator::computeInspiral(double a, double massratio, double r0, double dt, double T, int num_threads){
+InspiralContainer InspiralGenerator::computeInspiral(double a, double massratio, double r0, double dt, double T, ExecutionContext context, double phase_tolerance){
 	double chi, omega_i, alpha_i, t_i;
 	computeInitialConditions(chi, omega_i, alpha_i, t_i, a, massratio, r0, T);
 	int timesteps = computeTimeStepNumber(dt, T);
 	InspiralContainer inspiral(timesteps);
 	inspiral.setInspiralInitialConditions(a, massratio, r0, dt);
-	computeInspiral(inspiral, chi, omega_i, alpha_i, t_i, massratio, dt, num_threads);
+	computeInspiral(inspiral, chi, omega_i, alpha_i, t_i, massratio, dt, context, phase_tolerance);
 	return inspiral;
 }
 
 void InspiralGenerator::computeInitialConditions(double &chi, double &omega_i, double &alpha_i, double &t_i, double a, double massratio, double r0, double &T){
 	chi = chi_of_spin(a);
 	omega_i = kerr_geo_azimuthal_frequency_circ_time(a, r0);
-	alpha_i = alpha_of_a_omega(a, omega_i, _traj.orbital_frequency_isco(chi));
-	t_i = _traj.time(chi, alpha_i);
+	std::shared_ptr<TrajectorySlice> chiSlice = _traj.slice(chi);
+	alpha_i = chiSlice->alpha_of_omega(omega_i);
+	t_i = chiSlice->time(alpha_i);
 	if(T > -t_i/massratio){
 		T = -t_i/massratio;
 	}
 }
 
-void InspiralGenerator::computeInspiral(InspiralContainer &inspiral, double chi, double omega_i, double alpha_i, double t_i, double massratio, double dt, int num_threads){
-	int steps = inspiral.getSize();
-	double a = inspiral.getSpin();
-	dt *= massratio; // need to rescale by massratio to get in terms of "slow time"
+// alpha and phase of a trajectory at fixed chi, which are held at the plunge
+// once the trajectory runs past it
+template <typename ChiTrajectory>
+static inline void sample_inspiral(ChiTrajectory &traj, double &alpha, double &phase, double t){
+	traj.orbital_alpha_phase_of_time(alpha, phase, t);
+	if(alpha < 0. || std::isnan(alpha)){
+		alpha = 0.;
+	}
+	if(phase > 0. || std::isnan(phase)){
+		phase = 0.;
+	}
+}
+
+// fills the steps jmin <= j < jmax of the inspiral into inspiralAlpha[j - jmin]
+// and inspiralPhase[j - jmin] from the alpha and phase of a trajectory at fixed
+// chi, which may be a TrajectorySlice or a TrajectoryChebyshev
+template <typename ChiTrajectory>
+static void step_inspiral_range(double inspiralAlpha[], double inspiralPhase[], ChiTrajectory &traj, double alpha_i, double t_i, double phase_i, double massratio, double dt, int jmin, int jmax, int num_threads){
+	if(jmin == 0 && jmax > 0){
+		inspiralAlpha[0] = alpha_i;
+		inspiralPhase[0] = 0.;
+	}
 
-	double phase_i = _traj.phase_of_time(chi, t_i);
-	inspiral.setTimeStep(0, alpha_i, 0.);	
-
-	// first we downsample by fixing a and sampling in t
-	// int downsample_steps = 200;
-	// double t_f = t_i + dt*(time_steps-1);
-	// double dt_downsample = (t_f - t_i)/double(downsample_steps - 1.);
-	// Vector alpha_downsample(downsample_steps);
-	// Vector phase_downsample(downsample_steps);
-	// Vector t_downsample(downsample_steps);
-
-	// #pragma omp parallel num_threads(num_threads)
-	// {
-	// 	#pragma omp for
-	// 	for(int j = 0; j < downsample_steps - 1; j++){
-	// 		t_downsample[j] = t_i + dt_downsample*j;
-	// 		alpha_downsample[j] = _traj.orbital_alpha(chi, t_downsample[j]);
-	// 		phase_downsample[j] = (_traj.phase(chi, alpha_downsample[j]) - phase_i)/massratio;
-	// 	}
-	// }
-
-	// t_downsample[downsample_steps - 1] = t_f;
-	// alpha_downsample[downsample_steps - 1] = _traj.orbital_alpha(chi, t_downsample[downsample_steps - 1]);
-	// phase_downsample[downsample_steps - 1] = (_traj.phase(chi, alpha_downsample[downsample_steps - 1]) - phase_i)/massratio;
-	// CubicSpline alpha_interp(t_downsample, alpha_downsample);
-	// CubicSpline phase_interp(t_downsample, phase_downsample);
-
-	// #pragma omp parallel num_threads(num_threads)
-	// {
-	// 	double alpha, phase, t_j;
-	// 	#pragma omp for
-	// 	for(int j = 0; j < time_steps; j++){
-	// 		t_j = t_i + j*dt;
-	// 		alpha = alpha_interp.evaluate(t_j);
-	// 		phase = phase_interp.evaluate(t_j);
-	// 		inspiral.setTimeStep(j, alpha, phase);
-	// 	}
-	// }
 	#pragma omp parallel num_threads(num_threads)
 	{
 		double alpha, phase;
 		#pragma omp for
-		for(int j = 1; j < steps; j++){
-			alpha = _traj.orbital_alpha(chi, t_i + dt*j);
-			phase = _traj.phase_of_time(chi, t_i + dt*j);
-			if(alpha < 0. || std::isnan(alpha)){
-				alpha = 0.;
-			}
-			if(phase > 0. || std::isnan(phase)){
-				phase = 0.;
-			}
-			inspiral.setTimeStep(j, alpha, (phase - phase_i)/massratio);
+		for(int j = std::max(jmin, 1); j < jmax; j++){
+			sample_inspiral(traj, alpha, phase, t_i + dt*j);
+			inspiralAlpha[j - jmin] = alpha;
+			inspiralPhase[j - jmin] = (phase - phase_i)/massratio;
 		}
 	}
 }
 
-double InspiralGenerator::computeTimeToMerger(double a, double massratio, double r0){
-	double chi = chi_of_spin(a);
-	double omega_i = kerr_geo_azimuthal_frequency_circ_time(a, r0);
-	double alpha_i = alpha_of_a_omega(a, omega_i, _traj.orbital_frequency_isco(chi));
-	return -_traj.time(chi, alpha_i)/massratio;
+template <typename ChiTrajectory>
+static void step_inspiral(double inspiralAlpha[], double inspiralPhase[], ChiTrajectory &traj, double alpha_i, double t_i, double massratio, double dt, int steps, int num_threads){
+	step_inspiral_range(inspiralAlpha, inspiralPhase, traj, alpha_i, t_i, traj.phase_of_time(t_i), massratio, dt, 0, steps, num_threads);
 }
 
-int InspiralGenerator::computeTimeStepNumber(double a, double massratio, double r0, double dt, double T){
-	double Tmerge = computeTimeToMerger(a, massratio, r0);
-	T = (T > Tmerge) ? Tmerge : T;
-	return computeTimeStepNumber(dt, T);
-}
+// fills sample i of the inspiral at step steps[i] of its time grid, where steps[0]
+// is 0. The samples are the same as those of step_inspiral at the same steps
+template <typename ChiTrajectory>
+static void step_inspiral_samples(double inspiralAlpha[], double inspiralPhase[], ChiTrajectory &traj, double alpha_i, double t_i, double massratio, double dt, const int steps[], int n, int num_threads){
+	double phase_i = traj.phase_of_time(t_i);
+	if(n > 0){
+		inspiralAlpha[0] = alpha_i;
+		inspiralPhase[0] = 0.;
+	}
 
-int InspiralGenerator::computeTimeStepNumber(double dt, double T){
-	return T/dt + 1;
+	#pragma omp parallel num_threads(num_threads)
+	{
+		double alpha, phase;
+		#pragma omp for
+		for(int i = 1; i < n; i++){
+			sample_inspiral(traj, alpha, phase, t_i + dt*steps[i]);
+			inspiralAlpha[i] = alpha;
+			inspiralPhase[i] = (phase - phase_i)/massratio;
+		}
+	}
 }
 
-TrajectorySpline2D& InspiralGenerator::getTrajectorySpline(){
-	return _traj;
+// A piece of a sparse inspiral, which spans the time steps s0 <= j <= s1 (s0 and
+// s1 need not be integers). Alpha and the phase are the cubics through their
+// samples at the thirds of the piece, unless the piece is dense, in which case
+// the trajectory is evaluated at every step
+struct InspiralSparsePiece{
+	double s0;
+	double s1;
+	double alpha[4];
+	double phase[4];
+	bool dense;
+};
+
+// the cubic through f[k] at x = 0, 1, 2, 3
+static inline double cubic_of_samples(const double f[4], double x){
+	double x1 = x - 1.;
+	double x2 = x - 2.;
+	double x3 = x - 3.;
+	return (f[3]*x*x1*x2 - f[0]*x1*x2*x3 + 3.*x*(f[1]*x2 - f[2]*x1)*x3)/6.;
+}
+
+// splits a piece into halves until its cubics agree with the trajectory at 1/6,
+// 1/2 and 5/6 of the piece. These are the interior samples of the halves, so
+// no evaluation of the trajectory is wasted on a split. Alpha must agree to
+// phase_tolerance, and the phase must agree to phase_tolerance radians of the
+// full inspiral, i.e. to phase_tolerance*massratio in slow time. Both are
+// checked against a quarter of the tolerance, as the largest error of a cubic
+// can lie between the check points. Alpha and the phase are not smooth at the
+// plunge, where the checks cannot be trusted, so the piece that ends at the
+// last step sMax is always refined down to a dense piece
+template <typename ChiTrajectory>
+static void refine_sparse_piece(std::vector<InspiralSparsePiece> &pieces, ChiTrajectory &traj, const InspiralSparsePiece &first, double t_i, double dt, double sMax, double massratio, double phase_tolerance){
+	phase_tolerance *= 0.25;
+	std::vector<InspiralSparsePiece> stack(1, first);
+	while(!stack.empty()){
+		InspiralSparsePiece piece = stack.back();
+		stack.pop_back();
+
+		double alpha[3], phase[3];
+		bool converged = (piece.s1 < sMax);
+		for(int k = 0; k < 3; k++){
+			sample_inspiral(traj, alpha[k], phase[k], t_i + dt*(piece.s0 + (2*k + 1)*(piece.s1 - piece.s0)/6.));
+			converged = converged && fabs(cubic_of_samples(piece.alpha, k + 0.5) - alpha[k]) <= phase_tolerance
+				&& fabs(cubic_of_samples(piece.phase, k + 0.5) - phase[k]) <= phase_tolerance*massratio;
+		}
+		if(converged || piece.s1 - piece.s0 <= INSPIRAL_SPARSE_MIN_STEPS){
+			// the last steps before the plunge and pieces that cannot meet the tolerance are left dense
+			piece.dense = !converged;
+			pieces.push_back(piece);
+			continue;
+		}
+
+		InspiralSparsePiece left = {piece.s0, 0.5*(piece.s0 + piece.s1),
+			{piece.alpha[0], alpha[0], piece.alpha[1], alpha[1]}, {piece.phase[0], phase[0], piece.phase[1], phase[1]}, false};
+		InspiralSparsePiece right = {left.s1, piece.s1,
+			{alpha[1], piece.alpha[2], alpha[2], piece.alpha[3]}, {phase[1], piece.phase[2], phase[2], piece.phase[3]}, false};
+		stack.push_back(right);
+		stack.push_back(left);
+	}
 }
 
-Data read_data(const std::string& filename){
-	double x, y, z;
-	Vector xVec, yVec, zVec;
-	std::istringstream lin;
-	std::ifstream inFile(filename);
-	for (std::string line; std::getline(inFile, line); ) {
-	    lin.clear();
-	    lin.str(line);
-	    if(lin >> x >> y >> z){
-			xVec.push_back(x);
-			yVec.push_back(y);
-			zVec.push_back(z);
-	    }
-	}
-
-	Data data = {
-		.x = xVec,
-		.y = yVec,
-		.z = zVec
-	};
+// fills the inspiral from cubic pieces fit to the trajectory on an adaptive
+// set of sparse nodes, which concentrate towards the plunge where alpha and the
+// phase vary fastest
+template <typename ChiTrajectory>
+static void step_sparse_inspiral(double inspiralAlpha[], double inspiralPhase[], ChiTrajectory &traj, double alpha_i, double t_i, double massratio, double dt, int steps, int num_threads, double phase_tolerance){
+	// a tolerance near the round-off error of the phase would leave every piece dense
+	double phase_i = traj.phase_of_time(t_i);
+	int intervals = std::min(INSPIRAL_SPARSE_INTERVALS, (steps - 1)/INSPIRAL_SPARSE_MIN_STEPS);
+	if(intervals < 1 || phase_tolerance*massratio < INSPIRAL_SPARSE_ROUNDOFF*DBL_EPSILON*fabs(phase_i)){
+		step_inspiral(inspiralAlpha, inspiralPhase, traj, alpha_i, t_i, massratio, dt, steps, num_threads);
+		return;
+	}
+	double sMax = steps - 1;
+
+	std::vector<std::vector<InspiralSparsePiece> > pieces(intervals);
+	#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+	for(int k = 0; k < intervals; k++){
+		InspiralSparsePiece piece;
+		piece.s0 = sMax*k/intervals;
+		piece.s1 = (k == intervals - 1) ? sMax : sMax*(k + 1)/intervals;
+		piece.dense = false;
+		for(int n = 0; n < 4; n++){
+			sample_inspiral(traj, piece.alpha[n], piece.phase[n], t_i + dt*(piece.s0 + n*(piece.s1 - piece.s0)/3.));
+		}
+		refine_sparse_piece(pieces[k], traj, piece, t_i, dt, sMax, massratio, phase_tolerance);
+	}
 
-	return data;
+	#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+	for(int k = 0; k < intervals; k++){
+		double alpha, phase;
+		for(size_t n = 0; n < pieces[k].size(); n++){
+			const InspiralSparsePiece &piece = pieces[k][n];
+			// each step belongs to the piece with s0 <= j < s1, apart from the last step
+			int jmin = static_cast<int>(ceil(piece.s0));
+			int jmax = (piece.s1 == sMax) ? steps : static_cast<int>(ceil(piece.s1));
+			double scale = 3./(piece.s1 - piece.s0);
+			for(int j = jmin; j < jmax; j++){
+				if(piece.dense){
+					sample_inspiral(traj, alpha, phase, t_i + dt*j);
+				}else{
+					alpha = std::max(cubic_of_samples(piece.alpha, (j - piece.s0)*scale), 0.);
+					phase = std::min(cubic_of_samples(piece.phase, (j - piece.s0)*scale), 0.);
+				}
+				inspiralAlpha[j] = alpha;
+				inspiralPhase[j] = (phase - phase_i)/massratio;
+			}
+		}
+	}
+	inspiralAlpha[0] = alpha_i;
+	inspiralPhase[0] = 0.;
 }
 
-inline bool file_exists(const std::string& name) {
-  struct stat buffer;   
-  return (stat (name.c_str(), &buffer) == 0); 
+template <typename ChiTrajectory>
+static void fill_inspiral(double inspiralAlpha[], double inspiralPhase[], ChiTrajectory &traj, double alpha_i, double t_i, double massratio, double dt, int steps, int num_threads, double phase_tolerance){
+	if(phase_tolerance > 0.){
+		step_sparse_inspiral(inspiralAlpha, inspiralPhase, traj, alpha_i, t_i, massratio, dt, steps, num_threads, phase_tolerance);
+	}else{
+		step_inspiral(inspiralAlpha, inspiralPhase, traj, alpha_i, t_i, massratio, dt, steps, num_threads);
+	}
 }
 
-TrajectoryData::TrajectoryData(const Vector &chi, const Vector &alpha, const Vector &t, const Vector &phi, const Vector &chiFlux, const Vector &alphaFlux, const Vector & flux, const Vector &beta, const Vector &omega, const Vector &alphaOfT, const Vector &phiOfT, const double &tMax): chi(chi), alpha(alpha), t(t), phi(phi), chiFlux(chiFlux), alphaFlux(alphaFlux), flux(flux), beta(beta), omega(omega), alphaOfT(alphaOfT), phiOfT(phiOfT), tMax(tMax) {}
+void InspiralGenerator::computeInspiral(InspiralContainer &inspiral, double chi, double omega_i, double alpha_i, double t_i, double massratio, double dt, ExecutionContext context, double phase_tolerance){
+	ThreadLease lease(resolveContext(context));
+	int num_threads = lease.threads();
+	int steps = inspiral.getSize();
+	double a = inspiral.getSpin();
+	dt *= massratio; // need to rescale by massratio to get in terms of "slow time"
 
-TrajectoryData read_trajectory_data(std::string filename){
-	int chiSample, alphaSample, chiSampleFlux, alphaSampleFlux;
-	double chi, alpha, t, phi, flux, beta, omega, PhiT;
-	
-	if(!file_exists(filename)){
-		std::cout << "(ERROR): No trajectory data for filename = " << filename << "\n";
-		return TrajectoryData();
+	// chi is fixed along the inspiral, so the steps are taken on the reduced 1D
+	// splines or on the Chebyshev expansions at that chi
+	if(_engine == INSPIRAL_CHEBYSHEV_ENGINE){
+		std::shared_ptr<TrajectoryChebyshev> chiExpansion = chebyshevExpansion(chi);
+		fill_inspiral(inspiral.getAlphaNonConstRef().data(), inspiral.getPhaseNonConstRef().data(), *chiExpansion, alpha_i, t_i, massratio, dt, steps, num_threads, phase_tolerance);
+	}else{
+		std::shared_ptr<TrajectorySlice> chiSlice = _traj.slice(chi);
+		fill_inspiral(inspiral.getAlphaNonConstRef().data(), inspiral.getPhaseNonConstRef().data(), *chiSlice, alpha_i, t_i, massratio, dt, steps, num_threads, phase_tolerance);
 	}
+}
 
-	std::istringstream lin;
-	std::ifstream inFile(filename);
-	std::string line;
-	std::getline(inFile, line);
-	lin.clear();
-	lin.str(line);
-	while(line.front() == '#' || line.empty() || isalpha(line.front())){
-		std::getline(inFile, line);
-		lin.clear();
-		lin.str(line);
+InspiralSegments InspiralGenerator::computeInspiralSegments(double a, double massratio, double r0, double dt, double T, int segment_steps, ExecutionContext context){
+	context = resolveContext(context);
+	double chi, omega_i, alpha_i, t_i;
+	computeInitialConditions(chi, omega_i, alpha_i, t_i, a, massratio, r0, T);
+	int steps = computeTimeStepNumber(dt, T);
+	if(_engine == INSPIRAL_CHEBYSHEV_ENGINE){
+		return InspiralSegments(std::shared_ptr<TrajectorySlice>(), chebyshevExpansion(chi), a, massratio, r0, dt, alpha_i, t_i, steps, segment_steps, context);
 	}
-	lin >> chiSample >> alphaSample >> chiSampleFlux >> alphaSampleFlux;
+	return InspiralSegments(_traj.slice(chi), std::shared_ptr<TrajectoryChebyshev>(), a, massratio, r0, dt, alpha_i, t_i, steps, segment_steps, context);
+}
 
-	int n = chiSample*alphaSample;
-	int nflux = chiSampleFlux*alphaSampleFlux;
-	if(n > 500000){
-		n = 1;
-		std::cout << "ERROR: File "<< filename << " does not have appropriate number of samples \n";
+MultirateSampling InspiralGenerator::computeMultirateSampling(double a, double massratio, double r0, double dt, double dt_max, double T, double omega_factor, double samples_per_cycle){
+	double chi, omega_i, alpha_i, t_i;
+	computeInitialConditions(chi, omega_i, alpha_i, t_i, a, massratio, r0, T);
+	int last = computeTimeStepNumber(dt, T) - 1;
+	std::shared_ptr<TrajectorySlice> chiSlice = _traj.slice(chi);
+
+	// the largest phase of the highest frequency between two samples
+	double maxPhaseStep = 2.*M_PI/samples_per_cycle;
+	int maxStride = 1;
+	while(2.*maxStride*dt <= dt_max){
+		maxStride *= 2;
 	}
-	Vector chiA(n), alphaA(n), tA(n), phiA(n), betaA(n), omegaA(n), alphaOfTA(n), phiOfTA(n);
-	Vector chiAFlux(nflux), alphaAFlux(nflux), fluxA(nflux);
-	int i = 0;
-	int j = 0;
 
-	double oISCO, freq, spin;
-	for(std::string line; std::getline(inFile, line);){
-		lin.clear();
-		lin.str(line);
-		if(lin >> chi >> alpha >> flux >> t >> phi >> beta >> omega >> PhiT){
-			oISCO = kerr_isco_frequency(spin_of_chi(chi));
-			chiA[i] = chi;
-			alphaA[i] = alpha;
-			spin = spin_of_chi(chi);
-			freq = omega_of_a_alpha(spin, alpha);
-			tA[i] = -t/normalize_time(freq, oISCO);
-			phiA[i] = -phi/normalize_phase(freq, oISCO);
-			if(flux > 0){
-				if(j > nflux - 1){
-					std::cout << "(TRAJ) Error: More flux samples than expected\n";
-				}
-				fluxA[j] = flux/normalize_energy_flux(freq);
-				chiAFlux[j] = chi;
-				alphaAFlux[j] = alpha;
-				j++;			
+	// step is the grid step of the last sample taken, and the first segment
+	// also takes the sample at step 0
+	MultirateSampling sampling(dt);
+	int step = 0;
+	int first = 1;
+	while(first || step < last){
+		int stride = maxStride;
+		int steps = 0;
+		// the frequency increases along the inspiral, so it is checked at the
+		// end of the segment
+		for(; stride > 1; stride /= 2){
+			steps = std::min(MULTIRATE_SEGMENT_STEPS, (last - step)/stride + first);
+			double omega = chiSlice->orbital_frequency(t_i + massratio*dt*(step + (steps - first)*stride));
+			if(steps > 0 && omega_factor*omega*stride*dt <= maxPhaseStep){
+				break;
 			}
-			betaA[i] = beta;
-			omegaA[i] = omega;
-			alphaOfTA[i] = alpha_of_a_omega(spin, omega, oISCO);
-			phiOfTA[i] = log1p(-PhiT);
-			i++;
 		}
+		if(stride == 1){
+			steps = std::min(MULTIRATE_SEGMENT_STEPS, last - step + first);
+		}
+		sampling.addSegment(stride, steps);
+		step += (steps - first)*stride;
+		first = 0;
 	}
-	Vector alphaAReduce(alphaSample);
-	for(int i = 0; i < alphaSample; i++){
-		alphaAReduce[i] = alphaA[i];
-	}
-	Vector chiAReduce(chiSample);
-	for(int i = 0; i < chiSample; i++){
-		chiAReduce[i] = chiA[i*alphaSample];
-	}
-	Vector alphaAFluxReduce(alphaSampleFlux);
-	for(int i = 0; i < alphaSampleFlux; i++){
-		alphaAFluxReduce[i] = alphaAFlux[i];
-	}
-	Vector chiAFluxReduce(chiSampleFlux);
-	for(int i = 0; i < chiSampleFlux; i++){
-		chiAFluxReduce[i] = chiAFlux[i*alphaSample];
-	}
-	Vector betaAReduce(alphaSample);
-	for(int i = 0; i < alphaSample; i++){
-		betaAReduce[i] = betaA[i];
-	}
-	// double tMax = tA[n - 1];
-	// double tMax = -t;
-	double chiTemp = chiA[n - 1];
-	double alphaTemp = alphaA[n - 1];
-	double aTemp = spin_of_chi(chiTemp);
-	double oISCOTemp = kerr_isco_frequency(spin_of_chi(chiTemp));
-	double omegaTemp = omega_of_a_alpha(aTemp, alphaTemp);
-	double tMax = tA[n - 1]*normalize_time(omegaTemp, oISCOTemp);
-
-	TrajectoryData traj(chiAReduce, alphaAReduce, tA, phiA, chiAFluxReduce, alphaAFluxReduce, fluxA, betaAReduce, omegaA, alphaOfTA, phiOfTA, tMax);
-
-	return traj;
+	return sampling;
 }
 
-CubicSpline read_time_spline(double){
-  TrajectoryData traj = read_trajectory_data();
-  return CubicSpline(traj.alpha, traj.t);
+InspiralContainer InspiralGenerator::computeInspiral(double a, double massratio, double r0, const MultirateSampling &sampling, ExecutionContext context){
+	ThreadLease lease(resolveContext(context));
+	double chi, omega_i, alpha_i, t_i;
+	double T = sampling.getDuration();
+	computeInitialConditions(chi, omega_i, alpha_i, t_i, a, massratio, r0, T);
+	int n = sampling.getSize();
+	InspiralContainer inspiral(n);
+	inspiral.setInspiralInitialConditions(a, massratio, r0, sampling.getTimeSpacing());
+	std::vector<int> steps(n);
+	sampling.getSteps(steps.data());
+	// the steps are taken in slow time, as in computeInspiral
+	double dt = sampling.getTimeSpacing()*massratio;
+	if(_engine == INSPIRAL_CHEBYSHEV_ENGINE){
+		std::shared_ptr<TrajectoryChebyshev> chiExpansion = chebyshevExpansion(chi);
+		step_inspiral_samples(inspiral.getAlphaNonConstRef().data(), inspiral.getPhaseNonConstRef().data(), *chiExpansion, alpha_i, t_i, massratio, dt, steps.data(), n, lease.threads());
+	}else{
+		std::shared_ptr<TrajectorySlice> chiSlice = _traj.slice(chi);
+		step_inspiral_samples(inspiral.getAlphaNonConstRef().data(), inspiral.getPhaseNonConstRef().data(), *chiSlice, alpha_i, t_i, massratio, dt, steps.data(), n, lease.threads());
+	}
+	return inspiral;
 }
 
-CubicSpline read_phase_spline(double){
-  TrajectoryData traj = read_trajectory_data();
-  return CubicSpline(traj.alpha, traj.phi);
+std::shared_ptr<TrajectoryChebyshev> InspiralGenerator::chebyshevExpansion(double chi){
+	std::shared_ptr<TrajectoryChebyshev> chiExpansion = _chebyshev_cache.find(chi);
+	if(!chiExpansion || chiExpansion->getTolerance() != _engine_tolerance){
+		chiExpansion = std::make_shared<TrajectoryChebyshev>(_traj, chi, _engine_tolerance);
+		_chebyshev_cache.insert(chi, chiExpansion);
+	}
+	return chiExpansion;
 }
 
-CubicSpline read_flux_spline(double){
-  TrajectoryData traj = read_trajectory_data();
-  return CubicSpline(traj.alpha, traj.flux);
+InspiralSegments::InspiralSegments(std::shared_ptr<TrajectorySlice> slice, std::shared_ptr<TrajectoryChebyshev> expansion, double a, double massratio, double r0, double dt, double alpha_i, double t_i, int steps, int segmentSteps, ExecutionContext context): _slice(slice), _expansion(expansion), _a(a), _massratio(massratio), _r0(r0), _dt(dt), _alpha_i(alpha_i), _t_i(t_i), _steps(steps), _segment_steps(segmentSteps), _context(context), _next(0) {
+	if(_segment_steps < 1 || _segment_steps > _steps){
+		_segment_steps = std::max(_steps, 1);
+	}
+	_phase_i = _expansion ? _expansion->phase_of_time(_t_i) : _slice->phase_of_time(_t_i);
 }
 
-double slow_time_of_omega(CubicSpline &t, double a, double omega){
-  return -t.evaluate(alpha_of_a_omega(a, omega));
+void InspiralSegments::fill(double alpha[], double phase[], int jmin, int jmax, int num_threads){
+	// the steps are taken in slow time, as in computeInspiral
+	if(_expansion){
+		step_inspiral_range(alpha, phase, *_expansion, _alpha_i, _t_i, _phase_i, _massratio, _dt*_massratio, jmin, jmax, num_threads);
+	}else{
+		step_inspiral_range(alpha, phase, *_slice, _alpha_i, _t_i, _phase_i, _massratio, _dt*_massratio, jmin, jmax, num_threads);
+	}
 }
 
-double slow_phase_of_omega(CubicSpline &phi, double a, double omega){
-  return -phi.evaluate(alpha_of_a_omega(a, omega));
+bool InspiralSegments::next(InspiralContainer &segment){
+	if(_next >= _steps){
+		return false;
+	}
+	int jmax = std::min(_next + _segment_steps, _steps);
+	segment.resize(jmax - _next);
+	segment.setInspiralInitialConditions(_a, _massratio, _r0, _dt);
+	segment.setStartStep(_next);
+	// the threads are leased per segment, so they return to the pool between segments
+	ThreadLease lease(_context);
+	fill(segment.getAlphaNonConstRef().data(), segment.getPhaseNonConstRef().data(), _next, jmax, lease.threads());
+	_next = jmax;
+	return true;
+}
+
+void InspiralSegments::reset(){
+	_next = 0;
+}
+
+InspiralContainer InspiralSegments::getEndpoints(){
+	InspiralContainer endpoints(std::min(_steps, 2));
+	endpoints.setInspiralInitialConditions(_a, _massratio, _r0, _dt*std::max(_steps - 1, 1));
+	if(_steps > 0){
+		fill(endpoints.getAlphaNonConstRef().data(), endpoints.getPhaseNonConstRef().data(), 0, 1, 1);
+	}
+	if(_steps > 1){
+		fill(&endpoints.getAlphaNonConstRef()[1], &endpoints.getPhaseNonConstRef()[1], _steps - 1, _steps, 1);
+	}
+	return endpoints;
 }
 
-double normalized_flux_of_omega(CubicSpline &Edot, double a, double omega){
-  return Edot.evaluate(alpha_of_a_omega(a, omega))*newtonian_energy_flux(omega);
+int InspiralSegments::getSize() const{
+	return _steps;
 }
 
-double normalized_omega_time_derivative_of_omega(CubicSpline &Edot, double a, double omega){
-  return -(1./kerr_geo_denergy_domega_circ(a, omega) + omega/kerr_geo_dmomentum_domega_circ(a, omega))*Edot.evaluate(alpha_of_a_omega(a, omega))*newtonian_energy_flux(omega);
+int InspiralSegments::getSegmentSize() const{
+	return _segment_steps;
 }
 
-// TrajectorySpline2D class
-
-TrajectorySpline2D::TrajectorySpline2D(std::string filename): TrajectorySpline2D(read_trajectory_data(filename)) {}
-TrajectorySpline2D::TrajectorySpline2D(TrajectoryData traj):
-TrajectorySpline2D(traj.chi, traj.alpha, traj.chiFlux, traj.alphaFlux, traj.beta, traj.t, traj.phi, traj.flux, traj.omega, traj.alphaOfT, traj.phiOfT, traj.tMax) {}
-TrajectorySpline2D::TrajectorySpline2D(const Vector & chi, const Vector & alpha, const Vector & chiFlux, const Vector & alphaFlux, const Vector & beta, const Vector & t, const Vector & phi, const Vector & flux, const Vector & omega, const Vector & alphaOfT, const Vector & phaseOfT, const double & tMax):
-  	_time_spline(chi, alpha, t), _phase_spline(chi, alpha, phi), _flux_spline(chiFlux, alphaFlux, flux), _alpha_spline(chi, beta, alphaOfT), _frequency_spline(chi, beta, omega), _phase_time_spline(chi, beta, phaseOfT), _time_norm_parameter(gamma_of_time(-tMax)) {}
-TrajectorySpline2D::~TrajectorySpline2D(){}
+int InspiralSegments::getSegmentNumber() const{
+	return (_steps + _segment_steps - 1)/_segment_steps;
+}
 
-// Frequency domain
+MultirateSampling::MultirateSampling(double dt): _dt(dt), _offsets(1, 0) {}
 
-double TrajectorySpline2D::time(double chi, double alpha){
-  	// return -expm1(pow(_time_spline.evaluate(chi, alpha), 2));
-	double oISCO = fabs(kerr_isco_frequency(spin_of_chi(chi)));
-	double omega = omega_of_a_alpha(chi, alpha, oISCO);
-	return -_time_spline.evaluate(chi, alpha)*normalize_time(omega, oISCO);
+void MultirateSampling::addSegment(int stride, int steps){
+	int start = 0;
+	if(_strides.size() > 0){
+		start = getStep(getSize() - 1) + stride;
+	}
+	_offsets.push_back(getSize() + steps);
+	_strides.push_back(stride);
+	_starts.push_back(start);
 }
 
-double TrajectorySpline2D::phase(double chi, double alpha){
-  	// return -expm1(pow(_phase_spline.evaluate(chi, alpha), 2));
-	double oISCO = kerr_isco_frequency(spin_of_chi(chi));
-	double omega = omega_of_a_alpha(chi, alpha, oISCO);
-	return -_phase_spline.evaluate(chi, alpha)*normalize_phase(omega, oISCO);
+int MultirateSampling::getSize() const{
+	return _offsets.back();
 }
 
-double TrajectorySpline2D::flux(double chi, double alpha){
-	double omega = omega_of_a_alpha(spin_of_chi(chi), alpha);
-  	return _flux_spline.evaluate(chi, alpha)*normalize_energy_flux(omega);
+int MultirateSampling::getSegmentNumber() const{
+	return _strides.size();
 }
 
-double TrajectorySpline2D::flux_norm(double chi, double alpha){
-	return _flux_spline.evaluate(chi, alpha);
+int MultirateSampling::getOffset(int k) const{
+	return _offsets[k];
 }
 
-double TrajectorySpline2D::orbital_frequency_time_derivative_from_flux(double chi, double alpha){
-	double a = spin_of_chi(chi);
-	double omega = omega_of_a_alpha(a, alpha);
-  	return -(1./kerr_geo_denergy_domega_circ(a, omega))*_flux_spline.evaluate(chi, alpha)*normalize_energy_flux(omega);
+int MultirateSampling::getSegmentSize(int k) const{
+	return _offsets[k + 1] - _offsets[k];
 }
 
-double TrajectorySpline2D::time_of_a_omega(double a, double omega){
-  	return time(chi_of_spin(a), alpha_of_a_omega(a, omega));
+int MultirateSampling::getStride(int k) const{
+	return _strides[k];
 }
 
-double TrajectorySpline2D::time_of_a_omega_derivative(double a, double omega){
-	double oISCO = fabs(kerr_isco_frequency(a));
-	double chi = chi_of_spin(a);
-	double alpha = alpha_of_a_omega(a, omega, oISCO);
-	// double f = _time_spline.evaluate(chi, alpha);
-  	// return -2.*f*exp(pow(f, 2))*_time_spline.derivative_y(chi, alpha)*dalpha_domega_of_a_omega(a, omega, oISCO);
-	return _time_spline.evaluate(chi, alpha)*normalize_time_domega(omega) + dalpha_domega_of_a_omega(a, omega, oISCO)*_time_spline.derivative_y(chi, alpha)*normalize_time(omega, oISCO);
+double MultirateSampling::getSegmentTimeSpacing(int k) const{
+	return _strides[k]*_dt;
 }
 
-// double TrajectorySpline2D::time_of_a_alpha_omega_derivative(double a, double alpha){
-// 	double oISCO = fabs(kerr_isco_frequency(a));
-// 	double chi = chi_of_spin(a);
-// 	// double f = _time_spline.evaluate(chi, alpha);
-//   	// return -2.*f*exp(pow(f, 2))*_time_spline.derivative_y(chi, alpha)*dalpha_domega_of_alpha(alpha, oISCO);
-// 	double omega = omega_of_a_alpha(a, alpha, oISCO);
-// 	return _time_spline.evaluate(chi, alpha)*normalize_time_domega(omega) + dalpha_domega_of_a_omega(a, omega, oISCO)*_time_spline.derivative_y(chi, alpha)*normalize_time(omega, oISCO);
-// }
-
-double TrajectorySpline2D::time_of_a_alpha_omega_derivative(double a, double alpha){
-	double oISCO = fabs(kerr_isco_frequency(a));
-	double chi = chi_of_spin(a);
-	// double f = _time_spline.evaluate(chi, alpha);
-  	// return -2.*f*exp(pow(f, 2))*_time_spline.derivative_y(chi, alpha)*dalpha_domega_of_alpha(alpha, oISCO);
-	double omega = omega_of_a_alpha(a, alpha, oISCO);
-	return -(kerr_geo_denergy_domega_circ(a, omega))/_flux_spline.evaluate(chi, alpha)/normalize_energy_flux(omega);
+int MultirateSampling::getStep(int i) const{
+	int k = std::upper_bound(_offsets.begin(), _offsets.end(), i) - _offsets.begin() - 1;
+	return _starts[k] + (i - _offsets[k])*_strides[k];
 }
 
-double TrajectorySpline2D::phase_of_a_omega(double a, double omega){
-  	return phase(chi_of_spin(a), alpha_of_a_omega(a, omega));
+void MultirateSampling::getSteps(int steps[]) const{
+	for(int k = 0; k < getSegmentNumber(); k++){
+		for(int i = _offsets[k]; i < _offsets[k + 1]; i++){
+			steps[i] = _starts[k] + (i - _offsets[k])*_strides[k];
+		}
+	}
 }
 
-double TrajectorySpline2D::phase_of_a_omega_derivative(double a, double omega){
-	double oISCO = fabs(kerr_isco_frequency(a));
-	double chi = chi_of_spin(a);
-	double alpha = alpha_of_a_omega(a, omega, oISCO);
-	// double f = _phase_spline.evaluate(chi, alpha);
-  	// return -2.*f*exp(pow(f, 2))*_phase_spline.derivative_y(chi, alpha)*dalpha_domega_of_a_omega(a, omega, oISCO);
-	return _phase_spline.evaluate(chi, alpha)*normalize_phase_domega(omega) + dalpha_domega_of_a_omega(a, omega, oISCO)*_phase_spline.derivative_y(chi, alpha)*normalize_phase(omega, oISCO);
+double MultirateSampling::getTime(int i) const{
+	return getStep(i)*_dt;
 }
 
-double TrajectorySpline2D::flux_of_a_omega(double a, double omega){
-  	return _flux_spline.evaluate(chi_of_spin(a), alpha_of_a_omega(a, omega))*normalize_energy_flux(omega);
+void MultirateSampling::getTimes(double t[]) const{
+	for(int k = 0; k < getSegmentNumber(); k++){
+		for(int i = _offsets[k]; i < _offsets[k + 1]; i++){
+			t[i] = (_starts[k] + (i - _offsets[k])*_strides[k])*_dt;
+		}
+	}
 }
 
-double TrajectorySpline2D::orbital_frequency_time_derivative_from_flux_of_a_omega(double a, double omega){
-  	return -(1./kerr_geo_denergy_domega_circ(a, omega))*_flux_spline.evaluate(chi_of_spin(a), alpha_of_a_omega(a, omega))*normalize_energy_flux(omega);
+double MultirateSampling::getTimeSpacing() const{
+	return _dt;
 }
 
-// Time domain
-
-double TrajectorySpline2D::orbital_alpha(double chi, double t){
-  	return _alpha_spline.evaluate(chi, beta_of_time(t, _time_norm_parameter));
+void MultirateSampling::setTimeSpacing(double dt){
+	_dt = dt;
 }
 
-double TrajectorySpline2D::orbital_alpha_derivative(double chi, double t){
-  	return _alpha_spline.derivative_y(chi, beta_of_time(t, _time_norm_parameter))*dbeta_dtime(t, _time_norm_parameter);
+int MultirateSampling::getUniformSize() const{
+	return (getSize() > 0) ? getStep(getSize() - 1) + 1 : 0;
 }
 
-double TrajectorySpline2D::phase_of_time(double chi, double t){
-  	return phase_of_phase_norm_2(_phase_time_spline.evaluate(chi, beta_of_time(t, _time_norm_parameter)));
+double MultirateSampling::getDuration() const{
+	return (getSize() > 0) ? getTime(getSize() - 1) : 0.;
 }
 
-double TrajectorySpline2D::phase_of_time_derivative(double chi, double t){
-	double phase2 = _phase_time_spline.derivative_y(chi, beta_of_time(t, _time_norm_parameter));
-  	return _phase_time_spline.derivative_y(chi, beta_of_time(t, _time_norm_parameter))*dbeta_dtime(t, _time_norm_parameter)*dphase_dphase_norm_2(phase2);
+void MultirateSampling::resample(double uniform[], const double samples[]) const{
+	int n = getSize();
+	if(n < 2){
+		if(n == 1){
+			uniform[0] = samples[0];
+		}
+		return;
+	}
+	std::vector<int> steps(n);
+	getSteps(steps.data());
+	int order = std::min(n, 4);
+	for(int i = 0; i < n - 1; i++){
+		// the samples i - 1 to i + 2, shifted to lie within the sampling at its ends
+		int j0 = std::max(0, std::min(i - 1, n - order));
+		uniform[steps[i]] = samples[i];
+		for(int s = steps[i] + 1; s < steps[i + 1]; s++){
+			double value = 0.;
+			for(int j = j0; j < j0 + order; j++){
+				double weight = 1.;
+				for(int k = j0; k < j0 + order; k++){
+					if(k != j){
+						weight *= double(s - steps[k])/(steps[j] - steps[k]);
+					}
+				}
+				value += weight*samples[j];
+			}
+			uniform[s] = value;
+		}
+	}
+	uniform[steps[n - 1]] = samples[n - 1];
+}
+
+// a source of a batch of inspirals, with its time step in slow time
+struct InspiralBatchSource{
+	double chi;
+	double alpha_i;
+	double t_i;
+	double phase_i;
+	double massratio;
+	double dt;
+	int steps;
+	double *alpha;
+	double *phase;
+};
+
+// the steps jmin <= j < jmax of a source
+struct InspiralBatchBlock{
+	int source;
+	int jmin;
+	int jmax;
+};
+
+static bool larger_block(const InspiralBatchBlock &block1, const InspiralBatchBlock &block2){
+	return block1.jmax - block1.jmin > block2.jmax - block2.jmin;
+}
+
+// Dense inspirals are split into blocks of at most INSPIRAL_BATCH_BLOCK_STEPS
+// steps, which are handed out to the threads largest first, so that a long
+// source is shared by several threads while short sources fill in the gaps.
+// Sparse inspirals are taken a whole source at a time, longest first
+template <typename ChiTrajectory>
+static void step_inspirals(std::vector<InspiralBatchSource> &sources, std::vector<std::shared_ptr<ChiTrajectory> > &trajs, int num_threads, double phase_tolerance){
+	int n = sources.size();
+	std::vector<InspiralBatchBlock> blocks;
+	for(int i = 0; i < n; i++){
+		int blockSteps = (phase_tolerance > 0.) ? std::max(sources[i].steps, 1) : INSPIRAL_BATCH_BLOCK_STEPS;
+		for(int j = 0; j < sources[i].steps; j += blockSteps){
+			InspiralBatchBlock block = {i, j, std::min(j + blockSteps, sources[i].steps)};
+			blocks.push_back(block);
+		}
+	}
+	std::stable_sort(blocks.begin(), blocks.end(), larger_block);
+
+	int blockNum = blocks.size();
+	#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+	for(int k = 0; k < blockNum; k++){
+		InspiralBatchSource &source = sources[blocks[k].source];
+		ChiTrajectory &traj = *trajs[blocks[k].source];
+		if(phase_tolerance > 0.){
+			step_sparse_inspiral(source.alpha, source.phase, traj, source.alpha_i, source.t_i, source.massratio, source.dt, source.steps, 1, phase_tolerance);
+			continue;
+		}
+		int jmin = blocks[k].jmin;
+		step_inspiral_range(source.alpha + jmin, source.phase + jmin, traj, source.alpha_i, source.t_i, source.phase_i, source.massratio, source.dt, jmin, blocks[k].jmax, 1);
+	}
 }
 
-double TrajectorySpline2D::phase_of_a_time(double a, double t){
-	double chi = chi_of_spin(a);
-  	return phase_of_phase_norm_2(_phase_time_spline.evaluate(chi, beta_of_time(t, _time_norm_parameter)));
+void InspiralGenerator::computeTimeStepNumbers(int steps[], const double a[], const double massratio[], const double r0[], const double dt[], const double T[], int n){
+	for(int i = 0; i < n; i++){
+		steps[i] = computeTimeStepNumber(a[i], massratio[i], r0[i], dt[i], T[i]);
+	}
+}
+
+void InspiralGenerator::computeInspirals(double *alpha[], double *phase[], const int steps[], const double a[], const double massratio[], const double r0[], const double dt[], int n, ExecutionContext context, double phase_tolerance){
+	ThreadLease lease(resolveContext(context));
+	int num_threads = lease.threads();
+	std::vector<InspiralBatchSource> sources(n);
+	std::vector<std::shared_ptr<TrajectorySlice> > slices(_engine == INSPIRAL_CHEBYSHEV_ENGINE ? 0 : n);
+	std::vector<std::shared_ptr<TrajectoryChebyshev> > expansions(_engine == INSPIRAL_CHEBYSHEV_ENGINE ? n : 0);
+	#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+	for(int i = 0; i < n; i++){
+		InspiralBatchSource &source = sources[i];
+		double omega_i;
+		double T = DBL_MAX;
+		computeInitialConditions(source.chi, omega_i, source.alpha_i, source.t_i, a[i], massratio[i], r0[i], T);
+		if(_engine == INSPIRAL_CHEBYSHEV_ENGINE){
+			expansions[i] = chebyshevExpansion(source.chi);
+			source.phase_i = expansions[i]->phase_of_time(source.t_i);
+		}else{
+			slices[i] = _traj.slice(source.chi);
+			source.phase_i = slices[i]->phase_of_time(source.t_i);
+		}
+		source.massratio = massratio[i];
+		source.dt = dt[i]*massratio[i];
+		source.steps = steps[i];
+		source.alpha = alpha[i];
+		source.phase = phase[i];
+	}
+
+	if(_engine == INSPIRAL_CHEBYSHEV_ENGINE){
+		step_inspirals(sources, expansions, num_threads, phase_tolerance);
+	}else{
+		step_inspirals(sources, slices, num_threads, phase_tolerance);
+	}
+}
+
+void InspiralGenerator::computeInspirals(double alpha[], double phase[], const long offsets[], const double a[], const double massratio[], const double r0[], const double dt[], int n, ExecutionContext context, double phase_tolerance){
+	std::vector<double*> alphaPointers(n), phasePointers(n);
+	std::vector<int> steps(n);
+	for(int i = 0; i < n; i++){
+		alphaPointers[i] = alpha + offsets[i];
+		phasePointers[i] = phase + offsets[i];
+		steps[i] = offsets[i + 1] - offsets[i];
+	}
+	computeInspirals(alphaPointers.data(), phasePointers.data(), steps.data(), a, massratio, r0, dt, n, context, phase_tolerance);
+}
+
+std::vector<InspiralContainer> InspiralGenerator::computeInspirals(const double a[], const double massratio[], const double r0[], const double dt[], const double T[], int n, ExecutionContext context, double phase_tolerance){
+	std::vector<int> steps(n);
+	computeTimeStepNumbers(steps.data(), a, massratio, r0, dt, T, n);
+	std::vector<InspiralContainer> inspirals;
+	inspirals.reserve(n);
+	std::vector<double*> alphaPointers(n), phasePointers(n);
+	for(int i = 0; i < n; i++){
+		inspirals.push_back(InspiralContainer(steps[i]));
+		inspirals[i].setInspiralInitialConditions(a[i], massratio[i], r0[i], dt[i]);
+		alphaPointers[i] = inspirals[i].getAlphaNonConstRef().data();
+		phasePointers[i] = inspirals[i].getPhaseNonConstRef().data();
+	}
+	computeInspirals(alphaPointers.data(), phasePointers.data(), steps.data(), a, massratio, r0, dt, n, context, phase_tolerance);
+	return inspirals;
+}
+
+double InspiralGenerator::computeTimeToMerger(double a, double massratio, double r0){
+	std::shared_ptr<TrajectorySlice> chiSlice = _traj.slice_of_a(a);
+	double alpha_i = chiSlice->alpha_of_omega(kerr_geo_azimuthal_frequency_circ_time(a, r0));
+	return -chiSlice->time(alpha_i)/massratio;
+}
+
+// Solves slice.time(alpha) = t with Newton iterations in log(alpha) on
+// log(-t). The time to merger goes as alpha^4 close to the ISCO and as
+// omega^(-8/3) far from it, so log(-t) is close to linear in log(alpha) at
+// both ends and a few iterations reach the tolerance from the quadrupole
+// estimate of omega. Steps that leave the bracket of the root are replaced by
+// bisection
+static double frequency_of_time(TrajectorySlice &slice, double t){
+	double omegaMin = slice.min_orbital_frequency();
+	double omegaMax = slice.max_orbital_frequency();
+	if(t <= slice.time_of_omega(omegaMin)){
+		return omegaMin;
+	}
+	if(t >= slice.time_of_omega(omegaMax)){
+		return omegaMax;
+	}
+
+	double oiscoThird = pow(slice.orbital_frequency_isco(), 1./3.);
+	double logT = log(-t);
+	double alphaMin = slice.alpha_of_omega(omegaMax);
+	double alphaMax = slice.alpha_of_omega(omegaMin);
+	double omega = pow(-51.2*t, -0.375);
+	double alpha = (omega < omegaMax) ? slice.alpha_of_omega(omega) : 0.;
+	if(!(alpha > alphaMin && alpha < alphaMax)){
+		alpha = 0.5*(alphaMin + alphaMax);
+	}
+	for(int i = 0; i < INITIAL_RADIUS_MAX_ITERATIONS; i++){
+		omega = slice.omega_of_alpha(alpha);
+		double ta = slice.time(alpha);
+		if(fabs(ta - t) <= INITIAL_RADIUS_TOLERANCE*fabs(t)){
+			return omega;
+		}
+		// -t increases with alpha
+		double f = log(-ta) - logT;
+		if(f > 0.){
+			alphaMax = alpha;
+		}else{
+			alphaMin = alpha;
+		}
+		// df/dlog(alpha), where time_of_omega_derivative is the derivative of
+		// the time to merger -t and domega/dalpha = -6 (omega_ISCO^(1/3) - omega^(1/3)) omega^(2/3)/alpha
+		double omegaThird = cbrt(omega);
+		double dfdw = 6.*slice.time_of_omega_derivative(omega)*(oiscoThird - omegaThird)*omegaThird*omegaThird/ta;
+		double alphaNext = alpha*exp(-f/dfdw);
+		if(!(alphaNext > alphaMin && alphaNext < alphaMax)){
+			alphaNext = 0.5*(alphaMin + alphaMax);
+		}
+		if(alphaNext == alpha){
+			return omega;
+		}
+		alpha = alphaNext;
+	}
+	return slice.omega_of_alpha(alpha);
+}
+
+double InspiralGenerator::computeInitialRadius(double a, double massratio, double T){
+	std::shared_ptr<TrajectorySlice> chiSlice = _traj.slice_of_a(a);
+	return kerr_geo_radius_circ(a, frequency_of_time(*chiSlice, -T*massratio));
+}
+
+void InspiralGenerator::computeInitialRadii(double r0[], const double a[], const double massratio[], const double T[], int n, ExecutionContext context){
+	ThreadLease lease(resolveContext(context));
+	#pragma omp parallel for num_threads(lease.threads()) if(n > 1)
+	for(int i = 0; i < n; i++){
+		r0[i] = computeInitialRadius(a[i], massratio[i], T[i]);
+	}
+}
+
+int InspiralGenerator::computeTimeStepNumber(double a, double massratio, double r0, double dt, double T){
+	double Tmerge = computeTimeToMerger(a, massratio, r0);
+	T = (T > Tmerge) ? Tmerge : T;
+	return computeTimeStepNumber(dt, T);
+}
+
+int InspiralGenerator::computeTimeStepNumber(double dt, double T){
+	return T/dt + 1;
+}
+
+TrajectorySpline2D& InspiralGenerator::getTrajectorySpline(){
+	return _traj;
+}
+
+void InspiralGenerator::setEngine(int engine, double tolerance){
+	if(engine != INSPIRAL_SPLINE_ENGINE && engine != INSPIRAL_CHEBYSHEV_ENGINE){
+		std::cout << "ERROR: Unknown inspiral engine " << engine << ", using the spline engine \n";
+		engine = INSPIRAL_SPLINE_ENGINE;
+	}
+	_engine = engine;
+	if(tolerance != _engine_tolerance){
+		_engine_tolerance = tolerance;
+		_chebyshev_cache.clear();
+	}
+}
+
+int InspiralGenerator::getEngine(){
+	return _engine;
+}
+
+std::shared_ptr<const InspiralContainer> InspiralGenerator::computeInspiralShared(double a, double massratio, double r0, double dt, double T, ExecutionContext context, double phase_tolerance){
+	// the engine is part of the key, so that switching engines never returns
+	// an inspiral stepped with the other one
+	InspiralCacheKey key = {a, massratio, r0, dt, T, phase_tolerance, _engine, _engine_tolerance};
+	std::shared_ptr<const InspiralContainer> inspiral;
+	if(_inspiral_cache.capacity() > 0){
+		inspiral = _inspiral_cache.find(key);
+		if(inspiral){
+			return inspiral;
+		}
+	}
+	inspiral = std::make_shared<const InspiralContainer>(computeInspiral(a, massratio, r0, dt, T, context, phase_tolerance));
+	if(_inspiral_cache.capacity() > 0){
+		_inspiral_cache.insert(key, inspiral, sizeof(InspiralContainer) + 2*inspiral->getSize()*sizeof(double));
+	}
+	return inspiral;
+}
+
+void InspiralGenerator::setInspiralCacheBytes(size_t bytes){
+	_inspiral_cache.setCapacity(bytes);
+}
+
+size_t InspiralGenerator::getInspiralCacheBytes(){
+	return _inspiral_cache.capacity();
+}
+
+size_t InspiralGenerator::inspiralCacheSize(){
+	return _inspiral_cache.size();
+}
+
+size_t InspiralGenerator::inspiralCacheHits(){
+	return _inspiral_cache.hits();
+}
+
+size_t InspiralGenerator::inspiralCacheMisses(){
+	return _inspiral_cache.misses();
+}
+
+void InspiralGenerator::clearInspiralCache(){
+	_inspiral_cache.clear();
+	_inspiral_cache.resetCounters();
+}
+
+Data read_data(const std::string& filename){
+	TextFile file(filename);
+	Data data;
+	data.x.reserve(file.lines());
+	data.y.reserve(file.lines());
+	data.z.reserve(file.lines());
+	double row[3];
+	for(size_t k = 0; k < file.lines(); k++){
+		if(file.parseLine(k, row, 3)){
+			data.x.push_back(row[0]);
+			data.y.push_back(row[1]);
+			data.z.push_back(row[2]);
+		}
+	}
+
+	return data;
+}
+
+inline bool file_exists(const std::string& name) {
+  struct stat buffer;   
+  return (stat (name.c_str(), &buffer) == 0); 
+}
+
+TrajectoryData::TrajectoryData(const Vector &chi, const Vector &alpha, const Vector &t, const Vector &phi, const Vector &chiFlux, const Vector &alphaFlux, const Vector & flux, const Vector &beta, const Vector &omega, const Vector &alphaOfT, const Vector &phiOfT, const double &tMax): chi(chi), alpha(alpha), t(t), phi(phi), chiFlux(chiFlux), alphaFlux(alphaFlux), flux(flux), beta(beta), omega(omega), alphaOfT(alphaOfT), phiOfT(phiOfT), tMax(tMax) {}
+
+TrajectoryBinaryData read_trajectory_binary(std::string filename){
+	std::shared_ptr<const MappedFile> file = std::make_shared<const MappedFile>(filename);
+	if(!file->isOpen()){
+		throw std::runtime_error("Could not map trajectory file " + filename);
+	}
+	if(file->size() < sizeof(TrajectoryBinaryHeader) + TRAJECTORY_BINARY_TABLES*sizeof(TrajectoryBinaryTable)){
+		throw std::runtime_error("Trajectory file " + filename + " is too short");
+	}
+	const TrajectoryBinaryHeader *header = reinterpret_cast<const TrajectoryBinaryHeader*>(file->data());
+	if(memcmp(header->magic, TRAJECTORY_BINARY_MAGIC, sizeof(header->magic)) != 0){
+		throw std::runtime_error(filename + " is not a binary trajectory file");
+	}
+	if(header->byte_order != TRAJECTORY_BINARY_BYTE_ORDER){
+		throw std::runtime_error("Trajectory file " + filename + " was written with a different byte order");
+	}
+	if(header->version != TRAJECTORY_BINARY_VERSION || header->tables != TRAJECTORY_BINARY_TABLES){
+		throw std::runtime_error("Trajectory file " + filename + " has version " + std::to_string(header->version) + ", expected " + std::to_string(TRAJECTORY_BINARY_VERSION));
+	}
+
+	const TrajectoryBinaryTable *tables = reinterpret_cast<const TrajectoryBinaryTable*>(file->data() + sizeof(TrajectoryBinaryHeader));
+	BicubicSplineData splines[TRAJECTORY_BINARY_TABLES];
+	int fields[TRAJECTORY_BINARY_TABLES] = {2, 1, 3};
+	for(int k = 0; k < TRAJECTORY_BINARY_TABLES; k++){
+		const TrajectoryBinaryTable &table = tables[k];
+		BicubicSplineData spline = {table.x0, table.dx, table.nx, table.y0, table.dy, table.ny, table.nfields, nullptr};
+		bool valid = (table.nfields == fields[k]) && valid_spline_data(spline, table.size);
+		valid = valid && (table.offset % SPLINE_ALIGNMENT == 0) && file->contains(table.offset, table.size, sizeof(double));
+		if(!valid){
+			throw std::runtime_error("Trajectory file " + filename + " has an invalid spline table " + std::to_string(k));
+		}
+		spline.coefficients = reinterpret_cast<const double*>(file->data() + table.offset);
+		splines[k] = spline;
+	}
+
+	TrajectoryBinaryData traj;
+	traj.file = file;
+	traj.frequencyDomain = splines[0];
+	traj.flux = splines[1];
+	traj.timeDomain = splines[2];
+	traj.timeNormParameter = header->time_norm_parameter;
+	return traj;
+}
+
+bool is_trajectory_binary(std::string filename){
+	char magic[sizeof(TRAJECTORY_BINARY_MAGIC) - 1];
+	std::ifstream inFile(filename, std::ios::binary);
+	if(!inFile.read(magic, sizeof(magic))){
+		return false;
+	}
+	return memcmp(magic, TRAJECTORY_BINARY_MAGIC, sizeof(magic)) == 0;
+}
+
+int convert_trajectory_file(std::string text_filename, std::string binary_filename){
+	if(!file_exists(text_filename)){
+		std::cout << "(ERROR): No trajectory data for filename = " << text_filename << "\n";
+		return 1;
+	}
+	TrajectorySpline2D traj(text_filename);
+	return traj.writeBinary(binary_filename);
+}
+
+TrajectoryData read_trajectory_data(std::string filename){
+	if(!file_exists(filename)){
+		std::cout << "(ERROR): No trajectory data for filename = " << filename << "\n";
+		return TrajectoryData();
+	}
+
+	TextFile file(filename);
+	size_t header = file.firstDataLine();
+	double samples[4] = {0., 0., 0., 0.};
+	file.parseLine(header, samples, 4);
+	int chiSample = static_cast<int>(samples[0]);
+	int alphaSample = static_cast<int>(samples[1]);
+	int chiSampleFlux = static_cast<int>(samples[2]);
+	int alphaSampleFlux = static_cast<int>(samples[3]);
+
+	int n = chiSample*alphaSample;
+	int nflux = chiSampleFlux*alphaSampleFlux;
+	if(n > 500000 || n < 1 || nflux < 1){
+		std::cout << "ERROR: File "<< filename << " does not have appropriate number of samples \n";
+		return TrajectoryData();
+	}
+
+	// the lines are parsed in parallel, and only then numbered as rows of the
+	// grid and of the flux grid (the rows with a positive flux)
+	long lineNum = file.lines() - header - 1;
+	Vector values(8*lineNum);
+	std::vector<int> rowIndex(lineNum), fluxIndex(lineNum);
+	#pragma omp parallel for schedule(static)
+	for(long k = 0; k < lineNum; k++){
+		rowIndex[k] = file.parseLine(header + 1 + k, &values[8*k], 8) ? 0 : -1;
+	}
+	int i = 0;
+	int j = 0;
+	long lastRow = -1;
+	for(long k = 0; k < lineNum; k++){
+		fluxIndex[k] = -1;
+		if(rowIndex[k] < 0){
+			continue;
+		}
+		if(i > n - 1){
+			std::cout << "(TRAJ) Error: More samples than expected\n";
+			rowIndex[k] = -1;
+			continue;
+		}
+		rowIndex[k] = i++;
+		lastRow = k;
+		if(values[8*k + 2] > 0){
+			if(j > nflux - 1){
+				std::cout << "(TRAJ) Error: More flux samples than expected\n";
+			}else{
+				fluxIndex[k] = j++;
+			}
+		}
+	}
+	if(lastRow < 0){
+		std::cout << "ERROR: File "<< filename << " does not have appropriate number of samples \n";
+		return TrajectoryData();
+	}
+
+	TrajectoryData traj;
+	traj.chi.resize(chiSample);
+	traj.alpha.resize(alphaSample);
+	traj.beta.resize(alphaSample);
+	traj.t.resize(n);
+	traj.phi.resize(n);
+	traj.omega.resize(n);
+	traj.alphaOfT.resize(n);
+	traj.phiOfT.resize(n);
+	traj.chiFlux.resize(chiSampleFlux);
+	traj.alphaFlux.resize(alphaSampleFlux);
+	traj.flux.resize(nflux);
+
+	// columns: chi, alpha, flux, t, phi, beta, omega, PhiT
+	#pragma omp parallel for schedule(static)
+	for(long k = 0; k < lineNum; k++){
+		int i = rowIndex[k];
+		if(i < 0){
+			continue;
+		}
+		const double *row = &values[8*k];
+		double chi = row[0];
+		double alpha = row[1];
+		double spin = spin_of_chi(chi);
+		double oISCO = kerr_isco_frequency(spin);
+		double freq = omega_of_a_alpha(spin, alpha);
+		if(i % alphaSample == 0){
+			traj.chi[i/alphaSample] = chi;
+		}
+		if(i < alphaSample){
+			traj.alpha[i] = alpha;
+			traj.beta[i] = row[5];
+		}
+		traj.t[i] = -row[3]/normalize_time(freq, oISCO);
+		traj.phi[i] = -row[4]/normalize_phase(freq, oISCO);
+		traj.omega[i] = row[6];
+		traj.alphaOfT[i] = alpha_of_a_omega(spin, row[6], oISCO);
+		traj.phiOfT[i] = log1p(-row[7]);
+
+		int j = fluxIndex[k];
+		if(j >= 0){
+			if(j % alphaSampleFlux == 0){
+				traj.chiFlux[j/alphaSampleFlux] = chi;
+			}
+			if(j < alphaSampleFlux){
+				traj.alphaFlux[j] = alpha;
+			}
+			traj.flux[j] = row[2]/normalize_energy_flux(freq);
+		}
+	}
+
+	double chiTemp = values[8*lastRow];
+	double alphaTemp = values[8*lastRow + 1];
+	double aTemp = spin_of_chi(chiTemp);
+	double oISCOTemp = kerr_isco_frequency(aTemp);
+	double omegaTemp = omega_of_a_alpha(aTemp, alphaTemp);
+	traj.tMax = traj.t[i - 1]*normalize_time(omegaTemp, oISCOTemp);
+
+	return traj;
+}
+
+CubicSpline read_time_spline(double){
+  TrajectoryData traj = read_trajectory_data();
+  return CubicSpline(traj.alpha, traj.t);
+}
+
+CubicSpline read_phase_spline(double){
+  TrajectoryData traj = read_trajectory_data();
+  return CubicSpline(traj.alpha, traj.phi);
+}
+
+CubicSpline read_flux_spline(double){
+  TrajectoryData traj = read_trajectory_data();
+  return CubicSpline(traj.alpha, traj.flux);
+}
+
+double slow_time_of_omega(CubicSpline &t, double a, double omega){
+  return -t.evaluate(alpha_of_a_omega(a, omega));
+}
+
+double slow_phase_of_omega(CubicSpline &phi, double a, double omega){
+  return -phi.evaluate(alpha_of_a_omega(a, omega));
+}
+
+double normalized_flux_of_omega(CubicSpline &Edot, double a, double omega){
+  return Edot.evaluate(alpha_of_a_omega(a, omega))*newtonian_energy_flux(omega);
+}
+
+double normalized_omega_time_derivative_of_omega(CubicSpline &Edot, double a, double omega){
+  return -(1./kerr_geo_denergy_domega_circ(a, omega) + omega/kerr_geo_dmomentum_domega_circ(a, omega))*Edot.evaluate(alpha_of_a_omega(a, omega))*newtonian_energy_flux(omega);
+}
+
+// TrajectorySpline2D class
+
+// binary files are recognized by their magic number and mapped, anything else is parsed as text
+TrajectorySpline2D::TrajectorySpline2D(std::string filename, int single_precision): TrajectorySpline2D(is_trajectory_binary(filename) ? TrajectoryData() : read_trajectory_data(filename), is_trajectory_binary(filename) ? read_trajectory_binary(filename) : TrajectoryBinaryData(), single_precision) {}
+// the fields of a spline bundle, moved out of the vectors that held them
+static std::vector<Vector> bundle_fields(Vector &z0, Vector &z1){
+	std::vector<Vector> z(2);
+	z[0].swap(z0);
+	z[1].swap(z1);
+	return z;
+}
+
+static std::vector<Vector> bundle_fields(Vector &z0, Vector &z1, Vector &z2){
+	std::vector<Vector> z(3);
+	z[0].swap(z0);
+	z[1].swap(z1);
+	z[2].swap(z2);
+	return z;
+}
+
+// traj is taken by value, so its samples are moved into the spline bundles rather than copied
+TrajectorySpline2D::TrajectorySpline2D(TrajectoryData traj, int single_precision): TrajectorySpline2D(traj, TrajectoryBinaryData(), single_precision) {}
+TrajectorySpline2D::TrajectorySpline2D(const Vector & chi, const Vector & alpha, const Vector & chiFlux, const Vector & alphaFlux, const Vector & beta, const Vector & t, const Vector & phi, const Vector & flux, const Vector & omega, const Vector & alphaOfT, const Vector & phaseOfT, const double & tMax, int single_precision):
+  	_frequency_domain_splines(chi, alpha, {t, phi}), _flux_spline(chiFlux, alphaFlux, flux), _time_domain_splines(chi, beta, {alphaOfT, phaseOfT, omega}), _time_norm_parameter(gamma_of_time(-tMax)), _slice_cache(TRAJECTORY_SLICE_CACHE_SIZE) {
+	convertToSinglePrecision(single_precision);
+}
+TrajectorySpline2D::TrajectorySpline2D(const TrajectoryBinaryData &traj, int single_precision): TrajectorySpline2D(TrajectoryData(), traj, single_precision) {}
+TrajectorySpline2D::TrajectorySpline2D(TrajectoryData traj, const TrajectoryBinaryData &binary, int single_precision):
+	_frequency_domain_splines(binary.file ? BicubicSplineBundle(binary.frequencyDomain, binary.file) : BicubicSplineBundle(traj.chi, traj.alpha, bundle_fields(traj.t, traj.phi))),
+	_flux_spline(binary.file ? BicubicSpline(binary.flux, binary.file) : BicubicSpline(traj.chiFlux, traj.alphaFlux, traj.flux)),
+	_time_domain_splines(binary.file ? BicubicSplineBundle(binary.timeDomain, binary.file) : BicubicSplineBundle(traj.chi, traj.beta, bundle_fields(traj.alphaOfT, traj.phiOfT, traj.omega))),
+	_time_norm_parameter(binary.file ? binary.timeNormParameter : gamma_of_time(-traj.tMax)), _slice_cache(TRAJECTORY_SLICE_CACHE_SIZE) {
+	convertToSinglePrecision(single_precision);
+}
+TrajectorySpline2D::~TrajectorySpline2D(){}
+
+void TrajectorySpline2D::convertToSinglePrecision(int single_precision){
+	if(single_precision & TRAJECTORY_FREQUENCY_DOMAIN_SINGLE_PRECISION){
+		_frequency_domain_splines.convertToSinglePrecision();
+	}
+	if(single_precision & TRAJECTORY_FLUX_SINGLE_PRECISION){
+		_flux_spline.convertToSinglePrecision();
+	}
+	if(single_precision & TRAJECTORY_TIME_DOMAIN_SINGLE_PRECISION){
+		_time_domain_splines.convertToSinglePrecision();
+	}
+}
+
+static uint64_t aligned_offset(uint64_t offset){
+	return ((offset + SPLINE_ALIGNMENT - 1)/SPLINE_ALIGNMENT)*SPLINE_ALIGNMENT;
+}
+
+int TrajectorySpline2D::writeBinary(std::string filename){
+	if(_frequency_domain_splines.singlePrecision() || _flux_spline.singlePrecision() || _time_domain_splines.singlePrecision()){
+		std::cout << "ERROR: Trajectory splines in single precision cannot be written to " << filename << "\n";
+		return 1;
+	}
+	BicubicSplineData splines[TRAJECTORY_BINARY_TABLES] = {_frequency_domain_splines.data(), _flux_spline.data(), _time_domain_splines.data()};
+
+	TrajectoryBinaryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRAJECTORY_BINARY_MAGIC, sizeof(header.magic));
+	header.version = TRAJECTORY_BINARY_VERSION;
+	header.byte_order = TRAJECTORY_BINARY_BYTE_ORDER;
+	header.tables = TRAJECTORY_BINARY_TABLES;
+	header.time_norm_parameter = _time_norm_parameter;
+
+	TrajectoryBinaryTable tables[TRAJECTORY_BINARY_TABLES];
+	memset(tables, 0, sizeof(tables));
+	uint64_t offset = aligned_offset(sizeof(header) + sizeof(tables));
+	for(int k = 0; k < TRAJECTORY_BINARY_TABLES; k++){
+		tables[k].x0 = splines[k].x0;
+		tables[k].dx = splines[k].dx;
+		tables[k].y0 = splines[k].y0;
+		tables[k].dy = splines[k].dy;
+		tables[k].nx = splines[k].nx;
+		tables[k].ny = splines[k].ny;
+		tables[k].nfields = splines[k].nfields;
+		tables[k].offset = offset;
+		tables[k].size = 16*uint64_t(splines[k].nfields)*splines[k].nx*splines[k].ny;
+		offset = aligned_offset(offset + tables[k].size*sizeof(double));
+	}
+
+	std::ofstream outFile(filename, std::ios::binary | std::ios::trunc);
+	if(!outFile){
+		std::cout << "ERROR: Could not open " << filename << " for writing \n";
+		return 1;
+	}
+	outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	outFile.write(reinterpret_cast<const char*>(tables), sizeof(tables));
+	uint64_t position = sizeof(header) + sizeof(tables);
+	const char padding[SPLINE_ALIGNMENT] = {0};
+	for(int k = 0; k < TRAJECTORY_BINARY_TABLES; k++){
+		outFile.write(padding, tables[k].offset - position);
+		outFile.write(reinterpret_cast<const char*>(splines[k].coefficients), tables[k].size*sizeof(double));
+		position = tables[k].offset + tables[k].size*sizeof(double);
+	}
+	if(!outFile){
+		std::cout << "ERROR: Could not write " << filename << "\n";
+		return 1;
+	}
+	return 0;
+}
+
+// Frequency domain
+
+double TrajectorySpline2D::time(double chi, double alpha){
+  	// return -expm1(pow(_time_spline.evaluate(chi, alpha), 2));
+	double oISCO = fabs(kerr_isco_frequency(spin_of_chi(chi)));
+	double omega = omega_of_a_alpha(chi, alpha, oISCO);
+	return -_frequency_domain_splines.evaluate(TIME_FIELD, chi, alpha)*normalize_time(omega, oISCO);
+}
+
+double TrajectorySpline2D::phase(double chi, double alpha){
+  	// return -expm1(pow(_phase_spline.evaluate(chi, alpha), 2));
+	double oISCO = kerr_isco_frequency(spin_of_chi(chi));
+	double omega = omega_of_a_alpha(chi, alpha, oISCO);
+	return -_frequency_domain_splines.evaluate(PHASE_FIELD, chi, alpha)*normalize_phase(omega, oISCO);
+}
+
+double TrajectorySpline2D::flux(double chi, double alpha){
+	double omega = omega_of_a_alpha(spin_of_chi(chi), alpha);
+  	return _flux_spline.evaluate(chi, alpha)*normalize_energy_flux(omega);
+}
+
+double TrajectorySpline2D::flux_norm(double chi, double alpha){
+	return _flux_spline.evaluate(chi, alpha);
+}
+
+double TrajectorySpline2D::orbital_frequency_time_derivative_from_flux(double chi, double alpha){
+	double a = spin_of_chi(chi);
+	double omega = omega_of_a_alpha(a, alpha);
+  	return -(1./kerr_geo_denergy_domega_circ(a, omega))*_flux_spline.evaluate(chi, alpha)*normalize_energy_flux(omega);
+}
+
+double TrajectorySpline2D::time_of_a_omega(double a, double omega){
+  	return time(chi_of_spin(a), alpha_of_a_omega(a, omega));
+}
+
+double TrajectorySpline2D::time_of_a_omega_derivative(double a, double omega){
+	double oISCO = fabs(kerr_isco_frequency(a));
+	double chi = chi_of_spin(a);
+	double alpha = alpha_of_a_omega(a, omega, oISCO);
+	// double f = _time_spline.evaluate(chi, alpha);
+  	// return -2.*f*exp(pow(f, 2))*_time_spline.derivative_y(chi, alpha)*dalpha_domega_of_a_omega(a, omega, oISCO);
+	double f, dfdchi, dfdalpha;
+	_frequency_domain_splines.evaluateAll(TIME_FIELD, f, dfdchi, dfdalpha, chi, alpha);
+	return f*normalize_time_domega(omega) + dalpha_domega_of_a_omega(a, omega, oISCO)*dfdalpha*normalize_time(omega, oISCO);
+}
+
+// double TrajectorySpline2D::time_of_a_alpha_omega_derivative(double a, double alpha){
+// 	double oISCO = fabs(kerr_isco_frequency(a));
+// 	double chi = chi_of_spin(a);
+// 	// double f = _time_spline.evaluate(chi, alpha);
+//   	// return -2.*f*exp(pow(f, 2))*_time_spline.derivative_y(chi, alpha)*dalpha_domega_of_alpha(alpha, oISCO);
+// 	double omega = omega_of_a_alpha(a, alpha, oISCO);
+// 	return _time_spline.evaluate(chi, alpha)*normalize_time_domega(omega) + dalpha_domega_of_a_omega(a, omega, oISCO)*_time_spline.derivative_y(chi, alpha)*normalize_time(omega, oISCO);
+// }
+
+double TrajectorySpline2D::time_of_a_alpha_omega_derivative(double a, double alpha){
+	double oISCO = fabs(kerr_isco_frequency(a));
+	double chi = chi_of_spin(a);
+	// double f = _time_spline.evaluate(chi, alpha);
+  	// return -2.*f*exp(pow(f, 2))*_time_spline.derivative_y(chi, alpha)*dalpha_domega_of_alpha(alpha, oISCO);
+	double omega = omega_of_a_alpha(a, alpha, oISCO);
+	return -(kerr_geo_denergy_domega_circ(a, omega))/_flux_spline.evaluate(chi, alpha)/normalize_energy_flux(omega);
+}
+
+double TrajectorySpline2D::phase_of_a_omega(double a, double omega){
+  	return phase(chi_of_spin(a), alpha_of_a_omega(a, omega));
+}
+
+double TrajectorySpline2D::phase_of_a_omega_derivative(double a, double omega){
+	double oISCO = fabs(kerr_isco_frequency(a));
+	double chi = chi_of_spin(a);
+	double alpha = alpha_of_a_omega(a, omega, oISCO);
+	// double f = _phase_spline.evaluate(chi, alpha);
+  	// return -2.*f*exp(pow(f, 2))*_phase_spline.derivative_y(chi, alpha)*dalpha_domega_of_a_omega(a, omega, oISCO);
+	double f, dfdchi, dfdalpha;
+	_frequency_domain_splines.evaluateAll(PHASE_FIELD, f, dfdchi, dfdalpha, chi, alpha);
+	return f*normalize_phase_domega(omega) + dalpha_domega_of_a_omega(a, omega, oISCO)*dfdalpha*normalize_phase(omega, oISCO);
+}
+
+double TrajectorySpline2D::flux_of_a_omega(double a, double omega){
+  	return _flux_spline.evaluate(chi_of_spin(a), alpha_of_a_omega(a, omega))*normalize_energy_flux(omega);
+}
+
+double TrajectorySpline2D::orbital_frequency_time_derivative_from_flux_of_a_omega(double a, double omega){
+  	return -(1./kerr_geo_denergy_domega_circ(a, omega))*_flux_spline.evaluate(chi_of_spin(a), alpha_of_a_omega(a, omega))*normalize_energy_flux(omega);
+}
+
+// Time domain
+
+double TrajectorySpline2D::orbital_alpha(double chi, double t){
+  	return _time_domain_splines.evaluate(ALPHA_FIELD, chi, beta_of_time(t, _time_norm_parameter));
+}
+
+double TrajectorySpline2D::orbital_alpha_derivative(double chi, double t){
+  	return _time_domain_splines.derivative_y(ALPHA_FIELD, chi, beta_of_time(t, _time_norm_parameter))*dbeta_dtime(t, _time_norm_parameter);
+}
+
+double TrajectorySpline2D::phase_of_time(double chi, double t){
+  	return phase_of_phase_norm_2(_time_domain_splines.evaluate(PHASE_TIME_FIELD, chi, beta_of_time(t, _time_norm_parameter)));
+}
+
+double TrajectorySpline2D::phase_of_time_derivative(double chi, double t){
+	double phase2 = _time_domain_splines.derivative_y(PHASE_TIME_FIELD, chi, beta_of_time(t, _time_norm_parameter));
+  	return _time_domain_splines.derivative_y(PHASE_TIME_FIELD, chi, beta_of_time(t, _time_norm_parameter))*dbeta_dtime(t, _time_norm_parameter)*dphase_dphase_norm_2(phase2);
+}
+
+double TrajectorySpline2D::phase_of_a_time(double a, double t){
+	double chi = chi_of_spin(a);
+  	return phase_of_phase_norm_2(_time_domain_splines.evaluate(PHASE_TIME_FIELD, chi, beta_of_time(t, _time_norm_parameter)));
 }
 
 double TrajectorySpline2D::phase_of_a_time_derivative(double a, double t){
 	double chi = chi_of_spin(a);
-	double phase2 = _phase_time_spline.derivative_y(chi, beta_of_time(t, _time_norm_parameter));
-  	return _phase_time_spline.derivative_y(chi, beta_of_time(t, _time_norm_parameter))*dbeta_dtime(t, _time_norm_parameter)*dphase_dphase_norm_2(phase2);
+	double phase2 = _time_domain_splines.derivative_y(PHASE_TIME_FIELD, chi, beta_of_time(t, _time_norm_parameter));
+  	return _time_domain_splines.derivative_y(PHASE_TIME_FIELD, chi, beta_of_time(t, _time_norm_parameter))*dbeta_dtime(t, _time_norm_parameter)*dphase_dphase_norm_2(phase2);
+}
+
+// alpha and phase share the (chi, beta) grid, so both come from a single bundle evaluation
+void TrajectorySpline2D::orbital_alpha_phase_of_time(double &alpha, double &phase, double chi, double t){
+	double fields[3];
+	_time_domain_splines.evaluate(fields, chi, beta_of_time(t, _time_norm_parameter));
+	alpha = fields[ALPHA_FIELD];
+	phase = phase_of_phase_norm_2(fields[PHASE_TIME_FIELD]);
 }
 
 double TrajectorySpline2D::orbital_frequency(double a, double t){
-  	return _frequency_spline.evaluate(chi_of_spin(a), beta_of_time(t, _time_norm_parameter));
+  	return _time_domain_splines.evaluate(FREQUENCY_FIELD, chi_of_spin(a), beta_of_time(t, _time_norm_parameter));
 }
 
 double TrajectorySpline2D::orbital_frequency_derivative(double a, double t){
-  	return _frequency_spline.derivative_y(chi_of_spin(a), beta_of_time(t, _time_norm_parameter))*dbeta_dtime(t, _time_norm_parameter);
+  	return _time_domain_splines.derivative_y(FREQUENCY_FIELD, chi_of_spin(a), beta_of_time(t, _time_norm_parameter))*dbeta_dtime(t, _time_norm_parameter);
 }
 
 double TrajectorySpline2D::orbital_frequency_isco(double chi){
@@ -727,15 +1797,634 @@ double TrajectorySpline2D::max_orbital_radius(double a){
 
 double TrajectorySpline2D::max_time_before_merger(double a){
 	// return 1. - exp(pow(_max_time_spline.evaluate(chi_of_spin(a)), 2));
-	return _time_spline.evaluate(chi_of_spin(a), ALPHA_MAX);
+	return _frequency_domain_splines.evaluate(TIME_FIELD, chi_of_spin(a), ALPHA_MAX);
+}
+
+// Array queries
+
+// calls evaluateBlock(i0, blockSize) on the blocks of TRAJECTORY_BLOCK_SIZE
+// points that cover i < n, which are shared between the threads of the context
+template <typename BlockFunction>
+static void evaluate_blocks(int n, ExecutionContext context, BlockFunction evaluateBlock){
+	ThreadLease lease(context);
+	int blockNum = (n + TRAJECTORY_BLOCK_SIZE - 1)/TRAJECTORY_BLOCK_SIZE;
+	#pragma omp parallel for num_threads(lease.threads()) if(blockNum > 1)
+	for(int b = 0; b < blockNum; b++){
+		int i0 = b*TRAJECTORY_BLOCK_SIZE;
+		evaluateBlock(i0, std::min(TRAJECTORY_BLOCK_SIZE, n - i0));
+	}
+}
+
+void TrajectorySpline2D::frequencyDomainBlock(int field, double out[], const double chi[], const double a[], const double alpha[], int n){
+	double oISCO[TRAJECTORY_BLOCK_SIZE], omega[TRAJECTORY_BLOCK_SIZE], norm[TRAJECTORY_BLOCK_SIZE];
+	kerr_isco_frequency(oISCO, a, n);
+	omega_of_a_alpha(omega, alpha, oISCO, n);
+	if(field == TIME_FIELD){
+		normalize_time(norm, omega, oISCO, n);
+	}else{
+		normalize_phase(norm, omega, oISCO, n);
+	}
+	for(int i = 0; i < n; i++){
+		out[i] = -_frequency_domain_splines.evaluate(field, chi[i], alpha[i])*norm[i];
+	}
+}
+
+void TrajectorySpline2D::frequencyDomainDerivativeBlock(int field, double out[], const double a[], const double omega[], int n){
+	double chi[TRAJECTORY_BLOCK_SIZE], oISCO[TRAJECTORY_BLOCK_SIZE], alpha[TRAJECTORY_BLOCK_SIZE], dalpha[TRAJECTORY_BLOCK_SIZE];
+	double norm[TRAJECTORY_BLOCK_SIZE], dnorm[TRAJECTORY_BLOCK_SIZE];
+	chi_of_spin(chi, a, n);
+	kerr_isco_frequency(oISCO, a, n);
+	alpha_of_a_omega(alpha, omega, oISCO, n);
+	dalpha_domega_of_a_omega(dalpha, omega, oISCO, n);
+	if(field == TIME_FIELD){
+		normalize_time(norm, omega, oISCO, n);
+		normalize_time_domega(dnorm, omega, n);
+	}else{
+		normalize_phase(norm, omega, oISCO, n);
+		normalize_phase_domega(dnorm, omega, n);
+	}
+	for(int i = 0; i < n; i++){
+		double f, dfdchi, dfdalpha;
+		_frequency_domain_splines.evaluateAll(field, f, dfdchi, dfdalpha, chi[i], alpha[i]);
+		out[i] = f*dnorm[i] + dalpha[i]*dfdalpha*norm[i];
+	}
+}
+
+void TrajectorySpline2D::time(double t[], const double chi[], const double alpha[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double a[TRAJECTORY_BLOCK_SIZE];
+		spin_of_chi(a, chi + i0, blockSize);
+		frequencyDomainBlock(TIME_FIELD, t + i0, chi + i0, a, alpha + i0, blockSize);
+	});
+}
+
+void TrajectorySpline2D::phase(double phase[], const double chi[], const double alpha[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double a[TRAJECTORY_BLOCK_SIZE];
+		spin_of_chi(a, chi + i0, blockSize);
+		frequencyDomainBlock(PHASE_FIELD, phase + i0, chi + i0, a, alpha + i0, blockSize);
+	});
+}
+
+void TrajectorySpline2D::flux(double flux[], const double chi[], const double alpha[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double a[TRAJECTORY_BLOCK_SIZE], oISCO[TRAJECTORY_BLOCK_SIZE], omega[TRAJECTORY_BLOCK_SIZE], norm[TRAJECTORY_BLOCK_SIZE];
+		spin_of_chi(a, chi + i0, blockSize);
+		kerr_isco_frequency(oISCO, a, blockSize);
+		omega_of_a_alpha(omega, alpha + i0, oISCO, blockSize);
+		normalize_energy_flux(norm, omega, blockSize);
+		_flux_spline.evaluate(flux + i0, chi + i0, alpha + i0, blockSize);
+		for(int i = 0; i < blockSize; i++){
+			flux[i0 + i] *= norm[i];
+		}
+	});
+}
+
+void TrajectorySpline2D::flux_norm(double flux[], const double chi[], const double alpha[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		_flux_spline.evaluate(flux + i0, chi + i0, alpha + i0, blockSize);
+	});
+}
+
+void TrajectorySpline2D::time_of_a_omega(double t[], const double a[], const double omega[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double chi[TRAJECTORY_BLOCK_SIZE], oISCO[TRAJECTORY_BLOCK_SIZE], alpha[TRAJECTORY_BLOCK_SIZE];
+		chi_of_spin(chi, a + i0, blockSize);
+		kerr_isco_frequency(oISCO, a + i0, blockSize);
+		alpha_of_a_omega(alpha, omega + i0, oISCO, blockSize);
+		frequencyDomainBlock(TIME_FIELD, t + i0, chi, a + i0, alpha, blockSize);
+	});
+}
+
+void TrajectorySpline2D::time_of_a_omega_derivative(double dtdo[], const double a[], const double omega[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		frequencyDomainDerivativeBlock(TIME_FIELD, dtdo + i0, a + i0, omega + i0, blockSize);
+	});
+}
+
+void TrajectorySpline2D::phase_of_a_omega(double phase[], const double a[], const double omega[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double chi[TRAJECTORY_BLOCK_SIZE], oISCO[TRAJECTORY_BLOCK_SIZE], alpha[TRAJECTORY_BLOCK_SIZE];
+		chi_of_spin(chi, a + i0, blockSize);
+		kerr_isco_frequency(oISCO, a + i0, blockSize);
+		alpha_of_a_omega(alpha, omega + i0, oISCO, blockSize);
+		frequencyDomainBlock(PHASE_FIELD, phase + i0, chi, a + i0, alpha, blockSize);
+	});
+}
+
+void TrajectorySpline2D::phase_of_a_omega_derivative(double dphido[], const double a[], const double omega[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		frequencyDomainDerivativeBlock(PHASE_FIELD, dphido + i0, a + i0, omega + i0, blockSize);
+	});
+}
+
+void TrajectorySpline2D::flux_of_a_omega(double flux[], const double a[], const double omega[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double chi[TRAJECTORY_BLOCK_SIZE], oISCO[TRAJECTORY_BLOCK_SIZE], alpha[TRAJECTORY_BLOCK_SIZE], norm[TRAJECTORY_BLOCK_SIZE];
+		chi_of_spin(chi, a + i0, blockSize);
+		kerr_isco_frequency(oISCO, a + i0, blockSize);
+		alpha_of_a_omega(alpha, omega + i0, oISCO, blockSize);
+		normalize_energy_flux(norm, omega + i0, blockSize);
+		_flux_spline.evaluate(flux + i0, chi, alpha, blockSize);
+		for(int i = 0; i < blockSize; i++){
+			flux[i0 + i] *= norm[i];
+		}
+	});
+}
+
+void TrajectorySpline2D::orbital_frequency_time_derivative_from_flux(double dodt[], const double chi[], const double alpha[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double a[TRAJECTORY_BLOCK_SIZE], oISCO[TRAJECTORY_BLOCK_SIZE], omega[TRAJECTORY_BLOCK_SIZE], norm[TRAJECTORY_BLOCK_SIZE], dEdo[TRAJECTORY_BLOCK_SIZE];
+		spin_of_chi(a, chi + i0, blockSize);
+		kerr_isco_frequency(oISCO, a, blockSize);
+		omega_of_a_alpha(omega, alpha + i0, oISCO, blockSize);
+		normalize_energy_flux(norm, omega, blockSize);
+		kerr_geo_denergy_domega_circ(dEdo, a, omega, blockSize);
+		_flux_spline.evaluate(dodt + i0, chi + i0, alpha + i0, blockSize);
+		for(int i = 0; i < blockSize; i++){
+			dodt[i0 + i] *= -norm[i]/dEdo[i];
+		}
+	});
+}
+
+void TrajectorySpline2D::orbital_frequency_time_derivative_from_flux_of_a_omega(double dodt[], const double a[], const double omega[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double dEdo[TRAJECTORY_BLOCK_SIZE];
+		flux_of_a_omega(dodt + i0, a + i0, omega + i0, blockSize, 1);
+		kerr_geo_denergy_domega_circ(dEdo, a + i0, omega + i0, blockSize);
+		for(int i = 0; i < blockSize; i++){
+			dodt[i0 + i] *= -1./dEdo[i];
+		}
+	});
+}
+
+void TrajectorySpline2D::time_of_a_alpha_omega_derivative(double dtdo[], const double a[], const double alpha[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double chi[TRAJECTORY_BLOCK_SIZE], oISCO[TRAJECTORY_BLOCK_SIZE], omega[TRAJECTORY_BLOCK_SIZE], norm[TRAJECTORY_BLOCK_SIZE], dEdo[TRAJECTORY_BLOCK_SIZE];
+		chi_of_spin(chi, a + i0, blockSize);
+		kerr_isco_frequency(oISCO, a + i0, blockSize);
+		omega_of_a_alpha(omega, alpha + i0, oISCO, blockSize);
+		normalize_energy_flux(norm, omega, blockSize);
+		kerr_geo_denergy_domega_circ(dEdo, a + i0, omega, blockSize);
+		_flux_spline.evaluate(dtdo + i0, chi, alpha + i0, blockSize);
+		for(int i = 0; i < blockSize; i++){
+			dtdo[i0 + i] = -dEdo[i]/dtdo[i0 + i]/norm[i];
+		}
+	});
+}
+
+// the time-domain splines take beta, a transcendental function of the time,
+// so the time-domain queries are evaluated point by point within each block
+
+void TrajectorySpline2D::orbital_alpha(double alpha[], const double chi[], const double t[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		for(int i = i0; i < i0 + blockSize; i++){
+			alpha[i] = orbital_alpha(chi[i], t[i]);
+		}
+	});
+}
+
+void TrajectorySpline2D::orbital_alpha_derivative(double dalphadt[], const double chi[], const double t[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		for(int i = i0; i < i0 + blockSize; i++){
+			dalphadt[i] = orbital_alpha_derivative(chi[i], t[i]);
+		}
+	});
+}
+
+void TrajectorySpline2D::orbital_frequency(double omega[], const double a[], const double t[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double chi[TRAJECTORY_BLOCK_SIZE];
+		chi_of_spin(chi, a + i0, blockSize);
+		for(int i = 0; i < blockSize; i++){
+			omega[i0 + i] = _time_domain_splines.evaluate(FREQUENCY_FIELD, chi[i], beta_of_time(t[i0 + i], _time_norm_parameter));
+		}
+	});
+}
+
+void TrajectorySpline2D::orbital_frequency_derivative(double domegadt[], const double a[], const double t[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double chi[TRAJECTORY_BLOCK_SIZE];
+		chi_of_spin(chi, a + i0, blockSize);
+		for(int i = 0; i < blockSize; i++){
+			double t_i = t[i0 + i];
+			domegadt[i0 + i] = _time_domain_splines.derivative_y(FREQUENCY_FIELD, chi[i], beta_of_time(t_i, _time_norm_parameter))*dbeta_dtime(t_i, _time_norm_parameter);
+		}
+	});
+}
+
+void TrajectorySpline2D::phase_of_time(double phase[], const double chi[], const double t[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		for(int i = i0; i < i0 + blockSize; i++){
+			phase[i] = phase_of_time(chi[i], t[i]);
+		}
+	});
 }
 
-void TrajectorySpline2D::flux_of_a_omega(double flux[], const double a[], const double omega[], int n, int num_threads){
-	if(num_threads > 1){
-        omp_set_num_threads(num_threads);
-    }
-	#pragma omp parallel for
-		for(int j = 0; j < n; j++){
-			flux[j] = _flux_spline.evaluate(chi_of_spin(a[j]), alpha_of_a_omega(a[j], omega[j]))*normalize_energy_flux(omega[j]);
+void TrajectorySpline2D::phase_of_time_derivative(double dphidt[], const double chi[], const double t[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		for(int i = i0; i < i0 + blockSize; i++){
+			dphidt[i] = phase_of_time_derivative(chi[i], t[i]);
 		}
-}
\ No newline at end of file
+	});
+}
+
+void TrajectorySpline2D::phase_of_a_time(double phase[], const double a[], const double t[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double chi[TRAJECTORY_BLOCK_SIZE];
+		chi_of_spin(chi, a + i0, blockSize);
+		for(int i = 0; i < blockSize; i++){
+			phase[i0 + i] = phase_of_time(chi[i], t[i0 + i]);
+		}
+	});
+}
+
+void TrajectorySpline2D::phase_of_a_time_derivative(double dphidt[], const double a[], const double t[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double chi[TRAJECTORY_BLOCK_SIZE];
+		chi_of_spin(chi, a + i0, blockSize);
+		for(int i = 0; i < blockSize; i++){
+			dphidt[i0 + i] = phase_of_time_derivative(chi[i], t[i0 + i]);
+		}
+	});
+}
+
+void TrajectorySpline2D::orbital_alpha_phase_of_time(double alpha[], double phase[], const double chi[], const double t[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		for(int i = i0; i < i0 + blockSize; i++){
+			orbital_alpha_phase_of_time(alpha[i], phase[i], chi[i], t[i]);
+		}
+	});
+}
+
+void TrajectorySpline2D::orbital_frequency_isco(double oISCO[], const double chi[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double a[TRAJECTORY_BLOCK_SIZE];
+		spin_of_chi(a, chi + i0, blockSize);
+		kerr_isco_frequency(oISCO + i0, a, blockSize);
+	});
+}
+
+void TrajectorySpline2D::orbital_frequency_isco_of_a(double oISCO[], const double a[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		kerr_isco_frequency(oISCO + i0, a + i0, blockSize);
+	});
+}
+
+void TrajectorySpline2D::min_orbital_frequency(double omega[], const double a[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double oISCO[TRAJECTORY_BLOCK_SIZE], alpha[TRAJECTORY_BLOCK_SIZE];
+		kerr_isco_frequency(oISCO, a + i0, blockSize);
+		std::fill(alpha, alpha + blockSize, ALPHA_MAX);
+		omega_of_a_alpha(omega + i0, alpha, oISCO, blockSize);
+	});
+}
+
+void TrajectorySpline2D::max_orbital_frequency(double omega[], const double a[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double oISCO[TRAJECTORY_BLOCK_SIZE], alpha[TRAJECTORY_BLOCK_SIZE];
+		kerr_isco_frequency(oISCO, a + i0, blockSize);
+		std::fill(alpha, alpha + blockSize, ALPHA_MIN);
+		omega_of_a_alpha(omega + i0, alpha, oISCO, blockSize);
+	});
+}
+
+void TrajectorySpline2D::max_orbital_radius(double r[], const double a[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double omega[TRAJECTORY_BLOCK_SIZE];
+		min_orbital_frequency(omega, a + i0, blockSize, 1);
+		for(int i = 0; i < blockSize; i++){
+			r[i0 + i] = kerr_geo_radius_circ(a[i0 + i], omega[i]);
+		}
+	});
+}
+
+void TrajectorySpline2D::max_time_before_merger(double t[], const double a[], int n, ExecutionContext context){
+	evaluate_blocks(n, context, [&](int i0, int blockSize){
+		double chi[TRAJECTORY_BLOCK_SIZE];
+		chi_of_spin(chi, a + i0, blockSize);
+		for(int i = 0; i < blockSize; i++){
+			t[i0 + i] = _frequency_domain_splines.evaluate(TIME_FIELD, chi[i], ALPHA_MAX);
+		}
+	});
+}
+
+std::shared_ptr<TrajectorySlice> TrajectorySpline2D::slice(double chi){
+	std::shared_ptr<TrajectorySlice> chiSlice = _slice_cache.find(chi);
+	if(!chiSlice){
+		// two threads that miss on the same chi both build the slice, and the
+		// second insertion replaces the first
+		chiSlice = std::make_shared<TrajectorySlice>(chi, _time_norm_parameter,
+			_frequency_domain_splines.reduce_x(TIME_FIELD, chi), _frequency_domain_splines.reduce_x(PHASE_FIELD, chi), _flux_spline.reduce_x(chi),
+			_time_domain_splines.reduce_x(ALPHA_FIELD, chi), _time_domain_splines.reduce_x(PHASE_TIME_FIELD, chi), _time_domain_splines.reduce_x(FREQUENCY_FIELD, chi));
+		_slice_cache.insert(chi, chiSlice);
+	}
+	return chiSlice;
+}
+
+std::shared_ptr<TrajectorySlice> TrajectorySpline2D::slice_of_a(double a){
+	return slice(chi_of_spin(a));
+}
+
+// TrajectorySlice class
+
+TrajectorySlice::TrajectorySlice(double chi, double time_norm_parameter, CubicSpline time_spline, CubicSpline phase_spline, CubicSpline flux_spline, CubicSpline alpha_of_beta_spline, CubicSpline phase_of_beta_spline, CubicSpline frequency_of_beta_spline):
+	_chi(chi), _a(spin_of_chi(chi)), _time_norm_parameter(time_norm_parameter), _time_spline(time_spline), _phase_spline(phase_spline), _flux_spline(flux_spline), _alpha_of_beta_spline(alpha_of_beta_spline), _phase_of_beta_spline(phase_of_beta_spline), _frequency_of_beta_spline(frequency_of_beta_spline) {
+	// the same powers as the free functions take on every call, so that the
+	// slice reproduces them exactly
+	_oisco = fabs(kerr_isco_frequency(_a));
+	_oisco_third = pow(_oisco, 1./3.);
+	_omega_min_third = pow(OMEGA_MIN, 1./3.);
+	_alpha_scale = _oisco_third - _omega_min_third;
+	_oisco_time_norm = pow(_oisco, -8./3.);
+	_oisco_phase_norm = pow(_oisco, -5./3.);
+}
+
+double TrajectorySlice::getChi(){
+	return _chi;
+}
+
+double TrajectorySlice::getSpin(){
+	return _a;
+}
+
+// normalize_time, normalize_phase and dalpha_domega_of_a_omega at the ISCO frequency of the slice
+
+double TrajectorySlice::normalizeTime(double omega){
+	return pow(fabs(omega), -8./3.) - _oisco_time_norm + 1.e-6;
+}
+
+double TrajectorySlice::normalizePhase(double omega){
+	return pow(fabs(omega), -5./3.) - _oisco_phase_norm + 1.e-6;
+}
+
+double TrajectorySlice::dalphaDomega(double omega){
+	double domega_dalpha = (fabs(_oisco - omega) < 1.e-13) ? 0. : -6.*pow(_alpha_scale*(_oisco_third - pow(omega, 1./3.)), 0.5)*pow(omega, 2./3.);
+	return 1./domega_dalpha;
+}
+
+// the methods below mirror the TrajectorySpline2D methods of the same name
+
+double TrajectorySlice::time(double alpha){
+	double omega = omega_of_alpha(alpha);
+	return -_time_spline.evaluate(alpha)*normalizeTime(omega);
+}
+
+double TrajectorySlice::phase(double alpha){
+	double omega = omega_of_alpha(alpha);
+	return -_phase_spline.evaluate(alpha)*normalizePhase(omega);
+}
+
+double TrajectorySlice::flux(double alpha){
+	return _flux_spline.evaluate(alpha)*normalize_energy_flux(omega_of_alpha(alpha));
+}
+
+double TrajectorySlice::flux_norm(double alpha){
+	return _flux_spline.evaluate(alpha);
+}
+
+double TrajectorySlice::orbital_frequency_time_derivative_from_flux(double alpha){
+	double omega = omega_of_alpha(alpha);
+	return -(1./kerr_geo_denergy_domega_circ(_a, omega))*_flux_spline.evaluate(alpha)*normalize_energy_flux(omega);
+}
+
+double TrajectorySlice::time_of_alpha_omega_derivative(double alpha){
+	double omega = omega_of_alpha(alpha);
+	return -(kerr_geo_denergy_domega_circ(_a, omega))/_flux_spline.evaluate(alpha)/normalize_energy_flux(omega);
+}
+
+double TrajectorySlice::time_of_omega(double omega){
+	return time(alpha_of_omega(omega));
+}
+
+double TrajectorySlice::time_of_omega_derivative(double omega){
+	double alpha = alpha_of_omega(omega);
+	return _time_spline.evaluate(alpha)*normalize_time_domega(omega) + dalphaDomega(omega)*_time_spline.derivative(alpha)*normalizeTime(omega);
+}
+
+double TrajectorySlice::phase_of_omega(double omega){
+	return phase(alpha_of_omega(omega));
+}
+
+double TrajectorySlice::phase_of_omega_derivative(double omega){
+	double alpha = alpha_of_omega(omega);
+	return _phase_spline.evaluate(alpha)*normalize_phase_domega(omega) + dalphaDomega(omega)*_phase_spline.derivative(alpha)*normalizePhase(omega);
+}
+
+double TrajectorySlice::flux_of_omega(double omega){
+	return _flux_spline.evaluate(alpha_of_omega(omega))*normalize_energy_flux(omega);
+}
+
+double TrajectorySlice::orbital_frequency_time_derivative_from_flux_of_omega(double omega){
+	return -(1./kerr_geo_denergy_domega_circ(_a, omega))*_flux_spline.evaluate(alpha_of_omega(omega))*normalize_energy_flux(omega);
+}
+
+// the array versions take alpha in blocks
+
+void TrajectorySlice::time(double t[], const double alpha[], int n){
+	double omega[TRAJECTORY_BLOCK_SIZE], norm[TRAJECTORY_BLOCK_SIZE];
+	for(int i0 = 0; i0 < n; i0 += TRAJECTORY_BLOCK_SIZE){
+		int blockSize = std::min(TRAJECTORY_BLOCK_SIZE, n - i0);
+		omega_of_a_alpha(omega, alpha + i0, _oisco, blockSize);
+		normalize_time(norm, omega, _oisco, blockSize);
+		_time_spline.evaluate(t + i0, alpha + i0, blockSize);
+		for(int i = 0; i < blockSize; i++){
+			t[i0 + i] = -t[i0 + i]*norm[i];
+		}
+	}
+}
+
+void TrajectorySlice::phase(double phase[], const double alpha[], int n){
+	double omega[TRAJECTORY_BLOCK_SIZE], norm[TRAJECTORY_BLOCK_SIZE];
+	for(int i0 = 0; i0 < n; i0 += TRAJECTORY_BLOCK_SIZE){
+		int blockSize = std::min(TRAJECTORY_BLOCK_SIZE, n - i0);
+		omega_of_a_alpha(omega, alpha + i0, _oisco, blockSize);
+		normalize_phase(norm, omega, _oisco, blockSize);
+		_phase_spline.evaluate(phase + i0, alpha + i0, blockSize);
+		for(int i = 0; i < blockSize; i++){
+			phase[i0 + i] = -phase[i0 + i]*norm[i];
+		}
+	}
+}
+
+void TrajectorySlice::time_of_alpha_omega_derivative(double dtdo[], const double alpha[], int n){
+	double omega[TRAJECTORY_BLOCK_SIZE], dEdo[TRAJECTORY_BLOCK_SIZE], norm[TRAJECTORY_BLOCK_SIZE];
+	for(int i0 = 0; i0 < n; i0 += TRAJECTORY_BLOCK_SIZE){
+		int blockSize = std::min(TRAJECTORY_BLOCK_SIZE, n - i0);
+		omega_of_a_alpha(omega, alpha + i0, _oisco, blockSize);
+		kerr_geo_denergy_domega_circ(dEdo, _a, omega, blockSize);
+		normalize_energy_flux(norm, omega, blockSize);
+		_flux_spline.evaluate(dtdo + i0, alpha + i0, blockSize);
+		for(int i = 0; i < blockSize; i++){
+			dtdo[i0 + i] = -dEdo[i]/dtdo[i0 + i]/norm[i];
+		}
+	}
+}
+
+// Time domain
+
+double TrajectorySlice::orbital_alpha(double t){
+	return _alpha_of_beta_spline.evaluate(beta_of_time(t, _time_norm_parameter));
+}
+
+double TrajectorySlice::orbital_alpha_derivative(double t){
+	return _alpha_of_beta_spline.derivative(beta_of_time(t, _time_norm_parameter))*dbeta_dtime(t, _time_norm_parameter);
+}
+
+double TrajectorySlice::phase_of_time(double t){
+	return phase_of_phase_norm_2(_phase_of_beta_spline.evaluate(beta_of_time(t, _time_norm_parameter)));
+}
+
+double TrajectorySlice::phase_of_time_derivative(double t){
+	double phase2 = _phase_of_beta_spline.derivative(beta_of_time(t, _time_norm_parameter));
+	return phase2*dbeta_dtime(t, _time_norm_parameter)*dphase_dphase_norm_2(phase2);
+}
+
+void TrajectorySlice::orbital_alpha_phase_of_time(double &alpha, double &phase, double t){
+	double beta = beta_of_time(t, _time_norm_parameter);
+	alpha = _alpha_of_beta_spline.evaluate(beta);
+	phase = phase_of_phase_norm_2(_phase_of_beta_spline.evaluate(beta));
+}
+
+double TrajectorySlice::orbital_frequency(double t){
+	return _frequency_of_beta_spline.evaluate(beta_of_time(t, _time_norm_parameter));
+}
+
+double TrajectorySlice::orbital_frequency_derivative(double t){
+	return _frequency_of_beta_spline.derivative(beta_of_time(t, _time_norm_parameter))*dbeta_dtime(t, _time_norm_parameter);
+}
+
+// Utility
+
+double TrajectorySlice::alpha_of_omega(double omega){
+	if(fabs(_oisco - omega) < 1.e-13){return 0.;}
+	return pow(fabs(_oisco_third - pow(omega, 1./3.))/_alpha_scale, 0.5);
+}
+
+void TrajectorySlice::alpha_of_omega(double alpha[], const double omega[], int n){
+	alpha_of_a_omega(alpha, omega, _oisco, n);
+}
+
+double TrajectorySlice::omega_of_alpha(double alpha){
+	return pow(_oisco_third - pow(alpha, 2.)*_alpha_scale, 3.);
+}
+
+double TrajectorySlice::orbital_frequency_isco(){
+	return _oisco;
+}
+
+double TrajectorySlice::min_orbital_frequency(){
+	return omega_of_alpha(ALPHA_MAX);
+}
+
+double TrajectorySlice::max_orbital_frequency(){
+	return omega_of_alpha(ALPHA_MIN);
+}
+
+double TrajectorySlice::max_orbital_radius(){
+	return kerr_geo_radius_circ(_a, omega_of_alpha(ALPHA_MAX));
+}
+
+double TrajectorySlice::max_time_before_merger(){
+	return _time_spline.evaluate(ALPHA_MAX);
+}
+
+Vector TrajectorySlice::alphaNodes(){
+	return _time_spline.nodes();
+}
+
+Vector TrajectorySlice::timeNodes(){
+	// t decreases with beta
+	Vector beta = _alpha_of_beta_spline.nodes();
+	Vector t(beta.size());
+	for(size_t i = 0; i < beta.size(); i++){
+		t[beta.size() - 1 - i] = time_of_beta(beta[i], _time_norm_parameter);
+	}
+	return t;
+}
+
+// TrajectoryChebyshev class
+
+static double max_magnitude(std::function<double(double)> f, const Vector &x){
+	double fmax = 0.;
+	for(size_t i = 0; i < x.size(); i++){
+		fmax = std::max(fmax, fabs(f(x[i])));
+	}
+	return fmax;
+}
+
+TrajectoryChebyshev::TrajectoryChebyshev(TrajectorySpline2D &traj, double chi, double tolerance): _chi(chi), _tolerance(tolerance), _slice(traj.slice(chi)) {
+	TrajectorySlice &slice = *_slice;
+	Vector alpha = slice.alphaNodes();
+	Vector t = slice.timeNodes();
+
+	std::function<double(double)> f = [&slice](double x){ return slice.time(x); };
+	_time = ChebyshevExpansion(f, alpha, tolerance*max_magnitude(f, alpha));
+	f = [&slice](double x){ return slice.phase(x); };
+	_phase = ChebyshevExpansion(f, alpha, tolerance*max_magnitude(f, alpha));
+	f = [&slice](double x){ return slice.orbital_alpha(x); };
+	_orbital_alpha = ChebyshevExpansion(f, t, tolerance*max_magnitude(f, t));
+	f = [&slice](double x){ return slice.phase_of_time(x); };
+	_phase_of_time = ChebyshevExpansion(f, t, tolerance*max_magnitude(f, t));
+}
+
+double TrajectoryChebyshev::getChi(){
+	return _chi;
+}
+
+double TrajectoryChebyshev::getTolerance(){
+	return _tolerance;
+}
+
+double TrajectoryChebyshev::time(double alpha){
+	if(alpha < _time.xmin() || alpha > _time.xmax()){
+		return _slice->time(alpha);
+	}
+	return _time.evaluate(alpha);
+}
+
+double TrajectoryChebyshev::phase(double alpha){
+	if(alpha < _phase.xmin() || alpha > _phase.xmax()){
+		return _slice->phase(alpha);
+	}
+	return _phase.evaluate(alpha);
+}
+
+double TrajectoryChebyshev::orbital_alpha(double t){
+	if(t < _orbital_alpha.xmin() || t > _orbital_alpha.xmax()){
+		return _slice->orbital_alpha(t);
+	}
+	return _orbital_alpha.evaluate(t);
+}
+
+double TrajectoryChebyshev::phase_of_time(double t){
+	if(t < _phase_of_time.xmin() || t > _phase_of_time.xmax()){
+		return _slice->phase_of_time(t);
+	}
+	return _phase_of_time.evaluate(t);
+}
+
+void TrajectoryChebyshev::orbital_alpha_phase_of_time(double &alpha, double &phase, double t){
+	if(t < _orbital_alpha.xmin() || t > _orbital_alpha.xmax()){
+		_slice->orbital_alpha_phase_of_time(alpha, phase, t);
+		return;
+	}
+	alpha = _orbital_alpha.evaluate(t);
+	phase = _phase_of_time.evaluate(t);
+}
+
+double TrajectoryChebyshev::timeError(){
+	return _time.maxError();
+}
+
+double TrajectoryChebyshev::phaseError(){
+	return _phase.maxError();
+}
+
+double TrajectoryChebyshev::orbitalAlphaError(){
+	return _orbital_alpha.maxError();
+}
+
+double TrajectoryChebyshev::phaseOfTimeError(){
+	return _phase_of_time.maxError();
+}
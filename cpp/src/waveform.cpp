@@ -131,61 +131,77 @@ int WaveformContainer::getSize(){
   return _size;
 }
 
+MultirateWaveformContainer::MultirateWaveformContainer(const MultirateSampling &sampling): WaveformContainer(sampling.getSize()), _sampling(sampling) {}
+
+MultirateWaveformContainer::MultirateWaveformContainer(double *plus_ptr, double *cross_ptr, const MultirateSampling &sampling): WaveformContainer(plus_ptr, cross_ptr, sampling.getSize()), _sampling(sampling) {}
+
+const MultirateSampling& MultirateWaveformContainer::getSampling() const{
+  return _sampling;
+}
+
+void MultirateWaveformContainer::resample(WaveformContainer &h){
+  _sampling.resample(h.getPlusPointer(), _plus);
+  _sampling.resample(h.getCrossPointer(), _cross);
+}
+
 WaveformHarmonicGenerator::WaveformHarmonicGenerator(HarmonicAmplitudes &Alm, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts): _Alm(Alm), _mode_selector(Alm, hOpts), _opts(wOpts) {}
 
-WaveformContainer WaveformHarmonicGenerator::computeWaveformHarmonic(int l, int m, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
+WaveformContainer WaveformHarmonicGenerator::computeWaveformHarmonic(int l, int m, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
 	WaveformContainer h(inspiral.getSize());
 	computeWaveformHarmonic(h, l, m, inspiral, theta, phi, opts);
 	return h;
 }
-WaveformContainer WaveformHarmonicGenerator::computeWaveformHarmonics(int l[], int m[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
+WaveformContainer WaveformHarmonicGenerator::computeWaveformHarmonics(int l[], int m[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
 	WaveformContainer h(inspiral.getSize());
 	computeWaveformHarmonics(h, l, m, modeNum, inspiral, theta, phi, opts);
 	return h;
 }
 
-void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, InspiralContainer &inspiral, double theta, double phi){
+void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, const InspiralContainer &inspiral, double theta, double phi){
 	computeWaveformHarmonics(h, inspiral, theta, phi, _opts);
 }
-void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, InspiralContainer &inspiral, double theta, double phi, HarmonicOptions hOpts){
+void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, const InspiralContainer &inspiral, double theta, double phi, HarmonicOptions hOpts){
 	computeWaveformHarmonics(h, inspiral, theta, phi, hOpts, _opts);
 }
-void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions wOpts){
+void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions wOpts){
 	computeWaveformHarmonics(h, inspiral, theta, phi, getHarmonicOptions());
 }
-void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, InspiralContainer &inspiral, double theta, double phi, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts){
+void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, const InspiralContainer &inspiral, double theta, double phi, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts){
 	HarmonicModeContainer modes = _mode_selector.selectModes(inspiral, theta, hOpts);
 	computeWaveformHarmonics(h, modes.lmodes.data(), modes.mmodes.data(), modes.plusY.data(), modes.crossY.data(), modes.lmodes.size(), inspiral, theta, phi, wOpts);
 }
 
 
-void WaveformHarmonicGenerator::computeWaveformHarmonic(WaveformContainer &h, int l, int m, InspiralContainer &inspiral, double theta, double phi){
+void WaveformHarmonicGenerator::computeWaveformHarmonic(WaveformContainer &h, int l, int m, const InspiralContainer &inspiral, double theta, double phi){
 	computeWaveformHarmonic(h, l, m, inspiral, theta, phi, _opts);
 }
-void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, double theta, double phi){
+void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, double theta, double phi){
 	computeWaveformHarmonics(h, l, m, modeNum, inspiral, theta, phi, _opts);
 }
-void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, double theta, double phi){
+void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, double theta, double phi){
 	computeWaveformHarmonics(h, l, m, plusY, crossY, modeNum, inspiral, theta, phi, _opts);
 }
 
-void WaveformHarmonicGenerator::computeWaveformHarmonic(WaveformContainer &h, int l, int m, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){    
+void WaveformHarmonicGenerator::computeWaveformHarmonic(WaveformContainer &h, int l, int m, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){    
     double sYlm = spin_weighted_spherical_harmonic(-2, l, m, theta);
     double sYlmMinus = spin_weighted_spherical_harmonic(2, l, m, theta);
     double mphi_mod_2pi = fmod(m*phi, 2.*M_PI);
     double chi = chi_of_spin(inspiral.getSpin());
+    std::shared_ptr<HarmonicSlice> chiSlice = _Alm.slice(chi);
+    HarmonicSpline* Alm = chiSlice->getPointer(l, m);
     double plusY = (sYlm + pow(-1, l + m)*sYlmMinus);
     double crossY = (sYlm - pow(-1, l + m)*sYlmMinus);
 
     int imax = inspiral.getSize();
 
-    #pragma omp parallel num_threads(opts.num_threads)
+    ThreadLease lease(opts.num_threads);
+    #pragma omp parallel num_threads(lease.threads())
     {
 		double amp, modePhase, Phi, hplus, hcross;
         #pragma omp for
         for(int i = 0; i < imax; i++){
-            amp = _Alm.amplitude(l, m, chi, inspiral.getAlpha(i));
-            modePhase = _Alm.phase(l, m, chi, inspiral.getAlpha(i));
+            amp = Alm->amplitude(inspiral.getAlpha(i));
+            modePhase = Alm->phase(inspiral.getAlpha(i));
             Phi = modePhase - fmod(m*inspiral.getPhase(i), 2.*M_PI) + mphi_mod_2pi;
             hplus = amp*plusY*std::cos(Phi);
 			      hcross = -amp*crossY*std::sin(Phi);
@@ -194,7 +210,7 @@ void WaveformHarmonicGenerator::computeWaveformHarmonic(WaveformContainer &h, in
     }
 }
 
-void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
+void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
   double plusY[modeNum];
   double crossY[modeNum];
   double sYlm, sYlmMinus;
@@ -222,7 +238,7 @@ void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, i
   computeWaveformHarmonics(h, l, m, plusY, crossY, modeNum, inspiral, theta, phi, opts);
 }
 
-void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
+void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
   double plusY[modeNum];
   double crossY[modeNum];
   double sYlm, sYlmMinus;
@@ -250,62 +266,79 @@ void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformHarmonicsContai
   computeWaveformHarmonics(h, l, m, plusY, crossY, modeNum, inspiral, theta, phi, opts);
 }
 
-void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
+void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
     double mphi_mod_2pi[modeNum];
-    HarmonicSpline2D* Alms[modeNum];
+    HarmonicSpline* Alms[modeNum];
     double twopi = 2.*M_PI;
 
+    // chi is fixed along the inspiral, so the modes are evaluated on their 1D
+    // splines in alpha, which the harmonics cache across calls with the same spin
+    double chi = chi_of_spin(inspiral.getSpin());
+    std::shared_ptr<HarmonicSlice> chiSlice = _Alm.slice(chi);
+
     // first compute mode-dependent but not time-step dependent information and store
     for(int i = 0; i < modeNum; i++){
       mphi_mod_2pi[i] = fmod(m[i]*phi, twopi);
-      Alms[i] = _Alm.getPointer(l[i], m[i]);
+      Alms[i] = chiSlice->getPointer(l[i], m[i]);
     }
-    double chi = chi_of_spin(inspiral.getSpin());
 
     int imax = inspiral.getSize();
-    // for some reason creating arrays of this size was causing issues with OpenMP
-    // minimal internet research suggests that OpenMP allocates arrays on the stack
-    // and large arrays can lead to crashes. std::vector seems to work better here
-    Vector hplus(modeNum*imax);
-    Vector hcross(modeNum*imax);
 
-    #pragma omp parallel num_threads(opts.num_threads)
+    // the harmonics are evaluated in blocks of time samples using the batched spline API.
+    // Each thread owns whole blocks and adds the modes into the waveform in mode
+    // order, so no per-mode storage or atomic updates are needed and the sum is
+    // the same as adding the modes one at a time
+    const double* alpha = inspiral.getAlpha().data();
+    const double* phase = inspiral.getPhase().data();
+    double* plus = h.getPlusPointer();
+    double* cross = h.getCrossPointer();
+    int blockNum = (imax + WAVEFORM_BLOCK_SIZE - 1)/WAVEFORM_BLOCK_SIZE;
+
+    ThreadLease lease(opts.num_threads);
+    #pragma omp parallel num_threads(lease.threads())
     {
-      int i, j;
-      double amp, modePhase, Phi;
-      // first we calculate all of the mode data
-      #pragma omp for collapse(2) schedule(static)
-      for(j = 0; j < modeNum; j++){
-        for(i = 0; i < imax; i++){
-          amp = Alms[j]->amplitude(chi, inspiral.getAlpha(i));
-          modePhase = Alms[j]->phase(chi, inspiral.getAlpha(i));
-          Phi = modePhase - fmod(m[j]*inspiral.getPhase(i), twopi) + mphi_mod_2pi[j];
-          hplus[j + i*modeNum] = amp*plusY[j]*std::cos(Phi);
-          hcross[j + i*modeNum] = -amp*crossY[j]*std::sin(Phi);
-        }
-      }
-
-      // we then sum over the data and have it stored in the waveform container
+      int i, j, b, k, i0, blockSize;
+      double amp[WAVEFORM_BLOCK_SIZE], modePhase[WAVEFORM_BLOCK_SIZE], Phi;
+      double hplus[WAVEFORM_BLOCK_SIZE], hcross[WAVEFORM_BLOCK_SIZE];
       #pragma omp for schedule(static)
-      for(int i = 0; i < imax; i++){
-        for(int j = 0; j < modeNum; j++){
-          h.addTimeStep(i, hplus[j + i*modeNum], hcross[j + i*modeNum]);
+      for(b = 0; b < blockNum; b++){
+        i0 = b*WAVEFORM_BLOCK_SIZE;
+        blockSize = std::min(WAVEFORM_BLOCK_SIZE, imax - i0);
+        for(j = 0; j < modeNum; j++){
+          Alms[j]->amplitude(amp, &alpha[i0], blockSize);
+          Alms[j]->phase(modePhase, &alpha[i0], blockSize);
+          for(k = 0; k < blockSize; k++){
+            i = i0 + k;
+            Phi = modePhase[k] - fmod_2pi(m[j]*phase[i]) + mphi_mod_2pi[j];
+            hplus[k] = amp[k]*plusY[j]*std::cos(Phi);
+            hcross[k] = -amp[k]*crossY[j]*std::sin(Phi);
+          }
+          // the terms are added in a separate pass so that they are rounded
+          // before the sum, as they were when the modes were summed afterwards
+          for(k = 0; k < blockSize; k++){
+            plus[i0 + k] += hplus[k];
+            cross[i0 + k] += hcross[k];
+          }
         }
       }
     }
 }
 
-void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
+void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
     double mphi_mod_2pi[modeNum];
-    HarmonicSpline2D* Alms[modeNum];
+    HarmonicSpline* Alms[modeNum];
     double twopi = 2.*M_PI;
 
+    // chi is fixed along the inspiral, so the modes are evaluated on their 1D
+    // splines in alpha, which the harmonics cache across calls with the same spin
+    double chi = chi_of_spin(inspiral.getSpin());
+    std::shared_ptr<HarmonicSlice> chiSlice = _Alm.slice(chi);
+
     // first compute mode-dependent but not time-step dependent information and store
     for(int i = 0; i < modeNum; i++){
       mphi_mod_2pi[i] = fmod(m[i]*phi, twopi);
-      Alms[i] = _Alm.getPointer(l[i], m[i]);
+      Alms[i] = chiSlice->getPointer(l[i], m[i]);
     }
-    double chi = chi_of_spin(inspiral.getSpin());
 
     int imax = inspiral.getSize();
     // for some reason creating arrays of this size was causing issues with OpenMP
@@ -314,21 +347,31 @@ void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformHarmonicsContai
     // Vector hplus(modeNum*imax);
     // Vector hcross(modeNum*imax);
 
-    #pragma omp parallel num_threads(opts.num_threads)
+    const double* alpha = inspiral.getAlpha().data();
+    const double* phase = inspiral.getPhase().data();
+    int blockNum = (imax + WAVEFORM_BLOCK_SIZE - 1)/WAVEFORM_BLOCK_SIZE;
+
+    ThreadLease lease(opts.num_threads);
+    #pragma omp parallel num_threads(lease.threads())
     {
-      int i, j;
-      double amp, modePhase, Phi;
+      int i, j, b, k, i0, blockSize;
+      double amp[WAVEFORM_BLOCK_SIZE], modePhase[WAVEFORM_BLOCK_SIZE], Phi;
       double hplus, hcross;
       // first we calculate all of the mode data
       #pragma omp for collapse(2) schedule(static)
       for(j = 0; j < modeNum; j++){
-        for(i = 0; i < imax; i++){
-          amp = Alms[j]->amplitude(chi, inspiral.getAlpha(i));
-          modePhase = Alms[j]->phase(chi, inspiral.getAlpha(i));
-          Phi = modePhase - fmod(m[j]*inspiral.getPhase(i), twopi) + mphi_mod_2pi[j];
-          hplus = amp*plusY[j]*std::cos(Phi);
-          hcross = -amp*crossY[j]*std::sin(Phi);
-          h.setTimeStep(j, i, hplus, hcross);
+        for(b = 0; b < blockNum; b++){
+          i0 = b*WAVEFORM_BLOCK_SIZE;
+          blockSize = std::min(WAVEFORM_BLOCK_SIZE, imax - i0);
+          Alms[j]->amplitude(amp, &alpha[i0], blockSize);
+          Alms[j]->phase(modePhase, &alpha[i0], blockSize);
+          for(k = 0; k < blockSize; k++){
+            i = i0 + k;
+            Phi = modePhase[k] - fmod_2pi(m[j]*phase[i]) + mphi_mod_2pi[j];
+            hplus = amp[k]*plusY[j]*std::cos(Phi);
+            hcross = -amp[k]*crossY[j]*std::sin(Phi);
+            h.setTimeStep(j, i, hplus, hcross);
+          }
         }
       }
 
@@ -342,7 +385,7 @@ void WaveformHarmonicGenerator::computeWaveformHarmonics(WaveformHarmonicsContai
     }
 }
 
-void WaveformHarmonicGenerator::computeWaveformHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
+void WaveformHarmonicGenerator::computeWaveformHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
   double plusY[modeNum];
   double crossY[modeNum];
   double sYlm, sYlmMinus;
@@ -357,14 +400,18 @@ void WaveformHarmonicGenerator::computeWaveformHarmonicsPhaseAmplitude(WaveformH
   computeWaveformHarmonicsPhaseAmplitude(h, l, m, plusY, crossY, modeNum, inspiral, theta, phi, opts);
 }
 
-void WaveformHarmonicGenerator::computeWaveformHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
-    HarmonicSpline2D* Alms[modeNum];
+void WaveformHarmonicGenerator::computeWaveformHarmonicsPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], double plusY[], double crossY[], int modeNum, const InspiralContainer &inspiral, double theta, double phi, WaveformHarmonicOptions opts){
+    HarmonicSpline* Alms[modeNum];
+
+    // chi is fixed along the inspiral, so the modes are evaluated on their 1D
+    // splines in alpha, which the harmonics cache across calls with the same spin
+    double chi = chi_of_spin(inspiral.getSpin());
+    std::shared_ptr<HarmonicSlice> chiSlice = _Alm.slice(chi);
 
     // first compute mode-dependent but not time-step dependent information and store
     for(int i = 0; i < modeNum; i++){
-      Alms[i] = _Alm.getPointer(l[i], abs(m[i]));
+      Alms[i] = chiSlice->getPointer(l[i], abs(m[i]));
     }
-    double chi = chi_of_spin(inspiral.getSpin());
 
     int imax = inspiral.getSize();
     // for some reason creating arrays of this size was causing issues with OpenMP
@@ -373,23 +420,33 @@ void WaveformHarmonicGenerator::computeWaveformHarmonicsPhaseAmplitude(WaveformH
     // Vector ampVec(modeNum*imax);
     // Vector phaseVec(modeNum*imax);
 
-    #pragma omp parallel num_threads(opts.num_threads)
+    const double* alpha = inspiral.getAlpha().data();
+    const double* phase = inspiral.getPhase().data();
+    int blockNum = (imax + WAVEFORM_BLOCK_SIZE - 1)/WAVEFORM_BLOCK_SIZE;
+
+    ThreadLease lease(opts.num_threads);
+    #pragma omp parallel num_threads(lease.threads())
     {
-      int i, j;
-      double amp, modePhase, Phi, PhiNoShift;
+      int i, j, b, k, i0, blockSize;
+      double amp[WAVEFORM_BLOCK_SIZE], modePhase[WAVEFORM_BLOCK_SIZE], Phi;
       // first we calculate all of the mode data
       #pragma omp for collapse(2) schedule(static)
       for(j = 0; j < modeNum; j++){
-        for(i = 0; i < imax; i++){
+        for(b = 0; b < blockNum; b++){
           int am = abs(m[j]);
-          amp = Alms[j]->amplitude(chi, inspiral.getAlpha(i));
-          modePhase = Alms[j]->phase(chi, inspiral.getAlpha(i));
-          Phi = modePhase - am*(inspiral.getPhase(i) - phi);
-
-          // positive m-modes
-          h.setTimeStep(2*j, i, amp*plusY[j], Phi);
-          // negative m-modes
-          h.setTimeStep(2*j + 1, i, amp*crossY[j], - Phi - l[j]*M_PI);
+          i0 = b*WAVEFORM_BLOCK_SIZE;
+          blockSize = std::min(WAVEFORM_BLOCK_SIZE, imax - i0);
+          Alms[j]->amplitude(amp, &alpha[i0], blockSize);
+          Alms[j]->phase(modePhase, &alpha[i0], blockSize);
+          for(k = 0; k < blockSize; k++){
+            i = i0 + k;
+            Phi = modePhase[k] - am*(phase[i] - phi);
+
+            // positive m-modes
+            h.setTimeStep(2*j, i, amp[k]*plusY[j], Phi);
+            // negative m-modes
+            h.setTimeStep(2*j + 1, i, amp[k]*crossY[j], - Phi - l[j]*M_PI);
+          }
         }
       }
 
@@ -407,11 +464,11 @@ HarmonicSelector& WaveformHarmonicGenerator::getModeSelector(){
 	return _mode_selector;
 }
 
-HarmonicModeContainer WaveformHarmonicGenerator::selectModes(InspiralContainer &inspiral, double theta){
+HarmonicModeContainer WaveformHarmonicGenerator::selectModes(const InspiralContainer &inspiral, double theta){
 	return _mode_selector.selectModes(inspiral, theta);
 }
 
-HarmonicModeContainer WaveformHarmonicGenerator::selectModes(InspiralContainer &inspiral, double theta, HarmonicOptions opts){
+HarmonicModeContainer WaveformHarmonicGenerator::selectModes(const InspiralContainer &inspiral, double theta, HarmonicOptions opts){
 	return _mode_selector.selectModes(inspiral, theta, opts);
 }
 
@@ -456,6 +513,7 @@ void WaveformGenerator::computeWaveform(WaveformContainer &h, double M, double m
 }
 
 void WaveformGenerator::computeWaveform(WaveformContainer &h, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, double dt, double T, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts){
+	ThreadLease lease(wOpts.num_threads);
 	double theta, phi;
 	sourceAngles(theta, phi, qS, phiS, qK, phiK);
 	dt = convertTime(dt, M);
@@ -466,11 +524,25 @@ void WaveformGenerator::computeWaveform(WaveformContainer &h, double M, double m
 	// omp_set_num_threads(16);
 	StopWatch watch;
 	// watch.start();
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, wOpts.num_threads);
+	if(wOpts.segment_steps > 0){
+		// the modes are selected from the ends of the inspiral, and the waveform
+		// is summed one segment at a time, so that the memory used scales with
+		// the segment and not with the duration of the signal
+		InspiralSegments segments = _inspiralGen.computeInspiralSegments(a, mu/M, r0, dt, T, wOpts.segment_steps, wOpts.num_threads);
+		HarmonicModeContainer modes = _mode_selector.selectModes(segments.getEndpoints(), theta, hOpts);
+		InspiralContainer segment(0);
+		while(segments.next(segment)){
+			int start = segment.getStartStep();
+			WaveformContainer hSegment(h.getPlusPointer() + start, h.getCrossPointer() + start, segment.getSize());
+			computeWaveformHarmonics(hSegment, modes.lmodes.data(), modes.mmodes.data(), modes.plusY.data(), modes.crossY.data(), modes.lmodes.size(), segment, theta, phi - Phi_phi0, wOpts);
+		}
+	}else{
+		std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, wOpts.num_threads, wOpts.phase_tolerance);
+		computeWaveformHarmonics(h, *sharedInspiral, theta, phi - Phi_phi0, hOpts, wOpts);
+	}
 	// watch.stop();
 	// watch.print();
 	// watch.reset();
-	computeWaveformHarmonics(h, inspiral, theta, phi - Phi_phi0, hOpts, wOpts);
 	
 	double rescaleRe, rescaleIm;
 	rescaleRe = std::real(wOpts.rescale);
@@ -479,7 +551,7 @@ void WaveformGenerator::computeWaveform(WaveformContainer &h, double M, double m
 	// else, then we get a mixing of the plus and cross polarizations that gives us new polarization amplitudes
 	// watch.start();
 	int imax = h.getSize();
-	#pragma omp parallel num_threads(wOpts.num_threads)
+	#pragma omp parallel num_threads(lease.threads())
 	{
 		// total_td = omp_get_num_threads();
 		int i;
@@ -498,6 +570,7 @@ void WaveformGenerator::computeWaveform(WaveformContainer &h, double M, double m
 }
 
 void WaveformGenerator::computeWaveform(WaveformContainer &h, int l[], int m[], int modeNum, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, double dt, double T, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts){
+	ThreadLease lease(wOpts.num_threads);
   double theta, phi;
 	sourceAngles(theta, phi, qS, phiS, qK, phiK);
 	dt = convertTime(dt, M);
@@ -508,11 +581,21 @@ void WaveformGenerator::computeWaveform(WaveformContainer &h, int l[], int m[],
 	// omp_set_num_threads(16);
 	// StopWatch watch;
 	// watch.start();
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, wOpts.num_threads);
+	if(wOpts.segment_steps > 0){
+		InspiralSegments segments = _inspiralGen.computeInspiralSegments(a, mu/M, r0, dt, T, wOpts.segment_steps, wOpts.num_threads);
+		InspiralContainer segment(0);
+		while(segments.next(segment)){
+			int start = segment.getStartStep();
+			WaveformContainer hSegment(h.getPlusPointer() + start, h.getCrossPointer() + start, segment.getSize());
+			computeWaveformHarmonics(hSegment, l, m, modeNum, segment, theta, phi - Phi_phi0, wOpts);
+		}
+	}else{
+		std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, wOpts.num_threads, wOpts.phase_tolerance);
+		computeWaveformHarmonics(h, l, m, modeNum, *sharedInspiral, theta, phi - Phi_phi0, wOpts);
+	}
 	// watch.stop();
 	// watch.print();
 	// watch.reset();
-	computeWaveformHarmonics(h, l, m, modeNum, inspiral, theta, phi - Phi_phi0, wOpts);
 	
 	double rescaleRe, rescaleIm;
 	rescaleRe = std::real(wOpts.rescale);
@@ -523,7 +606,7 @@ void WaveformGenerator::computeWaveform(WaveformContainer &h, int l[], int m[],
 
 	// watch.start();
 	int imax = h.getSize();
-	#pragma omp parallel num_threads(wOpts.num_threads)
+	#pragma omp parallel num_threads(lease.threads())
 	{
 		// total_td = omp_get_num_threads();
 		int i;
@@ -542,6 +625,7 @@ void WaveformGenerator::computeWaveform(WaveformContainer &h, int l[], int m[],
 }
 
 void WaveformGenerator::computeWaveform(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, double dt, double T, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts){
+	ThreadLease lease(wOpts.num_threads);
   double theta, phi;
 	sourceAngles(theta, phi, qS, phiS, qK, phiK);
 	dt = convertTime(dt, M);
@@ -552,7 +636,8 @@ void WaveformGenerator::computeWaveform(WaveformHarmonicsContainer &h, int l[],
 	// omp_set_num_threads(16);
 	// StopWatch watch;
 	// watch.start();
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, wOpts.num_threads);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, wOpts.num_threads, wOpts.phase_tolerance);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	// watch.stop();
 	// watch.print();
 	// watch.reset();
@@ -568,7 +653,7 @@ void WaveformGenerator::computeWaveform(WaveformHarmonicsContainer &h, int l[],
 	// watch.start();
 	int timeMax = h.getTimeSize();
   int modeMax = h.getModeSize();
-	#pragma omp parallel num_threads(wOpts.num_threads)
+	#pragma omp parallel num_threads(lease.threads())
 	{
 		// total_td = omp_get_num_threads();
 		int i, j;
@@ -588,6 +673,7 @@ void WaveformGenerator::computeWaveform(WaveformHarmonicsContainer &h, int l[],
 }
 
 void WaveformGenerator::computeWaveformPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, double dt, double T, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts){
+	ThreadLease lease(wOpts.num_threads);
   double theta, phi;
 	sourceAngles(theta, phi, qS, phiS, qK, phiK);
 	dt = convertTime(dt, M);
@@ -598,7 +684,8 @@ void WaveformGenerator::computeWaveformPhaseAmplitude(WaveformHarmonicsContainer
 	// omp_set_num_threads(16);
 	// StopWatch watch;
 	// watch.start();
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, wOpts.num_threads);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, wOpts.num_threads, wOpts.phase_tolerance);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	// watch.stop();
 	// watch.print();
 	// watch.reset();
@@ -611,7 +698,7 @@ void WaveformGenerator::computeWaveformPhaseAmplitude(WaveformHarmonicsContainer
 	// watch.start();
 	int timeMax = h.getTimeSize();
   int modeMax = h.getModeSize();
-	#pragma omp parallel num_threads(wOpts.num_threads)
+	#pragma omp parallel num_threads(lease.threads())
 	{
 		int i, j;
 		double amp, phase;
@@ -626,6 +713,71 @@ void WaveformGenerator::computeWaveformPhaseAmplitude(WaveformHarmonicsContainer
 	}
 }
 
+MultirateSampling WaveformGenerator::computeMultirateSampling(double M, double mu, double a, double r0, double qS, double phiS, double qK, double phiK, double dt, double dt_max, double T, HarmonicOptions hOpts, double samples_per_cycle){
+	double theta, phi;
+	sourceAngles(theta, phi, qS, phiS, qK, phiK);
+	double dtM = convertTime(dt, M);
+	T = convertTime(years_to_seconds(T), M);
+
+	// the sampling follows the highest frequency m*Omega of the modes in the
+	// waveform, which are selected from the ends of the inspiral
+	InspiralSegments segments = _inspiralGen.computeInspiralSegments(a, mu/M, r0, dtM, T, 0, 1);
+	HarmonicModeContainer modes = _mode_selector.selectModes(segments.getEndpoints(), theta, hOpts);
+	int mMax = 1;
+	for(size_t i = 0; i < modes.mmodes.size(); i++){
+		mMax = std::max(mMax, abs(modes.mmodes[i]));
+	}
+	MultirateSampling sampling = _inspiralGen.computeMultirateSampling(a, mu/M, r0, dtM, convertTime(dt_max, M), T, mMax, samples_per_cycle);
+	sampling.setTimeSpacing(dt);
+	return sampling;
+}
+
+void WaveformGenerator::computeWaveform(MultirateWaveformContainer &h, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts){
+	ThreadLease lease(wOpts.num_threads);
+	double theta, phi;
+	sourceAngles(theta, phi, qS, phiS, qK, phiK);
+	wOpts.rescale = polarization(qS, phiS, qK, phiK);
+	wOpts.rescale *= scale_strain_amplitude(mu, dist);
+
+	// the inspiral is sampled in units of M, and the modes are selected from its
+	// first and last samples, which are the ends of the uniform inspiral used by
+	// computeMultirateSampling
+	MultirateSampling sampling = h.getSampling();
+	sampling.setTimeSpacing(convertTime(sampling.getTimeSpacing(), M));
+	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, sampling, wOpts.num_threads);
+	int last = inspiral.getSize() - 1;
+	InspiralContainer endpoints(std::min(inspiral.getSize(), 2));
+	endpoints.setInspiralInitialConditions(a, mu/M, r0, std::max(sampling.getDuration(), sampling.getTimeSpacing()));
+	if(last >= 0){
+		endpoints.setTimeStep(0, inspiral.getAlpha(0), inspiral.getPhase(0));
+	}
+	if(last > 0){
+		endpoints.setTimeStep(1, inspiral.getAlpha(last), inspiral.getPhase(last));
+	}
+	HarmonicModeContainer modes = _mode_selector.selectModes(endpoints, theta, hOpts);
+	computeWaveformHarmonics(h, modes.lmodes.data(), modes.mmodes.data(), modes.plusY.data(), modes.crossY.data(), modes.lmodes.size(), inspiral, theta, phi - Phi_phi0, wOpts);
+
+	double rescaleRe, rescaleIm;
+	rescaleRe = std::real(wOpts.rescale);
+	rescaleIm = std::imag(wOpts.rescale);
+	int imax = h.getSize();
+	#pragma omp parallel num_threads(lease.threads())
+	{
+		int i;
+		double hplus, hcross;
+		#pragma omp for
+		for(i = 0; i < imax; i++){
+			hplus = h.getPlus(i);
+			hcross = h.getCross(i);
+			h.setTimeStep(i, rescaleRe*hplus + rescaleIm*hcross, rescaleRe*hcross - rescaleIm*hplus);
+		}
+	}
+}
+
+InspiralGenerator& WaveformGenerator::getInspiralGenerator(){
+	return _inspiralGen;
+}
+
 HarmonicModeContainer WaveformGenerator::selectModes(double M, double mu, double a, double r0, double qS, double phiS, double qK, double phiK, double Phi_phi0, double dt, double T){
 	return selectModes(M, mu, a, r0, qS, phiS, qK, phiK, Phi_phi0, dt, T, getHarmonicOptions());
 }
@@ -637,7 +789,8 @@ HarmonicModeContainer WaveformGenerator::selectModes(double M, double mu, double
 	WaveformHarmonicOptions wOpts = getWaveformHarmonicOptions();
 
 	dt = T/(opts.max_samples - 1);
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, wOpts.num_threads);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, wOpts.num_threads, wOpts.phase_tolerance);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	return WaveformHarmonicGenerator::selectModes(inspiral, theta, opts);
 }
 
@@ -646,7 +799,8 @@ void WaveformGenerator::computeWaveformSourceFrame(WaveformContainer &h, double
 	T = convertTime(years_to_seconds(T), M);
 	WaveformHarmonicOptions opts = getWaveformHarmonicOptions();
 
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, opts.num_threads);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, opts.num_threads, opts.phase_tolerance);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	computeWaveformHarmonics(h, inspiral, theta, phi - Phi_phi0, opts);
 }
 
@@ -655,7 +809,8 @@ void WaveformGenerator::computeWaveformSourceFrame(WaveformContainer &h, int l[]
 	T = convertTime(years_to_seconds(T), M);
 	WaveformHarmonicOptions opts = getWaveformHarmonicOptions();
 
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, opts.num_threads);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, opts.num_threads, opts.phase_tolerance);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	computeWaveformHarmonics(h, l, m, modeNum, inspiral, theta, phi - Phi_phi0, opts);
 }
 
@@ -664,7 +819,8 @@ void WaveformGenerator::computeWaveformSourceFrame(WaveformHarmonicsContainer &h
 	T = convertTime(years_to_seconds(T), M);
 	WaveformHarmonicOptions opts = getWaveformHarmonicOptions();
 
-	InspiralContainer inspiral = _inspiralGen.computeInspiral(a, mu/M, r0, dt, T, opts.num_threads);
+	std::shared_ptr<const InspiralContainer> sharedInspiral = _inspiralGen.computeInspiralShared(a, mu/M, r0, dt, T, opts.num_threads, opts.phase_tolerance);
+	const InspiralContainer &inspiral = *sharedInspiral;
 	computeWaveformHarmonics(h, l, m, modeNum, inspiral, theta, phi - Phi_phi0, opts);
 }
 
@@ -727,4 +883,4 @@ double years_to_seconds(double years){
 
 double scale_strain_amplitude(double mass1, double distance){
   return mass1/parsecs_to_solar_mass(distance*pow(10., 9));
-}
\ No newline at end of file
+}
@@ -0,0 +1,95 @@
+// Reports the accuracy of the TrajectoryChebyshev expansions against the spline
+// path of TrajectorySpline2D, together with their construction and evaluation
+// times. Errors in alpha are absolute, while errors in the time and the phases
+// are relative to the largest magnitude of each function at that spin.
+// Build from the repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -Icpp/include cpp/tools/chebyshev_accuracy_report.cpp
+//       cpp/src/trajectory.cpp cpp/src/spline.cpp -lgsl -lgslcblas -o chebyshev_accuracy_report
+//
+// and run as ./chebyshev_accuracy_report [trajectory file] [tolerance]
+
+#include "trajectory.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+#define REPORT_SPINS 9
+#define REPORT_SAMPLES 20000
+
+static double sample(int i, int n, double xmin, double xmax){
+	return xmin + (i + 0.5)*(xmax - xmin)/n;
+}
+
+int main(int argc, char *argv[]){
+	std::string trajectory_file = "bhpwave/data/trajectory.txt";
+	double tolerance = TRAJECTORY_CHEBYSHEV_TOLERANCE;
+	if(argc > 1){
+		trajectory_file = argv[1];
+	}
+	if(argc > 2){
+		tolerance = atof(argv[2]);
+	}
+
+	TrajectorySpline2D traj(trajectory_file);
+	printf("Chebyshev expansions (tolerance %.1e) against the spline path\n", tolerance);
+	printf("     a    time       phase      alpha(t)   phase(t)   build (ms)  spline (ns)  Chebyshev (ns)\n");
+	double errorMax[4] = {0., 0., 0., 0.};
+	for(int s = 0; s < REPORT_SPINS; s++){
+		double a = -0.99 + s*(1.98/(REPORT_SPINS - 1));
+		double chi = chi_of_spin(a);
+
+		StopWatch buildWatch;
+		buildWatch.start();
+		TrajectoryChebyshev cheb(traj, chi, tolerance);
+		buildWatch.stop();
+
+		double tmin = traj.time(chi, 1.);
+		double timeScale = 0., phaseScale = 0., phaseOfTimeScale = 0.;
+		for(int i = 0; i < REPORT_SAMPLES; i++){
+			double alpha = sample(i, REPORT_SAMPLES, 0., 1.);
+			double t = sample(i, REPORT_SAMPLES, tmin, 0.);
+			timeScale = std::max(timeScale, fabs(traj.time(chi, alpha)));
+			phaseScale = std::max(phaseScale, fabs(traj.phase(chi, alpha)));
+			phaseOfTimeScale = std::max(phaseOfTimeScale, fabs(traj.phase_of_time(chi, t)));
+		}
+
+		double error[4] = {0., 0., 0., 0.};
+		for(int i = 0; i < REPORT_SAMPLES; i++){
+			double alpha = sample(i, REPORT_SAMPLES, 0., 1.);
+			double t = sample(i, REPORT_SAMPLES, tmin, 0.);
+			error[0] = std::max(error[0], fabs(cheb.time(alpha) - traj.time(chi, alpha))/timeScale);
+			error[1] = std::max(error[1], fabs(cheb.phase(alpha) - traj.phase(chi, alpha))/phaseScale);
+			error[2] = std::max(error[2], fabs(cheb.orbital_alpha(t) - traj.orbital_alpha(chi, t)));
+			error[3] = std::max(error[3], fabs(cheb.phase_of_time(t) - traj.phase_of_time(chi, t))/phaseOfTimeScale);
+		}
+		for(int k = 0; k < 4; k++){
+			errorMax[k] = std::max(errorMax[k], error[k]);
+		}
+
+		// cost of one alpha and phase step of an inspiral on each path
+		std::shared_ptr<TrajectorySlice> slice = traj.slice(chi);
+		double alpha, phase, check = 0.;
+		StopWatch splineWatch, chebWatch;
+		splineWatch.start();
+		for(int i = 0; i < REPORT_SAMPLES; i++){
+			slice->orbital_alpha_phase_of_time(alpha, phase, sample(i, REPORT_SAMPLES, tmin, 0.));
+			check += alpha + phase;
+		}
+		splineWatch.stop();
+		chebWatch.start();
+		for(int i = 0; i < REPORT_SAMPLES; i++){
+			cheb.orbital_alpha_phase_of_time(alpha, phase, sample(i, REPORT_SAMPLES, tmin, 0.));
+			check -= alpha + phase;
+		}
+		chebWatch.stop();
+
+		printf("  %5.2f  %.2e   %.2e   %.2e   %.2e   %9.2f  %11.1f  %14.1f\n", a, error[0], error[1], error[2], error[3],
+			1.e3*buildWatch.time(), 1.e9*splineWatch.time()/REPORT_SAMPLES, 1.e9*chebWatch.time()/REPORT_SAMPLES);
+		if(fabs(check) > 1.){
+			printf("  (paths disagree by %.3e)\n", check);
+		}
+	}
+	printf("  all    %.2e   %.2e   %.2e   %.2e\n", errorMax[0], errorMax[1], errorMax[2], errorMax[3]);
+
+	return 0;
+}
@@ -0,0 +1,75 @@
+// Converts the text harmonic files of the modes 2 <= l <= lmax, 1 <= m <= l to
+// a single binary harmonic file, which holds the fitted spline coefficients so
+// that HarmonicAmplitudes can map it instead of parsing and fitting, and
+// compares the load times of the two formats.
+// Build from the repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -Icpp/include cpp/tools/convert_harmonics.cpp
+//       cpp/src/harmonics.cpp cpp/src/trajectory.cpp cpp/src/swsh.cpp cpp/src/spline.cpp -lgsl -lgslcblas -o convert_harmonics
+//
+// and run as ./convert_harmonics [harmonic file base] [binary file] [lmax]
+
+#include "harmonics.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char *argv[]){
+	std::string harmonic_file_base = "bhpwave/data/circ_data";
+	std::string binary_file = "bhpwave/data/circ_data.bin";
+	int lmax = 15;
+	if(argc > 1){
+		harmonic_file_base = argv[1];
+	}
+	if(argc > 2){
+		binary_file = argv[2];
+	}
+	if(argc > 3){
+		lmax = atoi(argv[3]);
+	}
+
+	std::vector<int> lmodes;
+	std::vector<int> mmodes;
+	for(int l = 2; l <= lmax; l++){
+		for(int m = 1; m <= l; m++){
+			lmodes.push_back(l);
+			mmodes.push_back(m);
+		}
+	}
+
+	if(convert_harmonic_files(lmodes, mmodes, harmonic_file_base, binary_file) != 0){
+		return 1;
+	}
+	printf("Wrote %d modes to %s\n", int(lmodes.size()), binary_file.c_str());
+
+	// modes load on their first request, so both timings include every mode
+	StopWatch textWatch;
+	textWatch.start();
+	HarmonicAmplitudes harm(lmodes, mmodes, harmonic_file_base);
+	harm.preload();
+	textWatch.stop();
+
+	StopWatch binaryWatch;
+	binaryWatch.start();
+	HarmonicAmplitudes harmBinary(read_harmonic_binary(binary_file));
+	harmBinary.preload();
+	binaryWatch.stop();
+
+	// the binary file stores the same coefficients, so the splines agree exactly
+	double difference = 0.;
+	for(size_t k = 0; k < lmodes.size(); k++){
+		for(int i = 0; i < 20; i++){
+			double chi = (i + 0.5)/20.;
+			for(int j = 0; j < 20; j++){
+				double alpha = (j + 0.5)/20.;
+				difference = std::max(difference, fabs(harm.amplitude(lmodes[k], mmodes[k], chi, alpha) - harmBinary.amplitude(lmodes[k], mmodes[k], chi, alpha)));
+				difference = std::max(difference, fabs(harm.phase(lmodes[k], mmodes[k], chi, alpha) - harmBinary.phase(lmodes[k], mmodes[k], chi, alpha)));
+			}
+		}
+	}
+
+	printf("  load from text      %10.3f ms\n", 1.e3*textWatch.time());
+	printf("  load from binary    %10.3f ms\n", 1.e3*binaryWatch.time());
+	printf("  largest difference  %10.3e\n", difference);
+
+	return 0;
+}
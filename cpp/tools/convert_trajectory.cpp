@@ -0,0 +1,56 @@
+// Converts a text trajectory file to the binary trajectory format, which holds
+// the fitted spline coefficients so that TrajectorySpline2D can map it instead
+// of parsing and fitting, and compares the load times of the two files.
+// Build from the repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -Icpp/include cpp/tools/convert_trajectory.cpp
+//       cpp/src/trajectory.cpp cpp/src/spline.cpp -lgsl -lgslcblas -o convert_trajectory
+//
+// and run as ./convert_trajectory [text file] [binary file]
+
+#include "trajectory.hpp"
+#include <cstdio>
+
+int main(int argc, char *argv[]){
+	std::string text_file = "bhpwave/data/trajectory.txt";
+	std::string binary_file = "bhpwave/data/trajectory.bin";
+	if(argc > 1){
+		text_file = argv[1];
+	}
+	if(argc > 2){
+		binary_file = argv[2];
+	}
+
+	if(convert_trajectory_file(text_file, binary_file) != 0){
+		return 1;
+	}
+	printf("Wrote %s\n", binary_file.c_str());
+
+	StopWatch textWatch;
+	textWatch.start();
+	TrajectorySpline2D traj(text_file);
+	textWatch.stop();
+
+	StopWatch binaryWatch;
+	binaryWatch.start();
+	TrajectorySpline2D trajBinary(read_trajectory_binary(binary_file));
+	binaryWatch.stop();
+
+	// the binary file stores the same coefficients, so the splines agree exactly
+	double difference = 0.;
+	for(int i = 0; i < 100; i++){
+		double chi = (i + 0.5)/100.;
+		for(int j = 0; j < 100; j++){
+			double alpha = (j + 0.5)/100.;
+			difference = std::max(difference, fabs(traj.time(chi, alpha) - trajBinary.time(chi, alpha)));
+			difference = std::max(difference, fabs(traj.phase(chi, alpha) - trajBinary.phase(chi, alpha)));
+			difference = std::max(difference, fabs(traj.flux(chi, alpha) - trajBinary.flux(chi, alpha)));
+		}
+	}
+
+	printf("  load from text      %10.3f ms\n", 1.e3*textWatch.time());
+	printf("  load from binary    %10.3f ms\n", 1.e3*binaryWatch.time());
+	printf("  largest difference  %10.3e\n", difference);
+
+	return 0;
+}
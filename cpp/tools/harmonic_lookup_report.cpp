@@ -0,0 +1,154 @@
+// Reports the errors of the lookup-table mode of HarmonicAmplitudes, per mode
+// and for a set of table resolutions, together with the cost per sample of
+// evaluating the modes along an inspiral with the splines and with the tables.
+// Amplitude errors are relative and phase errors are absolute (in radians).
+// Build from the repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -Icpp/include cpp/tools/harmonic_lookup_report.cpp
+//       cpp/src/waveform.cpp cpp/src/harmonics.cpp cpp/src/trajectory.cpp cpp/src/swsh.cpp cpp/src/spline.cpp
+//       -lgsl -lgslcblas -o harmonic_lookup_report
+//
+// and run as ./harmonic_lookup_report [trajectory file] [harmonic file base] [lmax] [chi samples] [alpha samples]
+// Without the last two arguments, a range of resolutions is summarized first
+
+#include "waveform.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+#define REPORT_SPIN 0.9
+#define REPORT_MASS_RATIO 1.e-5
+#define REPORT_RADIUS 10.
+#define REPORT_TIME_STEP 10.
+#define REPORT_DURATION 3.e6
+#define REPORT_THETA 0.7
+#define REPORT_PHI 0.3
+
+static void mode_list(std::vector<int> &lmodes, std::vector<int> &mmodes, int lmax){
+	for(int l = 2; l <= lmax; l++){
+		for(int m = 1; m <= l; m++){
+			lmodes.push_back(l);
+			mmodes.push_back(m);
+		}
+	}
+}
+
+static void report_resolutions(std::string filepath_base, int lmax){
+	std::vector<int> lmodes;
+	std::vector<int> mmodes;
+	mode_list(lmodes, mmodes, lmax);
+	int resolutions[5][2] = {{32, 128}, {64, 256}, {HARMONIC_LOOKUP_CHI_SAMPLES, HARMONIC_LOOKUP_ALPHA_SAMPLES}, {256, 512}, {256, 1024}};
+
+	printf("Largest errors over all modes with l <= %d\n", lmax);
+	printf("  chi x alpha    memory (MB)   rel. error in amplitude   abs. error in phase (rad)   resampling (s)\n");
+	for(int r = 0; r < 5; r++){
+		HarmonicAmplitudes harm(lmodes, mmodes, filepath_base);
+		StopWatch watch;
+		watch.start();
+		harm.useLookupTables(resolutions[r][0], resolutions[r][1]);
+		watch.stop();
+		double amplitudeError = 0., phaseError = 0.;
+		for(size_t k = 0; k < lmodes.size(); k++){
+			amplitudeError = std::max(amplitudeError, harm.lookupAmplitudeError(lmodes[k], mmodes[k]));
+			phaseError = std::max(phaseError, harm.lookupPhaseError(lmodes[k], mmodes[k]));
+		}
+		double memory = 16.*(resolutions[r][0] + 1)*(resolutions[r][1] + 1)*lmodes.size()/1048576.;
+		printf("  %4d x %-5d   %11.1f   %.3e                 %.3e                   %.3f\n", resolutions[r][0], resolutions[r][1], memory, amplitudeError, phaseError, watch.time());
+	}
+}
+
+static double time_waveform(WaveformHarmonicGenerator &gen, InspiralContainer &inspiral, int l[], int m[], int modeNum, int repeats){
+	WaveformHarmonicOptions opts = gen.getWaveformHarmonicOptions();
+	opts.num_threads = 1;
+	StopWatch watch;
+	for(int r = 0; r < repeats; r++){
+		WaveformContainer h(inspiral.getSize());
+		watch.start();
+		gen.computeWaveformHarmonics(h, l, m, modeNum, inspiral, REPORT_THETA, REPORT_PHI, opts);
+		watch.stop();
+	}
+	return 1.e9*watch.time()/(double(repeats)*modeNum*inspiral.getSize());
+}
+
+static void report_modes(std::string trajectory_file, std::string filepath_base, int lmax, int chi_samples, int alpha_samples){
+	std::vector<int> lmodes;
+	std::vector<int> mmodes;
+	mode_list(lmodes, mmodes, lmax);
+	HarmonicAmplitudes harm(lmodes, mmodes, filepath_base);
+	HarmonicAmplitudes harmLookup(lmodes, mmodes, filepath_base);
+	harmLookup.useLookupTables(chi_samples, alpha_samples);
+
+	printf("Lookup tables of %d x %d intervals (%s)\n", chi_samples, alpha_samples, filepath_base.c_str());
+	printf("    l   m   max rel. error in amplitude   max abs. error in phase (rad)\n");
+	for(size_t k = 0; k < lmodes.size(); k++){
+		printf("  %3d %3d   %.3e                     %.3e\n", lmodes[k], mmodes[k], harmLookup.lookupAmplitudeError(lmodes[k], mmodes[k]), harmLookup.lookupPhaseError(lmodes[k], mmodes[k]));
+	}
+
+	TrajectorySpline2D traj(trajectory_file);
+	InspiralGenerator inspiralGen(traj);
+	InspiralContainer inspiral = inspiralGen.computeInspiral(REPORT_SPIN, REPORT_MASS_RATIO, REPORT_RADIUS, REPORT_TIME_STEP, REPORT_DURATION);
+	int imax = inspiral.getSize();
+	int modeNum = lmodes.size();
+
+	// cost of the mode evaluation alone, as done in blocks by computeWaveformHarmonics
+	std::shared_ptr<HarmonicSlice> slice = harm.slice(chi_of_spin(REPORT_SPIN));
+	std::shared_ptr<HarmonicSlice> sliceLookup = harmLookup.slice(chi_of_spin(REPORT_SPIN));
+	const double *alpha = inspiral.getAlpha().data();
+	double amp[WAVEFORM_BLOCK_SIZE], phase[WAVEFORM_BLOCK_SIZE], check = 0.;
+	StopWatch splineWatch, lookupWatch;
+	for(int pass = 0; pass < 2; pass++){
+		HarmonicSlice &s = (pass == 0) ? *slice : *sliceLookup;
+		StopWatch &watch = (pass == 0) ? splineWatch : lookupWatch;
+		watch.start();
+		for(int k = 0; k < modeNum; k++){
+			HarmonicSpline *Alm = s.getPointer(lmodes[k], mmodes[k]);
+			for(int i0 = 0; i0 < imax; i0 += WAVEFORM_BLOCK_SIZE){
+				int blockSize = std::min(WAVEFORM_BLOCK_SIZE, imax - i0);
+				Alm->amplitude(amp, &alpha[i0], blockSize);
+				Alm->phase(phase, &alpha[i0], blockSize);
+				check += amp[0] + phase[0];
+			}
+		}
+		watch.stop();
+	}
+
+	WaveformHarmonicGenerator gen(harm);
+	WaveformHarmonicGenerator genLookup(harmLookup);
+	double waveformTime = time_waveform(gen, inspiral, lmodes.data(), mmodes.data(), modeNum, 3);
+	double waveformLookupTime = time_waveform(genLookup, inspiral, lmodes.data(), mmodes.data(), modeNum, 3);
+
+	double sampleNum = double(modeNum)*imax;
+	printf("Cost per mode and time sample (%d modes, %d samples, one thread)\n", modeNum, imax);
+	printf("                               splines (ns)   lookup tables (ns)\n");
+	printf("  amplitude and phase          %12.2f   %18.2f\n", 1.e9*splineWatch.time()/sampleNum, 1.e9*lookupWatch.time()/sampleNum);
+	printf("  computeWaveformHarmonics     %12.2f   %18.2f\n", waveformTime, waveformLookupTime);
+	if(check != check){
+		printf("  (evaluation returned NaN)\n");
+	}
+}
+
+int main(int argc, char *argv[]){
+	std::string trajectory_file = "bhpwave/data/trajectory.txt";
+	std::string harmonic_file_base = "bhpwave/data/circ_data";
+	int lmax = 15;
+	int chi_samples = HARMONIC_LOOKUP_CHI_SAMPLES;
+	int alpha_samples = HARMONIC_LOOKUP_ALPHA_SAMPLES;
+	if(argc > 1){
+		trajectory_file = argv[1];
+	}
+	if(argc > 2){
+		harmonic_file_base = argv[2];
+	}
+	if(argc > 3){
+		lmax = atoi(argv[3]);
+	}
+	if(argc > 5){
+		chi_samples = atoi(argv[4]);
+		alpha_samples = atoi(argv[5]);
+	}else{
+		report_resolutions(harmonic_file_base, lmax);
+	}
+
+	report_modes(trajectory_file, harmonic_file_base, lmax, chi_samples, alpha_samples);
+
+	return 0;
+}
@@ -0,0 +1,210 @@
+// Reports the largest error, in units in the last place, of the scalar and the
+// array versions of the circular-orbit functions in trajectory.hpp against long
+// double evaluations of the same formulas, over a in [-A_MAX, A_MAX], omega in
+// [OMEGA_MIN, omega_ISCO(a)] and alpha, chi in [0, 1]. Several functions are
+// differences of nearly equal terms in part of the domain (alpha and the
+// normalizations close to the ISCO, spin_of_chi close to a = 0, the ISCO
+// frequency close to |a| = 1), where the largest error of either version
+// reflects that cancellation, so the median error is reported alongside.
+// Build from the repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -fno-math-errno -Icpp/include cpp/tools/kerr_math_report.cpp
+//       cpp/src/trajectory.cpp cpp/src/spline.cpp -lgsl -lgslcblas -o kerr_math_report
+//
+// and run as ./kerr_math_report [samples]
+
+#include "trajectory.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+// domain of the trajectory, as in trajectory.cpp
+#define REPORT_A_MAX 0.9999
+#define REPORT_OMEGA_MIN 2.e-3
+#define REPORT_RADIUS_MAX 100.
+
+typedef long double Real;
+
+// distance between x and the exact value in units of the spacing of doubles at the exact value
+static double ulp_error(double x, Real exact){
+	double rounded = static_cast<double>(exact);
+	double ulp = nextafter(fabs(rounded), INFINITY) - fabs(rounded);
+	return static_cast<double>(fabsl(static_cast<Real>(x) - exact)/ulp);
+}
+
+static Real cube(Real x){
+	return x*x*x;
+}
+
+static Real isco_frequency_exact(Real a){
+	Real sgnX = (a < 0) ? -1 : 1;
+	a = fabsl(a);
+	Real z1 = 1 + cbrtl(1 - a*a)*(cbrtl(1 - a) + cbrtl(1 + a));
+	Real z2 = sqrtl(3*a*a + z1*z1);
+	Real v = 1/sqrtl(3 + z2 - sgnX*sqrtl((3 - z1)*(3 + z1 + 2*z2)));
+	return cube(v)/(1 + sgnX*a*cube(v));
+}
+
+static Real denergy_domega_exact(Real a, Real omega){
+	Real v = cbrtl(omega/(1 - a*omega));
+	Real denergy = 0.5L*(powl(v, 4) - 6*powl(v, 6) + 8*a*powl(v, 7) - 3*a*a*powl(v, 8))/powl(1 + v*v*(2*a*v - 3), 1.5L);
+	return denergy*(-2/(3*powl(omega, 5.L/3.L)*cbrtl(1 - a*omega)));
+}
+
+struct ErrorStats{
+	std::vector<double> scalar;
+	std::vector<double> array;
+};
+
+static void print_stats(const char *name, ErrorStats &stats){
+	double maxScalar = *std::max_element(stats.scalar.begin(), stats.scalar.end());
+	double maxArray = *std::max_element(stats.array.begin(), stats.array.end());
+	size_t mid = stats.scalar.size()/2;
+	std::nth_element(stats.scalar.begin(), stats.scalar.begin() + mid, stats.scalar.end());
+	std::nth_element(stats.array.begin(), stats.array.begin() + mid, stats.array.end());
+	printf("  %-36s %12.1f %10.2f %12.1f %10.2f\n", name, maxScalar, stats.scalar[mid], maxArray, stats.array[mid]);
+}
+
+int main(int argc, char *argv[]){
+	int n = 100000;
+	if(argc > 1){
+		n = atoi(argv[1]);
+	}
+
+	// samples: a spin, a frequency between OMEGA_MIN and the ISCO of that spin,
+	// a radius outside the ISCO and alpha, chi in [0, 1]
+	Vector a(n), omega(n), oISCO(n), radius(n), alpha(n), chi(n);
+	unsigned long long state = 1;
+	for(int i = 0; i < n; i++){
+		double u[4];
+		for(int k = 0; k < 4; k++){
+			state = state*6364136223846793005ULL + 1442695040888963407ULL;
+			u[k] = (state >> 11)*(1./9007199254740992.);
+		}
+		a[i] = REPORT_A_MAX*(2.*u[0] - 1.);
+		oISCO[i] = kerr_isco_frequency(a[i]);
+		omega[i] = REPORT_OMEGA_MIN + u[1]*(oISCO[i] - REPORT_OMEGA_MIN);
+		double risco = kerr_isco_radius(a[i]);
+		radius[i] = risco + u[2]*(REPORT_RADIUS_MAX - risco);
+		alpha[i] = u[3];
+		chi[i] = u[1];
+	}
+
+	Vector out(n);
+	ErrorStats stats;
+	stats.scalar.resize(n);
+	stats.array.resize(n);
+	printf("Errors in ulp of %d samples against long double evaluations\n", n);
+	printf("                                             scalar max     median    array max     median\n");
+
+	kerr_geo_azimuthal_frequency_circ_time(out.data(), a.data(), radius.data(), n);
+	for(int i = 0; i < n; i++){
+		Real v = 1/sqrtl(radius[i]);
+		Real exact = cube(v)/(1 + a[i]*cube(v));
+		stats.scalar[i] = ulp_error(kerr_geo_azimuthal_frequency_circ_time(a[i], radius[i]), exact);
+		stats.array[i] = ulp_error(out[i], exact);
+	}
+	print_stats("kerr_geo_azimuthal_frequency_circ_time", stats);
+
+	kerr_isco_frequency(out.data(), a.data(), n);
+	for(int i = 0; i < n; i++){
+		Real exact = isco_frequency_exact(a[i]);
+		stats.scalar[i] = ulp_error(kerr_isco_frequency(a[i]), exact);
+		stats.array[i] = ulp_error(out[i], exact);
+	}
+	print_stats("kerr_isco_frequency", stats);
+
+	alpha_of_a_omega(out.data(), omega.data(), oISCO.data(), n);
+	for(int i = 0; i < n; i++){
+		Real oISCOThird = cbrtl(oISCO[i]);
+		Real exact = sqrtl(fabsl(oISCOThird - cbrtl(omega[i]))/(oISCOThird - cbrtl(REPORT_OMEGA_MIN)));
+		stats.scalar[i] = ulp_error(alpha_of_a_omega(a[i], omega[i], oISCO[i]), exact);
+		stats.array[i] = ulp_error(out[i], exact);
+	}
+	print_stats("alpha_of_a_omega", stats);
+
+	omega_of_a_alpha(out.data(), alpha.data(), oISCO.data(), n);
+	for(int i = 0; i < n; i++){
+		Real oISCOThird = cbrtl(oISCO[i]);
+		Real exact = cube(oISCOThird - static_cast<Real>(alpha[i])*alpha[i]*(oISCOThird - cbrtl(REPORT_OMEGA_MIN)));
+		stats.scalar[i] = ulp_error(omega_of_a_alpha(a[i], alpha[i], oISCO[i]), exact);
+		stats.array[i] = ulp_error(out[i], exact);
+	}
+	print_stats("omega_of_a_alpha", stats);
+
+	spin_of_chi(out.data(), chi.data(), n);
+	for(int i = 0; i < n; i++){
+		Real chiMax = cbrtl(1 - static_cast<Real>(REPORT_A_MAX));
+		Real exact = 1 - cube(chiMax + static_cast<Real>(chi[i])*chi[i]*(cbrtl(1 + static_cast<Real>(REPORT_A_MAX)) - chiMax));
+		stats.scalar[i] = ulp_error(spin_of_chi(chi[i]), exact);
+		stats.array[i] = ulp_error(out[i], exact);
+	}
+	print_stats("spin_of_chi", stats);
+
+	chi_of_spin(out.data(), a.data(), n);
+	for(int i = 0; i < n; i++){
+		Real chiMax = cbrtl(1 - static_cast<Real>(REPORT_A_MAX));
+		Real exact = sqrtl((cbrtl(1 - static_cast<Real>(a[i])) - chiMax)/(cbrtl(1 + static_cast<Real>(REPORT_A_MAX)) - chiMax));
+		stats.scalar[i] = ulp_error(chi_of_spin(a[i]), exact);
+		stats.array[i] = ulp_error(out[i], exact);
+	}
+	print_stats("chi_of_spin", stats);
+
+	kerr_geo_denergy_domega_circ(out.data(), a.data(), omega.data(), n);
+	for(int i = 0; i < n; i++){
+		Real exact = denergy_domega_exact(a[i], omega[i]);
+		stats.scalar[i] = ulp_error(kerr_geo_denergy_domega_circ(a[i], omega[i]), exact);
+		stats.array[i] = ulp_error(out[i], exact);
+	}
+	print_stats("kerr_geo_denergy_domega_circ", stats);
+
+	normalize_energy_flux(out.data(), omega.data(), n);
+	for(int i = 0; i < n; i++){
+		Real exact = powl(omega[i], 10.L/3.L);
+		stats.scalar[i] = ulp_error(normalize_energy_flux(omega[i]), exact);
+		stats.array[i] = ulp_error(out[i], exact);
+	}
+	print_stats("normalize_energy_flux", stats);
+
+	// the array normalizations take one ISCO frequency for all points, so
+	// these samples share the spin of the first one
+	double oISCOFixed = oISCO[0];
+	Vector omegaFixed(n);
+	for(int i = 0; i < n; i++){
+		omegaFixed[i] = REPORT_OMEGA_MIN + chi[i]*(oISCOFixed - REPORT_OMEGA_MIN);
+	}
+
+	normalize_time(out.data(), omegaFixed.data(), oISCOFixed, n);
+	for(int i = 0; i < n; i++){
+		Real exact = powl(omegaFixed[i], -8.L/3.L) - powl(oISCOFixed, -8.L/3.L) + 1.e-6L;
+		stats.scalar[i] = ulp_error(normalize_time(omegaFixed[i], oISCOFixed), exact);
+		stats.array[i] = ulp_error(out[i], exact);
+	}
+	print_stats("normalize_time", stats);
+
+	normalize_phase(out.data(), omegaFixed.data(), oISCOFixed, n);
+	for(int i = 0; i < n; i++){
+		Real exact = powl(omegaFixed[i], -5.L/3.L) - powl(oISCOFixed, -5.L/3.L) + 1.e-6L;
+		stats.scalar[i] = ulp_error(normalize_phase(omegaFixed[i], oISCOFixed), exact);
+		stats.array[i] = ulp_error(out[i], exact);
+	}
+	print_stats("normalize_phase", stats);
+
+	normalize_time_domega(out.data(), omega.data(), n);
+	for(int i = 0; i < n; i++){
+		Real exact = (-8.L/3.L)*powl(omega[i], -11.L/3.L);
+		stats.scalar[i] = ulp_error(normalize_time_domega(omega[i]), exact);
+		stats.array[i] = ulp_error(out[i], exact);
+	}
+	print_stats("normalize_time_domega", stats);
+
+	normalize_phase_domega(out.data(), omega.data(), n);
+	for(int i = 0; i < n; i++){
+		Real exact = (-5.L/3.L)*powl(omega[i], -8.L/3.L);
+		stats.scalar[i] = ulp_error(normalize_phase_domega(omega[i]), exact);
+		stats.array[i] = ulp_error(out[i], exact);
+	}
+	print_stats("normalize_phase_domega", stats);
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+// Reports the error introduced by storing the spline coefficients of the
+// harmonic amplitudes and of the trajectory in single precision, so that the
+// option can be enabled per field. Both tables are built in double and in
+// single precision and compared on a grid that is offset from the spline nodes.
+// Build from the repository root with (on one line)
+//
+//   g++ -std=c++11 -fopenmp -march=native -O2 -Icpp/include cpp/tools/spline_precision_report.cpp
+//       cpp/src/harmonics.cpp cpp/src/trajectory.cpp cpp/src/swsh.cpp cpp/src/spline.cpp
+//       -lgsl -lgslcblas -o spline_precision_report
+//
+// and run as ./spline_precision_report [trajectory file] [harmonic file base] [lmax]
+
+#include "harmonics.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+#define REPORT_SAMPLES 200
+#define REPORT_CHI_MIN 0.
+#define REPORT_CHI_MAX 1.
+#define REPORT_ALPHA_MIN 0.
+#define REPORT_ALPHA_MAX 1.
+
+static double sample(int i, double xmin, double xmax){
+	return xmin + (i + 0.5)*(xmax - xmin)/REPORT_SAMPLES;
+}
+
+static double relative_error(double x, double x_ref){
+	if(x_ref == 0.){
+		return fabs(x);
+	}
+	return fabs(x/x_ref - 1.);
+}
+
+static void report_trajectory(std::string filename){
+	TrajectoryData data = read_trajectory_data(filename);
+	TrajectorySpline2D traj(data);
+	TrajectorySpline2D trajSingle(data, TRAJECTORY_FREQUENCY_DOMAIN_SINGLE_PRECISION | TRAJECTORY_FLUX_SINGLE_PRECISION | TRAJECTORY_TIME_DOMAIN_SINGLE_PRECISION);
+
+	double timeError = 0., phaseError = 0., fluxError = 0.;
+	double alphaError = 0., phaseOfTimeError = 0., frequencyError = 0.;
+	for(int i = 0; i < REPORT_SAMPLES; i++){
+		double chi = sample(i, REPORT_CHI_MIN, REPORT_CHI_MAX);
+		double a = spin_of_chi(chi);
+		double tmax = traj.time(chi, REPORT_ALPHA_MAX);
+		for(int j = 0; j < REPORT_SAMPLES; j++){
+			double alpha = sample(j, REPORT_ALPHA_MIN, REPORT_ALPHA_MAX);
+			timeError = std::max(timeError, relative_error(trajSingle.time(chi, alpha), traj.time(chi, alpha)));
+			phaseError = std::max(phaseError, fabs(trajSingle.phase(chi, alpha) - traj.phase(chi, alpha)));
+			fluxError = std::max(fluxError, relative_error(trajSingle.flux(chi, alpha), traj.flux(chi, alpha)));
+
+			double t = sample(j, tmax, 0.);
+			alphaError = std::max(alphaError, fabs(trajSingle.orbital_alpha(chi, t) - traj.orbital_alpha(chi, t)));
+			phaseOfTimeError = std::max(phaseOfTimeError, fabs(trajSingle.phase_of_time(chi, t) - traj.phase_of_time(chi, t)));
+			frequencyError = std::max(frequencyError, relative_error(trajSingle.orbital_frequency(a, t), traj.orbital_frequency(a, t)));
+		}
+	}
+
+	printf("Trajectory (%s)\n", filename.c_str());
+	printf("  frequency domain  max rel. error in time      %.3e\n", timeError);
+	printf("  frequency domain  max abs. error in phase     %.3e rad\n", phaseError);
+	printf("  flux              max rel. error in flux      %.3e\n", fluxError);
+	printf("  time domain       max abs. error in alpha     %.3e\n", alphaError);
+	printf("  time domain       max abs. error in phase     %.3e rad\n", phaseOfTimeError);
+	printf("  time domain       max rel. error in frequency %.3e\n", frequencyError);
+}
+
+static void report_harmonics(std::string filepath_base, int lmax){
+	std::vector<int> lmodes;
+	std::vector<int> mmodes;
+	for(int l = 2; l <= lmax; l++){
+		for(int m = 1; m <= l; m++){
+			lmodes.push_back(l);
+			mmodes.push_back(m);
+		}
+	}
+	HarmonicAmplitudes harm(lmodes, mmodes, filepath_base);
+	HarmonicAmplitudes harmSingle(lmodes, mmodes, filepath_base, HARMONIC_AMPLITUDE_SINGLE_PRECISION | HARMONIC_PHASE_SINGLE_PRECISION);
+
+	printf("Harmonic modes (%s)\n", filepath_base.c_str());
+	printf("    l   m   max rel. error in amplitude   max abs. error in phase (rad)\n");
+	double amplitudeErrorMax = 0., phaseErrorMax = 0.;
+	for(size_t k = 0; k < lmodes.size(); k++){
+		int l = lmodes[k];
+		int m = mmodes[k];
+		double amplitudeError = 0., phaseError = 0.;
+		for(int i = 0; i < REPORT_SAMPLES; i++){
+			double chi = sample(i, REPORT_CHI_MIN, REPORT_CHI_MAX);
+			for(int j = 0; j < REPORT_SAMPLES; j++){
+				double alpha = sample(j, REPORT_ALPHA_MIN, REPORT_ALPHA_MAX);
+				amplitudeError = std::max(amplitudeError, relative_error(harmSingle.amplitude(l, m, chi, alpha), harm.amplitude(l, m, chi, alpha)));
+				phaseError = std::max(phaseError, fabs(harmSingle.phase(l, m, chi, alpha) - harm.phase(l, m, chi, alpha)));
+			}
+		}
+		amplitudeErrorMax = std::max(amplitudeErrorMax, amplitudeError);
+		phaseErrorMax = std::max(phaseErrorMax, phaseError);
+		printf("  %3d %3d   %.3e                     %.3e\n", l, m, amplitudeError, phaseError);
+	}
+	printf("  all modes %.3e                     %.3e\n", amplitudeErrorMax, phaseErrorMax);
+}
+
+int main(int argc, char *argv[]){
+	std::string trajectory_file = "bhpwave/data/trajectory.txt";
+	std::string harmonic_file_base = "data/circ_data";
+	int lmax = 15;
+	if(argc > 1){
+		trajectory_file = argv[1];
+	}
+	if(argc > 2){
+		harmonic_file_base = argv[2];
+	}
+	if(argc > 3){
+		lmax = atoi(argv[3]);
+	}
+
+	report_trajectory(trajectory_file);
+	report_harmonics(harmonic_file_base, lmax);
+
+	return 0;
+}
@@ -11,6 +11,13 @@ cdef unicode default_harmonic_filebase = '../bhpwave/data/circ_data'
 include "trajectory_wrap.pyx"
 
 cdef extern from "harmonics.hpp":
+    cdef cppclass HarmonicBinaryData:
+        pass
+
+    HarmonicBinaryData read_harmonic_binary(string filename) except +
+    bint is_harmonic_binary(string filename)
+    int convert_harmonic_files_cpp "convert_harmonic_files"(int lmodes[], int mmodes[], int modeNum, string filepath_base, string binary_filename)
+
     cdef cppclass HarmonicSpline2D:
         HarmonicSpline2D(int j, int m, string filebase)
 
@@ -23,15 +30,28 @@ cdef extern from "harmonics.hpp":
 
     cdef cppclass HarmonicAmplitudes:
         HarmonicAmplitudes(int lmodes[], int mmodes[], int modeNum, string filepath_base)
+        HarmonicAmplitudes(int lmodes[], int mmodes[], int modeNum, string filepath_base, int single_precision)
+        HarmonicAmplitudes(int lmodes[], int mmodes[], int modeNum, const HarmonicBinaryData &harm, int single_precision) except +
 
         double amplitude(int l, int m, double chi, double alpha)
         double phase(int l, int m, double chi, double alpha)
         int key_check(pair[int, int] key)
+        int getModeIndex(int l, int m)
 
         double amplitude_of_a_omega(int l, int m, double a, double omega)
         double phase_of_a_omega(int l, int m, double a, double omega)
         double phase_of_a_omega_derivative(int l, int m, double a, double omega)
 
+        void preload()
+        void preload(int lmodes[], int mmodes[], int modeNum)
+        int getModeNumber()
+        int loadedModeNumber()
+
+        void useLookupTables(int chi_samples, int alpha_samples)
+        int lookupTables()
+        double lookupAmplitudeError(int l, int m)
+        double lookupPhaseError(int l, int m)
+
     cdef cppclass HarmonicOptions:
         HarmonicOptions()
         HarmonicOptions(double eps, int max)
@@ -105,6 +125,10 @@ cdef int[::1] default_mmodes():
 cdef int[::1] DEFAULT_LMODES = default_lmodes()
 cdef int[::1] DEFAULT_MMODES = default_mmodes()
 
+def convert_harmonic_files(unicode filebase, unicode binary_filename, int[::1] lmodes = DEFAULT_LMODES, int[::1] mmodes = DEFAULT_MMODES):
+    if convert_harmonic_files_cpp(&lmodes[0], &mmodes[0], lmodes.shape[0], filebase.encode(), binary_filename.encode()) != 0:
+        raise RuntimeError("Could not convert the harmonic files " + filebase + " to " + binary_filename)
+
 cdef class HarmonicModeContainerWrapper:
     cdef HarmonicModeContainer modecpp
 
@@ -138,9 +162,43 @@ cdef class HarmonicAmplitudesPy:
     cdef HarmonicAmplitudes *harmonicscpp
     cdef bint dealloc_flag
 
-    def __cinit__(self, int[::1] lmodes = DEFAULT_LMODES, int[::1] mmodes = DEFAULT_MMODES, unicode filebase = default_harmonic_filebase, bint dealloc_flag = True):
-        self.harmonicscpp = new HarmonicAmplitudes(&lmodes[0], &mmodes[0], lmodes.shape[0], filebase.encode())
+    def __cinit__(self, int[::1] lmodes = DEFAULT_LMODES, int[::1] mmodes = DEFAULT_MMODES, unicode filebase = default_harmonic_filebase, bint dealloc_flag = True, int single_precision = 0, int lookup_chi_samples = 0, int lookup_alpha_samples = 0):
+        # a binary harmonic file is mapped rather than parsed, in which case
+        # filebase is the name of the file
+        if is_harmonic_binary(filebase.encode()):
+            self.harmonicscpp = new HarmonicAmplitudes(&lmodes[0], &mmodes[0], lmodes.shape[0], read_harmonic_binary(filebase.encode()), single_precision)
+        else:
+            self.harmonicscpp = new HarmonicAmplitudes(&lmodes[0], &mmodes[0], lmodes.shape[0], filebase.encode(), single_precision)
         self.dealloc_flag = dealloc_flag
+        if lookup_chi_samples > 0 and lookup_alpha_samples > 0:
+            self.harmonicscpp.useLookupTables(lookup_chi_samples, lookup_alpha_samples)
+
+    def preload(self, lmodes = None, mmodes = None):
+        # modes load on their first use, so this loads all of them, or the
+        # listed ones, ahead of time
+        if lmodes is None or mmodes is None:
+            self.harmonicscpp.preload()
+            return
+        cdef int[::1] l = np.ascontiguousarray(lmodes, dtype=np.int32)
+        cdef int[::1] m = np.ascontiguousarray(mmodes, dtype=np.int32)
+        assert l.shape[0] == m.shape[0], "Shapes of {}, {} for lmodes and mmodes are incompatible".format(l.shape[0], m.shape[0])
+        if l.shape[0] > 0:
+            self.harmonicscpp.preload(&l[0], &m[0], l.shape[0])
+
+    @property
+    def mode_number(self):
+        return self.harmonicscpp.getModeNumber()
+
+    @property
+    def loaded_mode_number(self):
+        return self.harmonicscpp.loadedModeNumber()
+
+    @property
+    def lookup_tables(self):
+        return self.harmonicscpp.lookupTables()
+
+    def lookup_errors(self, int l, int m):
+        return (self.harmonicscpp.lookupAmplitudeError(l, m), self.harmonicscpp.lookupPhaseError(l, m))
 
     def __dealloc__(self):
         if self.dealloc_flag:
@@ -173,3 +231,7 @@ cdef class HarmonicAmplitudesPy:
 
     def key_check(self, int l, int m):
         return self.harmonicscpp.key_check(pair[int, int](l, m))
+
+    def mode_index(self, int l, int m):
+        # position of mode (l, m) in the amplitudes, or -1 if it is not held
+        return self.harmonicscpp.getModeIndex(l, m)
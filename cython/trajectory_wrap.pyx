@@ -11,9 +11,27 @@ import os
 cdef unicode path_to_file = os.path.dirname(os.path.abspath(__file__))
 cdef unicode default_trajectory_file = path_to_file + '/bhpwave/data/trajectory.txt'
 
+cdef extern from "execution_context.hpp":
+    cdef cppclass ExecutionContext:
+        @staticmethod
+        int getPoolSize()
+        @staticmethod
+        void setPoolSize(int size)
+        @staticmethod
+        int getThreadsInUse()
+
 cdef extern from "trajectory.hpp":
+    cdef cppclass TrajectoryBinaryData:
+        pass
+
+    TrajectoryBinaryData read_trajectory_binary(string filename) except +
+    bint is_trajectory_binary(string filename)
+    int convert_trajectory_file_cpp "convert_trajectory_file"(string text_filename, string binary_filename)
+
     cdef cppclass TrajectorySpline2D:
         TrajectorySpline2D(string filename) except +
+        TrajectorySpline2D(string filename, int single_precision) except +
+        TrajectorySpline2D(const TrajectoryBinaryData &traj, int single_precision) except +
 
         double time(double chi, double alpha)
         double phase(double chi, double alpha)
@@ -31,6 +49,7 @@ cdef extern from "trajectory.hpp":
         double orbital_frequency(double a, double t)
         double orbital_frequency_derivative(double a, double t)
         double orbital_frequency_time_derivative_of_a_omega(double a, double omega)
+        double orbital_frequency_time_derivative_from_flux_of_a_omega(double a, double omega)
         double phase_of_a_time(double a, double t)
 
         double orbital_frequency_isco(double chi)
@@ -40,12 +59,32 @@ cdef extern from "trajectory.hpp":
         double max_orbital_radius(double a)
         double max_time_before_merger(double a)
 
+        void time(double t[], const double chi[], const double alpha[], int n, int num_threads)
+        void phase(double phase[], const double chi[], const double alpha[], int n, int num_threads)
+        void flux(double flux[], const double chi[], const double alpha[], int n, int num_threads)
+        void flux_norm(double flux[], const double chi[], const double alpha[], int n, int num_threads)
+        void time_of_a_omega(double t[], const double a[], const double omega[], int n, int num_threads)
+        void time_of_a_omega_derivative(double dtdo[], const double a[], const double omega[], int n, int num_threads)
+        void phase_of_a_omega(double phase[], const double a[], const double omega[], int n, int num_threads)
+        void phase_of_a_omega_derivative(double dphido[], const double a[], const double omega[], int n, int num_threads)
         void flux_of_a_omega(double flux[], const double a[], const double omega[], int n, int num_threads)
+        void orbital_frequency_time_derivative_from_flux_of_a_omega(double dodt[], const double a[], const double omega[], int n, int num_threads)
+        void orbital_alpha(double alpha[], const double chi[], const double t[], int n, int num_threads)
+        void orbital_frequency(double omega[], const double a[], const double t[], int n, int num_threads)
+        void orbital_frequency_derivative(double domegadt[], const double a[], const double t[], int n, int num_threads)
+        void phase_of_a_time(double phase[], const double a[], const double t[], int n, int num_threads)
+        void orbital_frequency_isco_of_a(double oISCO[], const double a[], int n, int num_threads)
+        void min_orbital_frequency(double omega[], const double a[], int n, int num_threads)
+        void max_orbital_frequency(double omega[], const double a[], int n, int num_threads)
+        void max_orbital_radius(double r[], const double a[], int n, int num_threads)
+        void max_time_before_merger(double t[], const double a[], int n, int num_threads)
 
     cdef cppclass InspiralContainer:
         InspiralContainer(int inspiralSteps)
         void setInspiralInitialConditions(double a, double massratio, double r0, double dt)
         void setTimeStep(int i, double alpha, double phase)
+        int getStartStep()
+        double getTimeSpacing()
 
         const vector[double]& getAlpha() const
         const vector[double]& getPhase() const
@@ -65,12 +104,58 @@ cdef extern from "trajectory.hpp":
         double getInitialFrequency()
         int getSize()
 
+    cdef cppclass InspiralSegments:
+        InspiralSegments(InspiralSegments &segments)
+        bint next(InspiralContainer &segment)
+        void reset()
+        int getSize()
+        int getSegmentSize()
+        int getSegmentNumber()
+
+    cdef cppclass MultirateSampling:
+        MultirateSampling(double dt)
+        MultirateSampling(MultirateSampling &sampling)
+        void addSegment(int stride, int steps)
+        int getSize()
+        int getSegmentNumber()
+        int getOffset(int k)
+        int getSegmentSize(int k)
+        int getStride(int k)
+        double getSegmentTimeSpacing(int k)
+        int getStep(int i)
+        void getSteps(int steps[])
+        double getTime(int i)
+        void getTimes(double t[])
+        double getTimeSpacing()
+        void setTimeSpacing(double dt)
+        int getUniformSize()
+        double getDuration()
+        void resample(double uniform[], const double samples[])
+
     cdef cppclass InspiralGenerator:
         InspiralGenerator(TrajectorySpline2D &traj, int num_threads)
         # InspiralContainer computeInspiral(double a, double massratio, double r0, double dt, double T, int num_threads)
         void computeInitialConditions(double &chi, double &omega_i, double &alpha_i, double &t_i, double a, double massratio, double r0, double &T)
         int computeTimeStepNumber(double dt, double T)
+        double computeTimeToMerger(double a, double massratio, double r0)
+        double computeInitialRadius(double a, double massratio, double T)
+        void computeInitialRadii(double r0[], const double a[], const double massratio[], const double T[], int n, int num_threads)
         void computeInspiral(InspiralContainer &inspiral, double chi, double omega_i, double alpha_i, double t_i, double massratio, double dt, int num_threads)
+        void computeInspiral(InspiralContainer &inspiral, double chi, double omega_i, double alpha_i, double t_i, double massratio, double dt, int num_threads, double phase_tolerance)
+        void computeTimeStepNumbers(int steps[], const double a[], const double massratio[], const double r0[], const double dt[], const double T[], int n)
+        void computeInspirals(double *alpha[], double *phase[], const int steps[], const double a[], const double massratio[], const double r0[], const double dt[], int n, int num_threads, double phase_tolerance)
+        void computeInspirals(double alpha[], double phase[], const long offsets[], const double a[], const double massratio[], const double r0[], const double dt[], int n, int num_threads, double phase_tolerance)
+        InspiralSegments computeInspiralSegments(double a, double massratio, double r0, double dt, double T, int segment_steps, int num_threads)
+        MultirateSampling computeMultirateSampling(double a, double massratio, double r0, double dt, double dt_max, double T, double omega_factor, double samples_per_cycle)
+        InspiralContainer computeInspiral(double a, double massratio, double r0, const MultirateSampling &sampling, int num_threads)
+        void setEngine(int engine, double tolerance)
+        int getEngine()
+        void setInspiralCacheBytes(size_t bytes)
+        size_t getInspiralCacheBytes()
+        size_t inspiralCacheSize()
+        size_t inspiralCacheHits()
+        size_t inspiralCacheMisses()
+        void clearInspiralCache()
 
 ######################################
 # Define Useful Trajectory Functions #
@@ -78,6 +163,19 @@ cdef extern from "trajectory.hpp":
 
 OMEGA_MIN = 2.e-3
 A_MAX = 0.9999
+INSPIRAL_SPLINE_ENGINE = 0
+INSPIRAL_CHEBYSHEV_ENGINE = 1
+
+def get_thread_pool_size():
+    return ExecutionContext.getPoolSize()
+
+# threads shared by the calls made with num_threads=0, which split them between concurrent calls
+def set_thread_pool_size(int size):
+    ExecutionContext.setPoolSize(size)
+
+def convert_trajectory_file(unicode text_filename, unicode binary_filename):
+    if convert_trajectory_file_cpp(text_filename.encode(), binary_filename.encode()) != 0:
+        raise RuntimeError("Could not convert " + text_filename + " to " + binary_filename)
 
 def kerr_geo_radius_circ(a, omega):
     return (abs(omega)*(1. - a*omega)/(omega**2))**(2./3.)
@@ -126,6 +224,10 @@ def a_omega_to_chi_alpha(a, omega):
 # Define New Python Wrapped Classes #
 #####################################
 
+cdef dict inspiral_cache_info(InspiralGenerator *inspiralcpp):
+    return {"hits": inspiralcpp.inspiralCacheHits(), "misses": inspiralcpp.inspiralCacheMisses(),
+        "size": inspiralcpp.inspiralCacheSize(), "bytes": inspiralcpp.getInspiralCacheBytes()}
+
 cdef class InspiralContainerWrapper:
     cdef InspiralContainer *inspiralcpp
 
@@ -185,11 +287,15 @@ cdef class InspiralContainerWrapper:
 
     @property
     def dt(self):
-        return self.inspiralcpp.getTime(1)
+        return self.inspiralcpp.getTimeSpacing()
+
+    @property
+    def start(self):
+        return self.inspiralcpp.getStartStep()
 
     @property
     def time(self):
-        return np.arange(0, self.inspiralcpp.getSize())*self.dt
+        return np.arange(self.start, self.start + self.inspiralcpp.getSize())*self.dt
 
     @property
     def frequency(self):
@@ -199,16 +305,133 @@ cdef class InspiralContainerWrapper:
     def radius(self):
         return kerr_geo_radius_circ(self.a, self.frequency)
 
+cdef class InspiralSegmentsWrapper:
+    cdef InspiralSegments *segmentscpp
+
+    def __dealloc__(self):
+        del self.segmentscpp
+
+    def __len__(self):
+        return self.segmentscpp.getSegmentNumber()
+
+    def __iter__(self):
+        self.segmentscpp.reset()
+        return self
+
+    def __next__(self):
+        cdef InspiralContainerWrapper segment = InspiralContainerWrapper(0)
+        if not self.segmentscpp.next(dereference(segment.inspiralcpp)):
+            raise StopIteration
+        return segment
+
+    @property
+    def size(self):
+        return self.segmentscpp.getSize()
+
+    @property
+    def segment_size(self):
+        return self.segmentscpp.getSegmentSize()
+
+cdef class MultirateSamplingPy:
+    cdef MultirateSampling *samplingcpp
+
+    def __cinit__(self, double dt=1.):
+        self.samplingcpp = new MultirateSampling(dt)
+
+    def __dealloc__(self):
+        del self.samplingcpp
+
+    def __len__(self):
+        return self.samplingcpp.getSize()
+
+    def add_segment(self, int stride, int steps):
+        self.samplingcpp.addSegment(stride, steps)
+
+    @property
+    def size(self):
+        return self.samplingcpp.getSize()
+
+    @property
+    def segment_number(self):
+        return self.samplingcpp.getSegmentNumber()
+
+    @property
+    def offsets(self):
+        # segment k holds the samples offsets[k]:offsets[k + 1]
+        return np.array([self.samplingcpp.getOffset(k) for k in range(self.samplingcpp.getSegmentNumber() + 1)], dtype=np.int64)
+
+    @property
+    def strides(self):
+        return np.array([self.samplingcpp.getStride(k) for k in range(self.samplingcpp.getSegmentNumber())], dtype=np.int64)
+
+    @property
+    def segment_dt(self):
+        return self.strides*self.dt
+
+    @property
+    def steps(self):
+        cdef np.ndarray[ndim=1, dtype=np.int32_t, mode='c'] steps = np.zeros(max(self.size, 1), dtype=np.int32)
+        self.samplingcpp.getSteps(<int *>&steps[0])
+        return steps[:self.size]
+
+    @property
+    def time(self):
+        cdef np.ndarray[ndim=1, dtype=np.float64_t, mode='c'] t = np.zeros(max(self.size, 1), dtype=np.float64)
+        self.samplingcpp.getTimes(&t[0])
+        return t[:self.size]
+
+    @property
+    def dt(self):
+        return self.samplingcpp.getTimeSpacing()
+
+    @property
+    def uniform_size(self):
+        return self.samplingcpp.getUniformSize()
+
+    @property
+    def duration(self):
+        return self.samplingcpp.getDuration()
+
+    def resample(self, samples):
+        # the samples interpolated to the uniform grid of time step dt. Complex
+        # samples are resampled by their real and imaginary parts
+        if np.iscomplexobj(samples):
+            return self.resample(np.real(samples)) + 1.j*self.resample(np.imag(samples))
+        cdef double[::1] samples_view = np.ascontiguousarray(samples, dtype=np.float64)
+        assert samples_view.shape[0] == self.size, "Expected {} samples, got {}".format(self.size, samples_view.shape[0])
+        cdef np.ndarray[ndim=1, dtype=np.float64_t, mode='c'] uniform = np.zeros(max(self.uniform_size, 1), dtype=np.float64)
+        if self.size > 0:
+            self.samplingcpp.resample(&uniform[0], &samples_view[0])
+        return uniform[:self.uniform_size]
+
 cdef class InspiralGeneratorPy:
     cdef InspiralGenerator *inspiralcpp
 
-    def __cinit__(self, TrajectoryDataPy traj, int num_threads=0):
+    def __cinit__(self, TrajectoryDataPy traj, int num_threads=0, int engine=INSPIRAL_SPLINE_ENGINE, double engine_tolerance=1.e-13):
         self.inspiralcpp = new InspiralGenerator(dereference(traj.trajcpp), num_threads)
+        self.inspiralcpp.setEngine(engine, engine_tolerance)
+
+    @property
+    def engine(self):
+        return self.inspiralcpp.getEngine()
+
+    def set_engine(self, int engine, double engine_tolerance=1.e-13):
+        self.inspiralcpp.setEngine(engine, engine_tolerance)
+
+    def set_inspiral_cache_bytes(self, size_t cache_bytes):
+        self.inspiralcpp.setInspiralCacheBytes(cache_bytes)
+
+    @property
+    def inspiral_cache_info(self):
+        return inspiral_cache_info(self.inspiralcpp)
+
+    def clear_inspiral_cache(self):
+        self.inspiralcpp.clearInspiralCache()
 
     def __dealloc__(self):
         del self.inspiralcpp
         
-    def __call__(self, double massratio, double a, double r0, double dt, double T, int num_threads=0):
+    def __call__(self, double massratio, double a, double r0, double dt, double T, int num_threads=0, double phase_tolerance=0.):
         cdef double chi = 0.
         cdef double omega_i = 0.
         cdef double alpha_i = 0.
@@ -217,7 +440,7 @@ cdef class InspiralGeneratorPy:
         cdef int step_number = self.inspiralcpp.computeTimeStepNumber(dt, T)
         cdef InspiralContainerWrapper inspiral = InspiralContainerWrapper(step_number)
         inspiral.set_initial_conditions(a, massratio, r0, dt)
-        self.inspiralcpp.computeInspiral(dereference(inspiral.inspiralcpp), chi, omega_i, alpha_i, t_i, massratio, dt, num_threads)
+        self.inspiralcpp.computeInspiral(dereference(inspiral.inspiralcpp), chi, omega_i, alpha_i, t_i, massratio, dt, num_threads, phase_tolerance)
         # current design just copies since inspiral may be deleted after the function call. 
         # Not really efficient, but something more efficient requires initializing InspiralWrapper with pointers
         # to the memory types or numpy arrays that will live on
@@ -227,14 +450,115 @@ cdef class InspiralGeneratorPy:
         # return (t, r, phase)
         return inspiral
 
+    def segments(self, double massratio, double a, double r0, double dt, double T, int segment_steps, int num_threads=0):
+        # iterates over the inspiral in segments of segment_steps steps, each
+        # with its first step number in start
+        cdef InspiralSegmentsWrapper segments = InspiralSegmentsWrapper()
+        segments.segmentscpp = new InspiralSegments(self.inspiralcpp.computeInspiralSegments(a, massratio, r0, dt, T, segment_steps, num_threads))
+        return segments
+
+    def multirate(self, double massratio, double a, double r0, double dt, double dt_max, double T, double omega_factor=2., double samples_per_cycle=8., int num_threads=0):
+        # the inspiral at the samples of a multirate sampling that resolves
+        # omega_factor times the orbital frequency, and the sampling, which holds
+        # the times of the samples
+        cdef MultirateSamplingPy sampling = MultirateSamplingPy()
+        sampling.samplingcpp[0] = self.inspiralcpp.computeMultirateSampling(a, massratio, r0, dt, dt_max, T, omega_factor, samples_per_cycle)
+        cdef InspiralContainerWrapper inspiral = InspiralContainerWrapper(0)
+        inspiral.inspiralcpp[0] = self.inspiralcpp.computeInspiral(a, massratio, r0, dereference(sampling.samplingcpp), num_threads)
+        return inspiral, sampling
+
+    def time_to_merger(self, double massratio, double a, double r0):
+        return self.inspiralcpp.computeTimeToMerger(a, massratio, r0)
+
+    def initial_radius(self, massratio, a, T, int num_threads=0):
+        # the initial radius whose time to merger is T, for floats or for the
+        # elements of the broadcast parameter arrays
+        if not (isinstance(massratio, np.ndarray) or isinstance(a, np.ndarray) or isinstance(T, np.ndarray)):
+            return self.inspiralcpp.computeInitialRadius(a, massratio, T)
+        arrays = np.broadcast_arrays(massratio, a, T)
+        shape = arrays[0].shape
+        params = [np.ascontiguousarray(x, dtype=np.float64).ravel() for x in arrays]
+        cdef double[::1] massratio_view = params[0]
+        cdef double[::1] a_view = params[1]
+        cdef double[::1] T_view = params[2]
+        cdef int n = a_view.shape[0]
+        cdef np.ndarray[ndim=1, dtype=np.float64_t, mode='c'] r0 = np.zeros(n, dtype=np.float64)
+        if n > 0:
+            self.inspiralcpp.computeInitialRadii(&r0[0], &a_view[0], &massratio_view[0], &T_view[0], n, num_threads)
+        return r0.reshape(shape)
+
+    def batch(self, massratio, a, r0, dt, T, int num_threads=0, double phase_tolerance=0., bint packed=False):
+        # one inspiral per element of the broadcast parameter arrays, all computed in a single call.
+        # Returns a list of InspiralContainerWrapper, or with packed=True the arrays
+        # (alpha, phase, offsets) holding inspiral i at offsets[i]:offsets[i + 1]
+        params = [np.ascontiguousarray(x, dtype=np.float64).ravel() for x in np.broadcast_arrays(massratio, a, r0, dt, T)]
+        cdef double[::1] massratio_view = params[0]
+        cdef double[::1] a_view = params[1]
+        cdef double[::1] r0_view = params[2]
+        cdef double[::1] dt_view = params[3]
+        cdef double[::1] T_view = params[4]
+        cdef int n = a_view.shape[0]
+        cdef np.ndarray[ndim=1, dtype=np.int32_t, mode='c'] steps = np.zeros(max(n, 1), dtype=np.int32)
+        if n == 0:
+            return (np.zeros(0), np.zeros(0), np.zeros(1, dtype=np.int64)) if packed else []
+        self.inspiralcpp.computeTimeStepNumbers(<int *>&steps[0], &a_view[0], &massratio_view[0], &r0_view[0], &dt_view[0], &T_view[0], n)
+
+        cdef np.ndarray[ndim=1, dtype=np.int64_t, mode='c'] offsets
+        cdef np.ndarray[ndim=1, dtype=np.float64_t, mode='c'] alpha
+        cdef np.ndarray[ndim=1, dtype=np.float64_t, mode='c'] phase
+        if packed:
+            offsets = np.zeros(n + 1, dtype=np.int64)
+            offsets[1:] = np.cumsum(steps)
+            alpha = np.zeros(max(offsets[n], 1), dtype=np.float64)
+            phase = np.zeros(max(offsets[n], 1), dtype=np.float64)
+            self.inspiralcpp.computeInspirals(&alpha[0], &phase[0], <long *>&offsets[0], &a_view[0], &massratio_view[0], &r0_view[0], &dt_view[0], n, num_threads, phase_tolerance)
+            return (alpha[:offsets[n]], phase[:offsets[n]], offsets)
+
+        cdef vector[double*] alpha_pointers
+        cdef vector[double*] phase_pointers
+        alpha_pointers.resize(n)
+        phase_pointers.resize(n)
+        cdef InspiralContainerWrapper inspiral
+        inspirals = []
+        for i in range(n):
+            inspiral = InspiralContainerWrapper(steps[i])
+            inspiral.set_initial_conditions(a_view[i], massratio_view[i], r0_view[i], dt_view[i])
+            alpha_pointers[i] = inspiral.inspiralcpp.getAlphaNonConstRef().data()
+            phase_pointers[i] = inspiral.inspiralcpp.getPhaseNonConstRef().data()
+            inspirals.append(inspiral)
+        self.inspiralcpp.computeInspirals(alpha_pointers.data(), phase_pointers.data(), <int *>&steps[0], &a_view[0], &massratio_view[0], &r0_view[0], &dt_view[0], n, num_threads, phase_tolerance)
+        return inspirals
+
 import warnings
 
+# queries of TrajectoryDataPy.array_query
+cdef enum TrajectoryQuery:
+    TIME_OF_CHI_ALPHA
+    PHASE_OF_CHI_ALPHA
+    TIME_OF_A_OMEGA
+    PHASE_OF_A_OMEGA
+    FLUX_OF_A_OMEGA
+    FREQUENCY_TIME_DERIVATIVE_OF_A_OMEGA
+    ALPHA_OF_CHI_TIME
+    FREQUENCY_OF_A_TIME
+    FREQUENCY_DERIVATIVE_OF_A_TIME
+    PHASE_OF_A_TIME
+    ISCO_FREQUENCY_OF_A
+    MIN_FREQUENCY_OF_A
+    MAX_FREQUENCY_OF_A
+    MAX_RADIUS_OF_A
+    MAX_TIME_OF_A
+
+cdef bint is_array_query(x, y):
+    return isinstance(x, np.ndarray) or isinstance(y, np.ndarray)
+
 cdef class TrajectoryDataPy:
     cdef TrajectorySpline2D *trajcpp
     cdef bint dealloc_flag
 
-    def __cinit__(self, unicode filename = default_trajectory_file, bint dealloc_flag = True):
-        self.trajcpp = new TrajectorySpline2D(filename.encode())
+    def __cinit__(self, unicode filename = default_trajectory_file, bint dealloc_flag = True, int single_precision = 0):
+        # binary trajectory files are mapped rather than parsed
+        self.trajcpp = new TrajectorySpline2D(filename.encode(), single_precision)
         self.dealloc_flag = dealloc_flag
 
     def __dealloc__(self):
@@ -242,50 +566,123 @@ cdef class TrajectoryDataPy:
             warnings.warn("Deallocating TrajectoryDataPy object", UserWarning)
         del self.trajcpp
 
-    def time_to_merger(self, double a, double omega):
+    # evaluates a query on the points of x and y broadcast against each other
+    # with the array functions of TrajectorySpline2D. Queries of the spin alone ignore y
+    cdef np.ndarray array_query(self, TrajectoryQuery query, x, y = 0.):
+        xb, yb = np.broadcast_arrays(np.asarray(x, dtype=np.float64), np.asarray(y, dtype=np.float64))
+        shape = xb.shape
+        cdef np.ndarray[ndim = 1, dtype=np.float64_t, mode='c'] xv = np.ascontiguousarray(xb).reshape(-1)
+        cdef np.ndarray[ndim = 1, dtype=np.float64_t, mode='c'] yv = np.ascontiguousarray(yb).reshape(-1)
+        cdef np.ndarray[ndim = 1, dtype=np.float64_t, mode='c'] out = np.empty(xv.shape[0], dtype=np.float64)
+        cdef int n = xv.shape[0]
+        if n == 0:
+            return out.reshape(shape)
+        if query == TIME_OF_CHI_ALPHA:
+            self.trajcpp.time(&out[0], &xv[0], &yv[0], n, 0)
+        elif query == PHASE_OF_CHI_ALPHA:
+            self.trajcpp.phase(&out[0], &xv[0], &yv[0], n, 0)
+        elif query == TIME_OF_A_OMEGA:
+            self.trajcpp.time_of_a_omega(&out[0], &xv[0], &yv[0], n, 0)
+        elif query == PHASE_OF_A_OMEGA:
+            self.trajcpp.phase_of_a_omega(&out[0], &xv[0], &yv[0], n, 0)
+        elif query == FLUX_OF_A_OMEGA:
+            self.trajcpp.flux_of_a_omega(&out[0], &xv[0], &yv[0], n, 0)
+        elif query == FREQUENCY_TIME_DERIVATIVE_OF_A_OMEGA:
+            self.trajcpp.orbital_frequency_time_derivative_from_flux_of_a_omega(&out[0], &xv[0], &yv[0], n, 0)
+        elif query == ALPHA_OF_CHI_TIME:
+            self.trajcpp.orbital_alpha(&out[0], &xv[0], &yv[0], n, 0)
+        elif query == FREQUENCY_OF_A_TIME:
+            self.trajcpp.orbital_frequency(&out[0], &xv[0], &yv[0], n, 0)
+        elif query == FREQUENCY_DERIVATIVE_OF_A_TIME:
+            self.trajcpp.orbital_frequency_derivative(&out[0], &xv[0], &yv[0], n, 0)
+        elif query == PHASE_OF_A_TIME:
+            self.trajcpp.phase_of_a_time(&out[0], &xv[0], &yv[0], n, 0)
+        elif query == ISCO_FREQUENCY_OF_A:
+            self.trajcpp.orbital_frequency_isco_of_a(&out[0], &xv[0], n, 0)
+        elif query == MIN_FREQUENCY_OF_A:
+            self.trajcpp.min_orbital_frequency(&out[0], &xv[0], n, 0)
+        elif query == MAX_FREQUENCY_OF_A:
+            self.trajcpp.max_orbital_frequency(&out[0], &xv[0], n, 0)
+        elif query == MAX_RADIUS_OF_A:
+            self.trajcpp.max_orbital_radius(&out[0], &xv[0], n, 0)
+        elif query == MAX_TIME_OF_A:
+            self.trajcpp.max_time_before_merger(&out[0], &xv[0], n, 0)
+        return out.reshape(shape)
+
+    # every query takes floats or NumPy arrays, which are broadcast against each
+    # other and evaluated in C++
+    def time_to_merger(self, a, omega):
+        if is_array_query(a, omega):
+            return -self.array_query(TIME_OF_A_OMEGA, a, omega)
         return -self.trajcpp.time_of_a_omega(a, omega)
 
-    def phase_to_merger(self, double a, double omega):
+    def phase_to_merger(self, a, omega):
+        if is_array_query(a, omega):
+            return -self.array_query(PHASE_OF_A_OMEGA, a, omega)
         return -self.trajcpp.phase_of_a_omega(a, omega)
 
-    def phase_of_chi_alpha(self, double chi, double alpha):
+    def phase_of_chi_alpha(self, chi, alpha):
+        if is_array_query(chi, alpha):
+            return self.array_query(PHASE_OF_CHI_ALPHA, chi, alpha)
         return self.trajcpp.phase(chi, alpha)
 
-    def time_of_chi_alpha(self, double chi, double alpha):
+    def time_of_chi_alpha(self, chi, alpha):
+        if is_array_query(chi, alpha):
+            return self.array_query(TIME_OF_CHI_ALPHA, chi, alpha)
         return self.trajcpp.time(chi, alpha)
 
-    cdef flux_parallel(self, double a, np.ndarray[ndim = 1, dtype=np.float64_t, mode='c'] omega):
-        cdef np.ndarray[ndim = 1, dtype=np.float64_t, mode='c'] flux = np.empty(omega.shape[0], dtype=np.float64)
-        cdef np.ndarray[ndim = 1, dtype=np.float64_t, mode='c'] anp = a*np.ones(omega.shape[0], dtype=np.float64)
-        self.trajcpp.flux_of_a_omega(&flux[0], &anp[0], &omega[0], omega.shape[0], 0)
-        return flux
-
-    def flux(self, double a, omega):
-        if isinstance(omega, np.ndarray):
-            return self.flux_parallel(a, omega)
-        elif type(omega) is float:
-            return self.trajcpp.flux_of_a_omega(a, omega)
-        else:
-            raise TypeError("Frequency must be a float of numpy array")
-
-    def orbital_frequency(self, double a, double t):
+    def flux(self, a, omega):
+        if is_array_query(a, omega):
+            return self.array_query(FLUX_OF_A_OMEGA, a, omega)
+        return self.trajcpp.flux_of_a_omega(a, omega)
+
+    def orbital_frequency_time_derivative(self, a, omega):
+        if is_array_query(a, omega):
+            return self.array_query(FREQUENCY_TIME_DERIVATIVE_OF_A_OMEGA, a, omega)
+        return self.trajcpp.orbital_frequency_time_derivative_from_flux_of_a_omega(a, omega)
+
+    def orbital_frequency(self, a, t):
+        if is_array_query(a, t):
+            return self.array_query(FREQUENCY_OF_A_TIME, a, t)
         return self.trajcpp.orbital_frequency(a, t)
 
-    def orbital_alpha(self, double a, double t):
+    def orbital_frequency_derivative(self, a, t):
+        if is_array_query(a, t):
+            return self.array_query(FREQUENCY_DERIVATIVE_OF_A_TIME, a, t)
+        return self.trajcpp.orbital_frequency_derivative(a, t)
+
+    def orbital_alpha(self, a, t):
+        if is_array_query(a, t):
+            return self.array_query(ALPHA_OF_CHI_TIME, chi_of_spin(np.asarray(a, dtype=np.float64)), t)
         return self.trajcpp.orbital_alpha(chi_of_spin(a), t)
     
-    def phase(self, double a, double t):
+    def phase(self, a, t):
+        if is_array_query(a, t):
+            return -self.array_query(PHASE_OF_A_TIME, a, t)
         return -self.trajcpp.phase_of_a_time(a, t)
 
-    def isco_frequency(self, double a):
+    def isco_frequency(self, a):
+        if isinstance(a, np.ndarray):
+            return self.array_query(ISCO_FREQUENCY_OF_A, a)
         return self.trajcpp.orbital_frequency_isco_of_a(a)
 
-    def min_orbital_frequency(self, double a):
+    def min_orbital_frequency(self, a):
+        if isinstance(a, np.ndarray):
+            return self.array_query(MIN_FREQUENCY_OF_A, a)
         return self.trajcpp.min_orbital_frequency(a)
 
-    def max_orbital_frequency(self, double a):
+    def max_orbital_frequency(self, a):
+        if isinstance(a, np.ndarray):
+            return self.array_query(MAX_FREQUENCY_OF_A, a)
         return self.trajcpp.max_orbital_frequency(a)
 
-    def max_time_before_merger(self, double a):
+    def max_orbital_radius(self, a):
+        if isinstance(a, np.ndarray):
+            return self.array_query(MAX_RADIUS_OF_A, a)
+        return self.trajcpp.max_orbital_radius(a)
+
+    def max_time_before_merger(self, a):
+        if isinstance(a, np.ndarray):
+            return self.array_query(MAX_TIME_OF_A, a)
         return self.trajcpp.max_time_before_merger(a)
     
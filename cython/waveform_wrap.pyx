@@ -25,6 +25,12 @@ cdef extern from "waveform.hpp":
         double getCross(int i)
         int getSize()
 
+    cdef cppclass MultirateWaveformContainer(WaveformContainer):
+        MultirateWaveformContainer(const MultirateSampling &sampling) except +
+        MultirateWaveformContainer(double* plus, double *cross, const MultirateSampling &sampling) except +
+        const MultirateSampling& getSampling()
+        void resample(WaveformContainer &h)
+
     cdef cppclass WaveformHarmonicsContainer:
         WaveformHarmonicsContainer(int modeNum, int timeSteps) except +
         WaveformHarmonicsContainer(double *plus_ptr, double *cross_ptr, int modeNum, int timeSteps) except +
@@ -45,11 +51,15 @@ cdef extern from "waveform.hpp":
     cdef cppclass WaveformHarmonicOptions:
         WaveformHarmonicOptions()
         WaveformHarmonicOptions(double rescale, int num, int pad_output, int include_negative_m)
+        WaveformHarmonicOptions(double rescale, int num, int pad_output, int include_negative_m, double phase_tolerance)
+        WaveformHarmonicOptions(double rescale, int num, int pad_output, int include_negative_m, double phase_tolerance, int segment_steps)
 
         cpp_complex[double] rescale
         int num_threads
         int pad_output
         int include_negative_m
+        double phase_tolerance
+        int segment_steps
 
     cdef cppclass WaveformHarmonicGenerator:
         WaveformHarmonicGenerator(HarmonicAmplitudes &Alm, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts) except +
@@ -89,8 +99,12 @@ cdef extern from "waveform.hpp":
 
         void computeWaveformPhaseAmplitude(WaveformHarmonicsContainer &h, int l[], int m[], int modeNum, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, double dt, double T, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts)
 
+        MultirateSampling computeMultirateSampling(double M, double mu, double a, double r0, double qS, double phiS, double qK, double phiK, double dt, double dt_max, double T, HarmonicOptions hOpts, double samples_per_cycle)
+        void computeWaveform(MultirateWaveformContainer &h, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, HarmonicOptions hOpts, WaveformHarmonicOptions wOpts)
+
         WaveformHarmonicOptions getWaveformHarmonicOptions()
         HarmonicOptions getHarmonicOptions()
+        InspiralGenerator& getInspiralGenerator()
 
 cdef extern from "fourier.hpp":
     cdef cppclass WaveformFourierHarmonicGenerator:
@@ -131,6 +145,8 @@ cdef extern from "fourier.hpp":
         HarmonicModeContainer selectModes(double M, double mu, double a, double r0, double qS, double phiS, double qK, double phiK, double Phi_phi0, double T)
         HarmonicModeContainer selectModes(double M, double mu, double a, double r0, double qS, double phiS, double qK, double phiK, double Phi_phi0, double T, HarmonicOptions opts)
 
+        InspiralGenerator& getInspiralGenerator()
+
         WaveformHarmonicOptions getWaveformHarmonicOptions()
         HarmonicOptions getHarmonicOptions()
 
@@ -290,16 +306,29 @@ cdef class WaveformGeneratorPy:
         
         if "num_threads" in waveform_kwargs.keys():
             wOpts.num_threads = waveform_kwargs["num_threads"]
+        if "phase_tolerance" in waveform_kwargs.keys():
+            wOpts.phase_tolerance = waveform_kwargs["phase_tolerance"]
+        if "segment_steps" in waveform_kwargs.keys():
+            wOpts.segment_steps = waveform_kwargs["segment_steps"]
         if "pad_output" in waveform_kwargs.keys():
             wOpts.pad_output = waveform_kwargs["pad_output"]
         if "include_negative_m" in waveform_kwargs.keys():
             wOpts.include_negative_m = waveform_kwargs["include_negative_m"]
 
         self.hcpp = new WaveformGenerator(dereference(traj.trajcpp), dereference(Alm.harmonicscpp), hOpts, wOpts)
+        if "inspiral_cache_bytes" in waveform_kwargs.keys():
+            self.hcpp.getInspiralGenerator().setInspiralCacheBytes(waveform_kwargs["inspiral_cache_bytes"])
 
     def __dealloc__(self):
         del self.hcpp
 
+    @property
+    def inspiral_cache_info(self):
+        return inspiral_cache_info(&self.hcpp.getInspiralGenerator())
+
+    def clear_inspiral_cache(self):
+        self.hcpp.getInspiralGenerator().clearInspiralCache()
+
     def time_step_number(self, double M, double mu, double a, double r0, double dt, double T):
         return self.hcpp.computeTimeStepNumber(M, mu, a, r0, dt, T)
 
@@ -342,6 +371,10 @@ cdef class WaveformGeneratorPy:
 
         if "num_threads" in kwargs.keys():
             wOpts.num_threads = kwargs["num_threads"]
+        if "phase_tolerance" in kwargs.keys():
+            wOpts.phase_tolerance = kwargs["phase_tolerance"]
+        if "segment_steps" in kwargs.keys():
+            wOpts.segment_steps = kwargs["segment_steps"]
         if "include_negative_m" in kwargs.keys():
             wOpts.include_negative_m = kwargs["include_negative_m"]
 
@@ -382,6 +415,10 @@ cdef class WaveformGeneratorPy:
 
         if "num_threads" in kwargs.keys():
             wOpts.num_threads = kwargs["num_threads"]
+        if "phase_tolerance" in kwargs.keys():
+            wOpts.phase_tolerance = kwargs["phase_tolerance"]
+        if "segment_steps" in kwargs.keys():
+            wOpts.segment_steps = kwargs["segment_steps"]
         if "include_negative_m" in kwargs.keys():
             wOpts.include_negative_m = kwargs["include_negative_m"]
 
@@ -420,6 +457,10 @@ cdef class WaveformGeneratorPy:
 
         if "num_threads" in kwargs.keys():
             wOpts.num_threads = kwargs["num_threads"]
+        if "phase_tolerance" in kwargs.keys():
+            wOpts.phase_tolerance = kwargs["phase_tolerance"]
+        if "segment_steps" in kwargs.keys():
+            wOpts.segment_steps = kwargs["segment_steps"]
         if "include_negative_m" in kwargs.keys():
             wOpts.include_negative_m = kwargs["include_negative_m"]
 
@@ -466,6 +507,10 @@ cdef class WaveformGeneratorPy:
 
         if "num_threads" in kwargs.keys():
             wOpts.num_threads = kwargs["num_threads"]
+        if "phase_tolerance" in kwargs.keys():
+            wOpts.phase_tolerance = kwargs["phase_tolerance"]
+        if "segment_steps" in kwargs.keys():
+            wOpts.segment_steps = kwargs["segment_steps"]
         if "include_negative_m" in kwargs.keys():
             wOpts.include_negative_m = kwargs["include_negative_m"]
 
@@ -495,6 +540,10 @@ cdef class WaveformGeneratorPy:
 
         if "num_threads" in kwargs.keys():
             wOpts.num_threads = kwargs["num_threads"]
+        if "phase_tolerance" in kwargs.keys():
+            wOpts.phase_tolerance = kwargs["phase_tolerance"]
+        if "segment_steps" in kwargs.keys():
+            wOpts.segment_steps = kwargs["segment_steps"]
         if "include_negative_m" in kwargs.keys():
             wOpts.include_negative_m = kwargs["include_negative_m"]
 
@@ -534,6 +583,10 @@ cdef class WaveformGeneratorPy:
 
         if "num_threads" in kwargs.keys():
             wOpts.num_threads = kwargs["num_threads"]
+        if "phase_tolerance" in kwargs.keys():
+            wOpts.phase_tolerance = kwargs["phase_tolerance"]
+        if "segment_steps" in kwargs.keys():
+            wOpts.segment_steps = kwargs["segment_steps"]
         if "include_negative_m" in kwargs.keys():
             wOpts.include_negative_m = kwargs["include_negative_m"]
         # cdef WaveformContainerWrapper h = WaveformContainerWrapper(timeSteps)
@@ -553,6 +606,42 @@ cdef class WaveformGeneratorPy:
 
         return waveform
 
+    def waveform_multirate(self, double M, double mu, double a, double r0, double dist, double qS, double phiS, double qK, double phiK, double Phi_phi0, double dt, double dt_max, double T, double samples_per_cycle = 8., bint return_list = False, **kwargs):
+        # the waveform at the samples of a multirate sampling with time steps
+        # between dt and dt_max seconds, returned with the sampling, whose
+        # resample method interpolates the waveform to the uniform grid
+        cdef WaveformHarmonicOptions wOpts = self.hcpp.getWaveformHarmonicOptions()
+        cdef HarmonicOptions hOpts = self.hcpp.getHarmonicOptions()
+
+        if "eps" in kwargs.keys():
+            hOpts.epsilon = kwargs["eps"]
+        if "max_samples" in kwargs.keys():
+            hOpts.max_samples = kwargs["max_samples"]
+
+        if "num_threads" in kwargs.keys():
+            wOpts.num_threads = kwargs["num_threads"]
+        if "include_negative_m" in kwargs.keys():
+            wOpts.include_negative_m = kwargs["include_negative_m"]
+
+        cdef MultirateSamplingPy sampling = MultirateSamplingPy()
+        sampling.samplingcpp[0] = self.hcpp.computeMultirateSampling(M, mu, a, r0, qS, phiS, qK, phiK, dt, dt_max, T, hOpts, samples_per_cycle)
+        cdef int timeSteps = sampling.size
+
+        cdef np.ndarray[ndim = 1, dtype = np.float64_t, mode='c'] plus = np.zeros(max(timeSteps, 1), dtype=np.float64)
+        cdef np.ndarray[ndim = 1, dtype = np.float64_t, mode='c'] cross = np.zeros(max(timeSteps, 1), dtype=np.float64)
+        cdef MultirateWaveformContainer *h = new MultirateWaveformContainer(&plus[0], &cross[0], dereference(sampling.samplingcpp))
+        self.hcpp.computeWaveform(dereference(h), M, mu, a, r0, dist, qS, phiS, qK, phiK, Phi_phi0, hOpts, wOpts)
+        del h
+
+        if return_list:
+            return [plus[:timeSteps], cross[:timeSteps]], sampling
+
+        cdef np.ndarray[ndim = 1, dtype = np.complex128_t, mode='c'] waveform = np.empty(timeSteps, dtype=np.complex128)
+        waveform = -1.j*cross[:timeSteps]
+        waveform += plus[:timeSteps]
+
+        return waveform, sampling
+
     def waveform_harmonics_source_frame(self, int[::1] l, int[::1] m, double M, double mu, double a, double r0, double theta, double phi, double Phi_phi0, double dt, double T, bint pad_output = False, bint return_list=False, **kwargs):
         cdef int timeSteps
         cdef WaveformHarmonicOptions wOpts = self.hcpp.getWaveformHarmonicOptions()
@@ -574,6 +663,10 @@ cdef class WaveformGeneratorPy:
 
         if "num_threads" in kwargs.keys():
             wOpts.num_threads = kwargs["num_threads"]
+        if "phase_tolerance" in kwargs.keys():
+            wOpts.phase_tolerance = kwargs["phase_tolerance"]
+        if "segment_steps" in kwargs.keys():
+            wOpts.segment_steps = kwargs["segment_steps"]
         if "include_negative_m" in kwargs.keys():
             wOpts.include_negative_m = kwargs["include_negative_m"]
 
@@ -612,6 +705,10 @@ cdef class WaveformGeneratorPy:
 
         if "num_threads" in kwargs.keys():
             wOpts.num_threads = kwargs["num_threads"]
+        if "phase_tolerance" in kwargs.keys():
+            wOpts.phase_tolerance = kwargs["phase_tolerance"]
+        if "segment_steps" in kwargs.keys():
+            wOpts.segment_steps = kwargs["segment_steps"]
         if "include_negative_m" in kwargs.keys():
             wOpts.include_negative_m = kwargs["include_negative_m"]
 
@@ -649,10 +746,19 @@ cdef class WaveformFourierGeneratorPy:
             wOpts.include_negative_m = waveform_kwargs["include_negative_m"]
 
         self.hcpp = new WaveformFourierGenerator(dereference(traj.trajcpp), dereference(Alm.harmonicscpp), hOpts, wOpts)
+        if "inspiral_cache_bytes" in waveform_kwargs.keys():
+            self.hcpp.getInspiralGenerator().setInspiralCacheBytes(waveform_kwargs["inspiral_cache_bytes"])
 
     def __dealloc__(self):
         del self.hcpp
 
+    @property
+    def inspiral_cache_info(self):
+        return inspiral_cache_info(&self.hcpp.getInspiralGenerator())
+
+    def clear_inspiral_cache(self):
+        self.hcpp.getInspiralGenerator().clearInspiralCache()
+
     def step_number(self, double dt, double T):
         return self.hcpp.computeFrequencyStepNumber(dt, T)
 
@@ -20,9 +20,11 @@ if sys.platform.startswith('win32'):
     libraries.append('gomp')
 elif sys.platform.startswith('darwin'):
     compiler_flags.append('-O2')
+    compiler_flags.append('-fno-math-errno')
     libraries.append('omp')
 elif sys.platform.startswith('linux'):
     compiler_flags.append('-O2')
+    compiler_flags.append('-fno-math-errno')
     libraries.append('gomp')
     
 